@@ -0,0 +1,415 @@
+#include <loader/asset_cache.h>
+
+#if !defined(__EMSCRIPTEN__)
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    **
+    */
+    CAssetCache::CAssetCache(
+        std::string const& directory,
+        uint64_t iMaxSize) :
+        mDirectory(directory),
+        miMaxSize(iMaxSize)
+    {
+        if(mDirectory.length() > 0 && mDirectory.back() != '/' && mDirectory.back() != '\\')
+        {
+            mDirectory += "/";
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(mDirectory + "urls", error);
+        std::filesystem::create_directories(mDirectory + "objects", error);
+        if(error)
+        {
+            DEBUG_PRINTF("%s : %d can\'t create cache directory \"%s\": %s\n",
+                __FILE__,
+                __LINE__,
+                mDirectory.c_str(),
+                error.message().c_str());
+        }
+
+        evict();
+    }
+
+    /*
+    **
+    */
+    uint64_t CAssetCache::hash(
+        void const* pData,
+        uint64_t iSize,
+        uint64_t iHash)
+    {
+        uint8_t const* pcData = (uint8_t const*)pData;
+        for(uint64_t i = 0; i < iSize; i++)
+        {
+            iHash ^= (uint64_t)pcData[i];
+            iHash *= 0x100000001b3ull;
+        }
+
+        return iHash;
+    }
+
+    /*
+    **
+    */
+    uint64_t CAssetCache::checkHash(
+        void const* pData,
+        uint64_t iSize,
+        uint64_t iHash)
+    {
+        uint8_t const* pcData = (uint8_t const*)pData;
+        for(uint64_t i = 0; i < iSize; i++)
+        {
+            iHash = (iHash ^ (uint64_t)pcData[i]) * 0xff51afd7ed558ccdull;
+            iHash ^= (iHash >> 32);
+        }
+
+        return iHash;
+    }
+
+    /*
+    **
+    */
+    std::string CAssetCache::getMetaFilePath(std::string const& url) const
+    {
+        char szHash[32];
+        snprintf(szHash, sizeof(szHash), "%016llx", (unsigned long long)hash(url.data(), url.length()));
+
+        return mDirectory + "urls/" + szHash + ".meta";
+    }
+
+    /*
+    **
+    */
+    std::string CAssetCache::getObjectFilePath(Entry const& entry) const
+    {
+        char szHash[48];
+        snprintf(szHash, sizeof(szHash), "%016llx-%016llx", (unsigned long long)entry.miContentHash, (unsigned long long)entry.miCheckHash);
+
+        return mDirectory + "objects/" + szHash + ".bin";
+    }
+
+    /*
+    ** meta file is "url\netag\nlast-modified\ncontent hash\ncheck hash\nsize\n"
+    */
+    bool CAssetCache::lookup(
+        Entry& entry,
+        std::string const& url)
+    {
+        FILE* fp = fopen(getMetaFilePath(url).c_str(), "rb");
+        if(fp == nullptr)
+        {
+            return false;
+        }
+
+        std::string aLines[6];
+        char szLine[1024];
+        uint32_t iNumLines = 0;
+        while(iNumLines < 6 && fgets(szLine, sizeof(szLine), fp))
+        {
+            aLines[iNumLines] = szLine;
+            if(aLines[iNumLines].length() > 0 && aLines[iNumLines].back() == '\n')
+            {
+                aLines[iNumLines].pop_back();
+            }
+            ++iNumLines;
+        }
+        fclose(fp);
+
+        // url hash collision, truncated file or one from before the check hash
+        if(iNumLines < 6 || aLines[0] != url)
+        {
+            return false;
+        }
+
+        entry.mETag = aLines[1];
+        entry.mLastModified = aLines[2];
+        entry.miContentHash = strtoull(aLines[3].c_str(), nullptr, 16);
+        entry.miCheckHash = strtoull(aLines[4].c_str(), nullptr, 16);
+        entry.miSize = strtoull(aLines[5].c_str(), nullptr, 10);
+
+        // body got evicted or replaced underneath us
+        std::error_code error;
+        uint64_t iFileSize = (uint64_t)std::filesystem::file_size(getObjectFilePath(entry), error);
+        if(error || iFileSize != entry.miSize)
+        {
+            return false;
+        }
+
+        return entry.mETag.length() > 0 || entry.mLastModified.length() > 0;
+    }
+
+    /*
+    **
+    */
+    void CAssetCache::remove(std::string const& url)
+    {
+        std::error_code error;
+        std::filesystem::remove(getMetaFilePath(url), error);
+    }
+
+    /*
+    **
+    */
+    bool CAssetCache::load(
+        FileView& view,
+        Entry const& entry)
+    {
+        std::string objectFilePath = getObjectFilePath(entry);
+
+        std::shared_ptr<CMappedFile> pMappedFile = std::make_shared<CMappedFile>();
+        if(!pMappedFile->open(objectFilePath) || pMappedFile->getSize() != entry.miSize)
+        {
+            view = FileView();
+            return false;
+        }
+
+        view.maData = std::span<char const>(pMappedFile->getData(), (size_t)pMappedFile->getSize());
+        view.mpBacking = pMappedFile;
+
+        std::error_code error;
+        std::filesystem::last_write_time(objectFilePath, std::filesystem::file_time_type::clock::now(), error);
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    bool CAssetCache::writeMeta(
+        Entry const& entry,
+        std::string const& url)
+    {
+        std::string metaFilePath = getMetaFilePath(url);
+        std::string tempFilePath = metaFilePath + ".tmp";
+        FILE* fp = fopen(tempFilePath.c_str(), "wb");
+        if(fp == nullptr)
+        {
+            return false;
+        }
+
+        fprintf(fp, "%s\n%s\n%s\n%016llx\n%016llx\n%llu\n",
+            url.c_str(),
+            entry.mETag.c_str(),
+            entry.mLastModified.c_str(),
+            (unsigned long long)entry.miContentHash,
+            (unsigned long long)entry.miCheckHash,
+            (unsigned long long)entry.miSize);
+        fclose(fp);
+
+        // readers only ever see a complete meta file
+        std::error_code error;
+        std::filesystem::rename(tempFilePath, metaFilePath, error);
+
+        return !error;
+    }
+
+    /*
+    **
+    */
+    bool CAssetCache::store(
+        Entry& entry,
+        std::string const& url,
+        std::span<char const> aData)
+    {
+        std::string tempFilePath;
+        FILE* fp = beginStore(tempFilePath);
+        if(fp == nullptr)
+        {
+            return false;
+        }
+
+        fwrite(aData.data(), sizeof(char), aData.size(), fp);
+        entry.miContentHash = hash(aData.data(), aData.size());
+        entry.miCheckHash = checkHash(aData.data(), aData.size());
+        entry.miSize = aData.size();
+
+        return commitStore(entry, url, fp, tempFilePath);
+    }
+
+    /*
+    **
+    */
+    FILE* CAssetCache::beginStore(std::string& tempFilePath)
+    {
+        uint32_t iTempFileIndex = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            iTempFileIndex = miTempFileIndex++;
+        }
+
+        std::ostringstream oss;
+        oss << mDirectory << "objects/incoming-" << (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count() << "-" << iTempFileIndex << ".tmp";
+        tempFilePath = oss.str();
+
+        return fopen(tempFilePath.c_str(), "wb");
+    }
+
+    /*
+    ** entry.miContentHash, miCheckHash and miSize are expected to be filled in
+    */
+    bool CAssetCache::commitStore(
+        Entry& entry,
+        std::string const& url,
+        FILE* fp,
+        std::string const& tempFilePath)
+    {
+        bool bWriteError = (ferror(fp) != 0);
+        fclose(fp);
+
+        // nothing to revalidate with, the object would never be found again
+        std::error_code error;
+        if(entry.mETag.length() == 0 && entry.mLastModified.length() == 0)
+        {
+            std::filesystem::remove(tempFilePath, error);
+            return false;
+        }
+
+        if(bWriteError || entry.miSize != (uint64_t)std::filesystem::file_size(tempFilePath, error) || error)
+        {
+            std::filesystem::remove(tempFilePath, error);
+            return false;
+        }
+
+        // same content under another url is already on disk when both hashes and the size match, keep the existing object
+        std::string objectFilePath = getObjectFilePath(entry);
+        uint64_t iObjectSize = (uint64_t)std::filesystem::file_size(objectFilePath, error);
+        if(!error && iObjectSize == entry.miSize)
+        {
+            std::filesystem::remove(tempFilePath, error);
+        }
+        else
+        {
+            std::filesystem::rename(tempFilePath, objectFilePath, error);
+            if(error)
+            {
+                std::filesystem::remove(tempFilePath, error);
+                return false;
+            }
+
+            miTotalSize += entry.miSize;
+        }
+
+        bool bWritten = writeMeta(entry, url);
+        if(miMaxSize > 0 && miTotalSize > miMaxSize)
+        {
+            evict();
+        }
+
+        return bWritten;
+    }
+
+    /*
+    ** re-counts the objects, the running total drifts when threads store the same body or other processes share the directory
+    **    the newest object is always kept so a single body over the limit is still served from disk
+    **    meta files of evicted objects stay behind, lookup sees the object is gone and revalidates without validators
+    */
+    void CAssetCache::evict()
+    {
+        struct Object
+        {
+            std::filesystem::path                   mPath;
+            std::filesystem::file_time_type         mLastWriteTime;
+            uint64_t                                miSize = 0;
+        };
+
+        std::lock_guard<std::mutex> lock(mEvictMutex);
+
+        std::vector<Object> aObjects;
+        uint64_t iTotalSize = 0;
+        std::error_code error;
+        for(std::filesystem::directory_iterator it(mDirectory + "objects", error), end; !error && it != end; it.increment(error))
+        {
+            if(it->path().extension() != ".bin" || !it->is_regular_file(error))
+            {
+                continue;
+            }
+
+            Object object;
+            object.mPath = it->path();
+            object.miSize = (uint64_t)it->file_size(error);
+            object.mLastWriteTime = it->last_write_time(error);
+            if(!error)
+            {
+                iTotalSize += object.miSize;
+                aObjects.push_back(object);
+            }
+            error.clear();
+        }
+
+        if(miMaxSize > 0 && iTotalSize > miMaxSize)
+        {
+            std::sort(
+                aObjects.begin(),
+                aObjects.end(),
+                [](Object const& a, Object const& b)
+                {
+                    return a.mLastWriteTime < b.mLastWriteTime;
+                });
+
+            uint32_t iNumEvicted = 0;
+            for(uint32_t i = 0; i + 1 < (uint32_t)aObjects.size() && iTotalSize > miMaxSize; i++)
+            {
+                // mapped objects stay readable on posix, on windows the remove fails and the object is retried next time
+                if(std::filesystem::remove(aObjects[i].mPath, error))
+                {
+                    iTotalSize -= aObjects[i].miSize;
+                    ++iNumEvicted;
+                }
+            }
+
+            DEBUG_PRINTF("evicted %d cached downloads, %lld bytes left in \"%s\"\n",
+                iNumEvicted,
+                (long long)iTotalSize,
+                mDirectory.c_str());
+        }
+
+        miTotalSize = iTotalSize;
+    }
+
+    /*
+    **
+    */
+    void CAssetCache::recordHit(uint64_t iSize)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.miNumHits += 1;
+        mStats.miNumBytesSaved += iSize;
+    }
+
+    /*
+    **
+    */
+    void CAssetCache::recordMiss(uint64_t iSize)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.miNumMisses += 1;
+        mStats.miNumBytesDownloaded += iSize;
+    }
+
+    /*
+    **
+    */
+    CacheStats CAssetCache::getStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+}   // Loader
+
+#endif // !__EMSCRIPTEN__
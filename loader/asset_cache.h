@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <span>
+#include <string>
+
+#include <loader/asset_source.h>
+
+namespace Loader
+{
+    // objects past this are evicted least recently used first
+    constexpr uint64_t kiDefaultAssetCacheSize = 2ull * 1024ull * 1024ull * 1024ull;
+
+    /*
+    ** running totals, bytes saved counts the bodies served from disk after a 304
+    */
+    struct CacheStats
+    {
+        uint64_t                        miNumHits = 0;
+        uint64_t                        miNumMisses = 0;
+        uint64_t                        miNumBytesSaved = 0;
+        uint64_t                        miNumBytesDownloaded = 0;
+    };
+
+    /*
+    ** on-disk http cache, "<dir>/urls/<url hash>.meta" holds the validators and points at "<dir>/objects/<content hash>-<check hash>.bin"
+    **    urls with the same body share its object, hits touch it so once the directory is over the size limit the least recently used go first
+    */
+    class CAssetCache
+    {
+    public:
+        struct Entry
+        {
+            std::string                 mETag;
+            std::string                 mLastModified;
+            uint64_t                    miContentHash = 0;
+            uint64_t                    miCheckHash = 0;
+            uint64_t                    miSize = 0;
+        };
+
+        CAssetCache(
+            std::string const& directory,
+            uint64_t iMaxSize = kiDefaultAssetCacheSize);
+        virtual ~CAssetCache() = default;
+
+        bool lookup(
+            Entry& entry,
+            std::string const& url);
+
+        // forgets the url, its object is left for other urls with the same content
+        void remove(std::string const& url);
+
+        // memory-mapped view of the cached body
+        bool load(
+            FileView& view,
+            Entry const& entry);
+
+        bool store(
+            Entry& entry,
+            std::string const& url,
+            std::span<char const> aData);
+
+        // streamed bodies are written to a temp file as they arrive and moved into place by commit, both hashes and the size filled in
+        FILE* beginStore(std::string& tempFilePath);
+        bool commitStore(
+            Entry& entry,
+            std::string const& url,
+            FILE* fp,
+            std::string const& tempFilePath);
+
+        void recordHit(uint64_t iSize);
+        void recordMiss(uint64_t iSize);
+        CacheStats getStats();
+
+        // 64 bit FNV-1a, pass the previous result as iHash to continue over the next chunk
+        static uint64_t hash(
+            void const* pData,
+            uint64_t iSize,
+            uint64_t iHash = 0xcbf29ce484222325ull);
+
+        // not FNV, a body has to match both to be taken for another with the same size
+        static uint64_t checkHash(
+            void const* pData,
+            uint64_t iSize,
+            uint64_t iHash = 0x9e3779b97f4a7c15ull);
+
+    protected:
+        std::string getMetaFilePath(std::string const& url) const;
+        std::string getObjectFilePath(Entry const& entry) const;
+        void evict();
+
+        bool writeMeta(
+            Entry const& entry,
+            std::string const& url);
+
+    protected:
+        std::string                     mDirectory;
+
+        std::mutex                      mMutex;
+        CacheStats                      mStats;
+        uint32_t                        miTempFileIndex = 0;
+
+        uint64_t                        miMaxSize = kiDefaultAssetCacheSize;
+        std::atomic<uint64_t>           miTotalSize = 0;
+        std::mutex                      mEvictMutex;
+    };
+
+}   // Loader
@@ -0,0 +1,840 @@
+#include <loader/asset_source.h>
+#include <loader/asset_cache.h>
+
+#if !defined(__EMSCRIPTEN__)
+
+#include <curl/curl.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    **
+    */
+    CMappedFile::~CMappedFile()
+    {
+        close();
+    }
+
+    /*
+    **
+    */
+    bool CMappedFile::open(std::string const& fullPath)
+    {
+        close();
+
+#if defined(_WIN32)
+        HANDLE fileHandle = CreateFileA(
+            fullPath.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+        if(fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize = {};
+        GetFileSizeEx(fileHandle, &fileSize);
+        mpFileHandle = fileHandle;
+        miSize = (uint64_t)fileSize.QuadPart;
+        if(miSize == 0)
+        {
+            // can't map empty file, hand out empty view
+            return true;
+        }
+
+        HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mappingHandle == nullptr)
+        {
+            close();
+            return false;
+        }
+        mpMappingHandle = mappingHandle;
+
+        mpData = (char const*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if(mpData == nullptr)
+        {
+            close();
+            return false;
+        }
+#else
+        miFileDescriptor = ::open(fullPath.c_str(), O_RDONLY);
+        if(miFileDescriptor < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStat = {};
+        if(fstat(miFileDescriptor, &fileStat) != 0)
+        {
+            close();
+            return false;
+        }
+
+        miSize = (uint64_t)fileStat.st_size;
+        if(miSize == 0)
+        {
+            return true;
+        }
+
+        void* pMapping = mmap(nullptr, (size_t)miSize, PROT_READ, MAP_PRIVATE, miFileDescriptor, 0);
+        if(pMapping == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        mpData = (char const*)pMapping;
+
+        // mesh and texture files are read front to back
+        madvise(pMapping, (size_t)miSize, MADV_SEQUENTIAL);
+#endif // _WIN32
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    void CMappedFile::close()
+    {
+#if defined(_WIN32)
+        if(mpData)
+        {
+            UnmapViewOfFile(mpData);
+        }
+        if(mpMappingHandle)
+        {
+            CloseHandle((HANDLE)mpMappingHandle);
+        }
+        if(mpFileHandle)
+        {
+            CloseHandle((HANDLE)mpFileHandle);
+        }
+        mpMappingHandle = nullptr;
+        mpFileHandle = nullptr;
+#else
+        if(mpData)
+        {
+            munmap((void*)mpData, (size_t)miSize);
+        }
+        if(miFileDescriptor >= 0)
+        {
+            ::close(miFileDescriptor);
+        }
+        miFileDescriptor = -1;
+#endif // _WIN32
+
+        mpData = nullptr;
+        miSize = 0;
+    }
+
+    /*
+    ** default for sources that only hand out views, copies into the caller's buffer
+    */
+    bool CAssetSource::load(
+        std::vector<char>& acFileContentBuffer,
+        std::string const& filePath)
+    {
+        FileView view;
+        if(!load(view, filePath))
+        {
+            return false;
+        }
+
+        acFileContentBuffer.resize((size_t)view.size());
+        if(view.size() > 0)
+        {
+            memcpy(acFileContentBuffer.data(), view.data(), (size_t)view.size());
+        }
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    void CAssetSource::loadBatch(
+        std::span<Request> aRequests,
+        uint32_t iMaxConcurrentRequests)
+    {
+        (void)iMaxConcurrentRequests;
+        for(auto& request : aRequests)
+        {
+            request.mbLoaded = load(request.mView, request.mFilePath);
+        }
+    }
+
+    /*
+    **
+    */
+    bool CAssetSource::stream(
+        std::string const& filePath,
+        StreamCallback const& callback)
+    {
+        FileView view;
+        if(!load(view, filePath))
+        {
+            return false;
+        }
+
+        return callback(view.maData, view.size());
+    }
+
+    /*
+    **
+    */
+    static size_t writeToVector(void* ptr, size_t size, size_t nmemb, void* pData)
+    {
+        size_t iTotalSize = size * nmemb;
+        std::vector<char>* pBuffer = (std::vector<char>*)pData;
+        pBuffer->insert(pBuffer->end(), (char const*)ptr, (char const*)ptr + iTotalSize);
+
+        return iTotalSize;
+    }
+
+    /*
+    **
+    */
+    CHttpAssetSource::CHttpAssetSource(std::string const& baseURL) :
+        mBaseURL(baseURL)
+    {
+        if(mBaseURL.length() > 0 && mBaseURL.back() != '/')
+        {
+            mBaseURL += "/";
+        }
+    }
+
+    /*
+    **
+    */
+    CHttpAssetSource::~CHttpAssetSource()
+    {
+        if(mpMultiHandle)
+        {
+            curl_multi_cleanup((CURLM*)mpMultiHandle);
+        }
+        if(mpEasyHandle)
+        {
+            curl_easy_cleanup((CURL*)mpEasyHandle);
+        }
+    }
+
+    /*
+    **
+    */
+    std::string CHttpAssetSource::getFullPath(std::string const& filePath) const
+    {
+        return mBaseURL + filePath;
+    }
+
+    /*
+    ** If-None-Match / If-Modified-Since from the cached entry
+    */
+    static curl_slist* addValidators(
+        CURL* curl,
+        CAssetCache::Entry const& entry)
+    {
+        curl_slist* pHeaders = nullptr;
+        if(entry.mETag.length() > 0)
+        {
+            pHeaders = curl_slist_append(pHeaders, ("If-None-Match: " + entry.mETag).c_str());
+        }
+        if(entry.mLastModified.length() > 0)
+        {
+            pHeaders = curl_slist_append(pHeaders, ("If-Modified-Since: " + entry.mLastModified).c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, pHeaders);
+
+        return pHeaders;
+    }
+
+    /*
+    **
+    */
+    static void readValidators(
+        CAssetCache::Entry& entry,
+        CURL* curl)
+    {
+        curl_header* pHeader = nullptr;
+        if(curl_easy_header(curl, "ETag", 0, CURLH_HEADER, -1, &pHeader) == CURLHE_OK)
+        {
+            entry.mETag = pHeader->value;
+        }
+        if(curl_easy_header(curl, "Last-Modified", 0, CURLH_HEADER, -1, &pHeader) == CURLHE_OK)
+        {
+            entry.mLastModified = pHeader->value;
+        }
+    }
+
+    /*
+    ** shared by single and batched loads, 304 or an unreachable server is served from the cache
+    */
+    static bool finishTransfer(
+        FileView& view,
+        CAssetCache* pCache,
+        CAssetCache::Entry const& cachedEntry,
+        bool bCached,
+        CURL* curl,
+        CURLcode res,
+        std::string const& url,
+        std::shared_ptr<std::vector<char>> const& pBuffer)
+    {
+        long iResponseCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &iResponseCode);
+
+        if(bCached && (iResponseCode == 304 || res != CURLE_OK))
+        {
+            if(pCache->load(view, cachedEntry))
+            {
+                if(res == CURLE_OK)
+                {
+                    pCache->recordHit(cachedEntry.miSize);
+                }
+                else
+                {
+                    DEBUG_PRINTF("%s : %d \"%s\" unreachable (curl %d), using cached copy\n",
+                        __FILE__,
+                        __LINE__,
+                        url.c_str(),
+                        (int32_t)res);
+                }
+                return true;
+            }
+
+            // the body went missing after the lookup, forget the entry and ask for the whole thing again
+            if(iResponseCode == 304)
+            {
+                pCache->remove(url);
+
+                CURL* pRefetch = curl_easy_init();
+                if(pRefetch == nullptr)
+                {
+                    view = FileView();
+                    return false;
+                }
+                pBuffer->clear();
+                curl_easy_setopt(pRefetch, CURLOPT_URL, url.c_str());
+                curl_easy_setopt(pRefetch, CURLOPT_WRITEFUNCTION, writeToVector);
+                curl_easy_setopt(pRefetch, CURLOPT_WRITEDATA, pBuffer.get());
+                CURLcode refetchResult = curl_easy_perform(pRefetch);
+
+                bool bLoaded = finishTransfer(
+                    view,
+                    pCache,
+                    CAssetCache::Entry(),
+                    false,
+                    pRefetch,
+                    refetchResult,
+                    url,
+                    pBuffer);
+                curl_easy_cleanup(pRefetch);
+
+                return bLoaded;
+            }
+        }
+
+        if(res != CURLE_OK || iResponseCode >= 300)
+        {
+            DEBUG_PRINTF("%s : %d can\'t load \"%s\" (curl %d, http %d)\n",
+                __FILE__,
+                __LINE__,
+                url.c_str(),
+                (int32_t)res,
+                (int32_t)iResponseCode);
+            // an error body isn't the asset, the view stays invalid
+            view = FileView();
+            return false;
+        }
+
+        view.maData = std::span<char const>(pBuffer->data(), pBuffer->size());
+        view.mpBacking = pBuffer;
+
+        if(pCache)
+        {
+            CAssetCache::Entry entry;
+            readValidators(entry, curl);
+            pCache->store(entry, url, view.maData);
+            pCache->recordMiss(view.size());
+        }
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    bool CHttpAssetSource::load(
+        std::vector<char>& acFileContentBuffer,
+        std::string const& filePath)
+    {
+        if(mpCache)
+        {
+            return CAssetSource::load(acFileContentBuffer, filePath);
+        }
+
+        std::string url = getFullPath(filePath);
+
+        // easy handle keeps its connection cache, the next load to the same server skips the connect
+        if(mpEasyHandle == nullptr)
+        {
+            mpEasyHandle = curl_easy_init();
+            if(mpEasyHandle == nullptr)
+            {
+                return false;
+            }
+        }
+        CURL* curl = (CURL*)mpEasyHandle;
+        curl_easy_reset(curl);
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeToVector);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &acFileContentBuffer);
+        CURLcode res = curl_easy_perform(curl);
+
+        long iResponseCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &iResponseCode);
+
+        if(res != CURLE_OK || iResponseCode >= 400)
+        {
+            DEBUG_PRINTF("%s : %d can\'t load \"%s\" (curl %d, http %d)\n",
+                __FILE__,
+                __LINE__,
+                url.c_str(),
+                (int32_t)res,
+                (int32_t)iResponseCode);
+            acFileContentBuffer.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+    ** download into a buffer owned by the view, or a mapping of the cached copy if it's still current
+    */
+    bool CHttpAssetSource::load(
+        FileView& view,
+        std::string const& filePath)
+    {
+        std::string url = getFullPath(filePath);
+
+        if(mpEasyHandle == nullptr)
+        {
+            mpEasyHandle = curl_easy_init();
+            if(mpEasyHandle == nullptr)
+            {
+                return false;
+            }
+        }
+        CURL* curl = (CURL*)mpEasyHandle;
+        curl_easy_reset(curl);
+
+        CAssetCache::Entry cachedEntry;
+        bool bCached = (mpCache != nullptr) && mpCache->lookup(cachedEntry, url);
+
+        std::shared_ptr<std::vector<char>> pBuffer = std::make_shared<std::vector<char>>();
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeToVector);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, pBuffer.get());
+        curl_slist* pHeaders = bCached ? addValidators(curl, cachedEntry) : nullptr;
+        CURLcode res = curl_easy_perform(curl);
+        curl_slist_free_all(pHeaders);
+
+        return finishTransfer(
+            view,
+            mpCache.get(),
+            cachedEntry,
+            bCached,
+            curl,
+            res,
+            url,
+            pBuffer);
+    }
+
+    struct StreamState
+    {
+        CURL*                           mpCurl = nullptr;
+        StreamCallback const*           mpCallback = nullptr;
+        bool                            mbAborted = false;
+        uint64_t                        miNumBytes = 0;
+
+        // copy of the body going to the cache
+        FILE*                           mpCacheFile = nullptr;
+        uint64_t                        miContentHash = 0xcbf29ce484222325ull;
+        uint64_t                        miCheckHash = 0x9e3779b97f4a7c15ull;
+    };
+
+    /*
+    **
+    */
+    static size_t writeToCallback(void* ptr, size_t size, size_t nmemb, void* pData)
+    {
+        size_t iTotalSize = size * nmemb;
+        StreamState* pState = (StreamState*)pData;
+
+        // headers are in by the time the body arrives, -1 without Content-Length
+        curl_off_t iContentLength = -1;
+        curl_easy_getinfo(pState->mpCurl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &iContentLength);
+
+        long iResponseCode = 0;
+        curl_easy_getinfo(pState->mpCurl, CURLINFO_RESPONSE_CODE, &iResponseCode);
+        if(iResponseCode >= 300)
+        {
+            // error page or empty 304, not the asset
+            return iTotalSize;
+        }
+
+        std::span<char const> aChunk((char const*)ptr, iTotalSize);
+        if(!(*pState->mpCallback)(aChunk, (iContentLength > 0) ? (uint64_t)iContentLength : 0))
+        {
+            pState->mbAborted = true;
+            return 0;
+        }
+        pState->miNumBytes += iTotalSize;
+
+        if(pState->mpCacheFile)
+        {
+            fwrite(ptr, sizeof(char), iTotalSize, pState->mpCacheFile);
+            pState->miContentHash = CAssetCache::hash(ptr, iTotalSize, pState->miContentHash);
+            pState->miCheckHash = CAssetCache::checkHash(ptr, iTotalSize, pState->miCheckHash);
+        }
+
+        return iTotalSize;
+    }
+
+    /*
+    **
+    */
+    bool CHttpAssetSource::stream(
+        std::string const& filePath,
+        StreamCallback const& callback)
+    {
+        std::string url = getFullPath(filePath);
+
+        if(mpEasyHandle == nullptr)
+        {
+            mpEasyHandle = curl_easy_init();
+            if(mpEasyHandle == nullptr)
+            {
+                return false;
+            }
+        }
+        CURL* curl = (CURL*)mpEasyHandle;
+        curl_easy_reset(curl);
+
+        CAssetCache::Entry cachedEntry;
+        bool bCached = (mpCache != nullptr) && mpCache->lookup(cachedEntry, url);
+
+        StreamState state;
+        state.mpCurl = curl;
+        state.mpCallback = &callback;
+
+        std::string tempCacheFilePath;
+        if(mpCache)
+        {
+            state.mpCacheFile = mpCache->beginStore(tempCacheFilePath);
+        }
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeToCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &state);
+        curl_slist* pHeaders = bCached ? addValidators(curl, cachedEntry) : nullptr;
+        CURLcode res = curl_easy_perform(curl);
+        curl_slist_free_all(pHeaders);
+
+        long iResponseCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &iResponseCode);
+
+        bool bDownloaded = (res == CURLE_OK && iResponseCode < 300);
+        if(state.mpCacheFile)
+        {
+            CAssetCache::Entry entry;
+            entry.miContentHash = state.miContentHash;
+            entry.miCheckHash = state.miCheckHash;
+            entry.miSize = bDownloaded ? state.miNumBytes : UINT64_MAX;
+            readValidators(entry, curl);
+            mpCache->commitStore(entry, url, state.mpCacheFile, tempCacheFilePath);
+            if(bDownloaded)
+            {
+                mpCache->recordMiss(state.miNumBytes);
+            }
+        }
+
+        // not modified, or the server is gone before anything was handed over
+        if(bCached && state.miNumBytes == 0 && !state.mbAborted && (iResponseCode == 304 || res != CURLE_OK))
+        {
+            FileView view;
+            if(mpCache->load(view, cachedEntry))
+            {
+                if(res == CURLE_OK)
+                {
+                    mpCache->recordHit(view.size());
+                }
+                return callback(view.maData, view.size());
+            }
+
+            // same as finishTransfer, the lookup won't find the entry the second time so no validators are sent
+            if(iResponseCode == 304)
+            {
+                mpCache->remove(url);
+                return stream(filePath, callback);
+            }
+        }
+
+        if(!bDownloaded)
+        {
+            DEBUG_PRINTF("%s : %d can\'t stream \"%s\" (curl %d, http %d%s)\n",
+                __FILE__,
+                __LINE__,
+                url.c_str(),
+                (int32_t)res,
+                (int32_t)iResponseCode,
+                state.mbAborted ? ", aborted by receiver" : "");
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+    ** keeps at most iMaxConcurrentRequests transfers in flight, a finished handle is re-armed with the next pending request
+    */
+    void CHttpAssetSource::loadBatch(
+        std::span<Request> aRequests,
+        uint32_t iMaxConcurrentRequests)
+    {
+        if(aRequests.size() == 0)
+        {
+            return;
+        }
+
+        iMaxConcurrentRequests = std::max(iMaxConcurrentRequests, 1u);
+
+        if(mpMultiHandle == nullptr)
+        {
+            mpMultiHandle = curl_multi_init();
+            if(mpMultiHandle == nullptr)
+            {
+                CAssetSource::loadBatch(aRequests, iMaxConcurrentRequests);
+                return;
+            }
+        }
+        CURLM* pMulti = (CURLM*)mpMultiHandle;
+
+        // connection pool lives in the multi handle, limit it so the server sees a fixed number of sockets
+        curl_multi_setopt(pMulti, CURLMOPT_MAX_HOST_CONNECTIONS, (long)iMaxConcurrentRequests);
+        curl_multi_setopt(pMulti, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)iMaxConcurrentRequests);
+        curl_multi_setopt(pMulti, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+        struct Transfer
+        {
+            CURL*                               mpCurl = nullptr;
+            uint32_t                            miRequest = UINT32_MAX;
+            std::shared_ptr<std::vector<char>>  mpBuffer;
+            std::string                         mURL;
+
+            CAssetCache::Entry                  mCachedEntry;
+            bool                                mbCached = false;
+            curl_slist*                         mpHeaders = nullptr;
+        };
+
+        uint32_t iNumTransfers = std::min(iMaxConcurrentRequests, (uint32_t)aRequests.size());
+        std::vector<Transfer> aTransfers(iNumTransfers);
+
+        uint32_t iNextRequest = 0;
+        auto startTransfer = [&](Transfer& transfer)
+        {
+            Request& request = aRequests[iNextRequest];
+            request.mView = FileView();
+            request.mbLoaded = false;
+
+            transfer.miRequest = iNextRequest;
+            transfer.mpBuffer = std::make_shared<std::vector<char>>();
+            transfer.mURL = getFullPath(request.mFilePath);
+
+            curl_easy_reset(transfer.mpCurl);
+            curl_easy_setopt(transfer.mpCurl, CURLOPT_URL, transfer.mURL.c_str());
+            curl_easy_setopt(transfer.mpCurl, CURLOPT_WRITEFUNCTION, writeToVector);
+            curl_easy_setopt(transfer.mpCurl, CURLOPT_WRITEDATA, transfer.mpBuffer.get());
+            curl_easy_setopt(transfer.mpCurl, CURLOPT_PRIVATE, &transfer);
+
+            // wait for an existing connection to multiplex on instead of opening a new one
+            curl_easy_setopt(transfer.mpCurl, CURLOPT_PIPEWAIT, 1L);
+
+            transfer.mCachedEntry = CAssetCache::Entry();
+            transfer.mbCached = (mpCache != nullptr) && mpCache->lookup(transfer.mCachedEntry, transfer.mURL);
+            transfer.mpHeaders = transfer.mbCached ? addValidators(transfer.mpCurl, transfer.mCachedEntry) : nullptr;
+
+            curl_multi_add_handle(pMulti, transfer.mpCurl);
+            ++iNextRequest;
+        };
+
+        for(auto& transfer : aTransfers)
+        {
+            transfer.mpCurl = curl_easy_init();
+            assert(transfer.mpCurl);
+            startTransfer(transfer);
+        }
+
+        int32_t iNumRunning = 0;
+        do
+        {
+            CURLMcode multiResult = curl_multi_perform(pMulti, &iNumRunning);
+            if(multiResult != CURLM_OK)
+            {
+                DEBUG_PRINTF("%s : %d curl multi error %d\n",
+                    __FILE__,
+                    __LINE__,
+                    (int32_t)multiResult);
+                break;
+            }
+
+            int32_t iNumMessages = 0;
+            CURLMsg* pMessage = nullptr;
+            while((pMessage = curl_multi_info_read(pMulti, &iNumMessages)) != nullptr)
+            {
+                if(pMessage->msg != CURLMSG_DONE)
+                {
+                    continue;
+                }
+
+                Transfer* pTransfer = nullptr;
+                curl_easy_getinfo(pMessage->easy_handle, CURLINFO_PRIVATE, &pTransfer);
+                assert(pTransfer);
+
+                Request& request = aRequests[pTransfer->miRequest];
+                request.mbLoaded = finishTransfer(
+                    request.mView,
+                    mpCache.get(),
+                    pTransfer->mCachedEntry,
+                    pTransfer->mbCached,
+                    pTransfer->mpCurl,
+                    pMessage->data.result,
+                    pTransfer->mURL,
+                    pTransfer->mpBuffer);
+
+                curl_multi_remove_handle(pMulti, pTransfer->mpCurl);
+                curl_slist_free_all(pTransfer->mpHeaders);
+                pTransfer->mpHeaders = nullptr;
+                pTransfer->mpBuffer.reset();
+                if(iNextRequest < (uint32_t)aRequests.size())
+                {
+                    startTransfer(*pTransfer);
+                    ++iNumRunning;
+                }
+            }
+
+            if(iNumRunning > 0)
+            {
+                curl_multi_poll(pMulti, nullptr, 0, 1000, nullptr);
+            }
+
+        } while(iNumRunning > 0);
+
+        for(auto& transfer : aTransfers)
+        {
+            if(transfer.mpBuffer)
+            {
+                curl_multi_remove_handle(pMulti, transfer.mpCurl);
+            }
+            curl_slist_free_all(transfer.mpHeaders);
+            curl_easy_cleanup(transfer.mpCurl);
+        }
+    }
+
+    /*
+    **
+    */
+    CMappedFileAssetSource::CMappedFileAssetSource(std::string const& rootDirectory) :
+        mRootDirectory(rootDirectory)
+    {
+        if(mRootDirectory.length() > 0 && mRootDirectory.back() != '/' && mRootDirectory.back() != '\\')
+        {
+            mRootDirectory += "/";
+        }
+    }
+
+    /*
+    **
+    */
+    std::string CMappedFileAssetSource::getFullPath(std::string const& filePath) const
+    {
+        return mRootDirectory + filePath;
+    }
+
+    /*
+    **
+    */
+    bool CMappedFileAssetSource::load(
+        FileView& view,
+        std::string const& filePath)
+    {
+        std::string fullPath = getFullPath(filePath);
+
+        std::shared_ptr<CMappedFile> pMappedFile = std::make_shared<CMappedFile>();
+        if(!pMappedFile->open(fullPath))
+        {
+            DEBUG_PRINTF("%s : %d can\'t map \"%s\"\n",
+                __FILE__,
+                __LINE__,
+                fullPath.c_str());
+
+            view = FileView();
+            return false;
+        }
+
+        view.maData = std::span<char const>(pMappedFile->getData(), (size_t)pMappedFile->getSize());
+        view.mpBacking = pMappedFile;
+
+        return true;
+    }
+
+    /*
+    ** "http://" and "https://" go to the server, "file://" and plain directories are mapped locally
+    */
+    std::unique_ptr<CAssetSource> createAssetSource(std::string const& url)
+    {
+        if(url.rfind("http://", 0) == 0 || url.rfind("https://", 0) == 0)
+        {
+            return std::make_unique<CHttpAssetSource>(url);
+        }
+
+        std::string rootDirectory = url;
+        if(rootDirectory.rfind("file://", 0) == 0)
+        {
+            rootDirectory = rootDirectory.substr(strlen("file://"));
+
+            // "file:///C:/assets" on windows
+            if(rootDirectory.length() > 2 && rootDirectory[0] == '/' && rootDirectory[2] == ':')
+            {
+                rootDirectory = rootDirectory.substr(1);
+            }
+        }
+
+        return std::make_unique<CMappedFileAssetSource>(rootDirectory);
+    }
+
+}   // Loader
+
+#endif // !__EMSCRIPTEN__
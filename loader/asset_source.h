@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Loader
+{
+    class CAssetCache;
+
+    /*
+    ** read-only view into a loaded asset, mpBacking keeps the file mapping or download buffer alive
+    */
+    struct FileView
+    {
+        std::span<char const>           maData;
+        std::shared_ptr<void const>     mpBacking;
+
+        inline char const* data() const { return maData.data(); }
+        inline uint64_t size() const { return (uint64_t)maData.size(); }
+        inline bool valid() const { return mpBacking != nullptr; }
+    };
+
+    /*
+    ** one entry of a batched load, mView and mbLoaded are filled in by the loader
+    */
+    struct Request
+    {
+        std::string                     mFilePath;
+        bool                            mbTextFile = false;
+
+        FileView                        mView;
+        bool                            mbLoaded = false;
+    };
+
+    /*
+    ** receives the file in order, iTotalSize is the Content-Length / file size (0 if unknown), return false to abort
+    */
+    using StreamCallback = std::function<bool(std::span<char const> aChunk, uint64_t iTotalSize)>;
+
+    /*
+    ** read-only memory mapping of a local file
+    */
+    class CMappedFile
+    {
+    public:
+        CMappedFile() = default;
+        virtual ~CMappedFile();
+
+        CMappedFile(CMappedFile const&) = delete;
+        CMappedFile& operator = (CMappedFile const&) = delete;
+
+        bool open(std::string const& fullPath);
+        void close();
+
+        inline char const* getData() const { return mpData; }
+        inline uint64_t getSize() const { return miSize; }
+
+    protected:
+        char const*                     mpData = nullptr;
+        uint64_t                        miSize = 0;
+
+#if defined(_WIN32)
+        void*                           mpFileHandle = nullptr;
+        void*                           mpMappingHandle = nullptr;
+#else
+        int32_t                         miFileDescriptor = -1;
+#endif // _WIN32
+    };
+
+    /*
+    ** where asset bytes come from, selected by url scheme
+    */
+    class CAssetSource
+    {
+    public:
+        CAssetSource() = default;
+        virtual ~CAssetSource() = default;
+
+        virtual bool load(
+            FileView& view,
+            std::string const& filePath) = 0;
+
+        virtual bool load(
+            std::vector<char>& acFileContentBuffer,
+            std::string const& filePath);
+
+        // default loads the requests one after another
+        virtual void loadBatch(
+            std::span<Request> aRequests,
+            uint32_t iMaxConcurrentRequests);
+
+        // default hands the whole view over as one chunk
+        virtual bool stream(
+            std::string const& filePath,
+            StreamCallback const& callback);
+
+        virtual std::string getFullPath(std::string const& filePath) const = 0;
+    };
+
+    /*
+    ** http server, ie. "http://127.0.0.1:8080/"
+    */
+    class CHttpAssetSource : public CAssetSource
+    {
+    public:
+        CHttpAssetSource(std::string const& baseURL);
+        virtual ~CHttpAssetSource();
+
+        virtual bool load(
+            FileView& view,
+            std::string const& filePath) override;
+
+        virtual bool load(
+            std::vector<char>& acFileContentBuffer,
+            std::string const& filePath) override;
+
+        // curl multi transfers sharing one connection pool
+        virtual void loadBatch(
+            std::span<Request> aRequests,
+            uint32_t iMaxConcurrentRequests) override;
+
+        // chunks are handed over as curl receives them, nothing is buffered
+        virtual bool stream(
+            std::string const& filePath,
+            StreamCallback const& callback) override;
+
+        virtual std::string getFullPath(std::string const& filePath) const override;
+
+        // revalidate against the on-disk cache instead of downloading unchanged files again
+        inline void setCache(std::shared_ptr<CAssetCache> const& pCache) { mpCache = pCache; }
+
+    protected:
+        std::string                     mBaseURL;
+        std::shared_ptr<CAssetCache>    mpCache;
+
+        // kept alive between loads so connections to the server are reused
+        void*                           mpEasyHandle = nullptr;
+        void*                           mpMultiHandle = nullptr;
+    };
+
+    /*
+    ** local directory, files are memory-mapped and handed out without copying, ie. "file:///data/assets/"
+    */
+    class CMappedFileAssetSource : public CAssetSource
+    {
+    public:
+        CMappedFileAssetSource(std::string const& rootDirectory);
+        virtual ~CMappedFileAssetSource() = default;
+
+        virtual bool load(
+            FileView& view,
+            std::string const& filePath) override;
+
+        virtual std::string getFullPath(std::string const& filePath) const override;
+
+    protected:
+        std::string                     mRootDirectory;
+    };
+
+    std::unique_ptr<CAssetSource> createAssetSource(std::string const& url);
+
+}   // Loader
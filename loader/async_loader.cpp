@@ -0,0 +1,335 @@
+#include <loader/async_loader.h>
+#include <loader/loader.h>
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/emscripten.h>
+#include <emscripten/fetch.h>
+#endif // __EMSCRIPTEN__
+
+#include <assert.h>
+#include <string.h>
+
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+#if defined(__EMSCRIPTEN__)
+    struct AsyncFetch
+    {
+        Request                         mRequest;
+        LoadCallback                    mCallback;
+    };
+
+    /*
+    **
+    */
+    static void asyncDownloadSucceeded(emscripten_fetch_t* fetch)
+    {
+        AsyncFetch* pAsyncFetch = (AsyncFetch*)fetch->userData;
+
+        std::shared_ptr<std::vector<char>> pBuffer = std::make_shared<std::vector<char>>(fetch->data, fetch->data + fetch->numBytes);
+        if(pAsyncFetch->mRequest.mbTextFile)
+        {
+            pBuffer->push_back(0);
+        }
+        emscripten_fetch_close(fetch);
+
+        Request& request = pAsyncFetch->mRequest;
+        request.mView.maData = std::span<char const>(pBuffer->data(), pBuffer->size());
+        request.mView.mpBacking = pBuffer;
+        request.mbLoaded = true;
+        pAsyncFetch->mCallback(request);
+
+        delete pAsyncFetch;
+    }
+
+    /*
+    **
+    */
+    static void asyncDownloadFailed(emscripten_fetch_t* fetch)
+    {
+        AsyncFetch* pAsyncFetch = (AsyncFetch*)fetch->userData;
+
+        printf("!!! error fetching \"%s\" !!!\n", pAsyncFetch->mRequest.mFilePath.c_str());
+        emscripten_fetch_close(fetch);
+
+        pAsyncFetch->mRequest.mbLoaded = false;
+        pAsyncFetch->mCallback(pAsyncFetch->mRequest);
+
+        delete pAsyncFetch;
+    }
+
+    /*
+    ** the browser schedules the fetches itself, priority is not used
+    */
+    void loadFileAsync(
+        std::string const& filePath,
+        Priority priority,
+        LoadCallback const& callback,
+        bool bTextFile)
+    {
+        AsyncFetch* pAsyncFetch = new AsyncFetch;
+        pAsyncFetch->mRequest.mFilePath = filePath;
+        pAsyncFetch->mRequest.mbTextFile = bTextFile;
+        pAsyncFetch->mCallback = callback;
+
+#if defined(EMBEDDED_FILES)
+        char* acFileContent = nullptr;
+        uint32_t iSize = loadFile(&acFileContent, filePath, bTextFile);
+        std::shared_ptr<std::vector<char>> pBuffer = std::make_shared<std::vector<char>>(acFileContent, acFileContent + iSize);
+        loadFileFree(acFileContent);
+
+        Request& request = pAsyncFetch->mRequest;
+        request.mView.maData = std::span<char const>(pBuffer->data(), pBuffer->size());
+        request.mView.mpBacking = pBuffer;
+        request.mbLoaded = (iSize > 0);
+        pAsyncFetch->mCallback(request);
+
+        delete pAsyncFetch;
+#else
+        std::string url = "http://127.0.0.1:8080/" + filePath;
+
+        emscripten_fetch_attr_t attr;
+        emscripten_fetch_attr_init(&attr);
+        strcpy(attr.requestMethod, "GET");
+        attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+        attr.onsuccess = asyncDownloadSucceeded;
+        attr.onerror = asyncDownloadFailed;
+        attr.userData = pAsyncFetch;
+        emscripten_fetch(&attr, url.c_str());
+#endif // EMBEDDED_FILES
+    }
+
+#else
+
+    /*
+    ** runs at static destruction for the shared pool, callbacks of jobs still queued aren't safe to call by then
+    */
+    CAsyncLoader::~CAsyncLoader()
+    {
+        joinWorkers();
+    }
+
+    /*
+    ** asset sources are created here rather than on the workers so the shared source is set up on the calling thread
+    */
+    void CAsyncLoader::start(uint32_t iNumWorkers)
+    {
+        stop();
+
+        mbStopping = false;
+        for(uint32_t i = 0; i < iNumWorkers; i++)
+        {
+            std::shared_ptr<CAssetSource> pAssetSource = createDefaultAssetSource();
+            maWorkers.emplace_back([this, pAssetSource]()
+            {
+                worker(*pAssetSource);
+            });
+        }
+    }
+
+    /*
+    ** queued jobs that haven't started are finished as not loaded
+    */
+    void CAsyncLoader::stop()
+    {
+        joinWorkers();
+
+        for(auto& aJobQueue : maJobQueues)
+        {
+            for(auto& job : aJobQueue)
+            {
+                if(job.mCallback)
+                {
+                    job.mCallback(job.mRequest);
+                }
+                else
+                {
+                    job.mPromise.set_value(job.mRequest);
+                }
+            }
+            aJobQueue.clear();
+        }
+    }
+
+    /*
+    ** a worker in the middle of a job finishes it first
+    */
+    void CAsyncLoader::joinWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mbStopping = true;
+        }
+        mCondition.notify_all();
+
+        for(auto& worker : maWorkers)
+        {
+            worker.join();
+        }
+        maWorkers.clear();
+    }
+
+    /*
+    **
+    */
+    std::future<Request> CAsyncLoader::load(
+        std::string const& filePath,
+        Priority priority,
+        bool bTextFile)
+    {
+        Job job;
+        job.mRequest.mFilePath = filePath;
+        job.mRequest.mbTextFile = bTextFile;
+        std::future<Request> future = job.mPromise.get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            maJobQueues[(uint32_t)priority].push_back(std::move(job));
+        }
+        mCondition.notify_one();
+
+        return future;
+    }
+
+    /*
+    **
+    */
+    void CAsyncLoader::load(
+        std::string const& filePath,
+        Priority priority,
+        LoadCallback const& callback,
+        bool bTextFile)
+    {
+        Job job;
+        job.mRequest.mFilePath = filePath;
+        job.mRequest.mbTextFile = bTextFile;
+        job.mCallback = callback;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            maJobQueues[(uint32_t)priority].push_back(std::move(job));
+        }
+        mCondition.notify_one();
+    }
+
+    /*
+    ** always takes the oldest job of the most important non-empty queue
+    */
+    void CAsyncLoader::worker(CAssetSource& assetSource)
+    {
+        for(;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]()
+                {
+                    if(mbStopping)
+                    {
+                        return true;
+                    }
+                    for(auto const& aJobQueue : maJobQueues)
+                    {
+                        if(aJobQueue.size() > 0)
+                        {
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+
+                if(mbStopping)
+                {
+                    return;
+                }
+
+                for(auto& aJobQueue : maJobQueues)
+                {
+                    if(aJobQueue.size() > 0)
+                    {
+                        job = std::move(aJobQueue.front());
+                        aJobQueue.pop_front();
+                        break;
+                    }
+                }
+            }
+
+            Request& request = job.mRequest;
+            request.mbLoaded = loadFileView(request.mView, request.mFilePath, assetSource);
+            if(request.mbLoaded && request.mbTextFile)
+            {
+                terminateText(request.mView);
+            }
+
+            if(job.mCallback)
+            {
+                job.mCallback(request);
+            }
+            else
+            {
+                job.mPromise.set_value(request);
+            }
+        }
+    }
+
+    CAsyncLoader gAsyncLoader;
+    uint32_t giNumLoaderThreads = 4;
+    std::once_flag gAsyncLoaderStarted;
+
+    /*
+    **
+    */
+    static CAsyncLoader& getAsyncLoader()
+    {
+        std::call_once(gAsyncLoaderStarted, []()
+        {
+            gAsyncLoader.start(giNumLoaderThreads);
+        });
+
+        return gAsyncLoader;
+    }
+
+    /*
+    **
+    */
+    void setNumLoaderThreads(uint32_t iNumThreads)
+    {
+        giNumLoaderThreads = (iNumThreads > 0) ? iNumThreads : 1;
+    }
+
+    /*
+    ** loads asked for afterwards are queued and never picked up
+    */
+    void shutdownAsyncLoader()
+    {
+        std::call_once(gAsyncLoaderStarted, []() {});
+        gAsyncLoader.stop();
+    }
+
+    /*
+    **
+    */
+    std::future<Request> loadFileAsync(
+        std::string const& filePath,
+        Priority priority,
+        bool bTextFile)
+    {
+        return getAsyncLoader().load(filePath, priority, bTextFile);
+    }
+
+    /*
+    **
+    */
+    void loadFileAsync(
+        std::string const& filePath,
+        Priority priority,
+        LoadCallback const& callback,
+        bool bTextFile)
+    {
+        getAsyncLoader().load(filePath, priority, callback, bTextFile);
+    }
+
+#endif // __EMSCRIPTEN__
+
+}   // Loader
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#if !defined(__EMSCRIPTEN__)
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif // !__EMSCRIPTEN__
+
+#include <loader/asset_source.h>
+
+namespace Loader
+{
+    /*
+    ** lower value is picked first
+    */
+    enum class Priority : uint32_t
+    {
+        Geometry = 0,
+        Texture,
+        Font,
+
+        NumPriorities,
+    };
+
+    using LoadCallback = std::function<void(Request& request)>;
+
+#if defined(__EMSCRIPTEN__)
+    // fetch without blocking, callback runs on the main thread once the download finishes
+    void loadFileAsync(
+        std::string const& filePath,
+        Priority priority,
+        LoadCallback const& callback,
+        bool bTextFile = false);
+#else
+    /*
+    ** worker pool, each worker owns its own asset source so transfers don't serialize on one curl handle
+    */
+    class CAsyncLoader
+    {
+    public:
+        CAsyncLoader() = default;
+        virtual ~CAsyncLoader();
+
+        void start(uint32_t iNumWorkers);
+
+        // joins the workers, jobs that haven't started get their callback or promise as not loaded
+        void stop();
+
+        std::future<Request> load(
+            std::string const& filePath,
+            Priority priority,
+            bool bTextFile);
+
+        void load(
+            std::string const& filePath,
+            Priority priority,
+            LoadCallback const& callback,
+            bool bTextFile);
+
+    protected:
+        struct Job
+        {
+            Request                     mRequest;
+            std::promise<Request>       mPromise;
+            LoadCallback                mCallback;
+        };
+
+        void worker(CAssetSource& assetSource);
+
+        void joinWorkers();
+
+    protected:
+        std::vector<std::thread>        maWorkers;
+
+        std::mutex                      mMutex;
+        std::condition_variable         mCondition;
+        std::deque<Job>                 maJobQueues[(uint32_t)Priority::NumPriorities];
+        bool                            mbStopping = false;
+    };
+
+    // future is ready once the file is in, mbLoaded on the request tells whether it succeeded
+    std::future<Request> loadFileAsync(
+        std::string const& filePath,
+        Priority priority,
+        bool bTextFile = false);
+
+    // callback runs on a loader thread
+    void loadFileAsync(
+        std::string const& filePath,
+        Priority priority,
+        LoadCallback const& callback,
+        bool bTextFile = false);
+
+    void setNumLoaderThreads(uint32_t iNumThreads);
+
+    // before exit, while whatever the callbacks touch is still around, the pool's destructor only joins its threads
+    void shutdownAsyncLoader();
+#endif // __EMSCRIPTEN__
+
+}   // Loader
@@ -0,0 +1,163 @@
+#include <loader/atlas_file.h>
+#include <loader/mesh_file.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    **
+    */
+    AtlasFormatInfo getAtlasFormatInfo(uint32_t iFormat)
+    {
+        switch((AtlasFormat)iFormat)
+        {
+        case AtlasFormat::RGBA8:
+            return {1, 1, 4};
+        case AtlasFormat::BC7:
+        case AtlasFormat::ETC2RGBA8:
+            return {4, 4, 16};
+        default:
+            return {1, 1, 0};
+        }
+    }
+
+    /*
+    **
+    */
+    char const* getAtlasFileSuffix(AtlasFormat format)
+    {
+        switch(format)
+        {
+        case AtlasFormat::BC7:
+            return "-diffuse-atlas-bc7.bin";
+        case AtlasFormat::ETC2RGBA8:
+            return "-diffuse-atlas-etc2.bin";
+        default:
+            return "-diffuse-atlas.bin";
+        }
+    }
+
+    /*
+    **
+    */
+    bool readAtlasFile(
+        AtlasFileHeader& header,
+        std::vector<AtlasTextureInfo>& aTextureInfo,
+        std::vector<AtlasMipLevel>& aMipLevels,
+        char const* pcData,
+        uint64_t iDataSize)
+    {
+        aTextureInfo.clear();
+        aMipLevels.clear();
+
+        if(pcData == nullptr || iDataSize < sizeof(AtlasFileHeader))
+        {
+            DEBUG_PRINTF("%s : %d atlas file is truncated\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        memcpy(&header, pcData, sizeof(header));
+        if(header.miSignature != kiAtlasFileSignature || header.miVersion != kiAtlasFileVersion)
+        {
+            DEBUG_PRINTF("%s : %d not an atlas file or an unknown version\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        AtlasFormatInfo formatInfo = getAtlasFormatInfo(header.miFormat);
+        if(formatInfo.miBlockSize == 0 || header.miPageWidth == 0 || header.miPageHeight == 0 || header.miNumPages == 0 || header.miNumMips == 0 || header.miNumMips > 32)
+        {
+            DEBUG_PRINTF("%s : %d atlas format %d, %d x %d pages or %d mips aren\'t supported\n",
+                __FILE__,
+                __LINE__,
+                header.miFormat,
+                header.miPageWidth,
+                header.miPageHeight,
+                header.miNumMips);
+            return false;
+        }
+
+        uint64_t iNumLevels = (uint64_t)header.miNumPages * header.miNumMips;
+        uint64_t iTableSize = sizeof(AtlasFileHeader) + (uint64_t)header.miNumTextures * sizeof(AtlasTextureInfo) + iNumLevels * sizeof(AtlasMipLevel);
+        if(header.miFileSize != iDataSize || iTableSize > iDataSize)
+        {
+            DEBUG_PRINTF("%s : %d atlas file is %lld bytes, its header says %lld and its tables need %lld\n",
+                __FILE__,
+                __LINE__,
+                (long long)iDataSize,
+                (long long)header.miFileSize,
+                (long long)iTableSize);
+            return false;
+        }
+
+        aTextureInfo.resize(header.miNumTextures);
+        memcpy(aTextureInfo.data(), pcData + sizeof(AtlasFileHeader), aTextureInfo.size() * sizeof(AtlasTextureInfo));
+        aMipLevels.resize(iNumLevels);
+        memcpy(aMipLevels.data(), pcData + sizeof(AtlasFileHeader) + aTextureInfo.size() * sizeof(AtlasTextureInfo), aMipLevels.size() * sizeof(AtlasMipLevel));
+
+        for(uint32_t i = 0; i < (uint32_t)aMipLevels.size(); i++)
+        {
+            AtlasMipLevel const& mipLevel = aMipLevels[i];
+            uint32_t iPage = i / header.miNumMips;
+            uint32_t iLevel = i % header.miNumMips;
+            uint32_t iWidth = std::max(header.miPageWidth >> iLevel, 1u);
+            uint32_t iHeight = std::max(header.miPageHeight >> iLevel, 1u);
+            uint32_t iNumBlocksX = (iWidth + formatInfo.miBlockWidth - 1) / formatInfo.miBlockWidth;
+            uint32_t iNumBlocksY = (iHeight + formatInfo.miBlockHeight - 1) / formatInfo.miBlockHeight;
+            bool bValid = (mipLevel.miPage == iPage && mipLevel.miLevel == iLevel &&
+                           mipLevel.miWidth == iWidth && mipLevel.miHeight == iHeight &&
+                           mipLevel.miBytesPerRow >= iNumBlocksX * formatInfo.miBlockSize &&
+                           mipLevel.miSize == (uint64_t)mipLevel.miBytesPerRow * mipLevel.miNumRows &&
+                           mipLevel.miNumRows >= iNumBlocksY &&
+                           mipLevel.miOffset >= iTableSize && mipLevel.miOffset <= iDataSize &&
+                           mipLevel.miSize <= iDataSize - mipLevel.miOffset);
+            if(!bValid)
+            {
+                DEBUG_PRINTF("%s : %d atlas page %d level %d doesn\'t match the page size or lies outside of the file\n",
+                    __FILE__,
+                    __LINE__,
+                    iPage,
+                    iLevel);
+                return false;
+            }
+
+            if(getMeshFileChecksum(pcData + mipLevel.miOffset, mipLevel.miSize) != mipLevel.miChecksum)
+            {
+                DEBUG_PRINTF("%s : %d atlas page %d level %d checksum mismatch\n",
+                    __FILE__,
+                    __LINE__,
+                    iPage,
+                    iLevel);
+                return false;
+            }
+        }
+
+        for(uint32_t i = 0; i < (uint32_t)aTextureInfo.size(); i++)
+        {
+            AtlasTextureInfo const& textureInfo = aTextureInfo[i];
+            if((uint64_t)textureInfo.maiTextureCoord[0] + textureInfo.miImageWidth > header.miPageWidth ||
+               (uint64_t)textureInfo.maiTextureCoord[1] + textureInfo.miImageHeight > header.miPageHeight ||
+               textureInfo.miNumMips > header.miNumMips ||
+               (textureInfo.miImageWidth > 0 && textureInfo.miPage >= header.miNumPages))
+            {
+                DEBUG_PRINTF("%s : %d atlas texture %d lies outside of its page\n",
+                    __FILE__,
+                    __LINE__,
+                    i);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}   // Loader
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <loader/bundle.h>
+
+namespace Loader
+{
+    /*
+    ** "-diffuse-atlas.bin", the diffuse textures packed and mipmapped by the converter:
+    **    AtlasFileHeader
+    **    AtlasTextureInfo[miNumTextures], indexed by texture id
+    **    AtlasMipLevel[miNumPages * miNumMips], page by page from the largest level down
+    **    pages are the layers of one texture array, all of the same size
+    **    level payloads, each starting at a multiple of kiAtlasFileAlignment
+    **
+    ** textures sit miGutter texels inside blocks aligned to 2 * miGutter, the gutter repeats the texture like the shader wraps
+    ** its coordinates, so the levels where a texel still covers a single block don't bleed into the neighbours
+    */
+    constexpr uint32_t kiAtlasFileSignature = makeFourCC('A', 'T', 'L', 'S');
+    constexpr uint32_t kiAtlasFileVersion = 2;
+    constexpr uint32_t kiAtlasFileAlignment = 256;
+
+    // one file per format, the renderer loads the first one the device can sample
+    enum class AtlasFormat : uint32_t
+    {
+        RGBA8 = 0,
+        BC7,                    // 4x4 blocks of 16 bytes
+        ETC2RGBA8,              // 4x4 blocks of 16 bytes, EAC alpha then ETC2 color
+    };
+
+    struct AtlasFormatInfo
+    {
+        uint32_t                        miBlockWidth;
+        uint32_t                        miBlockHeight;
+        uint32_t                        miBlockSize;            // bytes, 0 for formats this reader doesn't know
+    };
+
+    struct AtlasFileHeader
+    {
+        uint32_t                        miSignature;
+        uint32_t                        miVersion;
+        uint32_t                        miFormat;
+        uint32_t                        miNumTextures;
+        uint32_t                        miPageWidth;
+        uint32_t                        miPageHeight;
+        uint32_t                        miNumPages;
+        uint32_t                        miNumMips;
+        uint64_t                        miFileSize;
+        uint32_t                        miGutter;
+        uint32_t                        miPadding;
+    };
+
+    // same layout as the renderer's TextureAtlasInfo, empty slots for textures that couldn't be loaded have zero size
+    struct AtlasTextureInfo
+    {
+        uint32_t                        maiTextureCoord[2];     // top left texel on the largest level
+        float                           mafUV[2];
+        uint32_t                        miTextureID;
+        uint32_t                        miImageWidth;
+        uint32_t                        miImageHeight;
+        uint32_t                        miNumMips;              // levels that don't bleed, at most the page's
+        uint32_t                        miPage;
+        uint32_t                        miPadding;
+    };
+
+    struct AtlasMipLevel
+    {
+        uint32_t                        miPage;
+        uint32_t                        miLevel;
+        uint32_t                        miWidth;
+        uint32_t                        miHeight;
+        uint32_t                        miBytesPerRow;          // of texels or of blocks
+        uint32_t                        miNumRows;
+        uint32_t                        miChecksum;             // getMeshFileChecksum over the payload
+        uint32_t                        miPadding;
+        uint64_t                        miOffset;               // from the start of the file
+        uint64_t                        miSize;
+    };
+
+    static_assert(sizeof(AtlasFileHeader) == 48, "atlas file header size doesn't match the file layout");
+    static_assert(sizeof(AtlasTextureInfo) == 40, "atlas texture info size doesn't match the file layout");
+    static_assert(sizeof(AtlasMipLevel) == 48, "atlas mip level size doesn't match the file layout");
+
+    AtlasFormatInfo getAtlasFormatInfo(uint32_t iFormat);
+
+    // "-diffuse-atlas.bin" for RGBA8, "-diffuse-atlas-bc7.bin" and "-diffuse-atlas-etc2.bin" for the compressed ones
+    char const* getAtlasFileSuffix(AtlasFormat format);
+
+    // validates the tables and the level checksums against the whole file
+    bool readAtlasFile(
+        AtlasFileHeader& header,
+        std::vector<AtlasTextureInfo>& aTextureInfo,
+        std::vector<AtlasMipLevel>& aMipLevels,
+        char const* pcData,
+        uint64_t iDataSize);
+
+}   // Loader
@@ -0,0 +1,259 @@
+#include <loader/bundle.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <tinyexr/miniz.h>
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    **
+    */
+    bool CBundle::open(FileView const& view)
+    {
+        mView = FileView();
+        mpSections = nullptr;
+        maSectionIndices.clear();
+
+        if(view.size() < sizeof(BundleHeader))
+        {
+            return false;
+        }
+
+        BundleHeader const* pHeader = (BundleHeader const*)view.data();
+        if(pHeader->miSignature != kiBundleSignature || pHeader->miVersion != kiBundleVersion)
+        {
+            DEBUG_PRINTF("%s : %d not a bundle or unsupported version\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        // truncated download or partially written file
+        uint64_t iSectionTableEnd = sizeof(BundleHeader) + (uint64_t)pHeader->miNumSections * sizeof(BundleSection);
+        if(pHeader->miFileSize != view.size() || iSectionTableEnd > pHeader->miDataOffset || pHeader->miDataOffset > view.size())
+        {
+            DEBUG_PRINTF("%s : %d bundle size mismatch, expected %llu bytes, got %llu\n",
+                __FILE__,
+                __LINE__,
+                (unsigned long long)pHeader->miFileSize,
+                (unsigned long long)view.size());
+            return false;
+        }
+
+        BundleSection const* pSections = (BundleSection const*)(view.data() + sizeof(BundleHeader));
+        char const* pcNames = view.data() + iSectionTableEnd;
+        uint64_t iNameTableSize = pHeader->miDataOffset - iSectionTableEnd;
+        for(uint32_t i = 0; i < pHeader->miNumSections; i++)
+        {
+            BundleSection const& section = pSections[i];
+            if((uint64_t)section.miNameOffset + section.miNameLength > iNameTableSize ||
+               section.miOffset < pHeader->miDataOffset ||
+               section.miOffset + section.miSize > view.size())
+            {
+                DEBUG_PRINTF("%s : %d section %d is out of range\n",
+                    __FILE__,
+                    __LINE__,
+                    i);
+                maSectionIndices.clear();
+                return false;
+            }
+
+            maSectionIndices[std::string(pcNames + section.miNameOffset, section.miNameLength)] = i;
+        }
+
+        mView = view;
+        mpSections = pSections;
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    BundleSection const* CBundle::findSection(std::string const& name) const
+    {
+        auto iter = maSectionIndices.find(name);
+        if(iter == maSectionIndices.end())
+        {
+            return nullptr;
+        }
+
+        return &mpSections[iter->second];
+    }
+
+    /*
+    **
+    */
+    bool CBundle::getSection(
+        FileView& view,
+        std::string const& name) const
+    {
+        BundleSection const* pSection = findSection(name);
+        if(pSection == nullptr)
+        {
+            return false;
+        }
+
+        std::span<char const> aStored = mView.maData.subspan((size_t)pSection->miOffset, (size_t)pSection->miSize);
+        if(pSection->miCompression == (uint32_t)SectionCompression::None)
+        {
+            view.maData = aStored;
+            view.mpBacking = mView.mpBacking;
+            return true;
+        }
+        else if(pSection->miCompression == (uint32_t)SectionCompression::Zlib)
+        {
+            std::shared_ptr<std::vector<char>> pBuffer = std::make_shared<std::vector<char>>((size_t)pSection->miUncompressedSize);
+            mz_ulong iUncompressedSize = (mz_ulong)pSection->miUncompressedSize;
+            int32_t iStatus = mz_uncompress(
+                (unsigned char*)pBuffer->data(),
+                &iUncompressedSize,
+                (unsigned char const*)aStored.data(),
+                (mz_ulong)aStored.size());
+            if(iStatus != MZ_OK || iUncompressedSize != pSection->miUncompressedSize)
+            {
+                DEBUG_PRINTF("%s : %d can\'t inflate section \"%s\": %d\n",
+                    __FILE__,
+                    __LINE__,
+                    name.c_str(),
+                    iStatus);
+                return false;
+            }
+
+            view.maData = std::span<char const>(pBuffer->data(), pBuffer->size());
+            view.mpBacking = pBuffer;
+            return true;
+        }
+
+        DEBUG_PRINTF("%s : %d unknown compression %d for section \"%s\"\n",
+            __FILE__,
+            __LINE__,
+            pSection->miCompression,
+            name.c_str());
+
+        return false;
+    }
+
+    /*
+    **
+    */
+    void CBundleWriter::addSection(
+        std::string const& name,
+        SectionType type,
+        std::span<char const> aData,
+        bool bCompress)
+    {
+        PendingSection pendingSection;
+        pendingSection.mName = name;
+        pendingSection.mSection = {};
+        pendingSection.mSection.miType = (uint32_t)type;
+        pendingSection.mSection.miCompression = (uint32_t)SectionCompression::None;
+        pendingSection.mSection.miUncompressedSize = (uint64_t)aData.size();
+
+        if(bCompress && aData.size() > 0)
+        {
+            mz_ulong iCompressedSize = mz_compressBound((mz_ulong)aData.size());
+            pendingSection.macData.resize((size_t)iCompressedSize);
+            int32_t iStatus = mz_compress2(
+                (unsigned char*)pendingSection.macData.data(),
+                &iCompressedSize,
+                (unsigned char const*)aData.data(),
+                (mz_ulong)aData.size(),
+                MZ_BEST_COMPRESSION);
+
+            if(iStatus == MZ_OK && (uint64_t)iCompressedSize <= (uint64_t)aData.size() - aData.size() / 8)
+            {
+                pendingSection.macData.resize((size_t)iCompressedSize);
+                pendingSection.mSection.miCompression = (uint32_t)SectionCompression::Zlib;
+            }
+        }
+
+        if(pendingSection.mSection.miCompression == (uint32_t)SectionCompression::None)
+        {
+            pendingSection.macData.assign(aData.begin(), aData.end());
+        }
+        pendingSection.mSection.miSize = (uint64_t)pendingSection.macData.size();
+
+        maSections.push_back(std::move(pendingSection));
+    }
+
+    /*
+    **
+    */
+    bool CBundleWriter::write(std::string const& fullPath)
+    {
+        auto alignOffset = [](uint64_t iOffset)
+        {
+            return (iOffset + kiBundleAlignment - 1) & ~((uint64_t)kiBundleAlignment - 1);
+        };
+
+        // name table
+        std::vector<char> acNames;
+        std::vector<BundleSection> aSections(maSections.size());
+        for(uint32_t i = 0; i < (uint32_t)maSections.size(); i++)
+        {
+            aSections[i] = maSections[i].mSection;
+            aSections[i].miNameOffset = (uint32_t)acNames.size();
+            aSections[i].miNameLength = (uint32_t)maSections[i].mName.length();
+            acNames.insert(acNames.end(), maSections[i].mName.begin(), maSections[i].mName.end());
+            acNames.push_back(0);
+        }
+
+        // payload offsets
+        BundleHeader header = {};
+        header.miSignature = kiBundleSignature;
+        header.miVersion = kiBundleVersion;
+        header.miNumSections = (uint32_t)aSections.size();
+        header.miAlignment = kiBundleAlignment;
+        header.miDataOffset = alignOffset(sizeof(BundleHeader) + sizeof(BundleSection) * aSections.size() + acNames.size());
+
+        uint64_t iOffset = header.miDataOffset;
+        for(auto& section : aSections)
+        {
+            section.miOffset = iOffset;
+            iOffset = alignOffset(iOffset + section.miSize);
+        }
+        header.miFileSize = (aSections.size() > 0) ? aSections.back().miOffset + aSections.back().miSize : header.miDataOffset;
+
+        FILE* fp = fopen(fullPath.c_str(), "wb");
+        if(fp == nullptr)
+        {
+            DEBUG_PRINTF("%s : %d can\'t open \"%s\" for writing\n",
+                __FILE__,
+                __LINE__,
+                fullPath.c_str());
+            return false;
+        }
+
+        std::vector<char> acPadding(kiBundleAlignment, 0);
+        uint64_t iFilePosition = 0;
+        auto writeAligned = [&](void const* pData, uint64_t iSize, uint64_t iAlignedOffset)
+        {
+            assert(iAlignedOffset >= iFilePosition);
+            fwrite(acPadding.data(), sizeof(char), (size_t)(iAlignedOffset - iFilePosition), fp);
+            fwrite(pData, sizeof(char), (size_t)iSize, fp);
+            iFilePosition = iAlignedOffset + iSize;
+        };
+
+        writeAligned(&header, sizeof(header), 0);
+        writeAligned(aSections.data(), sizeof(BundleSection) * aSections.size(), iFilePosition);
+        writeAligned(acNames.data(), acNames.size(), iFilePosition);
+        for(uint32_t i = 0; i < (uint32_t)aSections.size(); i++)
+        {
+            writeAligned(maSections[i].macData.data(), aSections[i].miSize, aSections[i].miOffset);
+        }
+
+        // pads an empty bundle out to the data offset
+        writeAligned(acPadding.data(), 0, header.miFileSize);
+
+        bool bWriteError = (ferror(fp) != 0);
+        fclose(fp);
+
+        return !bWriteError;
+    }
+
+}   // Loader
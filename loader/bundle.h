@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <loader/asset_source.h>
+
+namespace Loader
+{
+    /*
+    ** "<name>.bundle" layout:
+    **    BundleHeader
+    **    BundleSection[miNumSections]
+    **    section names, null-terminated
+    **    section payloads, each starting at a multiple of miAlignment
+    */
+    constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+    {
+        return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+    }
+
+    constexpr uint32_t kiBundleSignature = makeFourCC('S', 'B', 'N', 'D');
+    constexpr uint32_t kiBundleVersion = 1;
+    constexpr uint32_t kiBundleAlignment = 4096;
+
+    enum class SectionType : uint32_t
+    {
+        Data = makeFourCC('D', 'A', 'T', 'A'),
+        Mesh = makeFourCC('M', 'E', 'S', 'H'),
+        TrianglePositions = makeFourCC('T', 'P', 'O', 'S'),
+        Materials = makeFourCC('M', 'A', 'T', 'L'),
+        MaterialIDs = makeFourCC('M', 'T', 'I', 'D'),
+        TextureNames = makeFourCC('T', 'X', 'N', 'M'),
+        MeshInstances = makeFourCC('I', 'N', 'S', 'T'),
+        Image = makeFourCC('I', 'M', 'A', 'G'),
+        TextureAtlas = makeFourCC('A', 'T', 'L', 'S'),
+    };
+
+    enum class SectionCompression : uint32_t
+    {
+        None = 0,
+        Zlib,
+    };
+
+    struct BundleHeader
+    {
+        uint32_t                        miSignature;
+        uint32_t                        miVersion;
+        uint32_t                        miNumSections;
+        uint32_t                        miAlignment;
+        uint64_t                        miFileSize;
+        uint64_t                        miDataOffset;
+    };
+
+    struct BundleSection
+    {
+        uint32_t                        miType;
+        uint32_t                        miCompression;
+        uint32_t                        miNameOffset;           // from the end of the section table
+        uint32_t                        miNameLength;
+        uint64_t                        miOffset;               // from the start of the file
+        uint64_t                        miSize;                 // stored size
+        uint64_t                        miUncompressedSize;
+    };
+
+    /*
+    ** read side, the whole bundle is one view and uncompressed sections are handed out as sub-views of it
+    */
+    class CBundle
+    {
+    public:
+        CBundle() = default;
+        virtual ~CBundle() = default;
+
+        bool open(FileView const& view);
+
+        // shares the bundle's backing when stored uncompressed, otherwise inflates into a new buffer
+        bool getSection(
+            FileView& view,
+            std::string const& name) const;
+
+        BundleSection const* findSection(std::string const& name) const;
+
+        inline uint32_t getNumSections() const { return (uint32_t)maSectionIndices.size(); }
+
+    protected:
+        FileView                            mView;
+        BundleSection const*                mpSections = nullptr;
+        std::map<std::string, uint32_t>     maSectionIndices;
+    };
+
+    /*
+    ** write side, used by the asset tools
+    */
+    class CBundleWriter
+    {
+    public:
+        CBundleWriter() = default;
+        virtual ~CBundleWriter() = default;
+
+        // bCompress is a hint, the section is stored as is if deflating doesn't shrink it by at least an eighth
+        void addSection(
+            std::string const& name,
+            SectionType type,
+            std::span<char const> aData,
+            bool bCompress);
+
+        bool write(std::string const& fullPath);
+
+    protected:
+        struct PendingSection
+        {
+            std::string                 mName;
+            BundleSection               mSection;
+            std::vector<char>           macData;
+        };
+
+        std::vector<PendingSection>     maSections;
+    };
+
+}   // Loader
@@ -9,22 +9,77 @@
 #endif // __EMSCRIPTEN__
 
 #include <assert.h>
+#include <string.h>
+
+#include <map>
+#include <mutex>
 
 #include <tinyexr/miniz.h>
+#include <utils/LogPrint.h>
 
 namespace Loader
 {
-    // Callback function to write data to file
-    size_t writeData(void* ptr, size_t size, size_t nmemb, void* pData) {
-        size_t iTotalSize = size * nmemb;
-        std::vector<char>* pBuffer = (std::vector<char>*)pData;
-        uint32_t iPrevSize = (uint32_t)pBuffer->size();
-        pBuffer->resize(pBuffer->size() + iTotalSize);
-        char* pBufferEnd = pBuffer->data();
-        pBufferEnd += iPrevSize;
-        memcpy(pBufferEnd, ptr, iTotalSize);
-
-        return iTotalSize;
+    std::vector<std::shared_ptr<CBundle>> gapMountedBundles;
+    std::mutex gBundleMutex;
+
+    /*
+    ** later mounts take precedence
+    */
+    static bool getBundledFile(
+        FileView& view,
+        std::string const& filePath)
+    {
+        std::vector<std::shared_ptr<CBundle>> apBundles;
+        {
+            std::lock_guard<std::mutex> lock(gBundleMutex);
+            apBundles = gapMountedBundles;
+        }
+
+        for(auto iter = apBundles.rbegin(); iter != apBundles.rend(); ++iter)
+        {
+            if((*iter)->getSection(view, filePath))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*
+    **
+    */
+    static bool addBundle(
+        FileView const& view,
+        std::string const& filePath)
+    {
+        std::shared_ptr<CBundle> pBundle = std::make_shared<CBundle>();
+        if(!pBundle->open(view))
+        {
+            DEBUG_PRINTF("%s : %d can't open bundle \"%s\"\n",
+                __FILE__,
+                __LINE__,
+                filePath.c_str());
+            return false;
+        }
+
+        DEBUG_PRINTF("mounted bundle \"%s\" with %d sections\n",
+            filePath.c_str(),
+            pBundle->getNumSections());
+
+        std::lock_guard<std::mutex> lock(gBundleMutex);
+        gapMountedBundles.push_back(pBundle);
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    void unmountBundles()
+    {
+        std::lock_guard<std::mutex> lock(gBundleMutex);
+        gapMountedBundles.clear();
     }
 
 #if defined(__EMSCRIPTEN__)
@@ -64,6 +119,25 @@ namespace Loader
 
         bDoneLoading = true;
     }
+
+    /*
+    ** hands out a malloc'd copy like the loaders below, freed with loadFileFree
+    */
+    static uint32_t copyBundledFile(
+        char** pacFileContentBuffer,
+        FileView const& view,
+        bool bTextFile)
+    {
+        uint32_t iFileSize = (uint32_t)view.size() + (bTextFile ? 1 : 0);
+        gacTempMemory = (char*)malloc(view.size() + 1);
+        memcpy(gacTempMemory, view.data(), view.size());
+        *(gacTempMemory + view.size()) = 0;
+        giTempMemorySize = iFileSize;
+
+        *pacFileContentBuffer = gacTempMemory;
+
+        return iFileSize;
+    }
 #endif // __EMSCRIPTEN__
 
 #if defined(__EMSCRIPTEN__)
@@ -74,6 +148,12 @@ namespace Loader
         std::string const& filePath,
         bool bTextFile)
     {
+        FileView bundledView;
+        if(getBundledFile(bundledView, filePath))
+        {
+            return copyBundledFile(pacFileContentBuffer, bundledView, bTextFile);
+        }
+
         printf("load %s\n", filePath.c_str());
         
         auto fileExtensionStart = filePath.rfind(".") - 1;
@@ -194,6 +274,12 @@ namespace Loader
         std::string const& filePath,
         bool bTextFile)
     {
+        FileView bundledView;
+        if(getBundledFile(bundledView, filePath))
+        {
+            return copyBundledFile(pacFileContentBuffer, bundledView, bTextFile);
+        }
+
         std::string url = "http://127.0.0.1:8080/" + filePath;
 
         emscripten_fetch_attr_t attr;
@@ -233,8 +319,224 @@ namespace Loader
         free(gacTempMemory);
     }
 
+    /*
+    ** embedded builds check for the file first, loadFile asserts on missing files
+    */
+    bool mountBundle(std::string const& filePath)
+    {
+#if defined(EMBEDDED_FILES)
+        FILE* fp = fopen(filePath.c_str(), "rb");
+        if(fp == nullptr)
+        {
+            fp = fopen((std::string("assets/") + filePath).c_str(), "rb");
+        }
+        if(fp == nullptr)
+        {
+            return false;
+        }
+        fclose(fp);
+#endif // EMBEDDED_FILES
+
+        char* acBundle = nullptr;
+        uint32_t iSize = loadFile(&acBundle, filePath);
+        if(iSize == 0 || acBundle == nullptr)
+        {
+            return false;
+        }
+
+        std::shared_ptr<std::vector<char>> pBuffer = std::make_shared<std::vector<char>>(acBundle, acBundle + iSize);
+        loadFileFree(acBundle);
+
+        FileView view;
+        view.maData = std::span<char const>(pBuffer->data(), pBuffer->size());
+        view.mpBacking = pBuffer;
+
+        return addBundle(view, filePath);
+    }
+
 #else 
 
+    std::unique_ptr<CAssetSource> gpAssetSource;
+    std::string gAssetSourceURL;
+    std::shared_ptr<CAssetCache> gpAssetCache;
+    bool gbAssetCacheDirectorySet = false;
+    std::shared_ptr<CDecodedTextureCache> gpTextureCache;
+    bool gbTextureCacheDirectorySet = false;
+    uint32_t giMaxConcurrentRequests = 8;
+
+    std::map<std::string, FileView> gaPrefetchedFiles;
+    std::mutex gPrefetchMutex;
+
+    /*
+    **
+    */
+    static bool getPrefetchedFile(
+        FileView& view,
+        std::string const& filePath)
+    {
+        std::lock_guard<std::mutex> lock(gPrefetchMutex);
+        auto iter = gaPrefetchedFiles.find(filePath);
+        if(iter == gaPrefetchedFiles.end())
+        {
+            return false;
+        }
+
+        view = iter->second;
+        return true;
+    }
+
+    /*
+    **
+    */
+    void setAssetSource(std::string const& url)
+    {
+        gpAssetSource = createAssetSource(url);
+        gAssetSourceURL = url;
+
+        DEBUG_PRINTF("asset source: \"%s\"\n", url.c_str());
+
+        if(gpAssetCache == nullptr && !gbAssetCacheDirectorySet)
+        {
+            char const* szCacheDirectory = getenv("ASSET_CACHE_DIR");
+            setAssetCacheDirectory((szCacheDirectory != nullptr) ? szCacheDirectory : ".asset-cache");
+        }
+
+        CHttpAssetSource* pHttpSource = dynamic_cast<CHttpAssetSource*>(gpAssetSource.get());
+        if(pHttpSource)
+        {
+            pHttpSource->setCache(gpAssetCache);
+        }
+    }
+
+    /*
+    **
+    */
+    void setAssetCacheDirectory(std::string const& directory)
+    {
+        gbAssetCacheDirectorySet = true;
+
+        uint64_t iMaxSize = kiDefaultAssetCacheSize;
+        char const* szMaxSize = getenv("ASSET_CACHE_MAX_MB");
+        if(szMaxSize != nullptr)
+        {
+            iMaxSize = strtoull(szMaxSize, nullptr, 10) * 1024ull * 1024ull;
+        }
+
+        gpAssetCache = (directory.length() > 0) ? std::make_shared<CAssetCache>(directory, iMaxSize) : nullptr;
+
+        CHttpAssetSource* pHttpSource = dynamic_cast<CHttpAssetSource*>(gpAssetSource.get());
+        if(pHttpSource)
+        {
+            pHttpSource->setCache(gpAssetCache);
+        }
+    }
+
+    /*
+    **
+    */
+    std::unique_ptr<CAssetSource> createDefaultAssetSource()
+    {
+        getAssetSource();
+
+        std::unique_ptr<CAssetSource> pAssetSource = createAssetSource(gAssetSourceURL);
+        CHttpAssetSource* pHttpSource = dynamic_cast<CHttpAssetSource*>(pAssetSource.get());
+        if(pHttpSource)
+        {
+            pHttpSource->setCache(gpAssetCache);
+        }
+
+        return pAssetSource;
+    }
+
+    /*
+    **
+    */
+    CacheStats getCacheStats()
+    {
+        return (gpAssetCache != nullptr) ? gpAssetCache->getStats() : CacheStats();
+    }
+
+    /*
+    **
+    */
+    void setTextureCacheDirectory(std::string const& directory)
+    {
+        gbTextureCacheDirectorySet = true;
+
+        uint64_t iMaxSize = kiDefaultDecodedTextureCacheSize;
+        char const* szMaxSize = getenv("TEXTURE_CACHE_MAX_MB");
+        if(szMaxSize != nullptr)
+        {
+            iMaxSize = strtoull(szMaxSize, nullptr, 10) * 1024ull * 1024ull;
+        }
+
+        gpTextureCache = (directory.length() > 0) ? std::make_shared<CDecodedTextureCache>(directory, iMaxSize) : nullptr;
+    }
+
+    /*
+    ** a local source keeps its decoded textures next to the assets, remote ones in the working directory like the asset cache
+    */
+    std::shared_ptr<CDecodedTextureCache> getTextureCache()
+    {
+        if(gpTextureCache == nullptr && !gbTextureCacheDirectorySet)
+        {
+            char const* szCacheDirectory = getenv("TEXTURE_CACHE_DIR");
+            if(szCacheDirectory != nullptr)
+            {
+                setTextureCacheDirectory(szCacheDirectory);
+            }
+            else
+            {
+                CAssetSource& assetSource = getAssetSource();
+                bool bLocalSource = (dynamic_cast<CMappedFileAssetSource*>(&assetSource) != nullptr);
+                setTextureCacheDirectory(bLocalSource ? assetSource.getFullPath("texture-cache") : ".texture-cache");
+            }
+        }
+
+        return gpTextureCache;
+    }
+
+    /*
+    **
+    */
+    CAssetSource& getAssetSource()
+    {
+        if(gpAssetSource == nullptr)
+        {
+            char const* szAssetSource = getenv("ASSET_SOURCE");
+            setAssetSource((szAssetSource != nullptr) ? szAssetSource : "http://127.0.0.1:8080/");
+        }
+
+        return *gpAssetSource;
+    }
+
+    /*
+    ** file paths with their own scheme ("http://...", "file://...") bypass the configured source
+    */
+    static CAssetSource& resolveAssetSource(
+        std::unique_ptr<CAssetSource>& pTempSource,
+        std::string& relativePath,
+        std::string const& filePath)
+    {
+        relativePath = filePath;
+        if(filePath.rfind("http://", 0) == 0 || filePath.rfind("https://", 0) == 0)
+        {
+            getAssetSource();
+            std::unique_ptr<CHttpAssetSource> pHttpSource = std::make_unique<CHttpAssetSource>("");
+            pHttpSource->setCache(gpAssetCache);
+            pTempSource = std::move(pHttpSource);
+            return *pTempSource;
+        }
+        else if(filePath.rfind("file://", 0) == 0)
+        {
+            relativePath = filePath.substr(strlen("file://"));
+            pTempSource = std::make_unique<CMappedFileAssetSource>("");
+            return *pTempSource;
+        }
+
+        return getAssetSource();
+    }
+
     /*
     **
     */
@@ -243,26 +545,195 @@ namespace Loader
         std::string const& filePath,
         bool bTextFile)
     {
-        std::string url = "http://127.0.0.1:8080/" + filePath;
+        FileView prefetchedView;
+        if(getPrefetchedFile(prefetchedView, filePath) || getBundledFile(prefetchedView, filePath))
+        {
+            acFileContentBuffer.assign(prefetchedView.data(), prefetchedView.data() + prefetchedView.size());
+        }
+        else
+        {
+            std::string relativePath;
+            std::unique_ptr<CAssetSource> pTempSource;
+            CAssetSource& assetSource = resolveAssetSource(pTempSource, relativePath, filePath);
+            assetSource.load(acFileContentBuffer, relativePath);
+        }
 
-        CURL* curl;
-        CURLcode res;
+        if(bTextFile)
+        {
+            acFileContentBuffer.push_back(0);
+        }
+    }
+
+    /*
+    **
+    */
+    bool loadFileView(
+        FileView& view,
+        std::string const& filePath)
+    {
+        return loadFileView(view, filePath, getAssetSource());
+    }
 
-        curl = curl_easy_init();
-        if(curl)
+    /*
+    **
+    */
+    bool loadFileView(
+        FileView& view,
+        std::string const& filePath,
+        CAssetSource& defaultAssetSource)
+    {
+        if(getPrefetchedFile(view, filePath))
         {
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeData);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &acFileContentBuffer);
-            res = curl_easy_perform(curl);
+            return view.valid();
+        }
 
-            curl_easy_cleanup(curl);
+        if(getBundledFile(view, filePath))
+        {
+            return true;
         }
 
-        if(bTextFile)
+        std::string relativePath;
+        std::unique_ptr<CAssetSource> pTempSource;
+        CAssetSource& assetSource = resolveAssetSource(pTempSource, relativePath, filePath);
+        if(pTempSource == nullptr)
         {
-            acFileContentBuffer.push_back(0);
+            return defaultAssetSource.load(view, relativePath);
         }
+
+        return assetSource.load(view, relativePath);
+    }
+
+    /*
+    **
+    */
+    void terminateText(FileView& view)
+    {
+        std::shared_ptr<std::vector<char>> pBuffer = std::make_shared<std::vector<char>>(view.data(), view.data() + view.size());
+        pBuffer->push_back(0);
+        view.maData = std::span<char const>(pBuffer->data(), pBuffer->size());
+        view.mpBacking = pBuffer;
+    }
+
+    /*
+    **
+    */
+    bool streamFile(
+        std::string const& filePath,
+        StreamCallback const& callback)
+    {
+        FileView prefetchedView;
+        if(getPrefetchedFile(prefetchedView, filePath) || getBundledFile(prefetchedView, filePath))
+        {
+            return callback(prefetchedView.maData, prefetchedView.size());
+        }
+
+        std::string relativePath;
+        std::unique_ptr<CAssetSource> pTempSource;
+        CAssetSource& assetSource = resolveAssetSource(pTempSource, relativePath, filePath);
+        return assetSource.stream(relativePath, callback);
+    }
+
+    /*
+    **
+    */
+    void setMaxConcurrentRequests(uint32_t iMaxConcurrentRequests)
+    {
+        giMaxConcurrentRequests = (iMaxConcurrentRequests > 0) ? iMaxConcurrentRequests : 1;
+    }
+
+    /*
+    **
+    */
+    void loadFiles(std::span<Request> aRequests)
+    {
+        // paths with their own scheme are loaded on their own, the rest go out as one batch
+        std::vector<Request> aBatchRequests;
+        std::vector<uint32_t> aiBatchIndices;
+        aBatchRequests.reserve(aRequests.size());
+        aiBatchIndices.reserve(aRequests.size());
+        for(uint32_t i = 0; i < (uint32_t)aRequests.size(); i++)
+        {
+            Request& request = aRequests[i];
+            if(getBundledFile(request.mView, request.mFilePath))
+            {
+                request.mbLoaded = true;
+                continue;
+            }
+
+            if(request.mFilePath.find("://") != std::string::npos)
+            {
+                request.mbLoaded = loadFileView(request.mView, request.mFilePath);
+                continue;
+            }
+
+            Request batchRequest;
+            batchRequest.mFilePath = request.mFilePath;
+            aBatchRequests.push_back(batchRequest);
+            aiBatchIndices.push_back(i);
+        }
+
+        getAssetSource().loadBatch(aBatchRequests, giMaxConcurrentRequests);
+        for(uint32_t i = 0; i < (uint32_t)aBatchRequests.size(); i++)
+        {
+            Request& request = aRequests[aiBatchIndices[i]];
+            request.mView = aBatchRequests[i].mView;
+            request.mbLoaded = aBatchRequests[i].mbLoaded;
+        }
+
+        // text files are handed out null-terminated like loadFile
+        for(auto& request : aRequests)
+        {
+            if(request.mbTextFile)
+            {
+                terminateText(request.mView);
+            }
+        }
+    }
+
+    /*
+    **
+    */
+    void prefetchFiles(std::vector<std::string> const& aFilePaths)
+    {
+        std::vector<Request> aRequests(aFilePaths.size());
+        for(uint32_t i = 0; i < (uint32_t)aFilePaths.size(); i++)
+        {
+            aRequests[i].mFilePath = aFilePaths[i];
+        }
+
+        loadFiles(aRequests);
+
+        std::lock_guard<std::mutex> lock(gPrefetchMutex);
+        for(auto& request : aRequests)
+        {
+            if(request.mbLoaded)
+            {
+                gaPrefetchedFiles[request.mFilePath] = request.mView;
+            }
+        }
+    }
+
+    /*
+    **
+    */
+    void clearPrefetchedFiles()
+    {
+        std::lock_guard<std::mutex> lock(gPrefetchMutex);
+        gaPrefetchedFiles.clear();
+    }
+
+    /*
+    ** mapped in place for local sources, a single download otherwise
+    */
+    bool mountBundle(std::string const& filePath)
+    {
+        FileView view;
+        if(!loadFileView(view, filePath))
+        {
+            return false;
+        }
+
+        return addBundle(view, filePath);
     }
 #endif // __EMSCRIPTEN__
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include <string>
 #include <vector>
 
+#include <loader/asset_source.h>
+#include <loader/asset_cache.h>
+#include <loader/texture_cache.h>
+#include <loader/bundle.h>
+
 namespace Loader
 {
 #if defined(__EMSCRIPTEN__)
@@ -16,6 +21,54 @@ namespace Loader
         std::vector<char>& acFileContentBuffer,
         std::string const& filePath,
         bool bTextFile = false);
+
+    // read-only view of the file, zero-copy for local (memory-mapped) sources
+    bool loadFileView(
+        FileView& view,
+        std::string const& filePath);
+
+    // same, through the given source instead of the shared one (loader threads each own one)
+    bool loadFileView(
+        FileView& view,
+        std::string const& filePath,
+        CAssetSource& assetSource);
+
+    // replaces the view with a null-terminated copy, like loadFile with bTextFile
+    void terminateText(FileView& view);
+
+    // file handed to the callback chunk by chunk as it arrives, for uploading without a staging copy
+    bool streamFile(
+        std::string const& filePath,
+        StreamCallback const& callback);
+
+    // all requests in one go, http sources keep up to the concurrency limit in flight over reused connections
+    void loadFiles(std::span<Request> aRequests);
+    void setMaxConcurrentRequests(uint32_t iMaxConcurrentRequests);
+
+    // batch-load ahead of time, loadFile / loadFileView are served from these until cleared
+    void prefetchFiles(std::vector<std::string> const& aFilePaths);
+    void clearPrefetchedFiles();
+
+    // "http://host:port/", "file:///directory/" or a plain directory, defaults to $ASSET_SOURCE or http://127.0.0.1:8080/
+    void setAssetSource(std::string const& url);
+    CAssetSource& getAssetSource();
+
+    // new instance of the configured source, sharing its cache
+    std::unique_ptr<CAssetSource> createDefaultAssetSource();
+
+    // http downloads are kept here and revalidated on the next run, defaults to $ASSET_CACHE_DIR or ".asset-cache", empty disables
+    // capped at $ASSET_CACHE_MAX_MB or 2 GB, 0 for no cap
+    void setAssetCacheDirectory(std::string const& directory);
+    CacheStats getCacheStats();
+
+    // decoded images, defaults to $TEXTURE_CACHE_DIR, "texture-cache" next to the assets for a local source or ".texture-cache", empty disables
+    // capped at $TEXTURE_CACHE_MAX_MB or 2 GB, 0 for no cap
+    void setTextureCacheDirectory(std::string const& directory);
+    std::shared_ptr<CDecodedTextureCache> getTextureCache();
 #endif // __EMSCRIPTEN__
 
+    // sections of a mounted bundle are served in place of the loose files of the same name, false if it can't be loaded
+    bool mountBundle(std::string const& filePath);
+    void unmountBundles();
+
 }   // Loader
\ No newline at end of file
@@ -0,0 +1,510 @@
+#include <loader/mesh_file.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    ** element size of the known section types, 0 for types this reader doesn't know
+    ** the structs live with the converter and the renderer, these are their file sizes
+    */
+    static uint32_t getSectionStride(uint32_t iType)
+    {
+        switch((MeshSectionType)iType)
+        {
+        case MeshSectionType::MeshRanges:
+            return 8;
+        case MeshSectionType::MeshExtents:
+            return 32;
+        case MeshSectionType::Indices:
+        case MeshSectionType::MeshBaseVertices:
+        case MeshSectionType::MeshBVHIndices:
+        case MeshSectionType::TriangleBVHIndices:
+            return 4;
+        case MeshSectionType::SmallIndices:
+            return 2;
+        case MeshSectionType::MeshClusters:
+            return 80;
+        case MeshSectionType::MeshLODs:
+            return 16;
+        case MeshSectionType::MeshBVHNodes:
+        case MeshSectionType::TriangleBVHNodes:
+            return 32;
+        default:
+            return 0;
+        }
+    }
+
+    /*
+    **
+    */
+    static bool isValidVertexStride(uint32_t iStride)
+    {
+        // v1 and v2, see kiLegacyVertexSize and kiCompactVertexSize
+        return iStride == 48 || iStride == 20;
+    }
+
+    /*
+    **
+    */
+    void CMeshFileChecksum::update(
+        void const* pData,
+        uint64_t iSize)
+    {
+        uint8_t const* pcData = (uint8_t const*)pData;
+
+        // finish the word left over from the last piece
+        while(miNumPending > 0 && iSize > 0)
+        {
+            macPending[miNumPending++] = *pcData++;
+            --iSize;
+            if(miNumPending == 4)
+            {
+                uint32_t iWord = 0;
+                memcpy(&iWord, macPending, sizeof(uint32_t));
+                miHash = (miHash ^ iWord) * 0x01000193;
+                miNumPending = 0;
+            }
+        }
+
+        uint64_t iNumWords = iSize / sizeof(uint32_t);
+        uint32_t iHash = miHash;
+        for(uint64_t i = 0; i < iNumWords; i++)
+        {
+            uint32_t iWord = 0;
+            memcpy(&iWord, pcData + i * sizeof(uint32_t), sizeof(uint32_t));
+            iHash = (iHash ^ iWord) * 0x01000193;
+        }
+        miHash = iHash;
+
+        for(uint64_t i = iNumWords * sizeof(uint32_t); i < iSize; i++)
+        {
+            macPending[miNumPending++] = pcData[i];
+        }
+    }
+
+    /*
+    ** section sizes are whole words, the zero padded tail only matters for pieces that aren't
+    */
+    uint32_t CMeshFileChecksum::get() const
+    {
+        if(miNumPending == 0)
+        {
+            return miHash;
+        }
+
+        uint32_t iWord = 0;
+        memcpy(&iWord, macPending, miNumPending);
+        return (miHash ^ iWord) * 0x01000193;
+    }
+
+    /*
+    **
+    */
+    uint32_t getMeshFileChecksum(
+        void const* pData,
+        uint64_t iSize)
+    {
+        CMeshFileChecksum checksum;
+        checksum.update(pData, iSize);
+        return checksum.get();
+    }
+
+    /*
+    ** older files start with the mesh count, nothing converted has anywhere near as many meshes as the signature reads as
+    */
+    uint64_t getMeshFileTableSize(
+        char const* pcData,
+        uint64_t iDataSize)
+    {
+        if(iDataSize < kiMeshFileProbeSize)
+        {
+            return 0;
+        }
+
+        MeshFileHeader header;
+        memcpy(&header, pcData, sizeof(header));
+        if(header.miSignature == kiMeshFileSignature)
+        {
+            return sizeof(MeshFileHeader) + (uint64_t)header.miNumSections * sizeof(MeshFileSection);
+        }
+
+        uint32_t aiLegacyHeader[5];
+        memcpy(aiLegacyHeader, pcData, sizeof(aiLegacyHeader));
+        if(!isValidVertexStride(aiLegacyHeader[3]))
+        {
+            return 0;
+        }
+
+        return kiLegacyMeshFileHeaderSize + (uint64_t)aiLegacyHeader[0] * getSectionStride((uint32_t)MeshSectionType::MeshRanges) +
+            ((uint64_t)aiLegacyHeader[0] + 1) * getSectionStride((uint32_t)MeshSectionType::MeshExtents);
+    }
+
+    /*
+    **
+    */
+    static bool validateMeshFileSections(
+        std::vector<MeshFileSection> const& aSections,
+        uint64_t iTableEnd,
+        uint32_t iAlignment,
+        uint64_t iFileSize)
+    {
+        uint64_t iPrevEnd = iTableEnd;
+        for(uint32_t i = 0; i < (uint32_t)aSections.size(); i++)
+        {
+            MeshFileSection const& section = aSections[i];
+
+            // unknown types only have to fit, readers skip them
+            uint32_t iExpectedStride = getSectionStride(section.miType);
+            bool bValidStride = (section.miType == (uint32_t)MeshSectionType::Vertices) ?
+                isValidVertexStride(section.miStride) :
+                (iExpectedStride == 0 || section.miStride == iExpectedStride);
+
+            bool bValidSize = (section.miSize == (uint64_t)section.miStride * section.miCount) && (section.miSize % sizeof(uint32_t) == 0);
+            bool bInRange = (section.miOffset >= iPrevEnd) &&
+                (section.miOffset % iAlignment == 0) &&
+                (iFileSize == 0 || section.miOffset + section.miSize <= iFileSize);
+            if(!bValidStride || !bValidSize || !bInRange)
+            {
+                DEBUG_PRINTF("%s : %d mesh file section %d (0x%08x) is invalid, stride %d count %d offset %lld size %lld\n",
+                    __FILE__,
+                    __LINE__,
+                    i,
+                    section.miType,
+                    section.miStride,
+                    section.miCount,
+                    (long long)section.miOffset,
+                    (long long)section.miSize);
+                return false;
+            }
+            iPrevEnd = section.miOffset + section.miSize;
+
+            for(uint32_t j = 0; j < i; j++)
+            {
+                if(aSections[j].miType == section.miType)
+                {
+                    DEBUG_PRINTF("%s : %d mesh file section 0x%08x is in the table twice\n",
+                        __FILE__,
+                        __LINE__,
+                        section.miType);
+                    return false;
+                }
+            }
+        }
+
+        // the header sections the rest is read against, vertices are encoded with the extents while they stream in
+        MeshFileSection const* pRanges = findMeshFileSection(aSections, MeshSectionType::MeshRanges);
+        MeshFileSection const* pExtents = findMeshFileSection(aSections, MeshSectionType::MeshExtents);
+        MeshFileSection const* pVertices = findMeshFileSection(aSections, MeshSectionType::Vertices);
+        MeshFileSection const* pIndices = findMeshFileSection(aSections, MeshSectionType::Indices);
+        MeshFileSection const* pBaseVertices = findMeshFileSection(aSections, MeshSectionType::MeshBaseVertices);
+        if(pRanges == nullptr || pExtents == nullptr || pVertices == nullptr || pIndices == nullptr ||
+           pExtents->miCount != pRanges->miCount + 1 ||
+           pExtents->miOffset > pVertices->miOffset ||
+           (pBaseVertices != nullptr && pBaseVertices->miCount != pRanges->miCount))
+        {
+            DEBUG_PRINTF("%s : %d mesh file is missing sections or their counts don't match\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    bool readMeshFileSections(
+        std::vector<MeshFileSection>& aSections,
+        uint32_t& iVersion,
+        char const* pcData,
+        uint64_t iDataSize,
+        uint64_t iFileSize)
+    {
+        aSections.clear();
+        iVersion = 0;
+
+        uint64_t iTableSize = getMeshFileTableSize(pcData, iDataSize);
+        if(iTableSize == 0 || iDataSize < iTableSize || (iFileSize > 0 && iFileSize < iTableSize))
+        {
+            DEBUG_PRINTF("%s : %d not a mesh file or its header is truncated\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        MeshFileHeader header;
+        memcpy(&header, pcData, sizeof(header));
+        if(header.miSignature != kiMeshFileSignature)
+        {
+            // made up from the 5 word header, ranges, extents, vertices and 32 bit indices are back to back
+            uint32_t aiLegacyHeader[5];
+            memcpy(aiLegacyHeader, pcData, sizeof(aiLegacyHeader));
+            uint32_t iNumMeshes = aiLegacyHeader[0];
+
+            uint64_t iOffset = kiLegacyMeshFileHeaderSize;
+            auto addSection = [&](MeshSectionType type, uint32_t iStride, uint64_t iCount)
+            {
+                MeshFileSection section = {};
+                section.miType = (uint32_t)type;
+                section.miStride = iStride;
+                section.miCount = (uint32_t)iCount;
+                section.miOffset = iOffset;
+                section.miSize = (uint64_t)iStride * iCount;
+                aSections.push_back(section);
+                iOffset += section.miSize;
+            };
+            addSection(MeshSectionType::MeshRanges, getSectionStride((uint32_t)MeshSectionType::MeshRanges), iNumMeshes);
+            addSection(MeshSectionType::MeshExtents, getSectionStride((uint32_t)MeshSectionType::MeshExtents), (uint64_t)iNumMeshes + 1);
+            addSection(MeshSectionType::Vertices, aiLegacyHeader[3], aiLegacyHeader[1]);
+            addSection(MeshSectionType::Indices, sizeof(uint32_t), (uint64_t)aiLegacyHeader[2] * 3);
+
+            // whatever follows, to the end of the file when its size isn't known yet
+            MeshFileSection tail = {};
+            tail.miType = (uint32_t)MeshSectionType::LegacySections;
+            tail.miStride = 1;
+            tail.miOffset = iOffset;
+            tail.miSize = (iFileSize > iOffset) ? iFileSize - iOffset : ((iFileSize == 0) ? UINT64_MAX - iOffset : 0);
+            tail.miCount = (uint32_t)std::min(tail.miSize, (uint64_t)UINT32_MAX);
+            if(tail.miSize > 0)
+            {
+                aSections.push_back(tail);
+            }
+
+            iVersion = (aiLegacyHeader[3] == 48) ? 1 : 2;
+            if(iFileSize > 0 && iOffset > iFileSize)
+            {
+                DEBUG_PRINTF("%s : %d mesh file is %lld bytes, its header needs %lld\n",
+                    __FILE__,
+                    __LINE__,
+                    (long long)iFileSize,
+                    (long long)iOffset);
+                aSections.clear();
+                return false;
+            }
+
+            return true;
+        }
+
+        if(header.miVersion != kiMeshFileVersion)
+        {
+            DEBUG_PRINTF("%s : %d unsupported mesh file version %d\n",
+                __FILE__,
+                __LINE__,
+                header.miVersion);
+            return false;
+        }
+
+        // truncated download or partially written file
+        if(iFileSize > 0 && header.miFileSize != iFileSize)
+        {
+            DEBUG_PRINTF("%s : %d mesh file size mismatch, expected %llu bytes, got %llu\n",
+                __FILE__,
+                __LINE__,
+                (unsigned long long)header.miFileSize,
+                (unsigned long long)iFileSize);
+            return false;
+        }
+
+        char const* pcTable = pcData + sizeof(MeshFileHeader);
+        uint64_t iTableBytes = (uint64_t)header.miNumSections * sizeof(MeshFileSection);
+        if(header.miAlignment < sizeof(uint32_t) || (header.miAlignment & (header.miAlignment - 1)) != 0 ||
+           getMeshFileChecksum(pcTable, iTableBytes) != header.miTableChecksum)
+        {
+            DEBUG_PRINTF("%s : %d mesh file section table is corrupt\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        aSections.resize(header.miNumSections);
+        memcpy(aSections.data(), pcTable, (size_t)iTableBytes);
+        if(!validateMeshFileSections(aSections, iTableSize, header.miAlignment, header.miFileSize))
+        {
+            aSections.clear();
+            return false;
+        }
+
+        iVersion = header.miVersion;
+
+        return true;
+    }
+
+    /*
+    ** signature, entry count and the entries, one after the other
+    */
+    bool readLegacyMeshSections(
+        std::vector<MeshFileSection>& aSections,
+        char const* pcData,
+        uint64_t iDataSize)
+    {
+        uint64_t iOffset = 0;
+        while(iOffset + sizeof(uint32_t) * 2 <= iDataSize)
+        {
+            uint32_t aiSectionHeader[2];
+            memcpy(aiSectionHeader, pcData + iOffset, sizeof(aiSectionHeader));
+            iOffset += sizeof(aiSectionHeader);
+
+            // 16 bit indices were counted in words
+            uint32_t iStride = getSectionStride(aiSectionHeader[0]);
+            uint64_t iCount = aiSectionHeader[1];
+            if(aiSectionHeader[0] == (uint32_t)MeshSectionType::SmallIndices)
+            {
+                iCount *= 2;
+            }
+
+            uint64_t iSectionSize = iStride * iCount;
+            if(iStride == 0 || iOffset + iSectionSize > iDataSize)
+            {
+                DEBUG_PRINTF("%s : %d unknown or truncated mesh section 0x%08x\n",
+                    __FILE__,
+                    __LINE__,
+                    aiSectionHeader[0]);
+                return false;
+            }
+
+            MeshFileSection section = {};
+            section.miType = aiSectionHeader[0];
+            section.miStride = iStride;
+            section.miCount = (uint32_t)iCount;
+            section.miOffset = iOffset;
+            section.miSize = iSectionSize;
+            aSections.push_back(section);
+
+            iOffset += iSectionSize;
+        }
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    MeshFileSection const* findMeshFileSection(
+        std::vector<MeshFileSection> const& aSections,
+        MeshSectionType type)
+    {
+        for(auto const& section : aSections)
+        {
+            if(section.miType == (uint32_t)type)
+            {
+                return &section;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /*
+    **
+    */
+    bool checkMeshFileSection(
+        MeshFileSection const& section,
+        char const* pcFileData)
+    {
+        uint32_t iChecksum = getMeshFileChecksum(pcFileData + section.miOffset, section.miSize);
+        if(iChecksum != section.miChecksum)
+        {
+            DEBUG_PRINTF("%s : %d mesh file section 0x%08x checksum 0x%08x doesn\'t match 0x%08x\n",
+                __FILE__,
+                __LINE__,
+                section.miType,
+                iChecksum,
+                section.miChecksum);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    void CMeshFileWriter::addSection(
+        MeshSectionType type,
+        void const* pData,
+        uint32_t iStride,
+        uint32_t iCount)
+    {
+        PendingSection pendingSection;
+        pendingSection.mSection = {};
+        pendingSection.mSection.miType = (uint32_t)type;
+        pendingSection.mSection.miStride = iStride;
+        pendingSection.mSection.miCount = iCount;
+        pendingSection.mSection.miSize = (uint64_t)iStride * iCount;
+        pendingSection.mSection.miChecksum = getMeshFileChecksum(pData, pendingSection.mSection.miSize);
+        pendingSection.mpcData = (char const*)pData;
+        assert(pendingSection.mSection.miSize % sizeof(uint32_t) == 0);
+
+        maSections.push_back(pendingSection);
+    }
+
+    /*
+    **
+    */
+    bool CMeshFileWriter::write(std::string const& fullPath)
+    {
+        auto alignOffset = [](uint64_t iOffset)
+        {
+            return (iOffset + kiMeshFileAlignment - 1) & ~((uint64_t)kiMeshFileAlignment - 1);
+        };
+
+        // payload offsets in the order the sections were added
+        std::vector<MeshFileSection> aSections(maSections.size());
+        uint64_t iOffset = alignOffset(sizeof(MeshFileHeader) + sizeof(MeshFileSection) * maSections.size());
+        for(uint32_t i = 0; i < (uint32_t)maSections.size(); i++)
+        {
+            aSections[i] = maSections[i].mSection;
+            aSections[i].miOffset = iOffset;
+            iOffset = alignOffset(iOffset + aSections[i].miSize);
+        }
+
+        MeshFileHeader header = {};
+        header.miSignature = kiMeshFileSignature;
+        header.miVersion = kiMeshFileVersion;
+        header.miNumSections = (uint32_t)aSections.size();
+        header.miAlignment = kiMeshFileAlignment;
+        header.miFileSize = (aSections.size() > 0) ? aSections.back().miOffset + aSections.back().miSize : sizeof(MeshFileHeader);
+        header.miTableChecksum = getMeshFileChecksum(aSections.data(), sizeof(MeshFileSection) * aSections.size());
+
+        FILE* fp = fopen(fullPath.c_str(), "wb");
+        if(fp == nullptr)
+        {
+            DEBUG_PRINTF("%s : %d can\'t open \"%s\" for writing\n",
+                __FILE__,
+                __LINE__,
+                fullPath.c_str());
+            return false;
+        }
+
+        std::vector<char> acPadding(kiMeshFileAlignment, 0);
+        uint64_t iFilePosition = 0;
+        auto writeAligned = [&](void const* pData, uint64_t iSize, uint64_t iAlignedOffset)
+        {
+            assert(iAlignedOffset >= iFilePosition);
+            fwrite(acPadding.data(), sizeof(char), (size_t)(iAlignedOffset - iFilePosition), fp);
+            fwrite(pData, sizeof(char), (size_t)iSize, fp);
+            iFilePosition = iAlignedOffset + iSize;
+        };
+
+        writeAligned(&header, sizeof(header), 0);
+        writeAligned(aSections.data(), sizeof(MeshFileSection) * aSections.size(), iFilePosition);
+        for(uint32_t i = 0; i < (uint32_t)aSections.size(); i++)
+        {
+            writeAligned(maSections[i].mpcData, aSections[i].miSize, aSections[i].miOffset);
+        }
+
+        bool bWriteError = (ferror(fp) != 0);
+        fclose(fp);
+
+        return !bWriteError;
+    }
+
+}   // Loader
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <loader/bundle.h>
+
+namespace Loader
+{
+    /*
+    ** "-triangles.bin" layout from version 3 on:
+    **    MeshFileHeader
+    **    MeshFileSection[miNumSections], sorted by offset
+    **    section payloads, each starting at a multiple of miAlignment so a copy of the whole file can be bound per section
+    **
+    ** versions 1 and 2 are the 5 word header (mesh count, vertex count, triangle count, vertex size, unused offset), mesh ranges,
+    ** mesh extents, vertices and 32 bit indices back to back, followed by sections chained as signature, count and entries
+    ** readers skip section types they don't know, new data goes in new sections instead of changing existing ones
+    */
+    constexpr uint32_t kiMeshFileSignature = makeFourCC('M', 'S', 'H', 'F');
+    constexpr uint32_t kiMeshFileVersion = 3;
+    constexpr uint32_t kiMeshFileAlignment = 256;
+    constexpr uint32_t kiLegacyMeshFileHeaderSize = 5 * sizeof(uint32_t);
+    constexpr uint32_t kiMeshFileProbeSize = 32;
+
+    // types that were chained sections keep their signature
+    enum class MeshSectionType : uint32_t
+    {
+        MeshRanges = makeFourCC('M', 'R', 'N', 'G'),
+        MeshExtents = makeFourCC('M', 'E', 'X', 'T'),           // one more than the meshes, the last one covers all of them
+        Vertices = makeFourCC('V', 'E', 'R', 'T'),              // stride tells the vertex versions apart
+        Indices = makeFourCC('I', 'X', '3', '2'),
+        SmallIndices = makeFourCC('I', 'X', '1', '6'),
+        MeshBaseVertices = makeFourCC('I', 'D', 'X', 'B'),
+        MeshClusters = makeFourCC('C', 'L', 'S', 'T'),
+        MeshLODs = makeFourCC('L', 'O', 'D', 'S'),
+        MeshBVHNodes = makeFourCC('M', 'B', 'V', 'H'),
+        MeshBVHIndices = makeFourCC('M', 'B', 'V', 'I'),
+        TriangleBVHNodes = makeFourCC('T', 'B', 'V', 'H'),
+        TriangleBVHIndices = makeFourCC('T', 'B', 'V', 'I'),
+
+        // read side only, everything after the indices of a version 1 or 2 file
+        LegacySections = makeFourCC('L', 'G', 'C', 'Y'),
+    };
+
+    struct MeshFileHeader
+    {
+        uint32_t                        miSignature;
+        uint32_t                        miVersion;
+        uint32_t                        miNumSections;
+        uint32_t                        miAlignment;
+        uint64_t                        miFileSize;
+        uint32_t                        miTableChecksum;        // over the section table
+        uint32_t                        miPadding;
+    };
+
+    struct MeshFileSection
+    {
+        uint32_t                        miType;
+        uint32_t                        miStride;               // bytes per element
+        uint32_t                        miCount;
+        uint32_t                        miChecksum;             // over the miSize bytes of the payload
+        uint64_t                        miOffset;               // from the start of the file
+        uint64_t                        miSize;                 // miStride * miCount, a multiple of 4
+    };
+
+    static_assert(sizeof(MeshFileHeader) == 32, "mesh file header size doesn't match the file layout");
+    static_assert(sizeof(MeshFileSection) == 32, "mesh file section size doesn't match the file layout");
+
+    /*
+    ** FNV-1a over 32 bit words, fed in pieces of any size as they arrive
+    */
+    class CMeshFileChecksum
+    {
+    public:
+        CMeshFileChecksum() = default;
+        virtual ~CMeshFileChecksum() = default;
+
+        void update(
+            void const* pData,
+            uint64_t iSize);
+
+        uint32_t get() const;
+
+    protected:
+        uint32_t                        miHash = 0x811c9dc5;
+        uint8_t                         macPending[4] = {};
+        uint32_t                        miNumPending = 0;
+    };
+
+    uint32_t getMeshFileChecksum(
+        void const* pData,
+        uint64_t iSize);
+
+    // bytes from the start of the file to the end of its section table, needs the first kiMeshFileProbeSize bytes
+    // 0 when it's neither a version 3 file nor a plausible older one
+    uint64_t getMeshFileTableSize(
+        char const* pcData,
+        uint64_t iDataSize);
+
+    // validates the table against the file size, 0 when it's not known yet
+    // version 1 and 2 files get a table made up from their header, with everything after the indices as one LegacySections entry
+    bool readMeshFileSections(
+        std::vector<MeshFileSection>& aSections,
+        uint32_t& iVersion,
+        char const* pcData,
+        uint64_t iDataSize,
+        uint64_t iFileSize);
+
+    // entries for the chained sections of a LegacySections payload, offsets are from the start of pcData
+    bool readLegacyMeshSections(
+        std::vector<MeshFileSection>& aSections,
+        char const* pcData,
+        uint64_t iDataSize);
+
+    MeshFileSection const* findMeshFileSection(
+        std::vector<MeshFileSection> const& aSections,
+        MeshSectionType type);
+
+    // whole section at once for files that are already in memory, version 1 and 2 sections have no checksum to compare to
+    bool checkMeshFileSection(
+        MeshFileSection const& section,
+        char const* pcFileData);
+
+    /*
+    ** write side, used by the converter
+    */
+    class CMeshFileWriter
+    {
+    public:
+        CMeshFileWriter() = default;
+        virtual ~CMeshFileWriter() = default;
+
+        // the data has to stay valid until write(), iStride * iCount has to be a multiple of 4
+        void addSection(
+            MeshSectionType type,
+            void const* pData,
+            uint32_t iStride,
+            uint32_t iCount);
+
+        bool write(std::string const& fullPath);
+
+    protected:
+        struct PendingSection
+        {
+            MeshFileSection             mSection;
+            char const*                 mpcData;
+        };
+
+        std::vector<PendingSection>     maSections;
+    };
+
+}   // Loader
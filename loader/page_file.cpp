@@ -0,0 +1,163 @@
+#include <loader/page_file.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    **
+    */
+    void getPageFileLevelTiles(
+        uint32_t& iNumTilesX,
+        uint32_t& iNumTilesY,
+        PageFileHeader const& header,
+        uint32_t iLevel)
+    {
+        uint32_t iLevelWidth = std::max(header.miPageWidth >> iLevel, 1u);
+        uint32_t iLevelHeight = std::max(header.miPageHeight >> iLevel, 1u);
+        iNumTilesX = (iLevelWidth + header.miTileSize - 1) / header.miTileSize;
+        iNumTilesY = (iLevelHeight + header.miTileSize - 1) / header.miTileSize;
+    }
+
+    /*
+    **
+    */
+    uint32_t getPageFileFirstTile(
+        PageFileHeader const& header,
+        uint32_t iPage,
+        uint32_t iLevel)
+    {
+        uint32_t iNumPageTiles = 0, iFirstLevelTile = 0;
+        for(uint32_t i = 0; i < header.miNumMips; i++)
+        {
+            if(i == iLevel)
+            {
+                iFirstLevelTile = iNumPageTiles;
+            }
+
+            uint32_t iNumTilesX = 0, iNumTilesY = 0;
+            getPageFileLevelTiles(iNumTilesX, iNumTilesY, header, i);
+            iNumPageTiles += iNumTilesX * iNumTilesY;
+        }
+
+        return iPage * iNumPageTiles + iFirstLevelTile;
+    }
+
+    /*
+    **
+    */
+    uint64_t getPageFileTileSize(PageFileHeader const& header)
+    {
+        uint64_t iTileWidth = header.miTileSize + header.miTileBorder * 2;
+        return iTileWidth * iTileWidth * getAtlasFormatInfo(header.miFormat).miBlockSize;
+    }
+
+    /*
+    **
+    */
+    bool readPageFile(
+        PageFileHeader& header,
+        std::vector<AtlasTextureInfo>& aTextureInfo,
+        std::vector<PageFileTile>& aTiles,
+        char const* pcData,
+        uint64_t iDataSize)
+    {
+        aTextureInfo.clear();
+        aTiles.clear();
+
+        if(pcData == nullptr || iDataSize < sizeof(PageFileHeader))
+        {
+            DEBUG_PRINTF("%s : %d page file is truncated\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        memcpy(&header, pcData, sizeof(header));
+        if(header.miSignature != kiPageFileSignature || header.miVersion != kiPageFileVersion)
+        {
+            DEBUG_PRINTF("%s : %d not a page file or an unknown version\n",
+                __FILE__,
+                __LINE__);
+            return false;
+        }
+
+        // the converter rounds pages up to powers of two, the per mip tile counts and the indirection texture rely on it
+        bool bPowerOfTwoTiles = (header.miTileSize >= 8 && (header.miTileSize & (header.miTileSize - 1)) == 0);
+        bool bPowerOfTwoPages = (header.miPageWidth > 0 && (header.miPageWidth & (header.miPageWidth - 1)) == 0 &&
+                                 header.miPageHeight > 0 && (header.miPageHeight & (header.miPageHeight - 1)) == 0);
+        if((AtlasFormat)header.miFormat != AtlasFormat::RGBA8 || !bPowerOfTwoPages ||
+           header.miNumPages == 0 || header.miNumMips == 0 || header.miNumMips > 16 ||
+           !bPowerOfTwoTiles || header.miTileBorder * 2 > header.miTileSize)
+        {
+            DEBUG_PRINTF("%s : %d page file format %d, %d x %d pages, %d mips or %d texel tiles with %d texel borders aren\'t supported\n",
+                __FILE__,
+                __LINE__,
+                header.miFormat,
+                header.miPageWidth,
+                header.miPageHeight,
+                header.miNumMips,
+                header.miTileSize,
+                header.miTileBorder);
+            return false;
+        }
+
+        uint64_t iNumTiles = (uint64_t)getPageFileFirstTile(header, header.miNumPages, 0);
+        uint64_t iTableSize = sizeof(PageFileHeader) + (uint64_t)header.miNumTextures * sizeof(AtlasTextureInfo) + (uint64_t)header.miNumTiles * sizeof(PageFileTile);
+        if(header.miNumTiles != iNumTiles || header.miFileSize != iDataSize || iTableSize > iDataSize)
+        {
+            DEBUG_PRINTF("%s : %d page file is %lld bytes with %d tiles, its header says %lld and %lld tiles, its tables need %lld bytes\n",
+                __FILE__,
+                __LINE__,
+                (long long)iDataSize,
+                (uint32_t)iNumTiles,
+                (long long)header.miFileSize,
+                (long long)header.miNumTiles,
+                (long long)iTableSize);
+            return false;
+        }
+
+        aTextureInfo.resize(header.miNumTextures);
+        memcpy(aTextureInfo.data(), pcData + sizeof(PageFileHeader), aTextureInfo.size() * sizeof(AtlasTextureInfo));
+        aTiles.resize(header.miNumTiles);
+        memcpy(aTiles.data(), pcData + sizeof(PageFileHeader) + aTextureInfo.size() * sizeof(AtlasTextureInfo), aTiles.size() * sizeof(PageFileTile));
+
+        uint64_t iTileSize = getPageFileTileSize(header);
+        for(uint32_t i = 0; i < (uint32_t)aTiles.size(); i++)
+        {
+            PageFileTile const& tile = aTiles[i];
+            if(tile.miOffset != 0 && (tile.miOffset < iTableSize || tile.miOffset > iDataSize || iTileSize > iDataSize - tile.miOffset))
+            {
+                DEBUG_PRINTF("%s : %d page file tile %d lies outside of the file\n",
+                    __FILE__,
+                    __LINE__,
+                    i);
+                return false;
+            }
+        }
+
+        for(uint32_t i = 0; i < (uint32_t)aTextureInfo.size(); i++)
+        {
+            AtlasTextureInfo const& textureInfo = aTextureInfo[i];
+            if((uint64_t)textureInfo.maiTextureCoord[0] + textureInfo.miImageWidth > header.miPageWidth ||
+               (uint64_t)textureInfo.maiTextureCoord[1] + textureInfo.miImageHeight > header.miPageHeight ||
+               textureInfo.miNumMips > header.miNumMips ||
+               (textureInfo.miImageWidth > 0 && textureInfo.miPage >= header.miNumPages))
+            {
+                DEBUG_PRINTF("%s : %d page file texture %d lies outside of its page\n",
+                    __FILE__,
+                    __LINE__,
+                    i);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}   // Loader
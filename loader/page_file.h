@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <loader/atlas_file.h>
+
+namespace Loader
+{
+    /*
+    ** "-diffuse-pages.bin", the baked atlas pages cut into tiles for virtual texturing:
+    **    PageFileHeader
+    **    AtlasTextureInfo[miNumTextures], indexed by texture id, coordinates are texels of the virtual pages
+    **    PageFileTile[miNumTiles], page by page, level by level from the largest, row by row
+    **    tile payloads, each starting at a multiple of kiPageFileAlignment
+    **
+    ** a tile is miTileSize texels square with miTileBorder texels of its neighbours around it, so bilinear lookups near its
+    ** edge don't need the tile next to it, texels past the edge of the level repeat the last one
+    ** levels stop at the last one the textures have, the tiles of that level are what's left resident at all times
+    */
+    constexpr uint32_t kiPageFileSignature = makeFourCC('V', 'T', 'P', 'F');
+    constexpr uint32_t kiPageFileVersion = 1;
+    constexpr uint32_t kiPageFileAlignment = 256;
+    constexpr char const* kszPageFileSuffix = "-diffuse-pages.bin";
+
+    struct PageFileHeader
+    {
+        uint32_t                        miSignature;
+        uint32_t                        miVersion;
+        uint32_t                        miFormat;               // AtlasFormat, only RGBA8 so far
+        uint32_t                        miNumTextures;
+        uint32_t                        miPageWidth;
+        uint32_t                        miPageHeight;
+        uint32_t                        miNumPages;
+        uint32_t                        miNumMips;
+        uint32_t                        miTileSize;             // power of two
+        uint32_t                        miTileBorder;
+        uint32_t                        miNumTiles;
+        uint32_t                        miGutter;
+        uint64_t                        miFileSize;
+        uint64_t                        miPadding;
+    };
+
+    // tiles nothing was packed into have no payload
+    struct PageFileTile
+    {
+        uint64_t                        miOffset;               // from the start of the file, 0 for an empty tile
+        uint32_t                        miChecksum;             // getMeshFileChecksum over the payload
+        uint32_t                        miPadding;
+    };
+
+    static_assert(sizeof(PageFileHeader) == 64, "page file header size doesn't match the file layout");
+    static_assert(sizeof(PageFileTile) == 16, "page file tile size doesn't match the file layout");
+
+    // tiles across and down a level of a page
+    void getPageFileLevelTiles(
+        uint32_t& iNumTilesX,
+        uint32_t& iNumTilesY,
+        PageFileHeader const& header,
+        uint32_t iLevel);
+
+    // index into the tile table of the first tile of the level
+    uint32_t getPageFileFirstTile(
+        PageFileHeader const& header,
+        uint32_t iPage,
+        uint32_t iLevel);
+
+    // bytes of one tile's payload, border included
+    uint64_t getPageFileTileSize(PageFileHeader const& header);
+
+    // tables only, the payloads are checked as the tiles are streamed in
+    bool readPageFile(
+        PageFileHeader& header,
+        std::vector<AtlasTextureInfo>& aTextureInfo,
+        std::vector<PageFileTile>& aTiles,
+        char const* pcData,
+        uint64_t iDataSize);
+
+}   // Loader
@@ -0,0 +1,241 @@
+#include <loader/texture_cache.h>
+
+#if !defined(__EMSCRIPTEN__)
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+#include <loader/asset_cache.h>
+#include <utils/LogPrint.h>
+
+namespace Loader
+{
+    /*
+    ** bytes the texels of an image take in the format, 0 for formats this reader doesn't know
+    */
+    static uint64_t getDecodedDataSize(DecodedTextureHeader const& header)
+    {
+        AtlasFormatInfo formatInfo = getAtlasFormatInfo(header.miFormat);
+        uint64_t iNumBlocksX = (header.miImageWidth + formatInfo.miBlockWidth - 1) / formatInfo.miBlockWidth;
+        uint64_t iNumBlocksY = (header.miImageHeight + formatInfo.miBlockHeight - 1) / formatInfo.miBlockHeight;
+
+        return iNumBlocksX * iNumBlocksY * formatInfo.miBlockSize;
+    }
+
+    /*
+    **
+    */
+    CDecodedTextureCache::CDecodedTextureCache(
+        std::string const& directory,
+        uint64_t iMaxSize) :
+        mDirectory(directory),
+        miMaxSize(iMaxSize)
+    {
+        if(mDirectory.length() > 0 && mDirectory.back() != '/' && mDirectory.back() != '\\')
+        {
+            mDirectory += "/";
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(mDirectory, error);
+        if(error)
+        {
+            DEBUG_PRINTF("%s : %d can\'t create texture cache directory \"%s\": %s\n",
+                __FILE__,
+                __LINE__,
+                mDirectory.c_str(),
+                error.message().c_str());
+        }
+
+        evict();
+    }
+
+    /*
+    **
+    */
+    std::string CDecodedTextureCache::getEntryPath(uint64_t iSourceHash) const
+    {
+        char szHash[32];
+        snprintf(szHash, sizeof(szHash), "%016llx", (unsigned long long)iSourceHash);
+
+        return mDirectory + szHash + ".tex";
+    }
+
+    /*
+    ** entries that are truncated, from another version or whose source size or check hash differ are misses
+    */
+    bool CDecodedTextureCache::load(
+        FileView& texels,
+        DecodedTextureHeader& header,
+        std::span<char const> acSource)
+    {
+        texels = FileView();
+
+        header = DecodedTextureHeader();
+        header.miSourceHash = CAssetCache::hash(acSource.data(), acSource.size());
+        header.miSourceSize = acSource.size();
+        header.miSourceCheckHash = CAssetCache::checkHash(acSource.data(), acSource.size());
+
+        std::string entryPath = getEntryPath(header.miSourceHash);
+        std::shared_ptr<CMappedFile> pMappedFile = std::make_shared<CMappedFile>();
+        if(!pMappedFile->open(entryPath) || pMappedFile->getSize() < sizeof(DecodedTextureHeader))
+        {
+            ++miNumMisses;
+            return false;
+        }
+
+        DecodedTextureHeader cachedHeader;
+        memcpy(&cachedHeader, pMappedFile->getData(), sizeof(DecodedTextureHeader));
+        if(cachedHeader.miSignature != kiDecodedTextureSignature ||
+           cachedHeader.miVersion != kiDecodedTextureVersion ||
+           cachedHeader.miSourceHash != header.miSourceHash ||
+           cachedHeader.miSourceSize != header.miSourceSize ||
+           cachedHeader.miSourceCheckHash != header.miSourceCheckHash ||
+           cachedHeader.miDataSize == 0 ||
+           cachedHeader.miDataSize != getDecodedDataSize(cachedHeader) ||
+           cachedHeader.miDataSize != pMappedFile->getSize() - sizeof(DecodedTextureHeader))
+        {
+            ++miNumMisses;
+            return false;
+        }
+
+        header = cachedHeader;
+        texels.maData = std::span<char const>(pMappedFile->getData() + sizeof(DecodedTextureHeader), (size_t)header.miDataSize);
+        texels.mpBacking = pMappedFile;
+        ++miNumHits;
+
+        std::error_code error;
+        std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), error);
+
+        return true;
+    }
+
+    /*
+    ** another thread writing the same entry is fine, the last rename wins and both hold the same bytes
+    */
+    bool CDecodedTextureCache::store(
+        DecodedTextureHeader const& header,
+        void const* pTexels)
+    {
+        DecodedTextureHeader entryHeader = header;
+        entryHeader.miSignature = kiDecodedTextureSignature;
+        entryHeader.miVersion = kiDecodedTextureVersion;
+        entryHeader.miDataSize = getDecodedDataSize(entryHeader);
+        if(entryHeader.miDataSize == 0)
+        {
+            return false;
+        }
+
+        std::ostringstream oss;
+        oss << mDirectory << "incoming-" << (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count() << "-" << miTempFileIndex++ << ".tmp";
+        std::string tempFilePath = oss.str();
+
+        FILE* fp = fopen(tempFilePath.c_str(), "wb");
+        if(fp == nullptr)
+        {
+            DEBUG_PRINTF("%s : %d can\'t write \"%s\"\n",
+                __FILE__,
+                __LINE__,
+                tempFilePath.c_str());
+            return false;
+        }
+        fwrite(&entryHeader, sizeof(DecodedTextureHeader), 1, fp);
+        fwrite(pTexels, 1, (size_t)entryHeader.miDataSize, fp);
+        bool bWriteError = (ferror(fp) != 0);
+        fclose(fp);
+
+        std::error_code error;
+        if(!bWriteError)
+        {
+            std::filesystem::rename(tempFilePath, getEntryPath(entryHeader.miSourceHash), error);
+        }
+        if(bWriteError || error)
+        {
+            std::filesystem::remove(tempFilePath, error);
+            return false;
+        }
+
+        miTotalSize += sizeof(DecodedTextureHeader) + entryHeader.miDataSize;
+        if(miMaxSize > 0 && miTotalSize > miMaxSize)
+        {
+            evict();
+        }
+
+        return true;
+    }
+
+    /*
+    ** re-counts the directory, the running total drifts when threads store the same entry or other processes share it
+    */
+    void CDecodedTextureCache::evict()
+    {
+        struct Entry
+        {
+            std::filesystem::path                   mPath;
+            std::filesystem::file_time_type         mLastWriteTime;
+            uint64_t                                miSize = 0;
+        };
+
+        std::lock_guard<std::mutex> lock(mEvictMutex);
+
+        std::vector<Entry> aEntries;
+        uint64_t iTotalSize = 0;
+        std::error_code error;
+        for(std::filesystem::directory_iterator it(mDirectory, error), end; !error && it != end; it.increment(error))
+        {
+            if(it->path().extension() != ".tex" || !it->is_regular_file(error))
+            {
+                continue;
+            }
+
+            Entry entry;
+            entry.mPath = it->path();
+            entry.miSize = (uint64_t)it->file_size(error);
+            entry.mLastWriteTime = it->last_write_time(error);
+            if(!error)
+            {
+                iTotalSize += entry.miSize;
+                aEntries.push_back(entry);
+            }
+            error.clear();
+        }
+
+        if(miMaxSize > 0 && iTotalSize > miMaxSize)
+        {
+            std::sort(
+                aEntries.begin(),
+                aEntries.end(),
+                [](Entry const& a, Entry const& b)
+                {
+                    return a.mLastWriteTime < b.mLastWriteTime;
+                });
+
+            uint32_t iNumEvicted = 0;
+            for(uint32_t i = 0; i < (uint32_t)aEntries.size() && iTotalSize > miMaxSize; i++)
+            {
+                // mapped entries stay readable on posix, on windows the remove fails and the entry is retried next time
+                if(std::filesystem::remove(aEntries[i].mPath, error))
+                {
+                    iTotalSize -= aEntries[i].miSize;
+                    ++iNumEvicted;
+                }
+            }
+
+            DEBUG_PRINTF("evicted %d decoded textures, %lld bytes left in \"%s\"\n",
+                iNumEvicted,
+                (long long)iTotalSize,
+                mDirectory.c_str());
+        }
+
+        miTotalSize = iTotalSize;
+    }
+
+}   // Loader
+
+#endif // !__EMSCRIPTEN__
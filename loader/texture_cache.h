@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+
+#include <loader/asset_source.h>
+#include <loader/atlas_file.h>
+
+namespace Loader
+{
+    // "TEXD", one file per source image in the cache directory
+    constexpr uint32_t kiDecodedTextureSignature = 0x44584554;
+    constexpr uint32_t kiDecodedTextureVersion = 2;
+
+    // entries past this are evicted oldest first
+    constexpr uint64_t kiDefaultDecodedTextureCacheSize = 2ull * 1024ull * 1024ull * 1024ull;
+
+    /*
+    ** in front of the texels, an entry is only used if its size and both hashes match the source
+    */
+    struct DecodedTextureHeader
+    {
+        uint32_t                        miSignature = kiDecodedTextureSignature;
+        uint32_t                        miVersion = kiDecodedTextureVersion;
+        uint64_t                        miSourceHash = 0;
+        uint64_t                        miSourceSize = 0;
+        uint64_t                        miSourceCheckHash = 0;
+        uint32_t                        miImageWidth = 0;
+        uint32_t                        miImageHeight = 0;
+        uint32_t                        miFormat = (uint32_t)AtlasFormat::RGBA8;
+        uint32_t                        miPadding = 0;
+        uint64_t                        miDataSize = 0;
+    };
+
+    /*
+    ** decoded images keyed by the hash of the file they were decoded from, "<dir>/<source hash>.tex"
+    **    entries are memory-mapped on the next run so the source only has to be hashed, not decoded
+    **    safe to use from the loader threads, entries are written to a temp file and moved into place
+    **    hits touch the entry so once the directory is over the size limit the least recently used go first
+    */
+    class CDecodedTextureCache
+    {
+    public:
+        CDecodedTextureCache(
+            std::string const& directory,
+            uint64_t iMaxSize = kiDefaultDecodedTextureCacheSize);
+        virtual ~CDecodedTextureCache() = default;
+
+        // texels view the mapped entry, the source hashes and size in header are filled in either way for store()
+        bool load(
+            FileView& texels,
+            DecodedTextureHeader& header,
+            std::span<char const> acSource);
+
+        // header as filled in by a load() that missed, with the image size and format set
+        bool store(
+            DecodedTextureHeader const& header,
+            void const* pTexels);
+
+        inline uint32_t getNumHits() const { return miNumHits; }
+        inline uint32_t getNumMisses() const { return miNumMisses; }
+
+    protected:
+        std::string getEntryPath(uint64_t iSourceHash) const;
+        void evict();
+
+    protected:
+        std::string                     mDirectory;
+        uint64_t                        miMaxSize = kiDefaultDecodedTextureCacheSize;
+
+        std::atomic<uint64_t>           miTotalSize = 0;
+        std::mutex                      mEvictMutex;
+
+        std::atomic<uint32_t>           miNumHits = 0;
+        std::atomic<uint32_t>           miNumMisses = 0;
+        std::atomic<uint32_t>           miTempFileIndex = 0;
+    };
+
+}   // Loader
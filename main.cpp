@@ -399,6 +399,10 @@ void initGraphics()
     desc.mMeshFilePath = "ICE1";
     desc.mRenderJobPipelineFilePath = "render-jobs.json";
     desc.mpSampler = &gSampler;
+#if !defined(__EMSCRIPTEN__)
+    // the loader threads also decode the diffuse textures, one per core keeps the pngs from queueing behind each other
+    Loader::setNumLoaderThreads(std::max(std::thread::hardware_concurrency(), 4u));
+#endif // __EMSCRIPTEN__
     gRenderer.setup(desc);
     
     createRenderPipeline();
@@ -943,6 +947,9 @@ void start()
         surface.Present();
         instance.ProcessEvents();
     }
+
+    // the loader's callbacks reach into the renderer, they're finished while it's still alive
+    Loader::shutdownAsyncLoader();
 #endif
 }
 
@@ -967,10 +974,29 @@ void GetAdapter(void (*callback)(wgpu::Adapter)) {
 
 void GetDevice(void (*callback)(wgpu::Device)) {
 
+    // the mesh culling pass binds more storage buffers than the default 8
+    wgpu::SupportedLimits supportedLimits = {};
+    adapter.GetLimits(&supportedLimits);
+
     wgpu::RequiredLimits requiredLimits = {};
     requiredLimits.limits.maxBufferSize = 400000000;
     requiredLimits.limits.maxStorageBufferBindingSize = 400000000;
+    requiredLimits.limits.maxStorageBuffersPerShaderStage = supportedLimits.limits.maxStorageBuffersPerShaderStage;
+
+    // block compressed atlas formats, the renderer falls back to rgba8 without them
+    std::vector<wgpu::FeatureName> aFeatureNames;
+    if(adapter.HasFeature(wgpu::FeatureName::TextureCompressionBC))
+    {
+        aFeatureNames.push_back(wgpu::FeatureName::TextureCompressionBC);
+    }
+    if(adapter.HasFeature(wgpu::FeatureName::TextureCompressionETC2))
+    {
+        aFeatureNames.push_back(wgpu::FeatureName::TextureCompressionETC2);
+    }
+
     wgpu::DeviceDescriptor deviceDesc = {};
+    deviceDesc.requiredFeatures = aFeatureNames.data();
+    deviceDesc.requiredFeatureCount = aFeatureNames.size();
     deviceDesc.requiredLimits = &requiredLimits;
     adapter.RequestDevice(
         &deviceDesc,
@@ -1348,11 +1374,30 @@ int main()
 
     static bool bGotDevice;
     bGotDevice = false;
+    // the mesh culling pass binds more storage buffers than the default 8
+    wgpu::SupportedLimits supportedLimits = {};
+    adapter.GetLimits(&supportedLimits);
+
     wgpu::RequiredLimits requiredLimits = {};
     requiredLimits.limits.maxBufferSize = 400000000;
     requiredLimits.limits.maxStorageBufferBindingSize = 400000000;
     requiredLimits.limits.maxColorAttachmentBytesPerSample = 64;
+    requiredLimits.limits.maxStorageBuffersPerShaderStage = supportedLimits.limits.maxStorageBuffersPerShaderStage;
+
+    // block compressed atlas formats, the renderer falls back to rgba8 without them
+    std::vector<wgpu::FeatureName> aFeatureNames;
+    if(adapter.HasFeature(wgpu::FeatureName::TextureCompressionBC))
+    {
+        aFeatureNames.push_back(wgpu::FeatureName::TextureCompressionBC);
+    }
+    if(adapter.HasFeature(wgpu::FeatureName::TextureCompressionETC2))
+    {
+        aFeatureNames.push_back(wgpu::FeatureName::TextureCompressionETC2);
+    }
+
     wgpu::DeviceDescriptor deviceDesc = {};
+    deviceDesc.requiredFeatures = aFeatureNames.data();
+    deviceDesc.requiredFeatureCount = aFeatureNames.size();
     deviceDesc.requiredLimits = &requiredLimits;
     adapter.RequestDevice(
         &deviceDesc,
@@ -1414,24 +1459,38 @@ int main()
         "allow_unsafe_apis",
         "disable_symbol_renaming"
     };
-    wgpu::FeatureName aFeatureNames[] =
+    std::vector<wgpu::FeatureName> aFeatureNames;
+#if defined(_MSC_VER)
+    aFeatureNames.push_back(wgpu::FeatureName::MultiDrawIndirect);
+#endif // _MSC_VER
+
+    // block compressed atlas formats, the renderer falls back to rgba8 without them
+    if(adapter.HasFeature(wgpu::FeatureName::TextureCompressionBC))
     {
-    #if defined(_MSC_VER)
-        wgpu::FeatureName::MultiDrawIndirect
-    #endif // _MSC_VER
-    };
+        aFeatureNames.push_back(wgpu::FeatureName::TextureCompressionBC);
+    }
+    if(adapter.HasFeature(wgpu::FeatureName::TextureCompressionETC2))
+    {
+        aFeatureNames.push_back(wgpu::FeatureName::TextureCompressionETC2);
+    }
+
+    // the mesh culling pass binds more storage buffers than the default 8
+    wgpu::Limits supportedLimits = {};
+    adapter.GetLimits(&supportedLimits);
+
     wgpu::Limits requireLimits = {};
     requireLimits.maxBufferSize = 1000000000;
     requireLimits.maxStorageBufferBindingSize = 1000000000;
     requireLimits.maxColorAttachmentBytesPerSample = 64;
+    requireLimits.maxStorageBuffersPerShaderStage = supportedLimits.maxStorageBuffersPerShaderStage;
 
     wgpu::DawnTogglesDescriptor toggleDesc = {};
     toggleDesc.enabledToggles = (const char* const*)&aszToggleNames;
     toggleDesc.enabledToggleCount = sizeof(aszToggleNames) / sizeof(*aszToggleNames);
     wgpu::DeviceDescriptor deviceDesc = {};
     deviceDesc.nextInChain = &toggleDesc;
-    deviceDesc.requiredFeatures = aFeatureNames;
-    deviceDesc.requiredFeatureCount = sizeof(aFeatureNames) / sizeof(*aFeatureNames);
+    deviceDesc.requiredFeatures = aFeatureNames.data();
+    deviceDesc.requiredFeatureCount = aFeatureNames.size();
     deviceDesc.requiredLimits = &requireLimits;
 
     deviceDesc.SetUncapturedErrorCallback(
@@ -0,0 +1,263 @@
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include "bvh.h"
+
+constexpr uint32_t kiNumBins = 16;
+
+// traversing a node costs about as much as testing one primitive
+constexpr float kfTraversalCost = 1.0f;
+
+struct BuildBounds
+{
+    float       mafMinPosition[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float       mafMaxPosition[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+};
+
+struct BuildInput
+{
+    float3 const*               maMinPositions;
+    float3 const*               maMaxPositions;
+    std::vector<float>          mafCentroids;       // xyz per primitive
+    uint32_t                    miMaxLeafSize;
+};
+
+/*
+**
+*/
+static void growBounds(
+    BuildBounds& bounds,
+    float3 const& minPosition,
+    float3 const& maxPosition)
+{
+    bounds.mafMinPosition[0] = std::min(bounds.mafMinPosition[0], minPosition.x);
+    bounds.mafMinPosition[1] = std::min(bounds.mafMinPosition[1], minPosition.y);
+    bounds.mafMinPosition[2] = std::min(bounds.mafMinPosition[2], minPosition.z);
+    bounds.mafMaxPosition[0] = std::max(bounds.mafMaxPosition[0], maxPosition.x);
+    bounds.mafMaxPosition[1] = std::max(bounds.mafMaxPosition[1], maxPosition.y);
+    bounds.mafMaxPosition[2] = std::max(bounds.mafMaxPosition[2], maxPosition.z);
+}
+
+/*
+**
+*/
+static void growBounds(
+    BuildBounds& bounds,
+    BuildBounds const& other)
+{
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        bounds.mafMinPosition[i] = std::min(bounds.mafMinPosition[i], other.mafMinPosition[i]);
+        bounds.mafMaxPosition[i] = std::max(bounds.mafMaxPosition[i], other.mafMaxPosition[i]);
+    }
+}
+
+/*
+** half the surface area, only compared against each other
+*/
+static float getHalfArea(BuildBounds const& bounds)
+{
+    if(bounds.mafMinPosition[0] > bounds.mafMaxPosition[0])
+    {
+        return 0.0f;
+    }
+
+    float fX = bounds.mafMaxPosition[0] - bounds.mafMinPosition[0];
+    float fY = bounds.mafMaxPosition[1] - bounds.mafMinPosition[1];
+    float fZ = bounds.mafMaxPosition[2] - bounds.mafMinPosition[2];
+    return fX * fY + fY * fZ + fZ * fX;
+}
+
+/*
+** appends the node for [iStart, iEnd) of aiPrimitives, returns where its primitives split or iEnd for a leaf
+*/
+static uint32_t buildNode(
+    std::vector<BVHNode>& aNodes,
+    std::vector<uint32_t>& aiPrimitives,
+    BuildInput const& input,
+    uint32_t iStart,
+    uint32_t iEnd)
+{
+    BuildBounds bounds;
+    BuildBounds centroidBounds;
+    for(uint32_t i = iStart; i < iEnd; i++)
+    {
+        uint32_t iPrimitive = aiPrimitives[i];
+        growBounds(bounds, input.maMinPositions[iPrimitive], input.maMaxPositions[iPrimitive]);
+
+        float const* pfCentroid = &input.mafCentroids[iPrimitive * 3];
+        float3 centroid(pfCentroid[0], pfCentroid[1], pfCentroid[2]);
+        growBounds(centroidBounds, centroid, centroid);
+    }
+
+    uint32_t iNode = (uint32_t)aNodes.size();
+    BVHNode node;
+    memcpy(node.mafMinPosition, bounds.mafMinPosition, sizeof(node.mafMinPosition));
+    memcpy(node.mafMaxPosition, bounds.mafMaxPosition, sizeof(node.mafMaxPosition));
+    node.miFirst = iStart;
+    node.miCount = iEnd - iStart;
+    aNodes.push_back(node);
+
+    uint32_t iNumPrimitives = iEnd - iStart;
+    if(iNumPrimitives <= 1)
+    {
+        return iEnd;
+    }
+
+    // cheapest bin boundary over all three axes
+    float fBestCost = FLT_MAX;
+    uint32_t iBestAxis = 0;
+    uint32_t iBestSplit = 0;
+    for(uint32_t iAxis = 0; iAxis < 3; iAxis++)
+    {
+        float fMin = centroidBounds.mafMinPosition[iAxis];
+        float fExtent = centroidBounds.mafMaxPosition[iAxis] - fMin;
+        if(fExtent <= 0.0f)
+        {
+            continue;
+        }
+
+        BuildBounds aBinBounds[kiNumBins];
+        uint32_t aiBinCounts[kiNumBins] = {};
+        float fScale = (float)kiNumBins / fExtent;
+        for(uint32_t i = iStart; i < iEnd; i++)
+        {
+            uint32_t iPrimitive = aiPrimitives[i];
+            uint32_t iBin = std::min((uint32_t)((input.mafCentroids[iPrimitive * 3 + iAxis] - fMin) * fScale), kiNumBins - 1);
+            growBounds(aBinBounds[iBin], input.maMinPositions[iPrimitive], input.maMaxPositions[iPrimitive]);
+            aiBinCounts[iBin] += 1;
+        }
+
+        // sweep from the right for the right side's area and count of each split
+        float afRightAreas[kiNumBins];
+        uint32_t aiRightCounts[kiNumBins];
+        BuildBounds rightBounds;
+        uint32_t iRightCount = 0;
+        for(uint32_t iBin = kiNumBins - 1; iBin > 0; iBin--)
+        {
+            growBounds(rightBounds, aBinBounds[iBin]);
+            iRightCount += aiBinCounts[iBin];
+            afRightAreas[iBin] = getHalfArea(rightBounds);
+            aiRightCounts[iBin] = iRightCount;
+        }
+
+        BuildBounds leftBounds;
+        uint32_t iLeftCount = 0;
+        for(uint32_t iSplit = 1; iSplit < kiNumBins; iSplit++)
+        {
+            growBounds(leftBounds, aBinBounds[iSplit - 1]);
+            iLeftCount += aiBinCounts[iSplit - 1];
+            if(iLeftCount == 0 || aiRightCounts[iSplit] == 0)
+            {
+                continue;
+            }
+
+            float fCost = getHalfArea(leftBounds) * (float)iLeftCount + afRightAreas[iSplit] * (float)aiRightCounts[iSplit];
+            if(fCost < fBestCost)
+            {
+                fBestCost = fCost;
+                iBestAxis = iAxis;
+                iBestSplit = iSplit;
+            }
+        }
+    }
+
+    float fNodeArea = getHalfArea(bounds);
+    float fSplitCost = (fNodeArea > 0.0f) ? kfTraversalCost + fBestCost / fNodeArea : kfTraversalCost + (float)iNumPrimitives;
+    if(iNumPrimitives <= input.miMaxLeafSize && (fBestCost == FLT_MAX || fSplitCost >= (float)iNumPrimitives))
+    {
+        return iEnd;
+    }
+
+    uint32_t iMiddle = iStart;
+    if(fBestCost < FLT_MAX)
+    {
+        float fMin = centroidBounds.mafMinPosition[iBestAxis];
+        float fScale = (float)kiNumBins / (centroidBounds.mafMaxPosition[iBestAxis] - fMin);
+        auto middle = std::partition(
+            aiPrimitives.begin() + iStart,
+            aiPrimitives.begin() + iEnd,
+            [&](uint32_t iPrimitive)
+            {
+                uint32_t iBin = std::min((uint32_t)((input.mafCentroids[iPrimitive * 3 + iBestAxis] - fMin) * fScale), kiNumBins - 1);
+                return iBin < iBestSplit;
+            });
+        iMiddle = (uint32_t)(middle - aiPrimitives.begin());
+    }
+
+    // all the centroids in one spot, too many for a leaf
+    if(iMiddle == iStart || iMiddle == iEnd)
+    {
+        iMiddle = iStart + iNumPrimitives / 2;
+    }
+
+    aNodes[iNode].miCount = 0;
+
+    return iMiddle;
+}
+
+/*
+**
+*/
+void buildBVH(
+    std::vector<BVHNode>& aNodes,
+    std::vector<uint32_t>& aiPrimitives,
+    float3 const* aMinPositions,
+    float3 const* aMaxPositions,
+    uint32_t iNumPrimitives,
+    uint32_t iMaxLeafSize)
+{
+    aNodes.clear();
+    aiPrimitives.resize(iNumPrimitives);
+    if(iNumPrimitives == 0)
+    {
+        return;
+    }
+
+    BuildInput input;
+    input.maMinPositions = aMinPositions;
+    input.maMaxPositions = aMaxPositions;
+    input.miMaxLeafSize = std::max(iMaxLeafSize, 1u);
+    input.mafCentroids.resize(iNumPrimitives * 3);
+    for(uint32_t iPrimitive = 0; iPrimitive < iNumPrimitives; iPrimitive++)
+    {
+        float3 centroid = (aMinPositions[iPrimitive] + aMaxPositions[iPrimitive]) * 0.5f;
+        input.mafCentroids[iPrimitive * 3] = centroid.x;
+        input.mafCentroids[iPrimitive * 3 + 1] = centroid.y;
+        input.mafCentroids[iPrimitive * 3 + 2] = centroid.z;
+
+        aiPrimitives[iPrimitive] = iPrimitive;
+    }
+
+    struct BuildTask
+    {
+        uint32_t    miStart;
+        uint32_t    miEnd;
+        uint32_t    miParent;           // UINT32_MAX for the root and left children, they're placed right after their parent
+    };
+
+    // left child is popped first so each subtree is written out before its sibling, a full binary tree has at most 2n - 1 nodes
+    aNodes.reserve(iNumPrimitives * 2 - 1);
+    std::vector<BuildTask> aTasks;
+    aTasks.push_back({0, iNumPrimitives, UINT32_MAX});
+    while(aTasks.size() > 0)
+    {
+        BuildTask task = aTasks.back();
+        aTasks.pop_back();
+
+        uint32_t iNode = (uint32_t)aNodes.size();
+        if(task.miParent != UINT32_MAX)
+        {
+            aNodes[task.miParent].miFirst = iNode;
+        }
+
+        uint32_t iMiddle = buildNode(aNodes, aiPrimitives, input, task.miStart, task.miEnd);
+        if(iMiddle < task.miEnd)
+        {
+            aTasks.push_back({iMiddle, task.miEnd, iNode});
+            aTasks.push_back({task.miStart, iMiddle, UINT32_MAX});
+        }
+    }
+    aNodes.shrink_to_fit();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <math/vec.h>
+
+/*
+** "-triangles.bin" bvh sections, see Loader::MeshSectionType
+**    MeshBVHNodes and MeshBVHIndices are over the mesh extents with a mesh index per leaf entry
+**    TriangleBVHNodes and TriangleBVHIndices are over the base triangles with a base triangle index per leaf entry, meshes in order
+**    nodes are depth first, an inner node's left child is the node right after it and miFirst is its right child
+**    leaves have miCount > 0 and cover [miFirst, miFirst + miCount) of the primitive index section
+*/
+
+struct BVHNode
+{
+    float               mafMinPosition[3];
+    uint32_t            miFirst;
+    float               mafMaxPosition[3];
+    uint32_t            miCount;
+};
+static_assert(sizeof(BVHNode) == 32, "bvh node size doesn't match the file layout");
+
+// binned surface area heuristic over the primitives' bounds, aiPrimitives gets the primitive order the leaves index into
+void buildBVH(
+    std::vector<BVHNode>& aNodes,
+    std::vector<uint32_t>& aiPrimitives,
+    float3 const* aMinPositions,
+    float3 const* aMaxPositions,
+    uint32_t iNumPrimitives,
+    uint32_t iMaxLeafSize);
@@ -0,0 +1,166 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "compact_vertex.h"
+
+/*
+** round to nearest even, values past the half range are clamped to the largest finite half
+*/
+uint16_t floatToHalf(float fValue)
+{
+    uint32_t iBits = 0;
+    memcpy(&iBits, &fValue, sizeof(float));
+
+    uint32_t iSign = (iBits >> 16) & 0x8000;
+    uint32_t iAbsBits = iBits & 0x7fffffff;
+
+    // inf and nan
+    if(iAbsBits >= 0x7f800000)
+    {
+        return (uint16_t)(iSign | ((iAbsBits > 0x7f800000) ? 0x7e00 : 0x7c00));
+    }
+
+    // would round to 65520 or more
+    if(iAbsBits >= 0x477ff000)
+    {
+        return (uint16_t)(iSign | 0x7bff);
+    }
+
+    // below the smallest normal half, 2^-14
+    if(iAbsBits < 0x38800000)
+    {
+        float fAbs = 0.0f;
+        memcpy(&fAbs, &iAbsBits, sizeof(float));
+        return (uint16_t)(iSign | (uint32_t)lrintf(fAbs * 16777216.0f));
+    }
+
+    // rebias the exponent from 127 to 15, drop 13 mantissa bits
+    uint32_t iHalf = (iAbsBits - 0x38000000) >> 13;
+    uint32_t iRemainder = iAbsBits & 0x1fff;
+    if(iRemainder > 0x1000 || (iRemainder == 0x1000 && (iHalf & 1)))
+    {
+        iHalf += 1;
+    }
+
+    return (uint16_t)(iSign | iHalf);
+}
+
+/*
+**
+*/
+float halfToFloat(uint16_t iValue)
+{
+    uint32_t iSign = ((uint32_t)iValue & 0x8000) << 16;
+    uint32_t iExponent = ((uint32_t)iValue >> 10) & 0x1f;
+    uint32_t iMantissa = (uint32_t)iValue & 0x3ff;
+
+    if(iExponent == 0)
+    {
+        float fValue = (float)iMantissa / 16777216.0f;
+        return (iSign != 0) ? -fValue : fValue;
+    }
+
+    uint32_t iBits = iSign | (iMantissa << 13);
+    iBits |= (iExponent == 31) ? 0x7f800000 : ((iExponent + 112) << 23);
+
+    float fValue = 0.0f;
+    memcpy(&fValue, &iBits, sizeof(float));
+    return fValue;
+}
+
+/*
+** project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+*/
+vec2 encodeOctahedral(vec3 const& normal)
+{
+    float fL1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if(fL1 <= 0.0f)
+    {
+        return vec2(0.0f, 0.0f);
+    }
+
+    vec2 ret(normal.x / fL1, normal.y / fL1);
+    if(normal.z < 0.0f)
+    {
+        float fX = (1.0f - fabsf(ret.y)) * ((ret.x >= 0.0f) ? 1.0f : -1.0f);
+        float fY = (1.0f - fabsf(ret.x)) * ((ret.y >= 0.0f) ? 1.0f : -1.0f);
+        ret = vec2(fX, fY);
+    }
+
+    return ret;
+}
+
+/*
+** same as octDecode in deferred.shader
+*/
+vec3 decodeOctahedral(vec2 const& encoded)
+{
+    vec3 ret(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+    float fT = std::max(-ret.z, 0.0f);
+    ret.x += (ret.x >= 0.0f) ? -fT : fT;
+    ret.y += (ret.y >= 0.0f) ? -fT : fT;
+
+    return normalize(ret);
+}
+
+/*
+**
+*/
+CompactVertex encodeCompactVertex(
+    vec4 const& position,
+    vec4 const& uv,
+    vec4 const& normal,
+    vec4 const& minPosition,
+    vec4 const& maxPosition)
+{
+    CompactVertex ret = {};
+    ret.miMeshID = (uint32_t)std::max(floorf(position.w + 0.5f), 0.0f);
+
+    float const afPosition[3] = {position.x, position.y, position.z};
+    float const afMin[3] = {minPosition.x, minPosition.y, minPosition.z};
+    float const afMax[3] = {maxPosition.x, maxPosition.y, maxPosition.z};
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        // flat extents keep every vertex at the minimum
+        float fExtent = afMax[i] - afMin[i];
+        float fPct = (fExtent > 0.0f) ? std::clamp((afPosition[i] - afMin[i]) / fExtent, 0.0f, 1.0f) : 0.0f;
+        ret.maiPosition[i] = (uint16_t)lrintf(fPct * 65535.0f);
+    }
+
+    vec2 octahedral = encodeOctahedral(vec3(normal.x, normal.y, normal.z));
+    ret.maiNormal[0] = (int16_t)lrintf(std::clamp(octahedral.x, -1.0f, 1.0f) * 32767.0f);
+    ret.maiNormal[1] = (int16_t)lrintf(std::clamp(octahedral.y, -1.0f, 1.0f) * 32767.0f);
+
+    ret.maiUV[0] = floatToHalf(uv.x);
+    ret.maiUV[1] = floatToHalf(uv.y);
+
+    return ret;
+}
+
+/*
+**
+*/
+void decodeCompactVertex(
+    vec4& position,
+    vec4& uv,
+    vec4& normal,
+    CompactVertex const& vertex,
+    vec4 const& minPosition,
+    vec4 const& maxPosition)
+{
+    float fMeshID = (float)vertex.miMeshID;
+
+    position = vec4(
+        minPosition.x + (maxPosition.x - minPosition.x) * ((float)vertex.maiPosition[0] / 65535.0f),
+        minPosition.y + (maxPosition.y - minPosition.y) * ((float)vertex.maiPosition[1] / 65535.0f),
+        minPosition.z + (maxPosition.z - minPosition.z) * ((float)vertex.maiPosition[2] / 65535.0f),
+        fMeshID);
+
+    uv = vec4(halfToFloat(vertex.maiUV[0]), halfToFloat(vertex.maiUV[1]), fMeshID, 0.0f);
+
+    vec2 octahedral(
+        std::max((float)vertex.maiNormal[0] / 32767.0f, -1.0f),
+        std::max((float)vertex.maiNormal[1] / 32767.0f, -1.0f));
+    vec3 decodedNormal = decodeOctahedral(octahedral);
+    normal = vec4(decodedNormal.x, decodedNormal.y, decodedNormal.z, 1.0f);
+}
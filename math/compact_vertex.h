@@ -0,0 +1,56 @@
+#pragma once
+
+#include <math/vec.h>
+
+/*
+** "-triangles.bin" vertex sizes, the vertex section's stride tells the versions apart
+*/
+constexpr uint32_t kiLegacyVertexSize = 48;            // v1, position, uv and normal as float4, mesh id in position.w and uv.z
+constexpr uint32_t kiCompactVertexSize = 20;           // v2, CompactVertex
+
+/*
+** "-triangles.bin" index sections, see Loader::MeshSectionType
+**    meshes whose vertices span less than 65536 get 16 bit indices relative to their first vertex, the base vertex of the draw
+**    MeshBaseVertices has one per mesh, SmallIndices is padded with a zero index to whole words
+**    ranges, meshlets and lods of 16 bit meshes index the 16 bit list
+*/
+constexpr uint32_t kiWideIndexBaseVertex = 0xffffffff;            // base vertex of meshes in the 32 bit list
+
+/*
+** v2 vertex, 20 bytes
+**    mesh id
+**    position quantized to 16 bits within the mesh's extent
+**    octahedral normal, 16 bit signed normalized
+**    half float uv
+*/
+struct CompactVertex
+{
+    uint32_t            miMeshID;
+    uint16_t            maiPosition[4];                 // w is padding, unorm16x4 is the smallest vertex format that holds xyz
+    int16_t             maiNormal[2];
+    uint16_t            maiUV[2];
+};
+static_assert(sizeof(CompactVertex) == kiCompactVertexSize, "compact vertex size doesn't match the vertex layout");
+
+uint16_t floatToHalf(float fValue);
+float halfToFloat(uint16_t iValue);
+
+vec2 encodeOctahedral(vec3 const& normal);
+vec3 decodeOctahedral(vec2 const& encoded);
+
+// mesh id is taken from position.w
+CompactVertex encodeCompactVertex(
+    vec4 const& position,
+    vec4 const& uv,
+    vec4 const& normal,
+    vec4 const& minPosition,
+    vec4 const& maxPosition);
+
+// restores the v1 layout, mesh id in position.w and uv.z
+void decodeCompactVertex(
+    vec4& position,
+    vec4& uv,
+    vec4& normal,
+    CompactVertex const& vertex,
+    vec4 const& minPosition,
+    vec4 const& maxPosition);
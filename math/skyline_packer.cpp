@@ -0,0 +1,171 @@
+#include <algorithm>
+#include "skyline_packer.h"
+
+/*
+**
+*/
+CSkylinePacker::CSkylinePacker(
+    uint32_t iPageWidth,
+    uint32_t iPageHeight,
+    uint32_t iMaxPages) :
+    miPageWidth(iPageWidth),
+    miPageHeight(iPageHeight),
+    miMaxPages(iMaxPages)
+{
+}
+
+/*
+** first page with room, in the order they were opened
+*/
+bool CSkylinePacker::insert(
+    PackedRect& rect,
+    uint32_t iWidth,
+    uint32_t iHeight)
+{
+    if(iWidth == 0 || iHeight == 0 || iWidth > miPageWidth || iHeight > miPageHeight)
+    {
+        return false;
+    }
+
+    for(uint32_t iPage = 0; iPage <= (uint32_t)maPages.size(); iPage++)
+    {
+        if(iPage == (uint32_t)maPages.size())
+        {
+            if(iPage >= miMaxPages)
+            {
+                break;
+            }
+
+            Page page;
+            page.maSkyline.push_back({0, 0, miPageWidth});
+            maPages.push_back(page);
+        }
+
+        uint32_t iSegment = 0, iY = 0;
+        if(findPosition(iSegment, iY, maPages[iPage], iWidth, iHeight))
+        {
+            rect.miPage = iPage;
+            rect.miX = maPages[iPage].maSkyline[iSegment].miX;
+            rect.miY = iY;
+            place(maPages[iPage], iSegment, iY, iWidth, iHeight);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+**
+*/
+uint32_t CSkylinePacker::getNumPages() const
+{
+    return (uint32_t)maPages.size();
+}
+
+/*
+**
+*/
+uint32_t CSkylinePacker::getUsedHeight(uint32_t iPage) const
+{
+    return (iPage < (uint32_t)maPages.size()) ? maPages[iPage].miUsedHeight : 0;
+}
+
+/*
+**
+*/
+uint64_t CSkylinePacker::getUsedArea(uint32_t iPage) const
+{
+    return (iPage < (uint32_t)maPages.size()) ? maPages[iPage].miUsedArea : 0;
+}
+
+/*
+** left edge at each segment, resting on the highest segment under the rectangle, lowest top wins and then the leftmost
+*/
+bool CSkylinePacker::findPosition(
+    uint32_t& iSegment,
+    uint32_t& iY,
+    Page const& page,
+    uint32_t iWidth,
+    uint32_t iHeight) const
+{
+    std::vector<SkylineSegment> const& aSkyline = page.maSkyline;
+
+    uint32_t iBestTop = UINT32_MAX;
+    for(uint32_t i = 0; i < (uint32_t)aSkyline.size(); i++)
+    {
+        if(aSkyline[i].miX + iWidth > miPageWidth)
+        {
+            break;
+        }
+
+        // the segments cover the page width, so the rectangle always ends on one of them
+        uint32_t iRestY = 0;
+        uint32_t iRemaining = iWidth;
+        for(uint32_t j = i; iRemaining > 0; j++)
+        {
+            iRestY = std::max(iRestY, aSkyline[j].miY);
+            iRemaining -= std::min(iRemaining, aSkyline[j].miWidth);
+        }
+
+        if(iRestY + iHeight <= miPageHeight && iRestY + iHeight < iBestTop)
+        {
+            iBestTop = iRestY + iHeight;
+            iSegment = i;
+            iY = iRestY;
+        }
+    }
+
+    return (iBestTop != UINT32_MAX);
+}
+
+/*
+** the rectangle's top becomes a segment, the ones it covers are cut back and equal neighbours merged
+*/
+void CSkylinePacker::place(
+    Page& page,
+    uint32_t iSegment,
+    uint32_t iY,
+    uint32_t iWidth,
+    uint32_t iHeight)
+{
+    std::vector<SkylineSegment>& aSkyline = page.maSkyline;
+
+    SkylineSegment segment = {aSkyline[iSegment].miX, iY + iHeight, iWidth};
+    aSkyline.insert(aSkyline.begin() + iSegment, segment);
+
+    uint32_t iRight = segment.miX + segment.miWidth;
+    for(uint32_t i = iSegment + 1; i < (uint32_t)aSkyline.size();)
+    {
+        if(aSkyline[i].miX >= iRight)
+        {
+            break;
+        }
+
+        uint32_t iCovered = iRight - aSkyline[i].miX;
+        if(aSkyline[i].miWidth <= iCovered)
+        {
+            aSkyline.erase(aSkyline.begin() + i);
+            continue;
+        }
+
+        aSkyline[i].miX += iCovered;
+        aSkyline[i].miWidth -= iCovered;
+        break;
+    }
+
+    for(uint32_t i = 1; i < (uint32_t)aSkyline.size();)
+    {
+        if(aSkyline[i - 1].miY == aSkyline[i].miY)
+        {
+            aSkyline[i - 1].miWidth += aSkyline[i].miWidth;
+            aSkyline.erase(aSkyline.begin() + i);
+            continue;
+        }
+        ++i;
+    }
+
+    page.miUsedHeight = std::max(page.miUsedHeight, iY + iHeight);
+    page.miUsedArea += (uint64_t)iWidth * iHeight;
+}
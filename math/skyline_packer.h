@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+** bottom left skyline packing over pages of the same size
+**    each page keeps the top edge of what's been placed as a list of segments, a rectangle goes where its top ends lowest
+**    pages are tried in the order they were opened, a new one is opened once a rectangle fits none of them
+*/
+
+struct PackedRect
+{
+    uint32_t            miPage;
+    uint32_t            miX;
+    uint32_t            miY;
+};
+
+class CSkylinePacker
+{
+public:
+    CSkylinePacker(
+        uint32_t iPageWidth,
+        uint32_t iPageHeight,
+        uint32_t iMaxPages);
+
+    // false if the rectangle is larger than a page or none of the pages left has room for it
+    bool insert(
+        PackedRect& rect,
+        uint32_t iWidth,
+        uint32_t iHeight);
+
+    uint32_t getNumPages() const;
+
+    // lowest height the page can be trimmed to
+    uint32_t getUsedHeight(uint32_t iPage) const;
+
+    // area of the rectangles placed on the page
+    uint64_t getUsedArea(uint32_t iPage) const;
+
+protected:
+    struct SkylineSegment
+    {
+        uint32_t        miX;
+        uint32_t        miY;
+        uint32_t        miWidth;
+    };
+
+    struct Page
+    {
+        std::vector<SkylineSegment>     maSkyline;          // left to right, covering the page width
+        uint32_t                        miUsedHeight = 0;
+        uint64_t                        miUsedArea = 0;
+    };
+
+    bool findPosition(
+        uint32_t& iSegment,
+        uint32_t& iY,
+        Page const& page,
+        uint32_t iWidth,
+        uint32_t iHeight) const;
+
+    void place(
+        Page& page,
+        uint32_t iSegment,
+        uint32_t iY,
+        uint32_t iWidth,
+        uint32_t iHeight);
+
+protected:
+    uint32_t                            miPageWidth;
+    uint32_t                            miPageHeight;
+    uint32_t                            miMaxPages;
+    std::vector<Page>                   maPages;
+};
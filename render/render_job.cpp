@@ -3,6 +3,7 @@
 #include <loader/loader.h>
 #include <utils/LogPrint.h>
 
+#include <algorithm>
 #include <sstream>
 
 namespace Render
@@ -125,12 +126,18 @@ namespace Render
             else if(attachmentType == "BufferOutput")
             {
                 std::string usage = "";
-                uint32_t iSize = attachment["Size"].GetUint();
+                uint64_t iSize = attachment["Size"].GetUint();
                 if(attachment.HasMember("Usage"))
                 {
                     usage = attachment["Usage"].GetString();
                 }
 
+                // one entry per meshlet, "Size" is the least it gets
+                if(attachment.HasMember("SizePerCluster"))
+                {
+                    iSize = std::max(iSize, (uint64_t)attachment["SizePerCluster"].GetUint() * createInfo.miNumMeshClusters);
+                }
+
                 wgpu::BufferDescriptor bufferDesc = {};
                 bufferDesc.size = iSize;
                 bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
@@ -423,13 +430,17 @@ namespace Render
         // shader code
         wgpu::ShaderModuleWGSLDescriptor wgslDesc = {};
         std::string shaderPath = std::string("shaders/") + doc["Shader"].GetString();
-#if defined(__EMSCRIPTEN__)
+
+        // builds without multi draw issue a draw per meshlet slot, same condition as the draw loop in CRenderer::draw
+#if defined(__EMSCRIPTEN__) || !defined(_MSC_VER)
         if(doc.HasMember("Emscripten Shader"))
         {
             shaderPath = std::string("shaders/") + doc["Emscripten Shader"].GetString();
             printf("!!! USE EMSCRIPTEN SHADER !!!\n");
         }
+#endif // __EMSCRIPTEN__ || !_MSC_VER
 
+#if defined(__EMSCRIPTEN__)
         char* acShaderFileContent = nullptr;
         Loader::loadFile(
             &acShaderFileContent,
@@ -582,20 +593,67 @@ namespace Render
             fragmentState.targets = aColorTargetState.data();
             fragmentState.entryPoint = "fs_main";
 
-            attrib.format = wgpu::VertexFormat::Float32x4;
-            attrib.offset = 0;
-            attrib.shaderLocation = 0;
-            aVertexAttributes.push_back(attrib);
-            attrib.offset = sizeof(float4);
-            attrib.shaderLocation = 1;
-            aVertexAttributes.push_back(attrib);
-            attrib.offset = sizeof(float4) * 2;
-            attrib.shaderLocation = 2;
-            aVertexAttributes.push_back(attrib);
+            // "VertexFormat" lists the attributes in shader location order, three float4s if the pipeline doesn't say
+            std::vector<std::string> aVertexFormats = {"Vec4", "Vec4", "Vec4"};
+            if(doc.HasMember("VertexFormat"))
+            {
+                aVertexFormats.clear();
+                for(auto const& vertexFormat : doc["VertexFormat"].GetArray())
+                {
+                    aVertexFormats.push_back(vertexFormat.GetString());
+                }
+            }
+
+            uint32_t iVertexStride = 0;
+            for(uint32_t iLocation = 0; iLocation < (uint32_t)aVertexFormats.size(); iLocation++)
+            {
+                uint32_t iAttributeSize = 0;
+                std::string const& vertexFormat = aVertexFormats[iLocation];
+                if(vertexFormat == "Vec4")
+                {
+                    attrib.format = wgpu::VertexFormat::Float32x4;
+                    iAttributeSize = sizeof(float4);
+                }
+                else if(vertexFormat == "UInt")
+                {
+                    attrib.format = wgpu::VertexFormat::Uint32;
+                    iAttributeSize = sizeof(uint32_t);
+                }
+                else if(vertexFormat == "Unorm16x4")
+                {
+                    attrib.format = wgpu::VertexFormat::Unorm16x4;
+                    iAttributeSize = sizeof(uint16_t) * 4;
+                }
+                else if(vertexFormat == "Snorm16x2")
+                {
+                    attrib.format = wgpu::VertexFormat::Snorm16x2;
+                    iAttributeSize = sizeof(int16_t) * 2;
+                }
+                else if(vertexFormat == "Half2")
+                {
+                    attrib.format = wgpu::VertexFormat::Float16x2;
+                    iAttributeSize = sizeof(uint16_t) * 2;
+                }
+                else
+                {
+                    DEBUG_PRINTF("%s : %d unknown vertex format \"%s\" in \"%s\"\n",
+                        __FILE__,
+                        __LINE__,
+                        vertexFormat.c_str(),
+                        createInfo.mPipelineFilePath.c_str());
+                    assert(!"no such vertex format");
+                    continue;
+                }
+
+                attrib.offset = iVertexStride;
+                attrib.shaderLocation = iLocation;
+                aVertexAttributes.push_back(attrib);
+                iVertexStride += iAttributeSize;
+            }
 
             // vertex layout
-            vertexBufferLayout.attributeCount = 3;
-            vertexBufferLayout.arrayStride = sizeof(float4) * 3;
+            vertexBufferLayout.attributeCount = (uint32_t)aVertexAttributes.size();
+            vertexBufferLayout.arrayStride = iVertexStride;
             vertexBufferLayout.attributes = aVertexAttributes.data();
             vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
 
@@ -708,6 +766,7 @@ namespace Render
 
         // shader resouces in group 1
         iIndex = 0;
+        bool bDiffuseTextureArray = false;
         for(auto const& uniformInfo : mUniformOrder)
         {
             std::string const& uniformName = uniformInfo.first;
@@ -727,10 +786,20 @@ namespace Render
 
                 if(uniformUsage == "texture_array")
                 {
+                    bindingLayout.texture.viewDimension = wgpu::TextureViewDimension::e2DArray;
                     if(uniformName == "totalDiffuseTextures")
                     {
                         bindGroupEntry.textureView = *createInfo.mpTotalDiffuseTextureView;
+                        bDiffuseTextureArray = true;
                     }
+                    else if(uniformName == "virtualTextureIndirection")
+                    {
+                        bindGroupEntry.textureView = *createInfo.mpVirtualTextureIndirectionView;
+                    }
+                }
+                else if(uniformName == "virtualTexturePhysicalPages")
+                {
+                    bindGroupEntry.textureView = *createInfo.mpVirtualTexturePhysicalView;
                 }
                 else
                 {
@@ -834,6 +903,28 @@ namespace Render
             ++iIndex;
         }
 
+        // filtered lookups into the diffuse atlas, right after the default sampler
+        if(bDiffuseTextureArray && createInfo.mpDiffuseTextureSampler != nullptr)
+        {
+            wgpu::BindGroupEntry bindGroupEntry = {};
+            wgpu::BindGroupLayoutEntry bindingLayout = {};
+
+            bindGroupEntry.binding = iIndex;
+            bindGroupEntry.sampler = *createInfo.mpDiffuseTextureSampler;
+
+            bindingLayout.binding = iIndex;
+            bindingLayout.sampler.type = wgpu::SamplerBindingType::Filtering;
+            bindingLayout.visibility = wgpu::ShaderStage::Fragment;
+
+            aaBindGroupLayoutEntries[1].push_back(bindingLayout);
+            aaBindingGroupEntries[1].push_back(bindGroupEntry);
+
+            DEBUG_PRINTF("\tgroup 1 binding %d \"diffuse texture sampler\"\n",
+                iIndex);
+
+            ++iIndex;
+        }
+
         // bind group layouts
         std::vector<wgpu::BindGroupLayout> aBindGroupLayout(2);
         for(uint32_t iGroup = 0; iGroup < 2; iGroup++)
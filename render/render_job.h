@@ -36,10 +36,16 @@ namespace Render
 
 			wgpu::Sampler*											mpSampler;
 
+			// "SizePerCluster" buffer outputs are sized from it
+			uint32_t											miNumMeshClusters = 0;
+
 			wgpu::Buffer(*mpfnGetBuffer)(uint32_t& iBufferSize, std::string const& bufferName, void* pUserData);
 			void* mpUserData = nullptr;
 
 			wgpu::TextureView*									mpTotalDiffuseTextureView = nullptr;
+			wgpu::Sampler*										mpDiffuseTextureSampler = nullptr;
+			wgpu::TextureView*									mpVirtualTextureIndirectionView = nullptr;
+			wgpu::TextureView*									mpVirtualTexturePhysicalView = nullptr;
 			wgpu::Texture*										mpDrawTextOutputAttachment = nullptr;
 		};
 	public:
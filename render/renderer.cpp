@@ -5,7 +5,10 @@
 #include <rapidjson/document.h>
 #include <math/vec.h>
 #include <math/mat4.h>
+#include <math/compact_vertex.h>
 #include <loader/loader.h>
+#include <loader/mesh_file.h>
+#include <loader/atlas_file.h>
 #include <assert.h>
 
 #include <iostream>
@@ -36,6 +39,52 @@ struct Vertex
     vec4        mNormal;
 };
 
+// culling pass lookup, the levels of a mesh are [miFirstLOD, miFirstLOD + miNumLODs) in the lod level buffer
+// miBaseVertex is added to the mesh's 16 bit indices, kiWideIndexBaseVertex for meshes in the 32 bit index buffer
+struct MeshLODRange
+{
+    uint32_t    miFirstCluster;
+    uint32_t    miFirstLOD;
+    uint32_t    miNumLODs;
+    uint32_t    miBaseVertex;
+};
+
+// pngs packed at load time sit on multiples of the alignment so their corner halves exactly down to the last level
+constexpr uint32_t kiLoadTimeAtlasNumMips = 5;
+constexpr uint32_t kiLoadTimeAtlasAlignment = 1 << (kiLoadTimeAtlasNumMips - 1);
+constexpr uint32_t kiAtlasMipUniformStride = 256;
+
+struct MeshLODLevel
+{
+    uint32_t    miFirstIndex;
+    uint32_t    miNumIndices;
+    float       mfError;
+    uint32_t    miPadding;
+};
+
+// per mesh, the transform takes the geometry mesh's vertices to this mesh. miListedMesh is entry i of the instance list, not related to mesh i,
+// [miFirstInstance, miFirstInstance + miNumInstances) of the list are the meshes drawn with this mesh's triangles, the culling pass packs the visible ones at the same offset
+struct MeshInstanceData
+{
+    float4      maTransform[3];
+    uint32_t    miGeometryMesh;
+    uint32_t    miFirstInstance;
+    uint32_t    miNumInstances;
+    uint32_t    miListedMesh;
+};
+
+struct Material
+{
+    float4 mDiffuse;
+    float4 mSpecular;
+    float4 mEmissive;
+
+    uint32_t miID;
+    uint32_t miAlbedoTextureID;
+    uint32_t miNormalTextureID;
+    uint32_t miEmissiveTextureID;
+};
+
 struct DefaultUniformData
 {
     int32_t miScreenWidth = 0;
@@ -104,78 +153,421 @@ void streamBinary(
 
 namespace Render
 {
+    /*
+    ** v1 mesh files are re-encoded while they load, the deferred pipelines only take CompactVertex
+    */
+    static CompactVertex encodeLegacyVertex(
+        char const* pcLegacyVertex,
+        CRenderer::MeshExtent const* pMeshExtents,
+        uint32_t iNumMeshes)
+    {
+        Vertex vertex;
+        memcpy(&vertex, pcLegacyVertex, sizeof(Vertex));
+
+        // out of range ids fall back to the total extent at the end of the list
+        uint32_t iMesh = std::min((uint32_t)std::max(vertex.mPosition.w + 0.5f, 0.0f), iNumMeshes);
+        return encodeCompactVertex(
+            vertex.mPosition,
+            vertex.mUV,
+            vertex.mNormal,
+            pMeshExtents[iMesh].mMinPosition,
+            pMeshExtents[iMesh].mMaxPosition);
+    }
+
     /*
     **
     */
     void CRenderer::setup(CreateDescriptor& desc)
     {
+        auto setupStart = std::chrono::high_resolution_clock::now();
         mCreateDesc = desc;
 
         mpDevice = desc.mpDevice;
         wgpu::Device& device = *mpDevice;
 
-        
+        // one open / fetch for the whole scene if the converter emitted a bundle, the loose files otherwise
+        Loader::mountBundle(desc.mMeshFilePath + ".bundle");
+
+        // sections by type, pointing into the loaded file or into the copies of the ones that aren't uploaded while streaming
+        std::map<uint32_t, std::span<char const>> aSectionData;
+        uint32_t iNumTotalVertices = 0;
+        uint32_t iNumTotalTriangles = 0;
+        wgpu::BufferDescriptor bufferDesc = {};
+
 #if defined(__EMSCRIPTEN__)
         char* acTriangleBuffer = nullptr;
         uint64_t iSize = Loader::loadFile(&acTriangleBuffer, desc.mMeshFilePath + "-triangles.bin");
         printf("acTriangleBuffer = 0x%X size: %lld\n", (uint32_t)acTriangleBuffer, iSize);
-        uint32_t const* piData = (uint32_t const*)acTriangleBuffer;
-#else 
-        std::vector<char> acTriangleBuffer;
-        Loader::loadFile(acTriangleBuffer, desc.mMeshFilePath + "-triangles.bin");
-        uint32_t const* piData = (uint32_t const*)acTriangleBuffer.data();
-#endif // __EMSCRIPTEN__
-        
-        uint32_t iNumMeshes = *piData++;
-        uint32_t iNumTotalVertices = *piData++;
-        uint32_t iNumTotalTriangles = *piData++;
-        uint32_t iVertexSize = *piData++;
-        uint32_t iTriangleStartOffset = *piData++;
-
-        printf("num meshes: %d\n", iNumMeshes);
-        printf("num total vertices: %d\n", iNumTotalVertices);
-
-        // triangle ranges for all the meshes
-        maMeshTriangleRanges.resize(iNumMeshes);
-        memcpy(maMeshTriangleRanges.data(), piData, sizeof(MeshTriangleRange) * iNumMeshes);
-        piData += (2 * iNumMeshes);
-
-        // the total mesh extent is at the very end of the list
-        MeshExtent const* pMeshExtent = (MeshExtent const*)piData;
-        maMeshExtents.resize(iNumMeshes + 1);
-        memcpy(maMeshExtents.data(), pMeshExtent, sizeof(MeshExtent) * (iNumMeshes + 1));
-        pMeshExtent += (iNumMeshes + 1);
-        mTotalMeshExtent = maMeshExtents.back();
 
-        // all the mesh vertices
-        std::vector<Vertex> aTotalMeshVertices(iNumTotalVertices);
-        Vertex const* pVertices = (Vertex const*)pMeshExtent;
-        memcpy(aTotalMeshVertices.data(), pVertices, iNumTotalVertices * sizeof(Vertex));
-        pVertices += iNumTotalVertices;
+        std::vector<Loader::MeshFileSection> aSections;
+        uint32_t iVersion = 0;
+        if(acTriangleBuffer == nullptr || !Loader::readMeshFileSections(aSections, iVersion, acTriangleBuffer, iSize, iSize))
+        {
+            printf("!!! invalid mesh file \"%s\" !!!\n", (desc.mMeshFilePath + "-triangles.bin").c_str());
+            aSections.clear();
+        }
 
-        // all the triangle indices
-        std::vector<uint32_t> aiTotalMeshTriangleIndices(iNumTotalTriangles * 3);
-        piData = (uint32_t const*)pVertices;
-        memcpy(aiTotalMeshTriangleIndices.data(), piData, iNumTotalTriangles * 3 * sizeof(uint32_t));
+        for(auto const& section : aSections)
+        {
+            if(iVersion < Loader::kiMeshFileVersion || Loader::checkMeshFileSection(section, acTriangleBuffer))
+            {
+                aSectionData[section.miType] = std::span<char const>(acTriangleBuffer + section.miOffset, (size_t)section.miSize);
+            }
+        }
 
-#if defined(__EMSCRIPTEN__)
-        Loader::loadFileFree(acTriangleBuffer);
-#endif // __EMSCRIPTEN__
+        // v1 vertices are re-encoded against the extents
+        std::span<char const> aMeshExtentData = aSectionData[(uint32_t)Loader::MeshSectionType::MeshExtents];
+        uint32_t iNumExtents = (uint32_t)(aMeshExtentData.size() / sizeof(MeshExtent));
+
+        // all the mesh vertices, uploaded directly from the loaded file unless it's still v1
+        Loader::MeshFileSection const* pVertexSection = Loader::findMeshFileSection(aSections, Loader::MeshSectionType::Vertices);
+        Loader::MeshFileSection const* pIndexSection = Loader::findMeshFileSection(aSections, Loader::MeshSectionType::Indices);
+        std::span<char const> aVertexData = aSectionData[(uint32_t)Loader::MeshSectionType::Vertices];
+        std::span<char const> aIndexData = aSectionData[(uint32_t)Loader::MeshSectionType::Indices];
+        char const* pcVertices = aVertexData.data();
+        if(pVertexSection != nullptr && pIndexSection != nullptr && iNumExtents > 0 &&
+           aVertexData.size() == pVertexSection->miSize && aIndexData.size() == pIndexSection->miSize)
+        {
+            iNumTotalVertices = pVertexSection->miCount;
+            iNumTotalTriangles = (uint32_t)(aIndexData.size() / (3 * sizeof(uint32_t)));
+        }
 
-        wgpu::BufferDescriptor bufferDesc = {};
+        std::vector<CompactVertex> aCompactVertices;
+        if(iNumTotalVertices > 0 && pVertexSection->miStride == kiLegacyVertexSize)
+        {
+            aCompactVertices.resize(iNumTotalVertices);
+            for(uint32_t i = 0; i < iNumTotalVertices; i++)
+            {
+                aCompactVertices[i] = encodeLegacyVertex(
+                    pcVertices + (uint64_t)i * kiLegacyVertexSize,
+                    (MeshExtent const*)aMeshExtentData.data(),
+                    iNumExtents - 1);
+            }
+            pcVertices = (char const*)aCompactVertices.data();
+        }
 
-        bufferDesc.size = iNumTotalVertices * sizeof(Vertex);
+        bufferDesc.size = (uint64_t)iNumTotalVertices * sizeof(CompactVertex);
         bufferDesc.usage = wgpu::BufferUsage::Vertex | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
         maBuffers["train-vertex-buffer"] = device.CreateBuffer(&bufferDesc);
         maBuffers["train-vertex-buffer"].SetLabel("Train Vertex Buffer");
         maBufferSizes["train-vertex-buffer"] = (uint32_t)bufferDesc.size;
 
-        bufferDesc.size = aiTotalMeshTriangleIndices.size() * sizeof(uint32_t);
+        bufferDesc.size = (uint64_t)iNumTotalTriangles * 3 * sizeof(uint32_t);
         bufferDesc.usage = wgpu::BufferUsage::Index | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
         maBuffers["train-index-buffer"] = device.CreateBuffer(&bufferDesc);
         maBuffers["train-index-buffer"].SetLabel("Train Index Buffer");
         maBufferSizes["train-index-buffer"] = (uint32_t)bufferDesc.size;
 
+        device.GetQueue().WriteBuffer(maBuffers["train-vertex-buffer"], 0, pcVertices, (uint64_t)iNumTotalVertices * sizeof(CompactVertex));
+        device.GetQueue().WriteBuffer(maBuffers["train-index-buffer"], 0, aIndexData.data(), (uint64_t)iNumTotalTriangles * 3 * sizeof(uint32_t));
+#else 
+        // small files needed before the first frame go out as one batch, the loads below are served from it
+        Loader::prefetchFiles({
+            desc.mMeshFilePath + "-texture-names.tex",
+            desc.mMeshFilePath + "-mesh-instances.bin",
+            "render-jobs/" + desc.mRenderJobPipelineFilePath,
+        });
+
+        // the rest arrives in the background and is patched in by updateAsyncLoads
+        mMaterialIDFuture = Loader::loadFileAsync(desc.mMeshFilePath + ".mid", Loader::Priority::Geometry);
+        mMaterialFuture = Loader::loadFileAsync(desc.mMeshFilePath + ".mat", Loader::Priority::Geometry);
+        mFontAtlasFuture = Loader::loadFileAsync("font-atlas.png", Loader::Priority::Font);
+        mGlyphInfoFuture = Loader::loadFileAsync("glyph_info.bin", Loader::Priority::Font);
+        mFontShaderFuture = Loader::loadFileAsync("shaders/draw_text.shader", Loader::Priority::Font, true);
+
+        std::map<uint32_t, std::vector<char>> aacStreamedSections;
+        {
+            // section table is parsed from the first bytes, vertices and indices are written straight into the mapped buffers as they arrive
+            std::vector<char> acHeader;
+            uint64_t iTableSize = 0;
+            bool bTableRead = false;
+            std::vector<Loader::MeshFileSection> aSections;
+            std::vector<Loader::CMeshFileChecksum> aChecksums;
+            uint32_t iVersion = 0;
+            uint32_t iCurrSection = 0;
+            uint64_t iFileOffset = 0;
+            char* pacMappedVertices = nullptr;
+            char* pacMappedIndices = nullptr;
+            char* pacMappedSmallIndices = nullptr;
+            char acPartialVertex[kiLegacyVertexSize];
+
+            auto createMappedBuffer = [&](std::string const& name, char const* szLabel, uint64_t iSize, wgpu::BufferUsage usage) -> char*
+            {
+                // mapped sizes have to be whole words and empty buffers can't be bound
+                bufferDesc.mappedAtCreation = true;
+                bufferDesc.size = std::max(iSize, (uint64_t)sizeof(uint32_t));
+                bufferDesc.usage = usage;
+                maBuffers[name] = device.CreateBuffer(&bufferDesc);
+                maBuffers[name].SetLabel(szLabel);
+                maBufferSizes[name] = (uint32_t)bufferDesc.size;
+                bufferDesc.mappedAtCreation = false;
+
+                return (char*)maBuffers[name].GetMappedRange(0, (size_t)bufferDesc.size);
+            };
+
+            auto streamSection = [&](Loader::MeshFileSection const& section, uint64_t iSectionOffset, char const* pcData, uint64_t iSize)
+            {
+                if(section.miType == (uint32_t)Loader::MeshSectionType::Vertices && section.miStride == kiCompactVertexSize)
+                {
+                    memcpy(pacMappedVertices + iSectionOffset, pcData, (size_t)iSize);
+                }
+                else if(section.miType == (uint32_t)Loader::MeshSectionType::Vertices)
+                {
+                    // v1, vertices can straddle chunks so the bytes of a split one are gathered before encoding it
+                    std::vector<char> const& acMeshExtents = aacStreamedSections[(uint32_t)Loader::MeshSectionType::MeshExtents];
+                    MeshExtent const* pMeshExtents = (MeshExtent const*)acMeshExtents.data();
+                    uint32_t iNumMeshes = (uint32_t)(acMeshExtents.size() / sizeof(MeshExtent)) - 1;
+                    CompactVertex* pCompactVertices = (CompactVertex*)pacMappedVertices;
+                    char const* pcLegacyVertex = pcData;
+                    uint64_t iVertexByte = iSectionOffset;
+                    uint64_t iVertexByteEnd = iVertexByte + iSize;
+                    while(iVertexByte < iVertexByteEnd)
+                    {
+                        uint64_t iVertex = iVertexByte / kiLegacyVertexSize;
+                        uint64_t iWithinVertex = iVertexByte % kiLegacyVertexSize;
+                        uint64_t iVertexBytes = std::min((uint64_t)kiLegacyVertexSize - iWithinVertex, iVertexByteEnd - iVertexByte);
+                        if(iVertexBytes == kiLegacyVertexSize)
+                        {
+                            pCompactVertices[iVertex] = encodeLegacyVertex(pcLegacyVertex, pMeshExtents, iNumMeshes);
+                        }
+                        else
+                        {
+                            memcpy(acPartialVertex + iWithinVertex, pcLegacyVertex, (size_t)iVertexBytes);
+                            if(iWithinVertex + iVertexBytes == kiLegacyVertexSize)
+                            {
+                                pCompactVertices[iVertex] = encodeLegacyVertex(acPartialVertex, pMeshExtents, iNumMeshes);
+                            }
+                        }
+
+                        pcLegacyVertex += iVertexBytes;
+                        iVertexByte += iVertexBytes;
+                    }
+                }
+                else if(section.miType == (uint32_t)Loader::MeshSectionType::Indices)
+                {
+                    memcpy(pacMappedIndices + iSectionOffset, pcData, (size_t)iSize);
+                }
+                else if(section.miType == (uint32_t)Loader::MeshSectionType::SmallIndices)
+                {
+                    memcpy(pacMappedSmallIndices + iSectionOffset, pcData, (size_t)iSize);
+                }
+                else
+                {
+                    // ranges, extents, meshlets, lods, bvh and whatever an older file has after its indices
+                    std::vector<char>& acSectionData = aacStreamedSections[section.miType];
+                    acSectionData.insert(acSectionData.end(), pcData, pcData + iSize);
+                }
+            };
+
+            auto streamTriangleFile = [&](std::span<char const> aChunk, uint64_t iTotalSize) -> bool
+            {
+                char const* pcData = aChunk.data();
+                uint64_t iRemaining = aChunk.size();
+                while(iRemaining > 0)
+                {
+                    if(!bTableRead)
+                    {
+                        uint64_t iHeaderTarget = (iTableSize == 0) ? Loader::kiMeshFileProbeSize : iTableSize;
+                        uint64_t iCopySize = std::min(iRemaining, iHeaderTarget - iFileOffset);
+                        acHeader.insert(acHeader.end(), pcData, pcData + iCopySize);
+                        pcData += iCopySize;
+                        iRemaining -= iCopySize;
+                        iFileOffset += iCopySize;
+
+                        if(iTableSize == 0 && iFileOffset == Loader::kiMeshFileProbeSize)
+                        {
+                            iTableSize = Loader::getMeshFileTableSize(acHeader.data(), acHeader.size());
+                            if(iTableSize == 0)
+                            {
+                                DEBUG_PRINTF("%s : %d not a mesh file\n",
+                                    __FILE__,
+                                    __LINE__);
+                                return false;
+                            }
+                        }
+
+                        if(iTableSize > 0 && iFileOffset >= iTableSize)
+                        {
+                            if(!Loader::readMeshFileSections(aSections, iVersion, acHeader.data(), acHeader.size(), iTotalSize))
+                            {
+                                return false;
+                            }
+                            aChecksums.resize(aSections.size());
+                            bTableRead = true;
+
+                            // sizes are known from the table, map the destination buffers for the rest of the file
+                            Loader::MeshFileSection const* pVertices = Loader::findMeshFileSection(aSections, Loader::MeshSectionType::Vertices);
+                            Loader::MeshFileSection const* pIndices = Loader::findMeshFileSection(aSections, Loader::MeshSectionType::Indices);
+                            Loader::MeshFileSection const* pSmallIndices = Loader::findMeshFileSection(aSections, Loader::MeshSectionType::SmallIndices);
+                            iNumTotalVertices = pVertices->miCount;
+                            iNumTotalTriangles = pIndices->miCount / 3;
+                            pacMappedVertices = createMappedBuffer(
+                                "train-vertex-buffer",
+                                "Train Vertex Buffer",
+                                (uint64_t)iNumTotalVertices * sizeof(CompactVertex),
+                                wgpu::BufferUsage::Vertex | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst);
+                            pacMappedIndices = createMappedBuffer(
+                                "train-index-buffer",
+                                "Train Index Buffer",
+                                pIndices->miSize,
+                                wgpu::BufferUsage::Index | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst);
+                            if(pSmallIndices != nullptr)
+                            {
+                                pacMappedSmallIndices = createMappedBuffer(
+                                    "train-index-buffer-16",
+                                    "Train Index Buffer 16",
+                                    pSmallIndices->miSize,
+                                    wgpu::BufferUsage::Index | wgpu::BufferUsage::CopyDst);
+                            }
+
+                            // older files have their ranges and extents in what was read as the header
+                            for(auto const& section : aSections)
+                            {
+                                if(section.miOffset + section.miSize <= iTableSize)
+                                {
+                                    streamSection(section, 0, acHeader.data() + section.miOffset, section.miSize);
+                                }
+                            }
+                        }
+
+                        continue;
+                    }
+
+                    // sections are sorted by offset, the bytes between them are alignment padding
+                    while(iCurrSection < (uint32_t)aSections.size() && aSections[iCurrSection].miOffset + aSections[iCurrSection].miSize <= iFileOffset)
+                    {
+                        ++iCurrSection;
+                    }
+
+                    uint64_t iCopySize = iRemaining;
+                    if(iCurrSection < (uint32_t)aSections.size())
+                    {
+                        Loader::MeshFileSection const& section = aSections[iCurrSection];
+                        if(iFileOffset < section.miOffset)
+                        {
+                            iCopySize = std::min(iRemaining, section.miOffset - iFileOffset);
+                        }
+                        else
+                        {
+                            iCopySize = std::min(iRemaining, section.miOffset + section.miSize - iFileOffset);
+                            streamSection(section, iFileOffset - section.miOffset, pcData, iCopySize);
+                            if(iVersion >= Loader::kiMeshFileVersion)
+                            {
+                                aChecksums[iCurrSection].update(pcData, iCopySize);
+                            }
+                        }
+                    }
+                    pcData += iCopySize;
+                    iRemaining -= iCopySize;
+                    iFileOffset += iCopySize;
+                }
+
+                return true;
+            };
+
+            // everything but the tail of an older file has to arrive
+            bool bStreamed = Loader::streamFile(desc.mMeshFilePath + "-triangles.bin", streamTriangleFile);
+            uint64_t iRequiredSize = iTableSize;
+            for(auto const& section : aSections)
+            {
+                if(section.miType != (uint32_t)Loader::MeshSectionType::LegacySections)
+                {
+                    iRequiredSize = std::max(iRequiredSize, section.miOffset + section.miSize);
+                }
+            }
+
+            bool bComplete = (bStreamed && bTableRead && iFileOffset >= iRequiredSize);
+            if(!bComplete)
+            {
+                DEBUG_PRINTF("%s : %d incomplete mesh file \"%s\" (%lld bytes)\n",
+                    __FILE__,
+                    __LINE__,
+                    (desc.mMeshFilePath + "-triangles.bin").c_str(),
+                    (long long)iFileOffset);
+            }
+
+            // a section that doesn't match its checksum is dropped, one that was streamed into a gpu buffer drops the whole file
+            for(uint32_t i = 0; bComplete && iVersion >= Loader::kiMeshFileVersion && i < (uint32_t)aChecksums.size(); i++)
+            {
+                if(aChecksums[i].get() != aSections[i].miChecksum)
+                {
+                    DEBUG_PRINTF("%s : %d mesh file section 0x%08x checksum 0x%08x doesn\'t match 0x%08x\n",
+                        __FILE__,
+                        __LINE__,
+                        aSections[i].miType,
+                        aChecksums[i].get(),
+                        aSections[i].miChecksum);
+                    aacStreamedSections.erase(aSections[i].miType);
+
+                    if(aSections[i].miType == (uint32_t)Loader::MeshSectionType::Vertices ||
+                       aSections[i].miType == (uint32_t)Loader::MeshSectionType::Indices ||
+                       aSections[i].miType == (uint32_t)Loader::MeshSectionType::SmallIndices)
+                    {
+                        bComplete = false;
+                    }
+                }
+            }
+
+            for(auto const& bufferName : {"train-vertex-buffer", "train-index-buffer", "train-index-buffer-16"})
+            {
+                if(maBuffers.find(bufferName) != maBuffers.end())
+                {
+                    maBuffers[bufferName].Unmap();
+                    if(!bComplete)
+                    {
+                        maBuffers[bufferName].Destroy();
+                        maBuffers.erase(bufferName);
+                        maBufferSizes.erase(bufferName);
+                    }
+                }
+            }
+
+            if(!bComplete)
+            {
+                // nothing that wasn't verified gets drawn, carry on with an empty scene
+                iNumTotalVertices = iNumTotalTriangles = 0;
+                aacStreamedSections.clear();
+
+                bufferDesc.size = sizeof(uint32_t);
+                bufferDesc.usage = wgpu::BufferUsage::Vertex | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+                maBuffers["train-vertex-buffer"] = device.CreateBuffer(&bufferDesc);
+                maBuffers["train-vertex-buffer"].SetLabel("Train Vertex Buffer");
+                maBufferSizes["train-vertex-buffer"] = (uint32_t)bufferDesc.size;
+
+                bufferDesc.usage = wgpu::BufferUsage::Index | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+                maBuffers["train-index-buffer"] = device.CreateBuffer(&bufferDesc);
+                maBuffers["train-index-buffer"].SetLabel("Train Index Buffer");
+                maBufferSizes["train-index-buffer"] = (uint32_t)bufferDesc.size;
+            }
+        }
+
+        for(auto const& keyValue : aacStreamedSections)
+        {
+            aSectionData[keyValue.first] = std::span<char const>(keyValue.second.data(), keyValue.second.size());
+        }
+#endif // __EMSCRIPTEN__
+
+        // triangle ranges for all the meshes
+        std::span<char const> aMeshRangeData = aSectionData[(uint32_t)Loader::MeshSectionType::MeshRanges];
+        std::span<char const> aMeshExtentData = aSectionData[(uint32_t)Loader::MeshSectionType::MeshExtents];
+        uint32_t iNumMeshes = (uint32_t)(aMeshRangeData.size() / sizeof(MeshTriangleRange));
+        if(aMeshExtentData.size() != (iNumMeshes + 1) * sizeof(MeshExtent))
+        {
+            iNumMeshes = 0;
+        }
+        maMeshTriangleRanges.resize(iNumMeshes);
+        memcpy(maMeshTriangleRanges.data(), aMeshRangeData.data(), sizeof(MeshTriangleRange) * iNumMeshes);
+
+        // the total mesh extent is at the very end of the list
+        maMeshExtents.assign(iNumMeshes + 1, MeshExtent{});
+        memcpy(maMeshExtents.data(), aMeshExtentData.data(), std::min(aMeshExtentData.size(), sizeof(MeshExtent) * (iNumMeshes + 1)));
+        mTotalMeshExtent = maMeshExtents.back();
+
+        printf("num meshes: %d\n", iNumMeshes);
+        printf("num total vertices: %d\n", iNumTotalVertices);
+
+        setupMeshSections(aSectionData, iNumTotalTriangles * 3);
+
         bufferDesc.size = iNumTotalVertices * sizeof(Vertex);
         bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
         maBuffers["meshTriangleIndexRanges"] = device.CreateBuffer(&bufferDesc);
@@ -188,74 +580,90 @@ namespace Render
         maBuffers["meshExtents"].SetLabel("Train Mesh Extents");
         maBufferSizes["meshExtents"] = (uint32_t)bufferDesc.size;
 
-        device.GetQueue().WriteBuffer(maBuffers["train-vertex-buffer"], 0, aTotalMeshVertices.data(), iNumTotalVertices * sizeof(Vertex));
-        device.GetQueue().WriteBuffer(maBuffers["train-index-buffer"], 0, aiTotalMeshTriangleIndices.data(), aiTotalMeshTriangleIndices.size() * sizeof(uint32_t));
         device.GetQueue().WriteBuffer(maBuffers["meshTriangleIndexRanges"], 0, maMeshTriangleRanges.data(), maMeshTriangleRanges.size() * sizeof(MeshTriangleRange));
         device.GetQueue().WriteBuffer(maBuffers["meshExtents"], 0, maMeshExtents.data(), maMeshExtents.size() * sizeof(MeshExtent));
 
+#if defined(__EMSCRIPTEN__)
+        Loader::loadFileFree(acTriangleBuffer);
+
+        {
+            char* acInstanceData = nullptr;
+            uint64_t iInstanceDataSize = Loader::loadFile(&acInstanceData, desc.mMeshFilePath + "-mesh-instances.bin");
+            setupMeshInstances(acInstanceData, (acInstanceData != nullptr) ? iInstanceDataSize : 0);
+            Loader::loadFileFree(acInstanceData);
+        }
+#else
         {
+            Loader::FileView instanceView;
+            bool bLoaded = Loader::loadFileView(instanceView, desc.mMeshFilePath + "-mesh-instances.bin");
+            setupMeshInstances(instanceView.data(), bLoaded ? instanceView.size() : 0);
+        }
+#endif // __EMSCRIPTEN__
+
 #if defined(__EMSCRIPTEN__)
+        {
             char* acMaterialID = nullptr;
             bufferDesc.size = Loader::loadFile(&acMaterialID, desc.mMeshFilePath + ".mid");
-#else 
-
-            std::vector<char> acMaterialID;
-            Loader::loadFile(acMaterialID, desc.mMeshFilePath + ".mid");
-            bufferDesc.size = acMaterialID.size();
-#endif // __EMSCRIPTEN__
 
             bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
             maBuffers["meshMaterialIDs"] = device.CreateBuffer(&bufferDesc);
             maBuffers["meshMaterialIDs"].SetLabel("Mesh Material IDs");
             maBufferSizes["meshEmeshMaterialIDsxtents"] = (uint32_t)bufferDesc.size;
 
-#if defined(__EMSCRIPTEN__)
             device.GetQueue().WriteBuffer(
                 maBuffers["meshMaterialIDs"],
                 0,
                 acMaterialID,
                 bufferDesc.size);
             Loader::loadFileFree(acMaterialID);
-#else
-            device.GetQueue().WriteBuffer(
-                maBuffers["meshMaterialIDs"],
-                0,
-                acMaterialID.data(),
-                acMaterialID.size());
-#endif // __EMSCRIPTEN__
         }
 
         {
-#if defined(__EMSCRIPTEN__)
             char* acMaterials = nullptr;
             bufferDesc.size = Loader::loadFile(&acMaterials, desc.mMeshFilePath + ".mat");
             printf("mesh material size: %d\n", (uint32_t)bufferDesc.size);
-#else
-            std::vector<char> acMaterials;
-            Loader::loadFile(acMaterials, desc.mMeshFilePath + ".mat");
 
-            bufferDesc.size = acMaterials.size();
-#endif // __EMSCRIPTEN__
             bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
             maBuffers["meshMaterials"] = device.CreateBuffer(&bufferDesc);
             maBuffers["meshMaterials"].SetLabel("Mesh Materials");
             maBufferSizes["meshMaterials"] = (uint32_t)bufferDesc.size;
 
-#if defined(__EMSCRIPTEN__)
             device.GetQueue().WriteBuffer(
                 maBuffers["meshMaterials"],
                 0,
                 acMaterials,
                 bufferDesc.size);
             Loader::loadFileFree(acMaterials);
-#else 
+        }
+#else
+        {
+            // sized by mesh count up front, all meshes use material 0 until the .mid arrives
+            bufferDesc.size = std::max(iNumMeshes, 1u) * sizeof(uint32_t);
+            bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+            maBuffers["meshMaterialIDs"] = device.CreateBuffer(&bufferDesc);
+            maBuffers["meshMaterialIDs"].SetLabel("Mesh Material IDs");
+            maBufferSizes["meshMaterialIDs"] = (uint32_t)bufferDesc.size;
+
+            // plain untextured material until the .mat arrives
+            Material defaultMaterial = {};
+            defaultMaterial.mDiffuse = float4(0.7f, 0.7f, 0.7f, 1.0f);
+            defaultMaterial.miAlbedoTextureID = UINT32_MAX;
+            defaultMaterial.miNormalTextureID = UINT32_MAX;
+            defaultMaterial.miEmissiveTextureID = UINT32_MAX;
+            std::vector<Material> aDefaultMaterials(std::max(iNumMeshes, 1u), defaultMaterial);
+
+            bufferDesc.size = aDefaultMaterials.size() * sizeof(Material);
+            bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+            maBuffers["meshMaterials"] = device.CreateBuffer(&bufferDesc);
+            maBuffers["meshMaterials"].SetLabel("Mesh Materials");
+            maBufferSizes["meshMaterials"] = (uint32_t)bufferDesc.size;
             device.GetQueue().WriteBuffer(
                 maBuffers["meshMaterials"],
                 0,
-                acMaterials.data(),
-                acMaterials.size());
-#endif // __EMSCRIPTEN__
+                aDefaultMaterials.data(),
+                bufferDesc.size);
         }
+#endif // __EMSCRIPTEN__
 
         bufferDesc.size = iNumMeshes * sizeof(uint32_t);
         bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
@@ -302,47 +710,104 @@ namespace Render
 
         mpSampler = desc.mpSampler;
         
-        struct TextureAtlasInfo
-        {
-            uint2               miTextureCoord;
-            float2              mUV;
-            uint32_t            miTextureID;
-            uint32_t            miImageWidth;
-            uint32_t            miImageHeight;
-            uint32_t            miPadding0;
-        };
-
-        std::vector<TextureAtlasInfo> aTextureAtlasInfo;
         std::vector<std::string> aDiffuseTextureNames;
         std::vector<std::string> aEmissiveTextureNames;
         std::vector<std::string> aSpecularTextureNames;
         std::vector<std::string> aNormalTextureNames;
         {
-            // diffuse texture atlas
-            int32_t iAtlasImageWidth = 8192;
-            int32_t iAtlasImageHeight = 8192;
-            wgpu::TextureFormat aViewFormats[] = {wgpu::TextureFormat::RGBA8Unorm};
-            wgpu::TextureDescriptor textureDesc = {};
-            textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
-            textureDesc.dimension = wgpu::TextureDimension::e2D;
-            textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
-            textureDesc.mipLevelCount = 1;
-            textureDesc.sampleCount = 1;
-            textureDesc.size.depthOrArrayLayers = 1;
-            textureDesc.size.width = iAtlasImageWidth;
-            textureDesc.size.height = iAtlasImageHeight;
-            textureDesc.viewFormatCount = 1;
-            textureDesc.viewFormats = aViewFormats;
-            mDiffuseTextureAtlas = device.CreateTexture(&textureDesc);
+            // diffuse texture atlas, packed and mipmapped by the converter, in the first format the device can sample
+            std::vector<Loader::AtlasFormat> aAtlasFormats;
+            if(device.HasFeature(wgpu::FeatureName::TextureCompressionBC))
+            {
+                aAtlasFormats.push_back(Loader::AtlasFormat::BC7);
+            }
+            if(device.HasFeature(wgpu::FeatureName::TextureCompressionETC2))
+            {
+                aAtlasFormats.push_back(Loader::AtlasFormat::ETC2RGBA8);
+            }
+            aAtlasFormats.push_back(Loader::AtlasFormat::RGBA8);
+
+            // a page file from "-virtual-texture" is streamed tile by tile instead, the atlas is left a placeholder
+            CVirtualTexture::CreateInfo virtualTextureCreateInfo = {};
+            virtualTextureCreateInfo.mpDevice = mpDevice;
+            virtualTextureCreateInfo.miScreenWidth = desc.miScreenWidth;
+            virtualTextureCreateInfo.miScreenHeight = desc.miScreenHeight;
+            std::vector<Loader::AtlasTextureInfo> aVirtualTextureInfo;
+            bool bBakedAtlas = mVirtualTexture.setup(
+                virtualTextureCreateInfo,
+                desc.mMeshFilePath + Loader::kszPageFileSuffix,
+                aVirtualTextureInfo);
+            if(bBakedAtlas)
+            {
+                maDiffuseTextureAtlasInfo.resize(aVirtualTextureInfo.size());
+                memcpy(maDiffuseTextureAtlasInfo.data(), aVirtualTextureInfo.data(), aVirtualTextureInfo.size() * sizeof(TextureAtlasInfo));
+
+                wgpu::TextureDescriptor textureDesc = {};
+                textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
+                textureDesc.dimension = wgpu::TextureDimension::e2D;
+                textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+                textureDesc.mipLevelCount = 1;
+                textureDesc.sampleCount = 1;
+                textureDesc.size.depthOrArrayLayers = 1;
+                textureDesc.size.width = 1;
+                textureDesc.size.height = 1;
+                mDiffuseTextureAtlas = device.CreateTexture(&textureDesc);
+            }
+            maBuffers["virtualTextureUniformBuffer"] = mVirtualTexture.getUniformBuffer();
+            maBufferSizes["virtualTextureUniformBuffer"] = (uint32_t)mVirtualTexture.getUniformBuffer().GetSize();
+            maBuffers["virtualTextureFeedback"] = mVirtualTexture.getFeedbackBuffer();
+            maBufferSizes["virtualTextureFeedback"] = (uint32_t)mVirtualTexture.getFeedbackBuffer().GetSize();
+
+            for(uint32_t i = 0; i < (uint32_t)aAtlasFormats.size() && !bBakedAtlas; i++)
+            {
+                std::string atlasFilePath = desc.mMeshFilePath + Loader::getAtlasFileSuffix(aAtlasFormats[i]);
+#if defined(__EMSCRIPTEN__)
+                char* acAtlasData = nullptr;
+                uint32_t iAtlasDataSize = Loader::loadFile(&acAtlasData, atlasFilePath);
+                bBakedAtlas = (acAtlasData != nullptr && iAtlasDataSize > 0 && setupDiffuseTextureAtlas(acAtlasData, iAtlasDataSize));
+                Loader::loadFileFree(acAtlasData);
+#else
+                Loader::FileView atlasView;
+                bBakedAtlas = Loader::loadFileView(atlasView, atlasFilePath);
+                bBakedAtlas = bBakedAtlas && setupDiffuseTextureAtlas(atlasView.data(), atlasView.size());
+#endif // __EMSCRIPTEN__
+            }
+
+            // scenes converted without one have their pngs packed into a single page as they are decoded, the levels are filtered on the gpu
+            if(!bBakedAtlas)
+            {
+                int32_t iAtlasImageWidth = 8192;
+                int32_t iAtlasImageHeight = 8192;
+                wgpu::TextureFormat aViewFormats[] = {wgpu::TextureFormat::RGBA8Unorm};
+                wgpu::TextureDescriptor textureDesc = {};
+                textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::StorageBinding;
+                textureDesc.dimension = wgpu::TextureDimension::e2D;
+                textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+                textureDesc.mipLevelCount = kiLoadTimeAtlasNumMips;
+                textureDesc.sampleCount = 1;
+                textureDesc.size.depthOrArrayLayers = 1;
+                textureDesc.size.width = iAtlasImageWidth;
+                textureDesc.size.height = iAtlasImageHeight;
+                textureDesc.viewFormatCount = 1;
+                textureDesc.viewFormats = aViewFormats;
+                mDiffuseTextureAtlas = device.CreateTexture(&textureDesc);
+
+                mpDiffuseAtlasPacker = std::make_unique<CSkylinePacker>(
+                    iAtlasImageWidth / kiLoadTimeAtlasAlignment,
+                    iAtlasImageHeight / kiLoadTimeAtlasAlignment,
+                    1);
+            }
 
-            
 #if defined(__EMSCRIPTEN__)
             char* acTextureNames = nullptr;
-            uint32_t iSize = Loader::loadFile(&acTextureNames, desc.mMeshFilePath + "-texture-names.tex");
+            uint32_t iSize = bBakedAtlas ? 0 : Loader::loadFile(&acTextureNames, desc.mMeshFilePath + "-texture-names.tex");
             if(iSize > 0)
 #else 
             std::vector<char> acTextureNames;
-            Loader::loadFile(acTextureNames, desc.mMeshFilePath + "-texture-names.tex");
+            if(!bBakedAtlas)
+            {
+                Loader::loadFile(acTextureNames, desc.mMeshFilePath + "-texture-names.tex");
+            }
             if(acTextureNames.size() > 0)
 #endif // __EMSCRIPTEN__
             {
@@ -417,125 +882,67 @@ namespace Render
                 free(acTextureNames);
 #endif // __EMSCRIPTEN__
 
-                int32_t iAtlasIndex = 0;
-                int32_t iX = 0, iY = 0;
-                int32_t iLargestHeight = 0;
-
-                auto copyToAtlas = [&](
-                    int32_t& iX,
-                    int32_t& iY,
-                    int32_t iAtlasImageWidth,
-                    int32_t iAtlasImageHeight,
-                    std::string const& textureName,
-                    wgpu::Texture& textureAtlas,
-                    int32_t& iLargestHeight)
-                    {
-                        std::string parsedTextureName = std::string("textures/") + textureName;
+                // atlas slot i belongs to texture id i, textures that fail to load leave an empty slot
+                maDiffuseTextureAtlasInfo.resize(aDiffuseTextureNames.size());
 
 #if defined(__EMSCRIPTEN__)
-                        char* acTextureImageData = nullptr;
-                        uint32_t iSize = Loader::loadFile(&acTextureImageData, parsedTextureName);
-                        int32_t iImageWidth = 0, iImageHeight = 0, iImageComp = 0;
-                        stbi_uc* pImageData = stbi_load_from_memory(
-                            (stbi_uc const*)acTextureImageData,
-                            (int32_t)iSize,
-                            &iImageWidth,
-                            &iImageHeight,
-                            &iImageComp,
-                            4
-                        );
-#else
-                        std::vector<char> acTextureImageData;
-                        Loader::loadFile(acTextureImageData, parsedTextureName);
-                        int32_t iImageWidth = 0, iImageHeight = 0, iImageComp = 0;
-                        stbi_uc* pImageData = stbi_load_from_memory(
-                            (stbi_uc const*)acTextureImageData.data(),
-                            (int32_t)acTextureImageData.size(),
-                            &iImageWidth,
-                            &iImageHeight,
-                            &iImageComp,
-                            4
-                        );
-#endif // __EMSCRIPTEN__
-
-                        if(pImageData)
-                        {
-                            iLargestHeight = std::max(iLargestHeight, iImageHeight);
-                            if(iX + iImageWidth >= iAtlasImageWidth)
-                            {
-                                iX = 0;
-                                iY += iLargestHeight;
-                                iLargestHeight = 0;
-                            }
+                for(uint32_t iTexture = 0; iTexture < (uint32_t)aDiffuseTextureNames.size(); iTexture++)
+                {
+                    std::string parsedTextureName = std::string("textures/") + aDiffuseTextureNames[iTexture];
+
+                    char* acTextureImageData = nullptr;
+                    uint32_t iSize = Loader::loadFile(&acTextureImageData, parsedTextureName);
+                    int32_t iImageWidth = 0, iImageHeight = 0, iImageComp = 0;
+                    stbi_uc* pImageData = stbi_load_from_memory(
+                        (stbi_uc const*)acTextureImageData,
+                        (int32_t)iSize,
+                        &iImageWidth,
+                        &iImageHeight,
+                        &iImageComp,
+                        4
+                    );
 
-#if defined(__EMSCRIPTEN__)
-                            wgpu::TextureDataLayout layout = {};
+                    if(pImageData)
+                    {
+                        copyToDiffuseAtlas(iTexture, pImageData, iImageWidth, iImageHeight);
+                        stbi_image_free(pImageData);
+                    }
+                    free(acTextureImageData);
+                }
 #else
-                            wgpu::TexelCopyBufferLayout layout = {};
-#endif // __EMSCRIPTEN__
-                            layout.bytesPerRow = iImageWidth * 4 * sizeof(char);
-                            layout.offset = 0;
-                            layout.rowsPerImage = iImageHeight;
-                            wgpu::Extent3D extent = {};
-                            extent.depthOrArrayLayers = 1;
-                            extent.width = iImageWidth;
-                            extent.height = iImageHeight;
-
-#if defined(__EMSCRIPTEN__)
-                            wgpu::ImageCopyTexture destination = {};
-#else 
-                            wgpu::TexelCopyTextureInfo destination = {};
-#endif // __EMSCRIPTEN__
-                            destination.aspect = wgpu::TextureAspect::All;
-                            destination.mipLevel = 0;
-                            destination.origin = {.x = (uint32_t)iX, .y = (uint32_t)iY, .z = 0};
-                            destination.texture = textureAtlas;
-                            device.GetQueue().WriteTexture(
-                                &destination,
-                                pImageData,
-                                iImageWidth * iImageHeight * 4,
-                                &layout,
-                                &extent);
-
-                            TextureAtlasInfo info = {};
-                            info.miTextureCoord = uint2(iX, iY);
-                            info.miTextureID = iAtlasIndex;
-                            info.mUV = float2(float(iX) / float(iAtlasImageWidth), float(iY) / float(iAtlasImageHeight));
-                            info.miImageWidth = iImageWidth;
-                            info.miImageHeight = iImageHeight;
-                            aTextureAtlasInfo.push_back(info);
-
-                            iX += iImageWidth;
-
-                            stbi_image_free(pImageData);
-
-#if defined(__EMSCRIPTEN__)
-                            free(acTextureImageData);
-#endif // __EMSCRIPTEN__
-                        }
-                    };
-
-
+                // textures are decoded on the loader threads as they arrive and placed in name order, see updateAsyncLoads
+                mDiffuseTextureStart = std::chrono::high_resolution_clock::now();
+                miDiffuseTextureDecodeUS = 0;
+                miDiffuseTextureUploadUS = 0;
+                miNumCachedDiffuseTextures = 0;
+                std::shared_ptr<Loader::CDecodedTextureCache> pTextureCache = Loader::getTextureCache();
                 for(auto const& diffuseTextureName : aDiffuseTextureNames)
                 {
-                    copyToAtlas(iX, iY, iAtlasImageWidth, iAtlasImageHeight, diffuseTextureName, mDiffuseTextureAtlas, iLargestHeight);
-
-                    ++iAtlasIndex;
+                    std::shared_ptr<std::promise<DecodedTexture>> pPromise = std::make_shared<std::promise<DecodedTexture>>();
+                    maDiffuseTextureFutures.push_back(pPromise->get_future());
+                    Loader::loadFileAsync(
+                        std::string("textures/") + diffuseTextureName,
+                        Loader::Priority::Texture,
+                        [pPromise, pTextureCache](Loader::Request& request)
+                        {
+                            pPromise->set_value(decodeTexture(request, pTextureCache.get()));
+                        });
                 }
-
+#endif // __EMSCRIPTEN__
             }
 
         }   // textures
 
+        // the pages are the layers, a load time atlas has one
         wgpu::TextureViewDescriptor viewDesc = {};
-        viewDesc.arrayLayerCount = 1;
+        viewDesc.arrayLayerCount = mDiffuseTextureAtlas.GetDepthOrArrayLayers();
         viewDesc.aspect = wgpu::TextureAspect::All;
         viewDesc.baseArrayLayer = 0;
         viewDesc.baseMipLevel = 0;
-        viewDesc.dimension = wgpu::TextureViewDimension::e2D;
-        viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        viewDesc.dimension = wgpu::TextureViewDimension::e2DArray;
+        viewDesc.format = mDiffuseTextureAtlas.GetFormat();
         viewDesc.label = "Diffuse Texture Atlas";
-        viewDesc.mipLevelCount = 1;
+        viewDesc.mipLevelCount = mDiffuseTextureAtlas.GetMipLevelCount();
 #if !defined(__EMSCRIPTEN__)
         viewDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
 #endif // __EMSCRIPTEN__
@@ -544,125 +951,33 @@ namespace Render
         bufferDesc = {};
         bufferDesc.mappedAtCreation = false;
         bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Storage;
-        bufferDesc.size = std::max((uint32_t)sizeof(TextureAtlasInfo) * (uint32_t)aTextureAtlasInfo.size(), 64u);
+        bufferDesc.size = std::max((uint32_t)sizeof(TextureAtlasInfo) * (uint32_t)maDiffuseTextureAtlasInfo.size(), 64u);
         maBuffers["diffuseTextureAtlasInfoBuffer"] = mpDevice->CreateBuffer(&bufferDesc);
         maBuffers["diffuseTextureAtlasInfoBuffer"].SetLabel("Diffuse Texture Atlas Info Buffer");
         device.GetQueue().WriteBuffer(
             maBuffers["diffuseTextureAtlasInfoBuffer"],
             0,
-            aTextureAtlasInfo.data(),
-            sizeof(TextureAtlasInfo)* (uint32_t)aTextureAtlasInfo.size()
+            maDiffuseTextureAtlasInfo.data(),
+            sizeof(TextureAtlasInfo)* (uint32_t)maDiffuseTextureAtlasInfo.size()
         );
 
-        // font atlas
+        // the textures placed so far, on the web that's all of them
+        if(mpDiffuseAtlasPacker)
         {
-#if defined(__EMSCRIPTEN__)
-            char* acAtlasImageData = nullptr;
-            uint32_t iFileSize = Loader::loadFile(&acAtlasImageData, "font-atlas.png");
-#else 
-            std::vector<char> acAtlasImageDataV;
-            Loader::loadFile(acAtlasImageDataV, "font-atlas.png");
-            char* acAtlasImageData = acAtlasImageDataV.data();
-            uint32_t iFileSize = (uint32_t)acAtlasImageDataV.size();
-#endif // __EMSCRIPTEN__
-
-            int32_t iImageWidth = 0, iImageHeight = 0, iNumComp = 0;
-            stbi_uc* pImageData = stbi_load_from_memory(
-                (stbi_uc const*)acAtlasImageData,
-                (int32_t)iFileSize,
-                &iImageWidth,
-                &iImageHeight,
-                &iNumComp,
-                4
-            );
-
-            wgpu::TextureFormat aViewFormats[] = {wgpu::TextureFormat::RGBA8Unorm};
-            wgpu::TextureDescriptor textureDesc = {};
-            textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
-            textureDesc.dimension = wgpu::TextureDimension::e2D;
-            textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
-            textureDesc.mipLevelCount = 1;
-            textureDesc.sampleCount = 1;
-            textureDesc.size.depthOrArrayLayers = 1;
-            textureDesc.size.width = iImageWidth;
-            textureDesc.size.height = iImageHeight;
-            textureDesc.viewFormatCount = 1;
-            textureDesc.viewFormats = aViewFormats;
-            maTextures["font-atlas-image"] = mpDevice->CreateTexture(&textureDesc);
-            maTextures["font-atlas-image"].SetLabel("Font Atlas");
-
-#if defined(__EMSCRIPTEN__)
-            wgpu::TextureDataLayout layout = {};
-#else
-            wgpu::TexelCopyBufferLayout layout = {};
-#endif // __EMSCRIPTEN__
-            layout.bytesPerRow = iImageWidth * 4 * sizeof(char);
-            layout.offset = 0;
-            layout.rowsPerImage = iImageHeight;
-            wgpu::Extent3D extent = {};
-            extent.depthOrArrayLayers = 1;
-            extent.width = iImageWidth;
-            extent.height = iImageHeight;
-
-#if defined(__EMSCRIPTEN__)
-            wgpu::ImageCopyTexture destination = {};
-#else 
-            wgpu::TexelCopyTextureInfo destination = {};
-#endif // __EMSCRIPTEN__
-            destination.aspect = wgpu::TextureAspect::All;
-            destination.mipLevel = 0;
-            destination.origin = {.x = 0, .y = 0, .z = 0, };
-            destination.texture = maTextures["font-atlas-image"];
-            device.GetQueue().WriteTexture(
-                &destination,
-                pImageData,
-                iImageWidth * iImageHeight * 4,
-                &layout,
-                &extent);
-            stbi_image_free(pImageData);
-
-            wgpu::TextureViewDescriptor viewDesc = {};
-            viewDesc.arrayLayerCount = 1;
-            viewDesc.aspect = wgpu::TextureAspect::All;
-            viewDesc.baseArrayLayer = 0;
-            viewDesc.baseMipLevel = 0;
-            viewDesc.dimension = wgpu::TextureViewDimension::e2D;
-            viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
-            viewDesc.label = "Font Texture Atlas";
-            viewDesc.mipLevelCount = 1;
-#if !defined(__EMSCRIPTEN__)
-            viewDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
-#endif // __EMSCRIPTEN__
-            maTextureViews["font-atlas-image"] = maTextures["font-atlas-image"].CreateView(&viewDesc);
-
-#if defined(__EMSCRIPTEN__)
-            free(acAtlasImageData);
-#endif // __EMSCRIPTEN__
-
-#if defined(__EMSCRIPTEN__)
-            char* acFontInfoData = nullptr;
-            iFileSize = Loader::loadFile(&acFontInfoData, "glyph_info.bin");
-#else 
-            std::vector<char> acFontInfoDataV;
-            Loader::loadFile(acFontInfoDataV, "glyph_info.bin");
-            char* acFontInfoData = acFontInfoDataV.data();
-            iFileSize = (uint32_t)acFontInfoDataV.size();
-#endif // __EMSCRIPTEN__
-
-            bufferDesc.size = iFileSize;
-            bufferDesc.usage = (wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Storage);
-            maBuffers["font-info"] = mpDevice->CreateBuffer(&bufferDesc);
-            maBuffers["font-info"].SetLabel("Font Info Buffer");
-            mpDevice->GetQueue().WriteBuffer(maBuffers["font-info"], 0, acFontInfoData, iFileSize);
-
-            uint32_t iNumFontInfo = iFileSize / sizeof(OutputGlyphInfo);
-            maFontInfo.resize(iNumFontInfo);
-            memcpy(maFontInfo.data(), acFontInfoData, iFileSize);
+            setupDiffuseAtlasMipPipeline();
+            generateDiffuseAtlasMips(0, (uint32_t)maDiffuseTextureAtlasInfo.size());
+        }
 
-#if defined(__EMSCRIPTEN__)
-            free(acFontInfoData);
-#endif // __EMSCRIPTEN__
+        wgpu::SamplerDescriptor samplerDesc = {};
+        samplerDesc.addressModeU = wgpu::AddressMode::ClampToEdge;
+        samplerDesc.addressModeV = wgpu::AddressMode::ClampToEdge;
+        samplerDesc.magFilter = wgpu::FilterMode::Linear;
+        samplerDesc.minFilter = wgpu::FilterMode::Linear;
+        samplerDesc.mipmapFilter = wgpu::MipmapFilterMode::Linear;
+        mDiffuseTextureSampler = device.CreateSampler(&samplerDesc);
 
+        // font atlas
+        {
             bufferDesc.size = sizeof(Vertex) * 4;
             bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
             maBuffers["quad-vertex-buffer"] = mpDevice->CreateBuffer(&bufferDesc);
@@ -701,20 +1016,62 @@ namespace Render
             maBuffers["draw-text-uniform"] = mpDevice->CreateBuffer(&bufferDesc);
             maBuffers["draw-text-uniform"].SetLabel("Draw Text Uniform Buffer");
 
+#if defined(__EMSCRIPTEN__)
+            char* acAtlasImageData = nullptr;
+            uint32_t iAtlasFileSize = Loader::loadFile(&acAtlasImageData, "font-atlas.png");
+            char* acFontInfoData = nullptr;
+            uint32_t iFontInfoFileSize = Loader::loadFile(&acFontInfoData, "glyph_info.bin");
+
+            setupFontAtlas(acAtlasImageData, iAtlasFileSize, acFontInfoData, iFontInfoFileSize);
+            free(acAtlasImageData);
+            free(acFontInfoData);
+
             setupFontPipeline();
+            mbFontReady = true;
+#else
+            // the render jobs composite the text output, the atlas and pipeline follow once the font files are in
+            createFontOutputAttachment();
+#endif // __EMSCRIPTEN__
         }
 
         createRenderJobs(desc);
 
+        // a slot per meshlet, sized from the scene when the jobs were created
+        {
+            uint64_t iDrawCallBufferSize = maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Draw Calls"].GetSize();
+            uint64_t iVisibleClusterBufferSize = maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Visible Clusters"].GetSize();
+            if(iDrawCallBufferSize < (uint64_t)miNumMeshClusters * 5 * sizeof(uint32_t) ||
+               iVisibleClusterBufferSize < (uint64_t)miNumMeshClusters * sizeof(uint32_t))
+            {
+                DEBUG_PRINTF("%s : %d %d meshlets don't fit %lld bytes of draw calls and %lld bytes of visible clusters, check "SizePerCluster" in mesh-culling-compute.json\n",
+                    __FILE__,
+                    __LINE__,
+                    miNumMeshClusters,
+                    (long long)iDrawCallBufferSize,
+                    (long long)iVisibleClusterBufferSize);
+                assert(0);
+            }
+        }
+
         struct UniformData
         {
             uint32_t    miNumMeshes;
             float       mfExplodeMultipler;
+            uint32_t    miNumClusters;
+            uint32_t    miConeCulling;
+            float       mfLODPixelError;
+            uint32_t    miFirstWideDraw;
+            uint32_t    miPadding1;
+            uint32_t    miPadding2;
         };
 
-        UniformData uniformData;
+        UniformData uniformData = {};
         uniformData.miNumMeshes = (uint32_t)maMeshExtents.size();
         uniformData.mfExplodeMultipler = 1.0f;
+        uniformData.miNumClusters = miNumMeshClusters;
+        uniformData.miConeCulling = 0;          // the deferred passes draw back faces too, for the cross section
+        uniformData.mfLODPixelError = mfLODPixelError;
+        uniformData.miFirstWideDraw = miNumSmallIndexClusters;
         device.GetQueue().WriteBuffer(
             maRenderJobs["Mesh Culling Compute"]->mUniformBuffers["uniformBuffer"],
             0,
@@ -731,6 +1088,344 @@ namespace Render
         mLastTimeStart = std::chrono::high_resolution_clock::now();
 
         mpInstance = desc.mpInstance;
+
+        uint64_t iSetupMS = std::chrono::duration_cast<std::chrono::milliseconds>(mLastTimeStart - setupStart).count();
+        printf("renderer setup took %d ms\n", (uint32_t)iSetupMS);
+    }
+
+    /*
+    ** sections of the mesh file by type, older files' chained sections are split out of their LegacySections entry
+    */
+    void CRenderer::setupMeshSections(
+        std::map<uint32_t, std::span<char const>> const& aSectionData,
+        uint32_t iNumTotalIndices)
+    {
+        std::map<uint32_t, std::span<char const>> aSections = aSectionData;
+        auto legacySections = aSectionData.find((uint32_t)Loader::MeshSectionType::LegacySections);
+        if(legacySections != aSectionData.end())
+        {
+            std::vector<Loader::MeshFileSection> aLegacySections;
+            Loader::readLegacyMeshSections(aLegacySections, legacySections->second.data(), legacySections->second.size());
+            for(auto const& section : aLegacySections)
+            {
+                aSections[section.miType] = legacySections->second.subspan((size_t)section.miOffset, (size_t)section.miSize);
+            }
+        }
+
+        // strides were checked against these when the file was read
+        auto getSection = [&](auto& aValues, Loader::MeshSectionType type)
+        {
+            auto iter = aSections.find((uint32_t)type);
+            if(iter != aSections.end())
+            {
+                aValues.resize(iter->second.size() / sizeof(aValues[0]));
+                memcpy(aValues.data(), iter->second.data(), aValues.size() * sizeof(aValues[0]));
+            }
+        };
+
+        // the bvh sections are for tools doing cpu queries, selection and the cross section are resolved on the gpu
+        std::vector<MeshCluster> aMeshClusters;
+        std::vector<MeshLOD> aMeshLODs;
+        getSection(aMeshClusters, Loader::MeshSectionType::MeshClusters);
+        getSection(aMeshLODs, Loader::MeshSectionType::MeshLODs);
+
+        uint32_t iNumMeshes = (uint32_t)maMeshTriangleRanges.size();
+        getSection(maiMeshBaseVertices, Loader::MeshSectionType::MeshBaseVertices);
+        if(maiMeshBaseVertices.size() != iNumMeshes)
+        {
+            maiMeshBaseVertices.assign(iNumMeshes, kiWideIndexBaseVertex);
+        }
+
+        // padded to whole words, streamed files already have theirs mapped and filled in
+        std::span<char const> aSmallIndexData;
+        auto smallIndices = aSections.find((uint32_t)Loader::MeshSectionType::SmallIndices);
+        if(smallIndices != aSections.end())
+        {
+            aSmallIndexData = smallIndices->second;
+        }
+        uint32_t iNumSmallIndices = (uint32_t)(aSmallIndexData.size() / sizeof(uint16_t));
+
+        // the draws bind it whenever the mesh's index size changes
+        if(maBuffers.find("train-index-buffer-16") != maBuffers.end())
+        {
+            iNumSmallIndices = maBufferSizes["train-index-buffer-16"] / sizeof(uint16_t);
+        }
+        else
+        {
+            wgpu::BufferDescriptor bufferDesc = {};
+            bufferDesc.size = std::max((uint64_t)aSmallIndexData.size(), (uint64_t)sizeof(uint32_t));
+            bufferDesc.usage = wgpu::BufferUsage::Index | wgpu::BufferUsage::CopyDst;
+            maBuffers["train-index-buffer-16"] = mpDevice->CreateBuffer(&bufferDesc);
+            maBuffers["train-index-buffer-16"].SetLabel("Train Index Buffer 16");
+            maBufferSizes["train-index-buffer-16"] = (uint32_t)bufferDesc.size;
+            mpDevice->GetQueue().WriteBuffer(maBuffers["train-index-buffer-16"], 0, aSmallIndexData.data(), aSmallIndexData.size());
+        }
+
+        printf("16 bit indices: %d\n", iNumSmallIndices);
+
+        setupMeshClusters(aMeshClusters);
+        setupMeshLODs(aMeshLODs, iNumTotalIndices, iNumSmallIndices);
+    }
+
+    /*
+    ** older mesh files get one cluster per mesh
+    */
+    void CRenderer::setupMeshClusters(std::vector<MeshCluster>& aMeshClusters)
+    {
+        uint32_t iNumMeshes = (uint32_t)maMeshTriangleRanges.size();
+
+        // clusters are sorted by mesh
+        bool bValid = true;
+        for(uint32_t iCluster = 0; iCluster < (uint32_t)aMeshClusters.size(); iCluster++)
+        {
+            if(aMeshClusters[iCluster].miMesh >= iNumMeshes || (iCluster > 0 && aMeshClusters[iCluster].miMesh < aMeshClusters[iCluster - 1].miMesh))
+            {
+                DEBUG_PRINTF("%s : %d invalid mesh cluster %d, using one cluster per mesh\n",
+                    __FILE__,
+                    __LINE__,
+                    iCluster);
+                bValid = false;
+                break;
+            }
+        }
+
+        if(aMeshClusters.size() <= 0 || !bValid)
+        {
+            aMeshClusters.resize(iNumMeshes);
+            for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+            {
+                MeshExtent const& meshExtent = maMeshExtents[iMesh];
+                float3 minPosition = float3(meshExtent.mMinPosition);
+                float3 maxPosition = float3(meshExtent.mMaxPosition);
+
+                MeshCluster& cluster = aMeshClusters[iMesh];
+                cluster.mBoundingSphere = float4((minPosition + maxPosition) * 0.5f, length(maxPosition - minPosition) * 0.5f);
+                cluster.mMinPosition = meshExtent.mMinPosition;
+                cluster.mMaxPosition = meshExtent.mMaxPosition;
+                cluster.mNormalCone = float4(0.0f, 0.0f, 1.0f, 1.0f);
+                cluster.miMesh = iMesh;
+                cluster.miFirstIndex = maMeshTriangleRanges[iMesh].miStart;
+                cluster.miNumIndices = maMeshTriangleRanges[iMesh].miEnd - maMeshTriangleRanges[iMesh].miStart;
+                cluster.miPadding = 0;
+            }
+        }
+
+        miNumMeshClusters = (uint32_t)aMeshClusters.size();
+        maMeshClusterRanges.assign(iNumMeshes, {0, 0});
+        for(uint32_t iCluster = 0; iCluster < miNumMeshClusters; iCluster++)
+        {
+            MeshTriangleRange& range = maMeshClusterRanges[aMeshClusters[iCluster].miMesh];
+            if(range.miEnd == 0)
+            {
+                range.miStart = iCluster;
+            }
+            range.miEnd = iCluster + 1;
+        }
+
+        printf("num mesh clusters: %d\n", miNumMeshClusters);
+
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.size = std::max(miNumMeshClusters, 1u) * sizeof(MeshCluster);
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+        maBuffers["meshClusters"] = mpDevice->CreateBuffer(&bufferDesc);
+        maBuffers["meshClusters"].SetLabel("Mesh Clusters");
+        maBufferSizes["meshClusters"] = (uint32_t)bufferDesc.size;
+        mpDevice->GetQueue().WriteBuffer(maBuffers["meshClusters"], 0, aMeshClusters.data(), aMeshClusters.size() * sizeof(MeshCluster));
+    }
+
+    /*
+    ** simplified levels per mesh, the culling pass swaps a mesh's meshlets for one draw of a level once the level's error
+    ** projects to less than mfLODPixelError, the draw goes in the slot of the mesh's first meshlet
+    */
+    void CRenderer::setupMeshLODs(
+        std::vector<MeshLOD> const& aMeshLODs,
+        uint32_t iNumTotalIndices,
+        uint32_t iNumSmallIndices)
+    {
+        uint32_t iNumMeshes = (uint32_t)maMeshTriangleRanges.size();
+
+        // the culling pass packs the 16 bit draws in front of the 32 bit ones, at most one draw per meshlet
+        miNumSmallIndexClusters = 0;
+        std::vector<MeshLODRange> aMeshLODRanges(iNumMeshes);
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            aMeshLODRanges[iMesh].miFirstCluster = maMeshClusterRanges[iMesh].miStart;
+            aMeshLODRanges[iMesh].miFirstLOD = 0;
+            aMeshLODRanges[iMesh].miNumLODs = 0;
+            aMeshLODRanges[iMesh].miBaseVertex = maiMeshBaseVertices[iMesh];
+            if(maiMeshBaseVertices[iMesh] != kiWideIndexBaseVertex)
+            {
+                miNumSmallIndexClusters += maMeshClusterRanges[iMesh].miEnd - maMeshClusterRanges[iMesh].miStart;
+            }
+        }
+
+        // levels of a mesh are consecutive, from fine to coarse
+        std::vector<MeshLODLevel> aLODs;
+        for(uint32_t iLOD = 0; iLOD < (uint32_t)aMeshLODs.size(); iLOD++)
+        {
+            MeshLOD const& meshLOD = aMeshLODs[iLOD];
+            if(meshLOD.miMesh >= iNumMeshes ||
+               (uint64_t)meshLOD.miFirstIndex + meshLOD.miNumIndices > ((maiMeshBaseVertices[meshLOD.miMesh] == kiWideIndexBaseVertex) ? iNumTotalIndices : iNumSmallIndices) ||
+               maMeshClusterRanges[meshLOD.miMesh].miEnd <= maMeshClusterRanges[meshLOD.miMesh].miStart)
+            {
+                DEBUG_PRINTF("%s : %d invalid mesh lod %d\n",
+                    __FILE__,
+                    __LINE__,
+                    iLOD);
+                continue;
+            }
+
+            MeshLODRange& range = aMeshLODRanges[meshLOD.miMesh];
+            if(range.miNumLODs == 0)
+            {
+                range.miFirstLOD = (uint32_t)aLODs.size();
+            }
+            else if(range.miFirstLOD + range.miNumLODs != (uint32_t)aLODs.size())
+            {
+                continue;
+            }
+            range.miNumLODs += 1;
+
+            aLODs.push_back({meshLOD.miFirstIndex, meshLOD.miNumIndices, meshLOD.mfError, 0});
+        }
+
+        printf("num mesh lods: %d\n", (uint32_t)aLODs.size());
+
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.size = std::max(iNumMeshes, 1u) * sizeof(MeshLODRange);
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+        maBuffers["meshLODRanges"] = mpDevice->CreateBuffer(&bufferDesc);
+        maBuffers["meshLODRanges"].SetLabel("Mesh LOD Ranges");
+        maBufferSizes["meshLODRanges"] = (uint32_t)bufferDesc.size;
+        mpDevice->GetQueue().WriteBuffer(maBuffers["meshLODRanges"], 0, aMeshLODRanges.data(), aMeshLODRanges.size() * sizeof(MeshLODRange));
+
+        bufferDesc.size = std::max((uint32_t)aLODs.size(), 1u) * sizeof(MeshLODLevel);
+        maBuffers["meshLODs"] = mpDevice->CreateBuffer(&bufferDesc);
+        maBuffers["meshLODs"].SetLabel("Mesh LODs");
+        maBufferSizes["meshLODs"] = (uint32_t)bufferDesc.size;
+        mpDevice->GetQueue().WriteBuffer(maBuffers["meshLODs"], 0, aLODs.data(), aLODs.size() * sizeof(MeshLODLevel));
+    }
+
+    /*
+    ** "-mesh-instances.bin" from the converter, a mesh without triangles of its own is drawn with its geometry mesh's
+    ** meshlets, one instanced draw per meshlet for all the visible instances. missing or mismatched tables draw every mesh by itself
+    */
+    void CRenderer::setupMeshInstances(
+        char const* pcInstanceData,
+        uint64_t iDataSize)
+    {
+        uint32_t iNumMeshes = (uint32_t)maMeshTriangleRanges.size();
+
+        std::vector<MeshInstance> aMeshInstances(iNumMeshes);
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            aMeshInstances[iMesh] = {};
+            aMeshInstances[iMesh].maTransform[0] = float4(1.0f, 0.0f, 0.0f, 0.0f);
+            aMeshInstances[iMesh].maTransform[1] = float4(0.0f, 1.0f, 0.0f, 0.0f);
+            aMeshInstances[iMesh].maTransform[2] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+            aMeshInstances[iMesh].miMesh = iMesh;
+            aMeshInstances[iMesh].miGeometryMesh = iMesh;
+        }
+
+        uint32_t iNumFileInstances = 0;
+        if(pcInstanceData != nullptr && iDataSize >= sizeof(uint32_t))
+        {
+            memcpy(&iNumFileInstances, pcInstanceData, sizeof(uint32_t));
+        }
+        if(iNumFileInstances > 0)
+        {
+            if(iNumFileInstances != iNumMeshes || iDataSize < sizeof(uint32_t) + (uint64_t)iNumFileInstances * sizeof(MeshInstance))
+            {
+                DEBUG_PRINTF("%s : %d instance table has %d entries for %d meshes, drawing the meshes by themselves\n",
+                    __FILE__,
+                    __LINE__,
+                    iNumFileInstances,
+                    iNumMeshes);
+            }
+            else
+            {
+                memcpy(aMeshInstances.data(), pcInstanceData + sizeof(uint32_t), iNumMeshes * sizeof(MeshInstance));
+            }
+        }
+
+        auto hasTriangles = [&](uint32_t iMesh)
+        {
+            return maMeshTriangleRanges[iMesh].miEnd > maMeshTriangleRanges[iMesh].miStart;
+        };
+
+        // instances only borrow from meshes with triangles of their own, meshes that kept theirs are drawn as they are
+        uint32_t iNumInstancedMeshes = 0;
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            MeshInstance& meshInstance = aMeshInstances[iMesh];
+            uint32_t iGeometryMesh = meshInstance.miGeometryMesh;
+            bool bInstanced = (iGeometryMesh != iMesh && iGeometryMesh < iNumMeshes && meshInstance.miMesh == iMesh);
+            if(bInstanced && (hasTriangles(iMesh) || !hasTriangles(iGeometryMesh) || aMeshInstances[iGeometryMesh].miGeometryMesh != iGeometryMesh))
+            {
+                bInstanced = false;
+            }
+
+            if(!bInstanced)
+            {
+                meshInstance.maTransform[0] = float4(1.0f, 0.0f, 0.0f, 0.0f);
+                meshInstance.maTransform[1] = float4(0.0f, 1.0f, 0.0f, 0.0f);
+                meshInstance.maTransform[2] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+                meshInstance.miMesh = iMesh;
+                meshInstance.miGeometryMesh = iMesh;
+            }
+            else
+            {
+                ++iNumInstancedMeshes;
+            }
+        }
+
+        // instances grouped by geometry mesh, in mesh order
+        maMeshInstanceRanges.assign(iNumMeshes, {0, 0});
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            maMeshInstanceRanges[aMeshInstances[iMesh].miGeometryMesh].miEnd += 1;
+        }
+        uint32_t iNumListed = 0;
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            uint32_t iNumInstances = maMeshInstanceRanges[iMesh].miEnd;
+            maMeshInstanceRanges[iMesh].miStart = maMeshInstanceRanges[iMesh].miEnd = iNumListed;
+            iNumListed += iNumInstances;
+        }
+        maiMeshInstanceList.resize(iNumMeshes);
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            MeshTriangleRange& range = maMeshInstanceRanges[aMeshInstances[iMesh].miGeometryMesh];
+            maiMeshInstanceList[range.miEnd] = iMesh;
+            range.miEnd += 1;
+        }
+
+        std::vector<MeshInstanceData> aInstanceData(std::max(iNumMeshes, 1u));
+        for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+        {
+            MeshInstanceData& instanceData = aInstanceData[iMesh];
+            memcpy(instanceData.maTransform, aMeshInstances[iMesh].maTransform, sizeof(instanceData.maTransform));
+            instanceData.miGeometryMesh = aMeshInstances[iMesh].miGeometryMesh;
+            instanceData.miFirstInstance = maMeshInstanceRanges[iMesh].miStart;
+            instanceData.miNumInstances = maMeshInstanceRanges[iMesh].miEnd - maMeshInstanceRanges[iMesh].miStart;
+            instanceData.miListedMesh = maiMeshInstanceList[iMesh];
+        }
+
+        printf("num instanced meshes: %d\n", iNumInstancedMeshes);
+
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.size = aInstanceData.size() * sizeof(MeshInstanceData);
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+        maBuffers["meshInstances"] = mpDevice->CreateBuffer(&bufferDesc);
+        maBuffers["meshInstances"].SetLabel("Mesh Instances");
+        maBufferSizes["meshInstances"] = (uint32_t)bufferDesc.size;
+        mpDevice->GetQueue().WriteBuffer(maBuffers["meshInstances"], 0, aInstanceData.data(), bufferDesc.size);
+
+        // bindings are at least 64 bytes
+        bufferDesc.size = std::max((uint64_t)iNumMeshes * sizeof(uint32_t), (uint64_t)64);
+        maBuffers["visibleMeshInstances"] = mpDevice->CreateBuffer(&bufferDesc);
+        maBuffers["visibleMeshInstances"].SetLabel("Visible Mesh Instances");
+        maBufferSizes["visibleMeshInstances"] = (uint32_t)bufferDesc.size;
     }
 
     /*
@@ -738,6 +1433,11 @@ namespace Render
     */
     void CRenderer::draw(DrawUpdateDescriptor& desc)
     {
+#if !defined(__EMSCRIPTEN__)
+        updateAsyncLoads();
+#endif // !__EMSCRIPTEN__
+        mVirtualTexture.update((uint32_t)miFrame);
+
         DefaultUniformData defaultUniformData;
         defaultUniformData.mViewMatrix = *desc.mpViewMatrix;
         defaultUniformData.mProjectionMatrix = *desc.mpProjectionMatrix;
@@ -921,14 +1621,26 @@ namespace Render
         oss << iFPS << " fps";
 
         std::vector<wgpu::CommandBuffer> aCommandBuffer;
-        drawText(
-            aCommandBuffer,
-            oss.str(),
-            100,
-            20,
-            50,
-            float3(1.0f, 0.5f, 0.2f)
-        );
+
+        // last frame's tile requests are copied out before the deferred pass writes this frame's
+        if(mVirtualTexture.isEnabled())
+        {
+            wgpu::CommandEncoder commandEncoder = mpDevice->CreateCommandEncoder();
+            mVirtualTexture.encodeFeedbackCopy(commandEncoder);
+            aCommandBuffer.push_back(commandEncoder.Finish());
+        }
+
+        if(mbFontReady)
+        {
+            drawText(
+                aCommandBuffer,
+                oss.str(),
+                100,
+                20,
+                50,
+                float3(1.0f, 0.5f, 0.2f)
+            );
+        }
 
         // add commands from the render jobs
         for(auto const& renderJobName : maOrderedRenderJobs)
@@ -979,18 +1691,42 @@ namespace Render
                 
                 if(pRenderJob->mPassType == Render::PassType::DrawMeshes)
                 {
+                    // one draw per meshlet, the culling pass zeroes the ones that aren't visible
+                    wgpu::Buffer& drawCallBuffer = maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Draw Calls"];
+                    uint32_t iMaxDrawCalls = miNumMeshClusters;
 #if defined(__EMSCRIPTEN__) || !defined(_MSC_VER)
+                    // mesh-culling-index-compute.shader leaves every meshlet's draw in its own slot, see CRenderJob::createWithInputAttachmentsAndPipeline
+                    // index buffer switches only where consecutive meshes differ in index size
+                    wgpu::IndexFormat boundIndexFormat = wgpu::IndexFormat::Uint32;
                     for(uint32_t iMesh = 0; iMesh < (uint32_t)maMeshTriangleRanges.size(); iMesh++)
                     {
-                        if(maiVisibilityFlags[iMesh] >= 1)
+                        // a mesh's meshlets also draw the meshes instanced from it
+                        bool bVisible = false;
+                        for(uint32_t iInstance = maMeshInstanceRanges[iMesh].miStart; iInstance < maMeshInstanceRanges[iMesh].miEnd; iInstance++)
                         {
-                            uint32_t iNumIndices = maMeshTriangleRanges[iMesh].miEnd - maMeshTriangleRanges[iMesh].miStart;
-                            uint32_t iIndexOffset = maMeshTriangleRanges[iMesh].miStart;
-                            //renderPassEncoder.DrawIndexed(iNumIndices, 1, iIndexOffset, 0, 0);
-                            renderPassEncoder.DrawIndexedIndirect(
-                                maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Draw Calls"],
-                                iMesh * 5 * sizeof(uint32_t)
-                            );
+                            bVisible = bVisible || (maiVisibilityFlags[maiMeshInstanceList[iInstance]] >= 1);
+                        }
+
+                        if(bVisible)
+                        {
+                            wgpu::IndexFormat indexFormat = (maiMeshBaseVertices[iMesh] == kiWideIndexBaseVertex) ? wgpu::IndexFormat::Uint32 : wgpu::IndexFormat::Uint16;
+                            if(indexFormat != boundIndexFormat)
+                            {
+                                renderPassEncoder.SetIndexBuffer(
+                                    maBuffers[(indexFormat == wgpu::IndexFormat::Uint16) ? "train-index-buffer-16" : "train-index-buffer"],
+                                    indexFormat
+                                );
+                                boundIndexFormat = indexFormat;
+                            }
+
+                            uint32_t iClusterEnd = std::min(maMeshClusterRanges[iMesh].miEnd, iMaxDrawCalls);
+                            for(uint32_t iCluster = maMeshClusterRanges[iMesh].miStart; iCluster < iClusterEnd; iCluster++)
+                            {
+                                renderPassEncoder.DrawIndexedIndirect(
+                                    drawCallBuffer,
+                                    iCluster * 5 * sizeof(uint32_t)
+                                );
+                            }
                         }
                         //else
                         //{
@@ -998,13 +1734,36 @@ namespace Render
                         //}
                     }
 #else
-                    renderPassEncoder.MultiDrawIndexedIndirect(
-                        maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Draw Calls"],
-                        0,
-                        (uint32_t)maMeshTriangleRanges.size(), //65536 * 2,
-                        maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Num Draw Calls"],
-                        0
-                    );
+                    // 16 bit draws are packed from the front with their count in the first word, 32 bit ones after the last 16 bit meshlet's slot with theirs in the third
+                    uint32_t iNumSmallIndexDraws = std::min(miNumSmallIndexClusters, iMaxDrawCalls);
+                    if(iNumSmallIndexDraws > 0)
+                    {
+                        renderPassEncoder.SetIndexBuffer(
+                            maBuffers["train-index-buffer-16"],
+                            wgpu::IndexFormat::Uint16
+                        );
+                        renderPassEncoder.MultiDrawIndexedIndirect(
+                            drawCallBuffer,
+                            0,
+                            iNumSmallIndexDraws,
+                            maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Num Draw Calls"],
+                            0
+                        );
+                        renderPassEncoder.SetIndexBuffer(
+                            maBuffers["train-index-buffer"],
+                            wgpu::IndexFormat::Uint32
+                        );
+                    }
+                    if(iMaxDrawCalls > iNumSmallIndexDraws)
+                    {
+                        renderPassEncoder.MultiDrawIndexedIndirect(
+                            drawCallBuffer,
+                            iNumSmallIndexDraws * 5 * sizeof(uint32_t),
+                            iMaxDrawCalls - iNumSmallIndexDraws,
+                            maRenderJobs["Mesh Culling Compute"]->mOutputBufferAttachments["Num Draw Calls"],
+                            2 * sizeof(uint32_t)
+                        );
+                    }
 #endif // __EMSCRIPTEN__
                 }
                 else if(pRenderJob->mPassType == Render::PassType::FullTriangle)
@@ -1118,6 +1877,7 @@ namespace Render
         mpDevice->GetQueue().Submit(
             (uint32_t)aCommandBuffer.size(), 
             aCommandBuffer.data());
+        mVirtualTexture.readBackFeedback();
 
         ++miFrame;
     }
@@ -1170,6 +1930,34 @@ namespace Render
         std::vector<std::string> aShaderModuleFilePath;
 
         auto const& jobs = doc["Jobs"].GetArray();
+
+#if !defined(__EMSCRIPTEN__)
+        // all the job pipelines in one batch, then all the shaders they reference
+        {
+            std::vector<std::string> aPipelineFilePaths;
+            for(auto const& job : jobs)
+            {
+                aPipelineFilePaths.push_back(std::string("render-jobs/") + job["Pipeline"].GetString());
+            }
+            Loader::prefetchFiles(aPipelineFilePaths);
+
+            std::vector<std::string> aShaderFilePaths;
+            for(auto const& pipelineFilePath : aPipelineFilePaths)
+            {
+                std::vector<char> acPipelineFileContent;
+                Loader::loadFile(acPipelineFileContent, pipelineFilePath, true);
+
+                rapidjson::Document pipelineDoc;
+                pipelineDoc.Parse(acPipelineFileContent.data());
+                if(!pipelineDoc.HasParseError() && pipelineDoc.HasMember("Shader"))
+                {
+                    aShaderFilePaths.push_back(std::string("shaders/") + pipelineDoc["Shader"].GetString());
+                }
+            }
+            Loader::prefetchFiles(aShaderFilePaths);
+        }
+#endif // !__EMSCRIPTEN__
+
         for(auto const& job : jobs)
         {
             createInfo.mName = job["Name"].GetString();
@@ -1222,7 +2010,11 @@ namespace Render
             createInfo.mPipelineFilePath = pipelineFilePath;
 
             createInfo.mpSampler = desc.mpSampler;
+            createInfo.miNumMeshClusters = miNumMeshClusters;
             createInfo.mpTotalDiffuseTextureView = &mDiffuseTextureAtlasView;
+            createInfo.mpDiffuseTextureSampler = &mDiffuseTextureSampler;
+            createInfo.mpVirtualTextureIndirectionView = &mVirtualTexture.getIndirectionView();
+            createInfo.mpVirtualTexturePhysicalView = &mVirtualTexture.getPhysicalView();
 
             aShaderModuleFilePath.push_back(pipelineFilePath);
 
@@ -1271,6 +2063,16 @@ namespace Render
             ++iIndex;
         }
 
+#if !defined(__EMSCRIPTEN__)
+        Loader::clearPrefetchedFiles();
+
+        Loader::CacheStats cacheStats = Loader::getCacheStats();
+        DEBUG_PRINTF("asset cache: %lld hits, %lld misses, %lld bytes saved, %lld bytes downloaded\n",
+            (long long)cacheStats.miNumHits,
+            (long long)cacheStats.miNumMisses,
+            (long long)cacheStats.miNumBytesSaved,
+            (long long)cacheStats.miNumBytesDownloaded);
+#endif // !__EMSCRIPTEN__
     }
 
     /*
@@ -1366,12 +2168,640 @@ namespace Render
         return mSelectMeshInfo;
     }
 
+    /*
+    ** skyline packing into the single page of the load time atlas, images that don't fit leave their slot empty
+    ** the levels past the first are left to generateDiffuseAtlasMips
+    */
+    void CRenderer::copyToDiffuseAtlas(
+        uint32_t iTextureID,
+        uint8_t const* pImageData,
+        int32_t iImageWidth,
+        int32_t iImageHeight)
+    {
+        uint32_t iAtlasImageWidth = mDiffuseTextureAtlas.GetWidth();
+        uint32_t iAtlasImageHeight = mDiffuseTextureAtlas.GetHeight();
+
+        PackedRect rect = {};
+        if(!mpDiffuseAtlasPacker->insert(
+            rect, 
+            ((uint32_t)iImageWidth + kiLoadTimeAtlasAlignment - 1) / kiLoadTimeAtlasAlignment, 
+            ((uint32_t)iImageHeight + kiLoadTimeAtlasAlignment - 1) / kiLoadTimeAtlasAlignment))
+        {
+            DEBUG_PRINTF("%s : %d texture %d (%d x %d) doesn\'t fit in the %d x %d atlas, bake the atlas with the converter to spill into more pages\n",
+                __FILE__,
+                __LINE__,
+                iTextureID,
+                iImageWidth,
+                iImageHeight,
+                iAtlasImageWidth,
+                iAtlasImageHeight);
+            return;
+        }
+        rect.miX *= kiLoadTimeAtlasAlignment;
+        rect.miY *= kiLoadTimeAtlasAlignment;
+
+#if defined(__EMSCRIPTEN__)
+        wgpu::TextureDataLayout layout = {};
+#else
+        wgpu::TexelCopyBufferLayout layout = {};
+#endif // __EMSCRIPTEN__
+        layout.bytesPerRow = iImageWidth * 4 * sizeof(char);
+        layout.offset = 0;
+        layout.rowsPerImage = iImageHeight;
+        wgpu::Extent3D extent = {};
+        extent.depthOrArrayLayers = 1;
+        extent.width = iImageWidth;
+        extent.height = iImageHeight;
+
+#if defined(__EMSCRIPTEN__)
+        wgpu::ImageCopyTexture destination = {};
+#else 
+        wgpu::TexelCopyTextureInfo destination = {};
+#endif // __EMSCRIPTEN__
+        destination.aspect = wgpu::TextureAspect::All;
+        destination.mipLevel = 0;
+        destination.origin = {.x = rect.miX, .y = rect.miY, .z = rect.miPage};
+        destination.texture = mDiffuseTextureAtlas;
+        mpDevice->GetQueue().WriteTexture(
+            &destination,
+            pImageData,
+            iImageWidth * iImageHeight * 4,
+            &layout,
+            &extent);
+
+        TextureAtlasInfo info = {};
+        info.miTextureCoord = uint2(rect.miX, rect.miY);
+        info.miTextureID = iTextureID;
+        info.mUV = float2(float(rect.miX) / float(iAtlasImageWidth), float(rect.miY) / float(iAtlasImageHeight));
+        info.miImageWidth = iImageWidth;
+        info.miImageHeight = iImageHeight;
+        info.miNumMips = 1;
+        while(info.miNumMips < kiLoadTimeAtlasNumMips && (std::min(iImageWidth, iImageHeight) >> info.miNumMips) > 0)
+        {
+            ++info.miNumMips;
+        }
+        info.miPage = rect.miPage;
+        maDiffuseTextureAtlasInfo[iTextureID] = info;
+    }
+
+    /*
+    ** one bind group per level, reading the level above through a sampled view and writing through a storage view
+    */
+    void CRenderer::setupDiffuseAtlasMipPipeline()
+    {
+        std::string shaderPath = "shaders/atlas-mip-compute.shader";
+        wgpu::ShaderModuleWGSLDescriptor wgslDesc = {};
+#if defined(__EMSCRIPTEN__)
+        char* acShaderFileContent = nullptr;
+        Loader::loadFile(
+            &acShaderFileContent,
+            shaderPath,
+            true
+        );
+        wgslDesc.code = acShaderFileContent;
+#else
+        std::vector<char> acShaderFileContent;
+        Loader::loadFile(
+            acShaderFileContent,
+            shaderPath,
+            true
+        );
+        wgslDesc.code = acShaderFileContent.data();
+#endif // __EMSCRIPTEN__
+        if(wgslDesc.code == nullptr)
+        {
+            DEBUG_PRINTF("%s : %d can\'t load \"%s\", the load time atlas only has its first level\n",
+                __FILE__,
+                __LINE__,
+                shaderPath.c_str());
+            return;
+        }
+
+        wgpu::ShaderModuleDescriptor shaderModuleDescriptor
+        {
+            .nextInChain = &wgslDesc
+        };
+        wgpu::ShaderModule shaderModule = mpDevice->CreateShaderModule(&shaderModuleDescriptor);
+
+        wgpu::ComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.compute.module = shaderModule;
+        pipelineDesc.compute.entryPoint = "cs_main";
+        mDiffuseAtlasMipPipeline = mpDevice->CreateComputePipeline(&pipelineDesc);
+        mDiffuseAtlasMipPipeline.SetLabel("Atlas Mip Pipeline");
+
+#if defined(__EMSCRIPTEN__)
+        Loader::loadFileFree(acShaderFileContent);
+#endif // __EMSCRIPTEN__
+
+        uint32_t iNumMips = mDiffuseTextureAtlas.GetMipLevelCount();
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
+        bufferDesc.size = kiAtlasMipUniformStride * iNumMips;
+        mDiffuseAtlasMipUniformBuffer = mpDevice->CreateBuffer(&bufferDesc);
+        mDiffuseAtlasMipUniformBuffer.SetLabel("Atlas Mip Uniform Buffer");
+
+        wgpu::BindGroupLayout bindGroupLayout = mDiffuseAtlasMipPipeline.GetBindGroupLayout(0);
+        maDiffuseAtlasMipBindGroups.clear();
+        for(uint32_t iLevel = 1; iLevel < iNumMips; iLevel++)
+        {
+            wgpu::TextureViewDescriptor viewDesc = {};
+            viewDesc.arrayLayerCount = mDiffuseTextureAtlas.GetDepthOrArrayLayers();
+            viewDesc.aspect = wgpu::TextureAspect::All;
+            viewDesc.baseArrayLayer = 0;
+            viewDesc.dimension = wgpu::TextureViewDimension::e2DArray;
+            viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+            viewDesc.mipLevelCount = 1;
+            viewDesc.baseMipLevel = iLevel - 1;
+            wgpu::TextureView sourceView = mDiffuseTextureAtlas.CreateView(&viewDesc);
+            viewDesc.baseMipLevel = iLevel;
+            wgpu::TextureView destView = mDiffuseTextureAtlas.CreateView(&viewDesc);
+
+            wgpu::BindGroupEntry aBindGroupEntries[4] = {};
+            aBindGroupEntries[0].binding = 0;
+            aBindGroupEntries[0].buffer = mDiffuseAtlasMipUniformBuffer;
+            aBindGroupEntries[0].offset = kiAtlasMipUniformStride * iLevel;
+            aBindGroupEntries[0].size = sizeof(uint32_t) * 4;
+            aBindGroupEntries[1].binding = 1;
+            aBindGroupEntries[1].buffer = maBuffers["diffuseTextureAtlasInfoBuffer"];
+            aBindGroupEntries[2].binding = 2;
+            aBindGroupEntries[2].textureView = sourceView;
+            aBindGroupEntries[3].binding = 3;
+            aBindGroupEntries[3].textureView = destView;
+
+            wgpu::BindGroupDescriptor bindGroupDesc = {};
+            bindGroupDesc.layout = bindGroupLayout;
+            bindGroupDesc.entries = aBindGroupEntries;
+            bindGroupDesc.entryCount = 4;
+            maDiffuseAtlasMipBindGroups.push_back(mpDevice->CreateBindGroup(&bindGroupDesc));
+        }
+    }
+
+    /*
+    ** level by level for the entries just placed, one entry per workgroup layer
+    */
+    void CRenderer::generateDiffuseAtlasMips(
+        uint32_t iFirstEntry,
+        uint32_t iNumEntries)
+    {
+        if(mDiffuseAtlasMipPipeline == nullptr || iNumEntries == 0)
+        {
+            return;
+        }
+
+        uint32_t iMaxWidth = 0, iMaxHeight = 0;
+        for(uint32_t iEntry = iFirstEntry; iEntry < iFirstEntry + iNumEntries; iEntry++)
+        {
+            iMaxWidth = std::max(iMaxWidth, maDiffuseTextureAtlasInfo[iEntry].miImageWidth);
+            iMaxHeight = std::max(iMaxHeight, maDiffuseTextureAtlasInfo[iEntry].miImageHeight);
+        }
+
+        wgpu::CommandEncoderDescriptor commandEncoderDesc = {};
+        wgpu::CommandEncoder commandEncoder = mpDevice->CreateCommandEncoder(&commandEncoderDesc);
+        wgpu::ComputePassDescriptor computePassDesc = {};
+        wgpu::ComputePassEncoder computePassEncoder = commandEncoder.BeginComputePass(&computePassDesc);
+        computePassEncoder.PushDebugGroup("Atlas Mips");
+        computePassEncoder.SetPipeline(mDiffuseAtlasMipPipeline);
+        for(uint32_t iLevel = 1; iLevel <= (uint32_t)maDiffuseAtlasMipBindGroups.size(); iLevel++)
+        {
+            uint32_t aiUniformData[4] = {iLevel, iFirstEntry, iNumEntries, 0};
+            mpDevice->GetQueue().WriteBuffer(
+                mDiffuseAtlasMipUniformBuffer,
+                kiAtlasMipUniformStride * iLevel,
+                aiUniformData,
+                sizeof(aiUniformData));
+
+            uint32_t iLevelWidth = std::max(iMaxWidth >> iLevel, 1u);
+            uint32_t iLevelHeight = std::max(iMaxHeight >> iLevel, 1u);
+            computePassEncoder.SetBindGroup(0, maDiffuseAtlasMipBindGroups[iLevel - 1]);
+            computePassEncoder.DispatchWorkgroups(
+                (iLevelWidth + 7) / 8,
+                (iLevelHeight + 7) / 8,
+                iNumEntries);
+        }
+        computePassEncoder.PopDebugGroup();
+        computePassEncoder.End();
+
+        wgpu::CommandBuffer commandBuffer = commandEncoder.Finish();
+        mpDevice->GetQueue().Submit(1, &commandBuffer);
+    }
+
+    /*
+    ** levels are uploaded straight from the file, nothing is decoded or packed here
+    */
+    bool CRenderer::setupDiffuseTextureAtlas(
+        char const* pcAtlasData,
+        uint64_t iAtlasDataSize)
+    {
+        Loader::AtlasFileHeader header;
+        std::vector<Loader::AtlasTextureInfo> aTextureInfo;
+        std::vector<Loader::AtlasMipLevel> aMipLevels;
+        if(!Loader::readAtlasFile(header, aTextureInfo, aMipLevels, pcAtlasData, iAtlasDataSize))
+        {
+            return false;
+        }
+
+        // compressed formats only when the device was created with them
+        wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+        switch((Loader::AtlasFormat)header.miFormat)
+        {
+        case Loader::AtlasFormat::RGBA8:
+            format = wgpu::TextureFormat::RGBA8Unorm;
+            break;
+        case Loader::AtlasFormat::BC7:
+            format = mpDevice->HasFeature(wgpu::FeatureName::TextureCompressionBC) ? wgpu::TextureFormat::BC7RGBAUnorm : wgpu::TextureFormat::Undefined;
+            break;
+        case Loader::AtlasFormat::ETC2RGBA8:
+            format = mpDevice->HasFeature(wgpu::FeatureName::TextureCompressionETC2) ? wgpu::TextureFormat::ETC2RGBA8Unorm : wgpu::TextureFormat::Undefined;
+            break;
+        default:
+            break;
+        }
+        if(format == wgpu::TextureFormat::Undefined)
+        {
+            DEBUG_PRINTF("%s : %d atlas format %d with %d pages isn\'t supported\n",
+                __FILE__,
+                __LINE__,
+                header.miFormat,
+                header.miNumPages);
+            return false;
+        }
+
+        wgpu::TextureFormat aViewFormats[] = {format};
+        wgpu::TextureDescriptor textureDesc = {};
+        textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
+        textureDesc.dimension = wgpu::TextureDimension::e2D;
+        textureDesc.format = format;
+        textureDesc.mipLevelCount = header.miNumMips;
+        textureDesc.sampleCount = 1;
+        textureDesc.size.depthOrArrayLayers = header.miNumPages;
+        textureDesc.size.width = header.miPageWidth;
+        textureDesc.size.height = header.miPageHeight;
+        textureDesc.viewFormatCount = 1;
+        textureDesc.viewFormats = aViewFormats;
+        mDiffuseTextureAtlas = mpDevice->CreateTexture(&textureDesc);
+
+        // levels smaller than a block are copied as a whole block
+        Loader::AtlasFormatInfo formatInfo = Loader::getAtlasFormatInfo(header.miFormat);
+        for(auto const& mipLevel : aMipLevels)
+        {
+#if defined(__EMSCRIPTEN__)
+            wgpu::TextureDataLayout layout = {};
+#else
+            wgpu::TexelCopyBufferLayout layout = {};
+#endif // __EMSCRIPTEN__
+            layout.bytesPerRow = mipLevel.miBytesPerRow;
+            layout.offset = 0;
+            layout.rowsPerImage = mipLevel.miNumRows;
+            wgpu::Extent3D extent = {};
+            extent.depthOrArrayLayers = 1;
+            extent.width = ((mipLevel.miWidth + formatInfo.miBlockWidth - 1) / formatInfo.miBlockWidth) * formatInfo.miBlockWidth;
+            extent.height = ((mipLevel.miHeight + formatInfo.miBlockHeight - 1) / formatInfo.miBlockHeight) * formatInfo.miBlockHeight;
+
+#if defined(__EMSCRIPTEN__)
+            wgpu::ImageCopyTexture destination = {};
+#else 
+            wgpu::TexelCopyTextureInfo destination = {};
+#endif // __EMSCRIPTEN__
+            destination.aspect = wgpu::TextureAspect::All;
+            destination.mipLevel = mipLevel.miLevel;
+            destination.origin = {.x = 0, .y = 0, .z = mipLevel.miPage};
+            destination.texture = mDiffuseTextureAtlas;
+            mpDevice->GetQueue().WriteTexture(
+                &destination,
+                pcAtlasData + mipLevel.miOffset,
+                (size_t)mipLevel.miSize,
+                &layout,
+                &extent);
+        }
+
+        // same layout, see AtlasTextureInfo
+        static_assert(sizeof(TextureAtlasInfo) == sizeof(Loader::AtlasTextureInfo), "atlas texture info doesn't match the file's");
+        maDiffuseTextureAtlasInfo.resize(aTextureInfo.size());
+        memcpy(maDiffuseTextureAtlasInfo.data(), aTextureInfo.data(), aTextureInfo.size() * sizeof(TextureAtlasInfo));
+
+        DEBUG_PRINTF("diffuse atlas format %d, %d pages of %d x %d, %d mips, %d textures\n",
+            header.miFormat,
+            header.miNumPages,
+            header.miPageWidth,
+            header.miPageHeight,
+            header.miNumMips,
+            header.miNumTextures);
+
+        return true;
+    }
+
     /*
     **
     */
-    void CRenderer::setupFontPipeline()
+    void CRenderer::setupFontAtlas(
+        char const* acAtlasImageData,
+        uint32_t iAtlasFileSize,
+        char const* acFontInfoData,
+        uint32_t iFontInfoFileSize)
+    {
+        int32_t iImageWidth = 0, iImageHeight = 0, iNumComp = 0;
+        stbi_uc* pImageData = stbi_load_from_memory(
+            (stbi_uc const*)acAtlasImageData,
+            (int32_t)iAtlasFileSize,
+            &iImageWidth,
+            &iImageHeight,
+            &iNumComp,
+            4
+        );
+
+        wgpu::TextureFormat aViewFormats[] = {wgpu::TextureFormat::RGBA8Unorm};
+        wgpu::TextureDescriptor textureDesc = {};
+        textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
+        textureDesc.dimension = wgpu::TextureDimension::e2D;
+        textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        textureDesc.mipLevelCount = 1;
+        textureDesc.sampleCount = 1;
+        textureDesc.size.depthOrArrayLayers = 1;
+        textureDesc.size.width = iImageWidth;
+        textureDesc.size.height = iImageHeight;
+        textureDesc.viewFormatCount = 1;
+        textureDesc.viewFormats = aViewFormats;
+        maTextures["font-atlas-image"] = mpDevice->CreateTexture(&textureDesc);
+        maTextures["font-atlas-image"].SetLabel("Font Atlas");
+
+#if defined(__EMSCRIPTEN__)
+        wgpu::TextureDataLayout layout = {};
+#else
+        wgpu::TexelCopyBufferLayout layout = {};
+#endif // __EMSCRIPTEN__
+        layout.bytesPerRow = iImageWidth * 4 * sizeof(char);
+        layout.offset = 0;
+        layout.rowsPerImage = iImageHeight;
+        wgpu::Extent3D extent = {};
+        extent.depthOrArrayLayers = 1;
+        extent.width = iImageWidth;
+        extent.height = iImageHeight;
+
+#if defined(__EMSCRIPTEN__)
+        wgpu::ImageCopyTexture destination = {};
+#else 
+        wgpu::TexelCopyTextureInfo destination = {};
+#endif // __EMSCRIPTEN__
+        destination.aspect = wgpu::TextureAspect::All;
+        destination.mipLevel = 0;
+        destination.origin = {.x = 0, .y = 0, .z = 0, };
+        destination.texture = maTextures["font-atlas-image"];
+        mpDevice->GetQueue().WriteTexture(
+            &destination,
+            pImageData,
+            iImageWidth * iImageHeight * 4,
+            &layout,
+            &extent);
+        stbi_image_free(pImageData);
+
+        wgpu::TextureViewDescriptor viewDesc = {};
+        viewDesc.arrayLayerCount = 1;
+        viewDesc.aspect = wgpu::TextureAspect::All;
+        viewDesc.baseArrayLayer = 0;
+        viewDesc.baseMipLevel = 0;
+        viewDesc.dimension = wgpu::TextureViewDimension::e2D;
+        viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        viewDesc.label = "Font Texture Atlas";
+        viewDesc.mipLevelCount = 1;
+#if !defined(__EMSCRIPTEN__)
+        viewDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
+#endif // __EMSCRIPTEN__
+        maTextureViews["font-atlas-image"] = maTextures["font-atlas-image"].CreateView(&viewDesc);
+
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.size = std::max(iFontInfoFileSize, 16u);
+        bufferDesc.usage = (wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Storage);
+        maBuffers["font-info"] = mpDevice->CreateBuffer(&bufferDesc);
+        maBuffers["font-info"].SetLabel("Font Info Buffer");
+        mpDevice->GetQueue().WriteBuffer(maBuffers["font-info"], 0, acFontInfoData, iFontInfoFileSize);
+
+        uint32_t iNumFontInfo = iFontInfoFileSize / sizeof(OutputGlyphInfo);
+        maFontInfo.resize(iNumFontInfo);
+        memcpy(maFontInfo.data(), acFontInfoData, iNumFontInfo * sizeof(OutputGlyphInfo));
+    }
+
+#if !defined(__EMSCRIPTEN__)
+    /*
+    ** runs on a loader thread, the texels are freed with the last reference
+    ** a cached decode of the same bytes is mapped instead of running stb_image, a fresh decode is written to the cache for the next run
+    */
+    CRenderer::DecodedTexture CRenderer::decodeTexture(
+        Loader::Request const& request,
+        Loader::CDecodedTextureCache* pTextureCache)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        DecodedTexture decoded;
+        Loader::DecodedTextureHeader cacheHeader;
+        if(request.mbLoaded && pTextureCache)
+        {
+            Loader::FileView cachedTexels;
+            if(pTextureCache->load(cachedTexels, cacheHeader, request.mView.maData) &&
+               cacheHeader.miFormat == (uint32_t)Loader::AtlasFormat::RGBA8)
+            {
+                decoded.mpTexels = std::shared_ptr<uint8_t const>(cachedTexels.mpBacking, (uint8_t const*)cachedTexels.data());
+                decoded.miImageWidth = (int32_t)cacheHeader.miImageWidth;
+                decoded.miImageHeight = (int32_t)cacheHeader.miImageHeight;
+                decoded.mbFromCache = true;
+            }
+        }
+
+        if(request.mbLoaded && !decoded.mbFromCache)
+        {
+            int32_t iImageComp = 0;
+            stbi_uc* pImageData = stbi_load_from_memory(
+                (stbi_uc const*)request.mView.data(),
+                (int32_t)request.mView.size(),
+                &decoded.miImageWidth,
+                &decoded.miImageHeight,
+                &iImageComp,
+                4
+            );
+            if(pImageData)
+            {
+                decoded.mpTexels = std::shared_ptr<uint8_t const>(pImageData, stbi_image_free);
+
+                if(pTextureCache)
+                {
+                    cacheHeader.miImageWidth = (uint32_t)decoded.miImageWidth;
+                    cacheHeader.miImageHeight = (uint32_t)decoded.miImageHeight;
+                    cacheHeader.miFormat = (uint32_t)Loader::AtlasFormat::RGBA8;
+                    pTextureCache->store(cacheHeader, pImageData);
+                }
+            }
+            else
+            {
+                DEBUG_PRINTF("%s : %d can\'t decode \"%s\"\n",
+                    __FILE__,
+                    __LINE__,
+                    request.mFilePath.c_str());
+            }
+        }
+
+        decoded.miDecodeUS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+        return decoded;
+    }
+
+    /*
+    ** materials pointing at atlas slots that aren't filled yet are drawn untextured
+    */
+    void CRenderer::uploadMaterials()
+    {
+        uint32_t iBufferSize = maBufferSizes["meshMaterials"];
+        uint32_t iNumMaterials = std::min((uint32_t)(macMaterials.size() / sizeof(Material)), iBufferSize / (uint32_t)sizeof(Material));
+
+        std::vector<Material> aMaterials(iNumMaterials);
+        memcpy(aMaterials.data(), macMaterials.data(), iNumMaterials * sizeof(Material));
+        for(auto& material : aMaterials)
+        {
+            if(material.miAlbedoTextureID < (uint32_t)maDiffuseTextureAtlasInfo.size() &&
+               maDiffuseTextureAtlasInfo[material.miAlbedoTextureID].miImageWidth == 0)
+            {
+                material.miAlbedoTextureID = UINT32_MAX;
+            }
+        }
+
+        mpDevice->GetQueue().WriteBuffer(
+            maBuffers["meshMaterials"],
+            0,
+            aMaterials.data(),
+            iNumMaterials * sizeof(Material));
+    }
+
+    /*
+    ** patch in whatever finished loading since the last frame, diffuse textures are placed in name order so the atlas layout doesn't depend on arrival order
+    */
+    void CRenderer::updateAsyncLoads()
+    {
+        auto isReady = [](std::future<Loader::Request>& future)
+        {
+            return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        };
+
+        if(isReady(mMaterialIDFuture))
+        {
+            Loader::Request request = mMaterialIDFuture.get();
+            uint64_t iSize = std::min(request.mView.size(), (uint64_t)maBufferSizes["meshMaterialIDs"]) & ~3ull;
+            if(request.mbLoaded && iSize > 0)
+            {
+                mpDevice->GetQueue().WriteBuffer(
+                    maBuffers["meshMaterialIDs"],
+                    0,
+                    request.mView.data(),
+                    iSize);
+            }
+        }
+
+        bool bUpdateMaterials = false;
+        if(isReady(mMaterialFuture))
+        {
+            Loader::Request request = mMaterialFuture.get();
+            if(request.mbLoaded)
+            {
+                macMaterials.assign(request.mView.data(), request.mView.data() + request.mView.size());
+                if(macMaterials.size() > maBufferSizes["meshMaterials"])
+                {
+                    DEBUG_PRINTF("%s : %d %d materials for %d meshes, extra materials are dropped\n",
+                        __FILE__,
+                        __LINE__,
+                        (uint32_t)(macMaterials.size() / sizeof(Material)),
+                        (uint32_t)maMeshTriangleRanges.size());
+                }
+                bUpdateMaterials = true;
+            }
+        }
+
+        // uploads are spread over frames to keep the frame time in check
+        auto start = std::chrono::high_resolution_clock::now();
+        uint32_t iNumPlacedBefore = miNumPlacedDiffuseTextures;
+        while(miNumPlacedDiffuseTextures < (uint32_t)maDiffuseTextureFutures.size() &&
+              isReady(maDiffuseTextureFutures[miNumPlacedDiffuseTextures]))
+        {
+            uint32_t iTexture = miNumPlacedDiffuseTextures;
+            DecodedTexture decoded = maDiffuseTextureFutures[iTexture].get();
+            miDiffuseTextureDecodeUS += decoded.miDecodeUS;
+            miNumCachedDiffuseTextures += decoded.mbFromCache ? 1 : 0;
+
+            if(decoded.mpTexels)
+            {
+                auto uploadStart = std::chrono::high_resolution_clock::now();
+                copyToDiffuseAtlas(iTexture, decoded.mpTexels.get(), decoded.miImageWidth, decoded.miImageHeight);
+                miDiffuseTextureUploadUS += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+            }
+            ++miNumPlacedDiffuseTextures;
+
+            uint64_t iElapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+            if(iElapsedMS >= 8)
+            {
+                break;
+            }
+        }
+
+        if(miNumPlacedDiffuseTextures > iNumPlacedBefore)
+        {
+            mpDevice->GetQueue().WriteBuffer(
+                maBuffers["diffuseTextureAtlasInfoBuffer"],
+                iNumPlacedBefore * sizeof(TextureAtlasInfo),
+                maDiffuseTextureAtlasInfo.data() + iNumPlacedBefore,
+                (miNumPlacedDiffuseTextures - iNumPlacedBefore) * sizeof(TextureAtlasInfo));
+            generateDiffuseAtlasMips(iNumPlacedBefore, miNumPlacedDiffuseTextures - iNumPlacedBefore);
+            bUpdateMaterials = true;
+
+            if(miNumPlacedDiffuseTextures == (uint32_t)maDiffuseTextureFutures.size())
+            {
+                uint32_t iNumDecoded = 0;
+                for(auto const& info : maDiffuseTextureAtlasInfo)
+                {
+                    iNumDecoded += (info.miImageWidth > 0) ? 1 : 0;
+                }
+                uint64_t iTotalMS = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - mDiffuseTextureStart).count();
+                printf("diffuse textures: %d of %d placed in %d ms, decode %d ms across the loader threads (%d from the texture cache), upload %d ms\n",
+                    iNumDecoded,
+                    miNumPlacedDiffuseTextures,
+                    (uint32_t)iTotalMS,
+                    (uint32_t)(miDiffuseTextureDecodeUS / 1000),
+                    miNumCachedDiffuseTextures,
+                    (uint32_t)(miDiffuseTextureUploadUS / 1000));
+
+                maDiffuseTextureFutures.clear();
+                miNumPlacedDiffuseTextures = 0;
+            }
+        }
+
+        if(bUpdateMaterials && macMaterials.size() > 0)
+        {
+            uploadMaterials();
+        }
+
+        if(!mbFontReady && isReady(mFontAtlasFuture) && isReady(mGlyphInfoFuture) && isReady(mFontShaderFuture))
+        {
+            Loader::Request fontAtlasRequest = mFontAtlasFuture.get();
+            Loader::Request glyphInfoRequest = mGlyphInfoFuture.get();
+            Loader::Request fontShaderRequest = mFontShaderFuture.get();
+            if(fontAtlasRequest.mbLoaded && glyphInfoRequest.mbLoaded && fontShaderRequest.mbLoaded)
+            {
+                setupFontAtlas(
+                    fontAtlasRequest.mView.data(),
+                    (uint32_t)fontAtlasRequest.mView.size(),
+                    glyphInfoRequest.mView.data(),
+                    (uint32_t)glyphInfoRequest.mView.size());
+
+                mFontShaderView = fontShaderRequest.mView;
+                setupFontPipeline();
+                mFontShaderView = Loader::FileView();
+
+                mbFontReady = true;
+            }
+        }
+    }
+#endif // !__EMSCRIPTEN__
+
+    /*
+    ** output texture for draw text
+    */
+    void CRenderer::createFontOutputAttachment()
     {
-        // output texture for draw text
         wgpu::TextureFormat aViewFormats[] = {wgpu::TextureFormat::RGBA8Unorm};
         wgpu::TextureDescriptor textureDesc = {};
         textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::RenderAttachment;
@@ -1385,6 +2815,17 @@ namespace Render
         textureDesc.viewFormatCount = 1;
         textureDesc.viewFormats = aViewFormats;
         mFontOutputAttachment = mpDevice->CreateTexture(&textureDesc);
+    }
+
+    /*
+    **
+    */
+    void CRenderer::setupFontPipeline()
+    {
+        if(!mFontOutputAttachment)
+        {
+            createFontOutputAttachment();
+        }
 
         wgpu::SamplerDescriptor samplerDesc = {};
         samplerDesc.addressModeU = wgpu::AddressMode::ClampToEdge;
@@ -1523,12 +2964,20 @@ namespace Render
         //printf("shader content: %s\n", acShaderFileContent);
 
 #else 
+        // arrives with the rest of the font files
         std::vector<char> acShaderFileContent;
-        Loader::loadFile(
-            acShaderFileContent,
-            shaderPath,
-            true
-        );
+        if(mFontShaderView.valid())
+        {
+            acShaderFileContent.assign(mFontShaderView.data(), mFontShaderView.data() + mFontShaderView.size());
+        }
+        else
+        {
+            Loader::loadFile(
+                acShaderFileContent,
+                shaderPath,
+                true
+            );
+        }
         wgslDesc.code = acShaderFileContent.data();
 #endif // __EMSCRIPTEN__
 
@@ -4,9 +4,18 @@
 #include <webgpu/webgpu_cpp.h>
 #include <string>
 #include <map>
+#include <span>
 #include <chrono>
 
+#if !defined(__EMSCRIPTEN__)
+#include <future>
+#include <loader/async_loader.h>
+#include <loader/texture_cache.h>
+#include <render/virtual_texture.h>
+#endif // !__EMSCRIPTEN__
+
 #include <math/mat4.h>
+#include <math/skyline_packer.h>
 
 namespace Render
 {
@@ -121,11 +130,54 @@ namespace Render
         }
 
         float  mfCrossSectionPlaneD = 1000000.0f;
+        float                                   mfLODPixelError = 1.0f;         // 0 always draws the full meshes
         float3                                  mCameraPosition;
         float3                                  mCameraLookAt;
 
     protected:
+        // layouts match the converter's
+        struct MeshCluster
+        {
+            float4      mBoundingSphere;
+            float4      mMinPosition;
+            float4      mMaxPosition;
+            float4      mNormalCone;
+
+            uint32_t    miMesh;
+            uint32_t    miFirstIndex;
+            uint32_t    miNumIndices;
+            uint32_t    miPadding;
+        };
+
+        struct MeshLOD
+        {
+            uint32_t    miMesh;
+            uint32_t    miFirstIndex;
+            uint32_t    miNumIndices;
+            float       mfError;
+        };
+
+        struct MeshInstance
+        {
+            float4      maTransform[3];
+            uint32_t    miMesh;
+            uint32_t    miGeometryMesh;
+            uint32_t    miPadding0;
+            uint32_t    miPadding1;
+        };
+
         void createRenderJobs(CreateDescriptor& desc);
+        void setupMeshSections(
+            std::map<uint32_t, std::span<char const>> const& aSectionData,
+            uint32_t iNumTotalIndices);
+        void setupMeshClusters(std::vector<MeshCluster>& aMeshClusters);
+        void setupMeshLODs(
+            std::vector<MeshLOD> const& aMeshLODs,
+            uint32_t iNumTotalIndices,
+            uint32_t iNumSmallIndices);
+        void setupMeshInstances(
+            char const* pcInstanceData,
+            uint64_t iDataSize);
 
     protected:
         CreateDescriptor                        mCreateDesc;
@@ -150,6 +202,18 @@ namespace Render
         std::vector<MeshTriangleRange>          maMeshTriangleRanges;
         std::vector<MeshExtent>                 maMeshExtents;
 
+        // meshlets are culled and drawn individually, ranges index the cluster list per mesh
+        std::vector<MeshTriangleRange>          maMeshClusterRanges;
+        uint32_t                                miNumMeshClusters = 0;
+
+        // per mesh, what its 16 bit indices are relative to, kiWideIndexBaseVertex for meshes drawn from the 32 bit index buffer
+        std::vector<uint32_t>                   maiMeshBaseVertices;
+        uint32_t                                miNumSmallIndexClusters = 0;
+
+        // meshes drawn with each mesh's triangles, ranges index maiMeshInstanceList, empty for meshes drawn as instances of another
+        std::vector<MeshTriangleRange>          maMeshInstanceRanges;
+        std::vector<uint32_t>                   maiMeshInstanceList;
+
         wgpu::Instance*                         mpInstance;
 
         wgpu::Sampler*                          mpSampler;
@@ -178,6 +242,85 @@ namespace Render
         wgpu::Texture                           mDiffuseTextureAtlas;
         wgpu::TextureView                       mDiffuseTextureAtlasView;
 
+        struct TextureAtlasInfo
+        {
+            uint2               miTextureCoord;
+            float2              mUV;
+            uint32_t            miTextureID;
+            uint32_t            miImageWidth;
+            uint32_t            miImageHeight;
+            uint32_t            miNumMips;          // levels the shader can pick from without bleeding into the neighbours
+            uint32_t            miPage;             // layer of the atlas texture
+            uint32_t            miPadding;
+        };
+
+        // indexed by texture id, empty slots have zero size
+        std::vector<TextureAtlasInfo>           maDiffuseTextureAtlasInfo;
+        std::unique_ptr<CSkylinePacker>         mpDiffuseAtlasPacker;           // pngs packed at load time only
+
+        // trilinear, the shader clamps the coordinates to the entry
+        wgpu::Sampler                           mDiffuseTextureSampler;
+
+        // stands in for the atlas when the converter wrote a page file
+        CVirtualTexture                         mVirtualTexture;
+
+        // levels of the load time atlas are filtered on the gpu as the pngs are placed, see shaders/atlas-mip-compute.shader
+        wgpu::ComputePipeline                   mDiffuseAtlasMipPipeline;
+        wgpu::Buffer                            mDiffuseAtlasMipUniformBuffer;
+        std::vector<wgpu::BindGroup>            maDiffuseAtlasMipBindGroups;    // level 1 onwards
+
+        void setupDiffuseAtlasMipPipeline();
+
+        void generateDiffuseAtlasMips(
+            uint32_t iFirstEntry,
+            uint32_t iNumEntries);
+
+        void copyToDiffuseAtlas(
+            uint32_t iTextureID,
+            uint8_t const* pImageData,
+            int32_t iImageWidth,
+            int32_t iImageHeight);
+
+        // "-diffuse-atlas.bin" from the converter, false leaves the pngs to be packed at load time
+        bool setupDiffuseTextureAtlas(
+            char const* pcAtlasData,
+            uint64_t iAtlasDataSize);
+
+#if !defined(__EMSCRIPTEN__)
+        // files still in flight after setup, patched in at the start of each frame
+        std::future<Loader::Request>                mMaterialIDFuture;
+        std::future<Loader::Request>                mMaterialFuture;
+        // decoded on the loader threads, placed and uploaded on this one
+        struct DecodedTexture
+        {
+            std::shared_ptr<uint8_t const>          mpTexels;           // rgba8, null if the file couldn't be loaded or decoded
+            int32_t                                 miImageWidth = 0;
+            int32_t                                 miImageHeight = 0;
+            uint64_t                                miDecodeUS = 0;
+            bool                                    mbFromCache = false;
+        };
+
+        std::vector<std::future<DecodedTexture>>    maDiffuseTextureFutures;
+        uint32_t                                    miNumPlacedDiffuseTextures = 0;
+        std::chrono::high_resolution_clock::time_point mDiffuseTextureStart;
+        uint64_t                                    miDiffuseTextureDecodeUS = 0;
+        uint64_t                                    miDiffuseTextureUploadUS = 0;
+        uint32_t                                    miNumCachedDiffuseTextures = 0;
+        std::vector<char>                           macMaterials;
+
+        std::future<Loader::Request>                mFontAtlasFuture;
+        std::future<Loader::Request>                mGlyphInfoFuture;
+        std::future<Loader::Request>                mFontShaderFuture;
+        Loader::FileView                            mFontShaderView;
+
+        void updateAsyncLoads();
+
+        static DecodedTexture decodeTexture(
+            Loader::Request const& request,
+            Loader::CDecodedTextureCache* pTextureCache);
+        void uploadMaterials();
+#endif // !__EMSCRIPTEN__
+
         std::map<std::string, wgpu::Texture>              maTextures;
         std::map<std::string, wgpu::TextureView>          maTextureViews;
 
@@ -201,7 +344,14 @@ namespace Render
         wgpu::RenderPipeline    mDrawTextPipeline;
 
         wgpu::Texture           mFontOutputAttachment;
-
+        bool                    mbFontReady = false;
+
+        void createFontOutputAttachment();
+        void setupFontAtlas(
+            char const* acAtlasImageData,
+            uint32_t iAtlasFileSize,
+            char const* acFontInfoData,
+            uint32_t iFontInfoFileSize);
         void setupFontPipeline();
         void drawText(
             std::vector<wgpu::CommandBuffer>& aCommandBuffers,
@@ -0,0 +1,711 @@
+#include <render/virtual_texture.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <loader/loader.h>
+#include <loader/mesh_file.h>
+#include <utils/LogPrint.h>
+
+// screen pixels per feedback texel, one pixel of the cell writes its request each frame and the pixel moves around the cell
+constexpr uint32_t kiFeedbackCellSize = 8;
+
+// feedback copies waiting to be mapped, a frame's feedback is dropped when all of them are
+constexpr uint32_t kiNumFeedbackReadbacks = 3;
+
+// tiles handed to the streamer and not uploaded yet
+constexpr uint32_t kiMaxTilesInFlight = 64;
+
+// same packing as packTileRequest in deferred.shader, the top bit marks a request
+constexpr uint32_t kiTileRequestValid = 0x80000000;
+constexpr uint32_t kiMaxPages = 256;
+constexpr uint32_t kiMaxTilesAcross = 256;
+
+namespace Render
+{
+    /*
+    **
+    */
+    CVirtualTexture::~CVirtualTexture()
+    {
+#if !defined(__EMSCRIPTEN__)
+        if(mStreamer.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mStreamMutex);
+                mbStopStreaming = true;
+            }
+            mStreamCondition.notify_all();
+            mStreamer.join();
+        }
+#endif // !__EMSCRIPTEN__
+    }
+
+    /*
+    **
+    */
+    bool CVirtualTexture::setup(
+        CreateInfo const& createInfo,
+        std::string const& pageFilePath,
+        std::vector<Loader::AtlasTextureInfo>& aTextureInfo)
+    {
+        mpDevice = createInfo.mpDevice;
+        mCreateInfo = createInfo;
+        mbEnabled = false;
+
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.size = 64;
+        bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
+        mUniformBuffer = mpDevice->CreateBuffer(&bufferDesc);
+        mUniformBuffer.SetLabel("Virtual Texture Uniform Buffer");
+
+#if defined(__EMSCRIPTEN__)
+        // the feedback is read back without blocking, which the web build doesn't do yet
+        createPlaceholders();
+        return false;
+#else
+        std::vector<Loader::AtlasTextureInfo> aPageFileTextureInfo;
+        if(!Loader::loadFileView(mPageFileView, pageFilePath) ||
+           !Loader::readPageFile(mHeader, aPageFileTextureInfo, maPageFileTiles, mPageFileView.data(), mPageFileView.size()))
+        {
+            mPageFileView = Loader::FileView();
+            createPlaceholders();
+            return false;
+        }
+
+        uint32_t iNumTilesX = 0, iNumTilesY = 0;
+        Loader::getPageFileLevelTiles(iNumTilesX, iNumTilesY, mHeader, 0);
+        miSlotSize = mHeader.miTileSize + mHeader.miTileBorder * 2;
+        miNumSlotsX = std::min(std::min(createInfo.miNumPhysicalTilesX, 8192 / miSlotSize), 256u);
+        miNumSlotsY = std::min(std::min(createInfo.miNumPhysicalTilesY, 8192 / miSlotSize), 256u);
+
+        // the last level is pinned, the rest of the slots are for streaming
+        uint32_t iLastLevelTilesX = 0, iLastLevelTilesY = 0;
+        Loader::getPageFileLevelTiles(iLastLevelTilesX, iLastLevelTilesY, mHeader, mHeader.miNumMips - 1);
+        uint32_t iNumPinnedTiles = iLastLevelTilesX * iLastLevelTilesY * mHeader.miNumPages;
+        if(mHeader.miNumPages > kiMaxPages || iNumTilesX > kiMaxTilesAcross || iNumTilesY > kiMaxTilesAcross ||
+           iNumPinnedTiles + kiMaxTilesInFlight > miNumSlotsX * miNumSlotsY)
+        {
+            DEBUG_PRINTF("%s : %d %d virtual pages of %d x %d tiles with %d pinned don\'t fit %d x %d physical tiles\n",
+                __FILE__,
+                __LINE__,
+                mHeader.miNumPages,
+                iNumTilesX,
+                iNumTilesY,
+                iNumPinnedTiles,
+                miNumSlotsX,
+                miNumSlotsY);
+            mPageFileView = Loader::FileView();
+            createPlaceholders();
+            return false;
+        }
+
+        miNumPageTiles = Loader::getPageFileFirstTile(mHeader, 1, 0);
+        maTiles.assign(mHeader.miNumTiles, TileState());
+        for(uint32_t iPage = 0; iPage < mHeader.miNumPages; iPage++)
+        {
+            for(uint32_t iLevel = 0; iLevel < mHeader.miNumMips; iLevel++)
+            {
+                uint32_t iLevelTilesX = 0, iLevelTilesY = 0;
+                Loader::getPageFileLevelTiles(iLevelTilesX, iLevelTilesY, mHeader, iLevel);
+                uint32_t iFirstTile = Loader::getPageFileFirstTile(mHeader, iPage, iLevel);
+                for(uint32_t i = 0; i < iLevelTilesX * iLevelTilesY; i++)
+                {
+                    maTiles[iFirstTile + i].miLevel = (uint8_t)iLevel;
+                }
+            }
+        }
+
+        maSlots.assign(miNumSlotsX * miNumSlotsY, Slot());
+        maiFreeSlots.clear();
+        for(uint32_t iSlot = (uint32_t)maSlots.size(); iSlot > 0; iSlot--)
+        {
+            maiFreeSlots.push_back(iSlot - 1);
+        }
+        maLRU.clear();
+        mabDirtyPages.assign(mHeader.miNumPages, true);
+
+        // physical slots, sampled bilinearly inside a tile's border
+        wgpu::TextureDescriptor textureDesc = {};
+        textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
+        textureDesc.dimension = wgpu::TextureDimension::e2D;
+        textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        textureDesc.mipLevelCount = 1;
+        textureDesc.sampleCount = 1;
+        textureDesc.size.width = miNumSlotsX * miSlotSize;
+        textureDesc.size.height = miNumSlotsY * miSlotSize;
+        textureDesc.size.depthOrArrayLayers = 1;
+        mPhysicalTexture = mpDevice->CreateTexture(&textureDesc);
+        mPhysicalTexture.SetLabel("Virtual Texture Physical Tiles");
+        mPhysicalView = mPhysicalTexture.CreateView();
+
+        // a texel per tile, level and page, padded so the levels past a single tile still get their own mip
+        textureDesc.size.width = std::max(iNumTilesX, 1u << (mHeader.miNumMips - 1));
+        textureDesc.size.height = std::max(iNumTilesY, 1u << (mHeader.miNumMips - 1));
+        textureDesc.size.depthOrArrayLayers = mHeader.miNumPages;
+        textureDesc.mipLevelCount = mHeader.miNumMips;
+        mIndirectionTexture = mpDevice->CreateTexture(&textureDesc);
+        mIndirectionTexture.SetLabel("Virtual Texture Indirection");
+
+        wgpu::TextureViewDescriptor viewDesc = {};
+        viewDesc.arrayLayerCount = mHeader.miNumPages;
+        viewDesc.aspect = wgpu::TextureAspect::All;
+        viewDesc.baseArrayLayer = 0;
+        viewDesc.baseMipLevel = 0;
+        viewDesc.dimension = wgpu::TextureViewDimension::e2DArray;
+        viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        viewDesc.label = "Virtual Texture Indirection";
+        viewDesc.mipLevelCount = mHeader.miNumMips;
+        mIndirectionView = mIndirectionTexture.CreateView(&viewDesc);
+
+        // one request per cell, the render targets are all made once at the screen size so this is too
+        miFeedbackWidth = (createInfo.miScreenWidth + kiFeedbackCellSize - 1) / kiFeedbackCellSize;
+        miFeedbackHeight = (createInfo.miScreenHeight + kiFeedbackCellSize - 1) / kiFeedbackCellSize;
+        bufferDesc.size = std::max((uint64_t)miFeedbackWidth * miFeedbackHeight * sizeof(uint32_t), (uint64_t)64);
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc | wgpu::BufferUsage::CopyDst;
+        mFeedbackBuffer = mpDevice->CreateBuffer(&bufferDesc);
+        mFeedbackBuffer.SetLabel("Virtual Texture Feedback");
+
+        maReadbacks.resize(kiNumFeedbackReadbacks);
+        bufferDesc.usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst;
+        for(auto& readback : maReadbacks)
+        {
+            readback.mBuffer = mpDevice->CreateBuffer(&bufferDesc);
+            readback.mBuffer.SetLabel("Virtual Texture Feedback Read Back");
+            readback.mState = ReadbackState::Free;
+        }
+
+        // last level up front, every lookup falls back to it
+        std::vector<char> acTexels;
+        for(uint32_t iPage = 0; iPage < mHeader.miNumPages; iPage++)
+        {
+            uint32_t iFirstTile = Loader::getPageFileFirstTile(mHeader, iPage, mHeader.miNumMips - 1);
+            for(uint32_t i = 0; i < iLastLevelTilesX * iLastLevelTilesY; i++)
+            {
+                if(readTile(acTexels, iFirstTile + i))
+                {
+                    uploadTile(iFirstTile + i, acTexels.data(), true);
+                }
+                else
+                {
+                    maTiles[iFirstTile + i].mbBroken = true;
+                }
+            }
+        }
+        for(uint32_t iPage = 0; iPage < mHeader.miNumPages; iPage++)
+        {
+            writeIndirection(iPage);
+        }
+
+        UniformData uniformData = {};
+        uniformData.miEnabled = 1;
+        uniformData.miTileSize = mHeader.miTileSize;
+        uniformData.miTileBorder = mHeader.miTileBorder;
+        uniformData.miNumMips = mHeader.miNumMips;
+        uniformData.miFeedbackWidth = miFeedbackWidth;
+        uniformData.miFeedbackHeight = miFeedbackHeight;
+        uniformData.miFeedbackCellSize = kiFeedbackCellSize;
+        mpDevice->GetQueue().WriteBuffer(mUniformBuffer, 0, &uniformData, sizeof(uniformData));
+
+        mbStopStreaming = false;
+        mStreamer = std::thread([this]()
+        {
+            streamer();
+        });
+
+        aTextureInfo = aPageFileTextureInfo;
+        mbEnabled = true;
+
+        DEBUG_PRINTF("virtual texture: %d pages of %d x %d, %d mips, %d of %d tiles in the page file, %d x %d physical tiles (%d MB), %d pinned\n",
+            mHeader.miNumPages,
+            mHeader.miPageWidth,
+            mHeader.miPageHeight,
+            mHeader.miNumMips,
+            (uint32_t)std::count_if(maPageFileTiles.begin(), maPageFileTiles.end(), [](Loader::PageFileTile const& tile) { return tile.miOffset != 0; }),
+            mHeader.miNumTiles,
+            miNumSlotsX,
+            miNumSlotsY,
+            (uint32_t)((uint64_t)miNumSlotsX * miNumSlotsY * miSlotSize * miSlotSize * 4 / (1024 * 1024)),
+            iNumPinnedTiles);
+
+        return true;
+#endif // __EMSCRIPTEN__
+    }
+
+    /*
+    ** bound in place of the real thing so the pipelines don't depend on there being a page file
+    */
+    void CVirtualTexture::createPlaceholders()
+    {
+        wgpu::TextureDescriptor textureDesc = {};
+        textureDesc.usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding;
+        textureDesc.dimension = wgpu::TextureDimension::e2D;
+        textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        textureDesc.mipLevelCount = 1;
+        textureDesc.sampleCount = 1;
+        textureDesc.size.width = 1;
+        textureDesc.size.height = 1;
+        textureDesc.size.depthOrArrayLayers = 1;
+        mPhysicalTexture = mpDevice->CreateTexture(&textureDesc);
+        mPhysicalView = mPhysicalTexture.CreateView();
+        mIndirectionTexture = mpDevice->CreateTexture(&textureDesc);
+
+        wgpu::TextureViewDescriptor viewDesc = {};
+        viewDesc.arrayLayerCount = 1;
+        viewDesc.aspect = wgpu::TextureAspect::All;
+        viewDesc.dimension = wgpu::TextureViewDimension::e2DArray;
+        viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+        viewDesc.mipLevelCount = 1;
+        mIndirectionView = mIndirectionTexture.CreateView(&viewDesc);
+
+        wgpu::BufferDescriptor bufferDesc = {};
+        bufferDesc.size = 64;
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc | wgpu::BufferUsage::CopyDst;
+        mFeedbackBuffer = mpDevice->CreateBuffer(&bufferDesc);
+        mFeedbackBuffer.SetLabel("Virtual Texture Feedback");
+
+        UniformData uniformData = {};
+        mpDevice->GetQueue().WriteBuffer(mUniformBuffer, 0, &uniformData, sizeof(uniformData));
+    }
+
+    /*
+    **
+    */
+    uint32_t CVirtualTexture::getTileIndex(
+        uint32_t iPage,
+        uint32_t iLevel,
+        uint32_t iTileX,
+        uint32_t iTileY) const
+    {
+        uint32_t iNumTilesX = 0, iNumTilesY = 0;
+        Loader::getPageFileLevelTiles(iNumTilesX, iNumTilesY, mHeader, iLevel);
+        if(iTileX >= iNumTilesX || iTileY >= iNumTilesY)
+        {
+            return UINT32_MAX;
+        }
+
+        return Loader::getPageFileFirstTile(mHeader, iPage, iLevel) + iTileY * iNumTilesX + iTileX;
+    }
+
+    /*
+    ** page in bits 20 to 30, level in 16 to 19, tile row in 8 to 15 and column in 0 to 7
+    */
+    void CVirtualTexture::markRequested(uint32_t iRequest)
+    {
+        uint32_t iPage = (iRequest >> 20) & 0x7ff;
+        uint32_t iLevel = (iRequest >> 16) & 0xf;
+        uint32_t iTileX = iRequest & 0xff;
+        uint32_t iTileY = (iRequest >> 8) & 0xff;
+        if(iPage >= mHeader.miNumPages || iLevel >= mHeader.miNumMips)
+        {
+            return;
+        }
+
+        for(; iLevel < mHeader.miNumMips; iLevel++, iTileX >>= 1, iTileY >>= 1)
+        {
+            uint32_t iTile = getTileIndex(iPage, iLevel, iTileX, iTileY);
+            if(iTile == UINT32_MAX)
+            {
+                return;
+            }
+
+            // the ones above were seen to with it
+            TileState& tile = maTiles[iTile];
+            if(tile.miLastUsedFrame == miFrame)
+            {
+                return;
+            }
+            tile.miLastUsedFrame = miFrame;
+
+            if(tile.miSlot >= 0)
+            {
+                Slot& slot = maSlots[tile.miSlot];
+                if(!slot.mbPinned)
+                {
+                    maLRU.splice(maLRU.begin(), maLRU, slot.mLRUPosition);
+                }
+            }
+            else if(!tile.mbQueued && !tile.mbBroken && maPageFileTiles[iTile].miOffset != 0 &&
+                    miNumTilesInFlight + maiMissingTiles.size() < kiMaxTilesInFlight * 4)
+            {
+                maiMissingTiles.push_back(iTile);
+            }
+        }
+    }
+
+    /*
+    **
+    */
+    int32_t CVirtualTexture::allocateSlot()
+    {
+        if(maiFreeSlots.size() > 0)
+        {
+            int32_t iSlot = (int32_t)maiFreeSlots.back();
+            maiFreeSlots.pop_back();
+            return iSlot;
+        }
+
+        if(maLRU.empty())
+        {
+            return -1;
+        }
+
+        uint32_t iSlot = maLRU.back();
+        Slot& slot = maSlots[iSlot];
+        TileState& evictedTile = maTiles[slot.miTile];
+        if(evictedTile.miLastUsedFrame == miFrame)
+        {
+            return -1;
+        }
+
+        maLRU.pop_back();
+        evictedTile.miSlot = -1;
+        mabDirtyPages[slot.miTile / miNumPageTiles] = true;
+        slot.miTile = UINT32_MAX;
+
+        return (int32_t)iSlot;
+    }
+
+    /*
+    **
+    */
+    void CVirtualTexture::uploadTile(
+        uint32_t iTile,
+        char const* pcTexels,
+        bool bPinned)
+    {
+        int32_t iSlot = allocateSlot();
+        if(iSlot < 0)
+        {
+            if(!mbReportedFull)
+            {
+                DEBUG_PRINTF("virtual texture: all %d physical tiles are in use this frame, the rest wait for one to free up\n",
+                    (uint32_t)maSlots.size());
+                mbReportedFull = true;
+            }
+            return;
+        }
+
+#if defined(__EMSCRIPTEN__)
+        wgpu::TextureDataLayout layout = {};
+        wgpu::ImageCopyTexture destination = {};
+#else
+        wgpu::TexelCopyBufferLayout layout = {};
+        wgpu::TexelCopyTextureInfo destination = {};
+#endif // __EMSCRIPTEN__
+        layout.bytesPerRow = miSlotSize * 4;
+        layout.offset = 0;
+        layout.rowsPerImage = miSlotSize;
+        destination.aspect = wgpu::TextureAspect::All;
+        destination.mipLevel = 0;
+        destination.origin = {.x = ((uint32_t)iSlot % miNumSlotsX) * miSlotSize, .y = ((uint32_t)iSlot / miNumSlotsX) * miSlotSize, .z = 0};
+        destination.texture = mPhysicalTexture;
+        wgpu::Extent3D extent = {};
+        extent.width = miSlotSize;
+        extent.height = miSlotSize;
+        extent.depthOrArrayLayers = 1;
+        mpDevice->GetQueue().WriteTexture(
+            &destination,
+            pcTexels,
+            (size_t)miSlotSize * miSlotSize * 4,
+            &layout,
+            &extent);
+
+        Slot& slot = maSlots[iSlot];
+        slot.miTile = iTile;
+        slot.mbPinned = bPinned;
+        if(!bPinned)
+        {
+            maLRU.push_front((uint32_t)iSlot);
+            slot.mLRUPosition = maLRU.begin();
+        }
+        maTiles[iTile].miSlot = iSlot;
+        mabDirtyPages[iTile / miNumPageTiles] = true;
+    }
+
+    /*
+    ** from the last level down, a tile that isn't resident points where the one above it does
+    */
+    void CVirtualTexture::writeIndirection(uint32_t iPage)
+    {
+        std::vector<uint8_t> acAbove, acLevel;
+        uint32_t iAboveTilesX = 0;
+        for(int32_t iLevel = (int32_t)mHeader.miNumMips - 1; iLevel >= 0; iLevel--)
+        {
+            uint32_t iNumTilesX = 0, iNumTilesY = 0;
+            Loader::getPageFileLevelTiles(iNumTilesX, iNumTilesY, mHeader, (uint32_t)iLevel);
+            uint32_t iFirstTile = Loader::getPageFileFirstTile(mHeader, iPage, (uint32_t)iLevel);
+
+            acLevel.assign((size_t)iNumTilesX * iNumTilesY * 4, 0);
+            for(uint32_t iTileY = 0; iTileY < iNumTilesY; iTileY++)
+            {
+                for(uint32_t iTileX = 0; iTileX < iNumTilesX; iTileX++)
+                {
+                    uint8_t* pcEntry = acLevel.data() + ((size_t)iTileY * iNumTilesX + iTileX) * 4;
+                    int32_t iSlot = maTiles[iFirstTile + iTileY * iNumTilesX + iTileX].miSlot;
+                    if(iSlot >= 0)
+                    {
+                        pcEntry[0] = (uint8_t)((uint32_t)iSlot % miNumSlotsX);
+                        pcEntry[1] = (uint8_t)((uint32_t)iSlot / miNumSlotsX);
+                        pcEntry[2] = (uint8_t)iLevel;
+                        pcEntry[3] = 255;
+                    }
+                    else if(acAbove.size() > 0)
+                    {
+                        memcpy(pcEntry, acAbove.data() + ((size_t)(iTileY >> 1) * iAboveTilesX + (iTileX >> 1)) * 4, 4);
+                    }
+                }
+            }
+
+#if defined(__EMSCRIPTEN__)
+            wgpu::TextureDataLayout layout = {};
+            wgpu::ImageCopyTexture destination = {};
+#else
+            wgpu::TexelCopyBufferLayout layout = {};
+            wgpu::TexelCopyTextureInfo destination = {};
+#endif // __EMSCRIPTEN__
+            layout.bytesPerRow = iNumTilesX * 4;
+            layout.offset = 0;
+            layout.rowsPerImage = iNumTilesY;
+            destination.aspect = wgpu::TextureAspect::All;
+            destination.mipLevel = (uint32_t)iLevel;
+            destination.origin = {.x = 0, .y = 0, .z = iPage};
+            destination.texture = mIndirectionTexture;
+            wgpu::Extent3D extent = {};
+            extent.width = iNumTilesX;
+            extent.height = iNumTilesY;
+            extent.depthOrArrayLayers = 1;
+            mpDevice->GetQueue().WriteTexture(
+                &destination,
+                acLevel.data(),
+                acLevel.size(),
+                &layout,
+                &extent);
+
+            acAbove.swap(acLevel);
+            iAboveTilesX = iNumTilesX;
+        }
+
+        mabDirtyPages[iPage] = false;
+    }
+
+    /*
+    ** copied out of the mapped page file, touching the mapping is what reads it from disk
+    */
+    bool CVirtualTexture::readTile(
+        std::vector<char>& acTexels,
+        uint32_t iTile) const
+    {
+        Loader::PageFileTile const& pageFileTile = maPageFileTiles[iTile];
+        if(pageFileTile.miOffset == 0)
+        {
+            return false;
+        }
+
+        uint64_t iTileSize = Loader::getPageFileTileSize(mHeader);
+        acTexels.assign(mPageFileView.data() + pageFileTile.miOffset, mPageFileView.data() + pageFileTile.miOffset + iTileSize);
+        if(Loader::getMeshFileChecksum(acTexels.data(), iTileSize) != pageFileTile.miChecksum)
+        {
+            DEBUG_PRINTF("%s : %d page file tile %d checksum mismatch\n",
+                __FILE__,
+                __LINE__,
+                iTile);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+    **
+    */
+    void CVirtualTexture::update(uint32_t iFrame)
+    {
+        if(!mbEnabled)
+        {
+            return;
+        }
+
+#if !defined(__EMSCRIPTEN__)
+        miFrame = iFrame;
+        maiMissingTiles.clear();
+        for(uint32_t iRequest : maiRequests)
+        {
+            markRequested(iRequest);
+        }
+        maiRequests.clear();
+
+        // tiles that came in, up to the per frame budget
+        std::vector<StreamedTile> aStreamedTiles;
+        {
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            uint32_t iNumTaken = std::min((uint32_t)maStreamedTiles.size(), mCreateInfo.miMaxUploadsPerFrame);
+            aStreamedTiles.assign(
+                std::make_move_iterator(maStreamedTiles.begin()),
+                std::make_move_iterator(maStreamedTiles.begin() + iNumTaken));
+            maStreamedTiles.erase(maStreamedTiles.begin(), maStreamedTiles.begin() + iNumTaken);
+        }
+        for(auto& streamedTile : aStreamedTiles)
+        {
+            TileState& tile = maTiles[streamedTile.miTile];
+            tile.mbQueued = false;
+            tile.mbBroken = !streamedTile.mbValid;
+            --miNumTilesInFlight;
+            if(streamedTile.mbValid && tile.miSlot < 0)
+            {
+                uploadTile(streamedTile.miTile, streamedTile.macTexels.data(), false);
+            }
+        }
+
+        // what was asked for this frame and isn't in, coarse levels first so there's something close to fall back on
+        std::stable_sort(maiMissingTiles.begin(), maiMissingTiles.end(), [&](uint32_t iLeft, uint32_t iRight)
+        {
+            return maTiles[iLeft].miLevel > maTiles[iRight].miLevel;
+        });
+
+        uint32_t iNumQueued = 0;
+        {
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            for(uint32_t iTile : maiMissingTiles)
+            {
+                if(miNumTilesInFlight >= kiMaxTilesInFlight)
+                {
+                    break;
+                }
+                if(maTiles[iTile].miSlot >= 0)
+                {
+                    continue;
+                }
+                maTiles[iTile].mbQueued = true;
+                maiStreamQueue.push_back(iTile);
+                ++miNumTilesInFlight;
+                ++iNumQueued;
+            }
+        }
+        if(iNumQueued > 0)
+        {
+            mStreamCondition.notify_one();
+        }
+
+        for(uint32_t iPage = 0; iPage < (uint32_t)mabDirtyPages.size(); iPage++)
+        {
+            if(mabDirtyPages[iPage])
+            {
+                writeIndirection(iPage);
+            }
+        }
+#endif // !__EMSCRIPTEN__
+    }
+
+    /*
+    **
+    */
+    void CVirtualTexture::encodeFeedbackCopy(wgpu::CommandEncoder& commandEncoder)
+    {
+        if(!mbEnabled)
+        {
+            return;
+        }
+
+        for(auto& readback : maReadbacks)
+        {
+            if(readback.mState == ReadbackState::Free)
+            {
+                commandEncoder.CopyBufferToBuffer(
+                    mFeedbackBuffer,
+                    0,
+                    readback.mBuffer,
+                    0,
+                    mFeedbackBuffer.GetSize());
+                readback.mState = ReadbackState::Copied;
+                break;
+            }
+        }
+
+        commandEncoder.ClearBuffer(mFeedbackBuffer, 0, mFeedbackBuffer.GetSize());
+    }
+
+    /*
+    ** the requests are taken out of the mapping right away so the buffer is free for another frame
+    */
+    void CVirtualTexture::readBackFeedback()
+    {
+        if(!mbEnabled)
+        {
+            return;
+        }
+
+#if !defined(__EMSCRIPTEN__)
+        for(uint32_t iReadback = 0; iReadback < (uint32_t)maReadbacks.size(); iReadback++)
+        {
+            Readback& readback = maReadbacks[iReadback];
+            if(readback.mState != ReadbackState::Copied)
+            {
+                continue;
+            }
+
+            readback.mState = ReadbackState::Mapping;
+            readback.mBuffer.MapAsync(
+                wgpu::MapMode::Read,
+                0,
+                readback.mBuffer.GetSize(),
+                wgpu::CallbackMode::AllowProcessEvents,
+                [this, iReadback](wgpu::MapAsyncStatus status, const char* message)
+                {
+                    Readback& readback = maReadbacks[iReadback];
+                    if(status == wgpu::MapAsyncStatus::Success)
+                    {
+                        uint32_t const* piRequests = (uint32_t const*)readback.mBuffer.GetConstMappedRange(0, readback.mBuffer.GetSize());
+                        uint32_t iNumCells = (uint32_t)(readback.mBuffer.GetSize() / sizeof(uint32_t));
+                        for(uint32_t iCell = 0; piRequests != nullptr && iCell < iNumCells; iCell++)
+                        {
+                            if(piRequests[iCell] & kiTileRequestValid)
+                            {
+                                maiRequests.push_back(piRequests[iCell]);
+                            }
+                        }
+                        readback.mBuffer.Unmap();
+                    }
+                    readback.mState = ReadbackState::Free;
+                });
+        }
+#endif // !__EMSCRIPTEN__
+    }
+
+#if !defined(__EMSCRIPTEN__)
+    /*
+    **
+    */
+    void CVirtualTexture::streamer()
+    {
+        for(;;)
+        {
+            uint32_t iTile = 0;
+            {
+                std::unique_lock<std::mutex> lock(mStreamMutex);
+                mStreamCondition.wait(lock, [this]()
+                {
+                    return mbStopStreaming || maiStreamQueue.size() > 0;
+                });
+                if(mbStopStreaming)
+                {
+                    return;
+                }
+
+                iTile = maiStreamQueue.front();
+                maiStreamQueue.pop_front();
+            }
+
+            StreamedTile streamedTile;
+            streamedTile.miTile = iTile;
+            streamedTile.mbValid = readTile(streamedTile.macTexels, iTile);
+
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            maStreamedTiles.push_back(std::move(streamedTile));
+        }
+    }
+#endif // !__EMSCRIPTEN__
+
+}   // Render
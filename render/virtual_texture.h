@@ -0,0 +1,193 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+#if !defined(__EMSCRIPTEN__)
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif // !__EMSCRIPTEN__
+
+#include <loader/asset_source.h>
+#include <loader/page_file.h>
+
+namespace Render
+{
+    /*
+    ** virtual texturing over the tiles of "-diffuse-pages.bin", see loader/page_file.h
+    **    deferred.shader writes the tile it wants for one pixel of each feedback cell into the feedback buffer
+    **    the buffer is copied out at the start of the next frame and read back without waiting on the gpu
+    **    tiles that were asked for, and the coarser ones above them, are streamed from the page file on a thread of
+    **    their own and uploaded into slots of the physical texture, the least recently used slot is given up when it's full
+    **    the indirection texture has a texel per tile and level pointing at the slot of the tile or of the closest
+    **    resident one above it, the last level is kept resident so every lookup lands somewhere
+    */
+    class CVirtualTexture
+    {
+    public:
+        struct CreateInfo
+        {
+            wgpu::Device*                       mpDevice;
+            uint32_t                            miScreenWidth;
+            uint32_t                            miScreenHeight;
+            uint32_t                            miNumPhysicalTilesX = 32;
+            uint32_t                            miNumPhysicalTilesY = 32;
+            uint32_t                            miMaxUploadsPerFrame = 16;
+        };
+
+        // same layout as VirtualTextureUniformData in deferred.shader
+        struct UniformData
+        {
+            uint32_t                            miEnabled;
+            uint32_t                            miTileSize;
+            uint32_t                            miTileBorder;
+            uint32_t                            miNumMips;
+            uint32_t                            miFeedbackWidth;
+            uint32_t                            miFeedbackHeight;
+            uint32_t                            miFeedbackCellSize;
+            uint32_t                            miPadding;
+        };
+
+    public:
+        CVirtualTexture() = default;
+        virtual ~CVirtualTexture();
+
+        // placeholders are bound when the page file can't be used, aTextureInfo gets its texture table otherwise
+        bool setup(
+            CreateInfo const& createInfo,
+            std::string const& pageFilePath,
+            std::vector<Loader::AtlasTextureInfo>& aTextureInfo);
+
+        // tiles asked for in the feedback read back so far are streamed, the ones that came in uploaded and the indirection patched
+        void update(uint32_t iFrame);
+
+        // last frame's requests are copied out and the feedback buffer cleared, ahead of the deferred passes
+        void encodeFeedbackCopy(wgpu::CommandEncoder& commandEncoder);
+
+        // maps the copy once it's submitted, the callback runs from the instance's ProcessEvents
+        void readBackFeedback();
+
+        inline bool isEnabled() const { return mbEnabled; }
+        inline wgpu::Buffer& getUniformBuffer() { return mUniformBuffer; }
+        inline wgpu::Buffer& getFeedbackBuffer() { return mFeedbackBuffer; }
+        inline wgpu::TextureView& getIndirectionView() { return mIndirectionView; }
+        inline wgpu::TextureView& getPhysicalView() { return mPhysicalView; }
+
+    protected:
+        struct TileState
+        {
+            int32_t                             miSlot = -1;
+            uint32_t                            miLastUsedFrame = UINT32_MAX;
+            uint8_t                             miLevel = 0;
+            bool                                mbQueued = false;
+            bool                                mbBroken = false;
+        };
+
+        struct Slot
+        {
+            uint32_t                            miTile = UINT32_MAX;
+            bool                                mbPinned = false;
+            std::list<uint32_t>::iterator       mLRUPosition;
+        };
+
+        enum class ReadbackState : uint32_t
+        {
+            Free = 0,
+            Copied,
+            Mapping,
+        };
+
+        struct Readback
+        {
+            wgpu::Buffer                        mBuffer;
+            ReadbackState                       mState = ReadbackState::Free;
+        };
+
+        struct StreamedTile
+        {
+            uint32_t                            miTile;
+            std::vector<char>                   macTexels;
+            bool                                mbValid;
+        };
+
+        void createPlaceholders();
+
+        uint32_t getTileIndex(
+            uint32_t iPage,
+            uint32_t iLevel,
+            uint32_t iTileX,
+            uint32_t iTileY) const;
+
+        // requests in the feedback are the tile and everything above it, the ones that have to be streamed go in maiMissingTiles
+        void markRequested(uint32_t iRequest);
+
+        // a free slot or the least recently used one that wasn't asked for this frame, -1 if they all were
+        int32_t allocateSlot();
+
+        void uploadTile(
+            uint32_t iTile,
+            char const* pcTexels,
+            bool bPinned);
+
+        void writeIndirection(uint32_t iPage);
+
+        bool readTile(
+            std::vector<char>& acTexels,
+            uint32_t iTile) const;
+
+#if !defined(__EMSCRIPTEN__)
+        void streamer();
+#endif // !__EMSCRIPTEN__
+
+    protected:
+        wgpu::Device*                           mpDevice = nullptr;
+        CreateInfo                              mCreateInfo = {};
+        bool                                    mbEnabled = false;
+
+        Loader::FileView                        mPageFileView;
+        Loader::PageFileHeader                  mHeader = {};
+        std::vector<Loader::PageFileTile>       maPageFileTiles;
+        uint32_t                                miNumPageTiles = 0;             // tiles of every level of one page
+
+        wgpu::Buffer                            mUniformBuffer;
+        wgpu::Buffer                            mFeedbackBuffer;
+        uint32_t                                miFeedbackWidth = 1;
+        uint32_t                                miFeedbackHeight = 1;
+        std::vector<Readback>                   maReadbacks;
+
+        wgpu::Texture                           mIndirectionTexture;
+        wgpu::TextureView                       mIndirectionView;
+        wgpu::Texture                           mPhysicalTexture;
+        wgpu::TextureView                       mPhysicalView;
+        uint32_t                                miSlotSize = 0;                 // tile with its border
+        uint32_t                                miNumSlotsX = 0;
+        uint32_t                                miNumSlotsY = 0;
+
+        std::vector<TileState>                  maTiles;
+        std::vector<Slot>                       maSlots;
+        std::vector<uint32_t>                   maiFreeSlots;
+        std::list<uint32_t>                     maLRU;                          // slots, most recently used first
+        std::vector<bool>                       mabDirtyPages;
+        std::vector<uint32_t>                   maiRequests;                    // read back, not looked at yet
+        std::vector<uint32_t>                   maiMissingTiles;                // asked for this frame, not resident or on the way
+        uint32_t                                miFrame = 0;
+        uint32_t                                miNumTilesInFlight = 0;
+        bool                                    mbReportedFull = false;
+
+#if !defined(__EMSCRIPTEN__)
+        std::thread                             mStreamer;
+        std::mutex                              mStreamMutex;
+        std::condition_variable                 mStreamCondition;
+        std::deque<uint32_t>                    maiStreamQueue;
+        std::vector<StreamedTile>               maStreamedTiles;
+        bool                                    mbStopStreaming = false;
+#endif // !__EMSCRIPTEN__
+    };
+
+}   // Render
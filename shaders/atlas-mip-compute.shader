@@ -0,0 +1,98 @@
+struct TextureAtlasInfo
+{
+    miTextureCoord: vec2i,
+    mUV: vec2f,
+    miTextureID: u32,
+    miImageWidth: u32,
+    miImageHeight: u32,
+    miNumMips: u32,
+    miPage: u32,
+    miPadding: u32,
+};
+
+struct UniformData
+{
+    miLevel: u32,
+    miFirstEntry: u32,
+    miNumEntries: u32,
+    miPadding: u32,
+};
+
+@group(0) @binding(0) var<uniform> uniformBuffer: UniformData;
+@group(0) @binding(1) var<storage, read> aAtlasInfo: array<TextureAtlasInfo>;
+@group(0) @binding(2) var sourceLevel: texture_2d_array<f32>;
+@group(0) @binding(3) var destLevel: texture_storage_2d_array<rgba8unorm, write>;
+
+const iNumThreads = 8u;
+
+/*
+**
+*/
+fn srgbToLinear(color: vec3f) -> vec3f
+{
+    let low: vec3f = color / 12.92f;
+    let high: vec3f = pow((color + vec3f(0.055f)) / 1.055f, vec3f(2.4f));
+    return select(high, low, color <= vec3f(0.04045f));
+}
+
+/*
+**
+*/
+fn linearToSRGB(color: vec3f) -> vec3f
+{
+    let low: vec3f = color * 12.92f;
+    let high: vec3f = 1.055f * pow(color, vec3f(1.0f / 2.4f)) - vec3f(0.055f);
+    return select(high, low, color <= vec3f(0.0031308f));
+}
+
+/*
+** one entry per z, a texel of the entry is the 2x2 average of the level above, colors averaged in linear space
+** reads wrap around inside the entry so no texel of a neighbour gets pulled in
+*/
+@compute
+@workgroup_size(iNumThreads, iNumThreads, 1)
+fn cs_main(
+    @builtin(global_invocation_id) globalID: vec3<u32>)
+{
+    if(globalID.z >= uniformBuffer.miNumEntries)
+    {
+        return;
+    }
+
+    let info: TextureAtlasInfo = aAtlasInfo[uniformBuffer.miFirstEntry + globalID.z];
+    if(uniformBuffer.miLevel >= info.miNumMips)
+    {
+        return;
+    }
+
+    let iLevel: u32 = uniformBuffer.miLevel;
+    let sourceSize: vec2u = max(vec2u(info.miImageWidth, info.miImageHeight) >> vec2u(iLevel - 1u), vec2u(1u, 1u));
+    let destSize: vec2u = max(vec2u(info.miImageWidth, info.miImageHeight) >> vec2u(iLevel), vec2u(1u, 1u));
+    if(globalID.x >= destSize.x || globalID.y >= destSize.y)
+    {
+        return;
+    }
+
+    // entries are aligned to the last level they have, so their corner halves exactly
+    let sourceOrigin: vec2u = vec2u(info.miTextureCoord) >> vec2u(iLevel - 1u);
+    let destOrigin: vec2u = vec2u(info.miTextureCoord) >> vec2u(iLevel);
+
+    var linearTotal: vec4f = vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+    for(var i: u32 = 0u; i < 4u; i++)
+    {
+        let sourceCoord: vec2u = (globalID.xy * 2u + vec2u(i & 1u, i >> 1u)) % sourceSize;
+        let texel: vec4f = textureLoad(
+            sourceLevel,
+            vec2i(sourceOrigin + sourceCoord),
+            i32(info.miPage),
+            0);
+        linearTotal += vec4f(srgbToLinear(texel.xyz), texel.w);
+    }
+    linearTotal *= 0.25f;
+
+    textureStore(
+        destLevel,
+        vec2i(destOrigin + globalID.xy),
+        i32(info.miPage),
+        vec4f(linearToSRGB(linearTotal.xyz), linearTotal.w));
+}
@@ -73,7 +73,34 @@ struct TextureAtlasInfo
     miTextureID: u32,
     miImageWidth: u32,
     miImageHeight: u32,
-    miPadding0: u32,
+    miNumMips: u32,
+    miPage: u32,
+    miPadding: u32,
+};
+
+// same layout as CVirtualTexture::UniformData
+struct VirtualTextureUniformData
+{
+    miEnabled: u32,
+    miTileSize: u32,
+    miTileBorder: u32,
+    miNumMips: u32,
+    miFeedbackWidth: u32,
+    miFeedbackHeight: u32,
+    miFeedbackCellSize: u32,
+    miPadding: u32,
+};
+
+struct MeshInstance
+{
+    mTransform0: vec4<f32>,
+    mTransform1: vec4<f32>,
+    mTransform2: vec4<f32>,
+
+    miGeometryMesh: u32,
+    miFirstInstance: u32,
+    miNumInstances: u32,
+    miListedMesh: u32,
 };
 
 @group(1) @binding(0)
@@ -95,19 +122,42 @@ var<storage, read> aMeshExtents: array<MeshExtent>;
 var<storage, read> diffuseTextureAtlasInfoBuffer: array<TextureAtlasInfo>;
 
 @group(1) @binding(6)
-var diffuseTextureAtlas: texture_2d<f32>;
+var diffuseTextureAtlas: texture_2d_array<f32>;
 
 @group(1) @binding(7)
-var<uniform> defaultUniformBuffer: DefaultUniformData;
+var<storage, read> aMeshInstances: array<MeshInstance>;
 
 @group(1) @binding(8)
+var<storage, read> aiVisibleMeshInstances: array<u32>;
+
+@group(1) @binding(9)
+var<uniform> virtualTextureUniformBuffer: VirtualTextureUniformData;
+
+@group(1) @binding(10)
+var virtualTextureIndirection: texture_2d_array<f32>;
+
+@group(1) @binding(11)
+var virtualTexturePhysicalPages: texture_2d<f32>;
+
+@group(1) @binding(12)
+var<storage, read_write> aiVirtualTextureFeedback: array<u32>;
+
+@group(1) @binding(13)
+var<uniform> defaultUniformBuffer: DefaultUniformData;
+
+@group(1) @binding(14)
 var textureSampler: sampler;
 
+@group(1) @binding(15)
+var diffuseTextureSampler: sampler;
+
+// v2 mesh file vertex, see CompactVertex
 struct VertexInput 
 {
-    @location(0) worldPosition : vec4<f32>,
-    @location(1) texCoord: vec4<f32>,
-    @location(2) normal : vec4<f32>
+    @location(0) miMeshID : u32,
+    @location(1) quantizedPosition: vec4<f32>,        // 0 to 1 within the mesh extent
+    @location(2) octahedralNormal : vec2<f32>,
+    @location(3) texCoord: vec2<f32>
 };
 struct VertexOutput 
 {
@@ -126,43 +176,168 @@ struct FragmentOutput
     @location(4) motionVector: vec4<f32>,
 };
 
+/*
+** same as decodeOctahedral in math/compact_vertex.cpp
+*/
+fn octDecode(encoded: vec2<f32>) -> vec3<f32>
+{
+    var normal: vec3<f32> = vec3<f32>(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+    let fT: f32 = max(-normal.z, 0.0f);
+    normal.x += select(fT, -fT, normal.x >= 0.0f);
+    normal.y += select(fT, -fT, normal.y >= 0.0f);
+
+    return normalize(normal);
+}
+
 @vertex
 fn vs_main(in: VertexInput,
-    @builtin(vertex_index) iVertexIndex: u32) -> VertexOutput 
+    @builtin(vertex_index) iVertexIndex: u32,
+    @builtin(instance_index) iInstanceIndex: u32) -> VertexOutput 
 {
     var out: VertexOutput;
     
-    //let iMesh: u32 = u32(ceil(in.worldPosition.w - 0.5f));
-    let iMesh: u32 = u32(ceil(in.texCoord.z - 0.5f));
-    let midPt: vec3f = (aMeshExtents[iMesh].mMaxPosition.xyz + aMeshExtents[iMesh].mMinPosition.xyz) * 0.5f;
+    // vertices are quantized within the extent of the mesh they belong to
+    let geometryExtent: MeshExtent = aMeshExtents[in.miMeshID];
+    var decodedPosition: vec3f = mix(geometryExtent.mMinPosition.xyz, geometryExtent.mMaxPosition.xyz, in.quantizedPosition.xyz);
+    var normal: vec3f = octDecode(in.octahedralNormal);
+
+    // repeated meshes are drawn instanced, the culling pass lists the visible copies
+    var iMesh: u32 = in.miMeshID;
+    let meshInstance: MeshInstance = aMeshInstances[in.miMeshID];
+    if(meshInstance.miNumInstances > 1u)
+    {
+        iMesh = aiVisibleMeshInstances[meshInstance.miFirstInstance + iInstanceIndex];
+        let instance: MeshInstance = aMeshInstances[iMesh];
+        decodedPosition = vec3f(
+            dot(instance.mTransform0.xyz, decodedPosition) + instance.mTransform0.w,
+            dot(instance.mTransform1.xyz, decodedPosition) + instance.mTransform1.w,
+            dot(instance.mTransform2.xyz, decodedPosition) + instance.mTransform2.w);
+        normal = vec3f(
+            dot(instance.mTransform0.xyz, normal),
+            dot(instance.mTransform1.xyz, normal),
+            dot(instance.mTransform2.xyz, normal));
+    }
+
+    let meshExtent: MeshExtent = aMeshExtents[iMesh];
+    let midPt: vec3f = (meshExtent.mMaxPosition.xyz + meshExtent.mMinPosition.xyz) * 0.5f;
 
     // total mesh extent is at the very end of list
     let totalMeshExtent: MeshExtent = aMeshExtents[defaultUniformBuffer.miNumMeshes];
     let totalCenter: vec3f = (totalMeshExtent.mMaxPosition.xyz + totalMeshExtent.mMinPosition.xyz) * 0.5f;
 
     var worldPosition: vec4<f32> = vec4<f32>(
-        in.worldPosition.x,
-        in.worldPosition.y,
-        in.worldPosition.z - (totalCenter.z - midPt.z) * max(uniformBuffer.mfExplodeMultiplier, 0.0f),
+        decodedPosition.x,
+        decodedPosition.y,
+        decodedPosition.z - (totalCenter.z - midPt.z) * max(uniformBuffer.mfExplodeMultiplier, 0.0f),
         1.0f
     );
     out.pos = worldPosition * defaultUniformBuffer.mJitteredViewProjectionMatrix;
     out.worldPosition = vec4f(worldPosition.xyz, f32(iMesh));
     out.texCoord = vec4f(in.texCoord.x, in.texCoord.y, f32(iMesh), 1.0f);
-    out.normal = in.normal;
+    out.normal = vec4f(normal, 1.0f);
 
     out.mViewPosition = worldPosition * defaultUniformBuffer.mViewMatrix;
 
     return out;
 }
 
+/*
+** bilinear lookup in one level, kept half a texel inside the entry so the filter doesn't reach its neighbours
+*/
+fn sampleDiffuseAtlas(
+    textureAtlasInfo: TextureAtlasInfo,
+    textureUV: vec2f,
+    iMip: u32) -> vec4f
+{
+    let fMipScale: f32 = 1.0f / f32(1u << iMip);
+    let entryMin: vec2f = vec2f(textureAtlasInfo.miTextureCoord) * fMipScale;
+    let entrySize: vec2f = vec2f(f32(textureAtlasInfo.miImageWidth), f32(textureAtlasInfo.miImageHeight)) * fMipScale;
+    let clampMin: vec2f = entryMin + vec2f(0.5f, 0.5f);
+    let clampMax: vec2f = max(entryMin + entrySize - vec2f(0.5f, 0.5f), clampMin);
+    let texel: vec2f = clamp(entryMin + textureUV * entrySize, clampMin, clampMax);
+
+    return textureSampleLevel(
+        diffuseTextureAtlas,
+        diffuseTextureSampler,
+        texel / vec2f(textureDimensions(diffuseTextureAtlas, iMip)),
+        i32(textureAtlasInfo.miPage),
+        f32(iMip)
+    );
+}
+
+/*
+** texel of the entry in a level of its virtual page, clamped the same way as sampleDiffuseAtlas
+*/
+fn getVirtualTexel(
+    textureAtlasInfo: TextureAtlasInfo,
+    textureUV: vec2f,
+    iMip: u32) -> vec2f
+{
+    let fMipScale: f32 = 1.0f / f32(1u << iMip);
+    let entryMin: vec2f = vec2f(textureAtlasInfo.miTextureCoord) * fMipScale;
+    let entrySize: vec2f = vec2f(f32(textureAtlasInfo.miImageWidth), f32(textureAtlasInfo.miImageHeight)) * fMipScale;
+    let clampMin: vec2f = entryMin + vec2f(0.5f, 0.5f);
+    let clampMax: vec2f = max(entryMin + entrySize - vec2f(0.5f, 0.5f), clampMin);
+
+    return clamp(entryMin + textureUV * entrySize, clampMin, clampMax);
+}
+
+/*
+** same packing as CVirtualTexture::markRequested
+*/
+fn packTileRequest(
+    iPage: u32,
+    iMip: u32,
+    tile: vec2u) -> u32
+{
+    return 0x80000000u | ((iPage & 0x7ffu) << 20u) | ((iMip & 0xfu) << 16u) | ((tile.y & 0xffu) << 8u) | (tile.x & 0xffu);
+}
+
+/*
+** the indirection points at the slot of the tile or of the closest level above it that's resident, the lookup is
+** rescaled to that level and stays inside the tile's border so the bilinear filter doesn't reach the next slot
+*/
+fn sampleVirtualTexture(
+    textureAtlasInfo: TextureAtlasInfo,
+    textureUV: vec2f,
+    iMip: u32) -> vec4f
+{
+    let fTileSize: f32 = f32(virtualTextureUniformBuffer.miTileSize);
+    let texel: vec2f = getVirtualTexel(textureAtlasInfo, textureUV, iMip);
+    let tile: vec2u = vec2u(texel / fTileSize);
+    let entry: vec4u = vec4u(textureLoad(
+        virtualTextureIndirection,
+        vec2i(tile),
+        i32(textureAtlasInfo.miPage),
+        i32(iMip)
+    ) * 255.0f + 0.5f);
+    if(entry.w == 0u)
+    {
+        return vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+
+    let residentTexel: vec2f = getVirtualTexel(textureAtlasInfo, textureUV, entry.z);
+    let inTile: vec2f = residentTexel - floor(residentTexel / fTileSize) * fTileSize;
+    let fSlotSize: f32 = fTileSize + f32(virtualTextureUniformBuffer.miTileBorder * 2u);
+    let physicalTexel: vec2f = vec2f(entry.xy) * fSlotSize + f32(virtualTextureUniformBuffer.miTileBorder) + inTile;
+
+    return textureSampleLevel(
+        virtualTexturePhysicalPages,
+        diffuseTextureSampler,
+        physicalTexel / vec2f(textureDimensions(virtualTexturePhysicalPages, 0)),
+        0.0f
+    );
+}
+
 @fragment
 fn fs_main(in: VertexOutput) -> FragmentOutput 
 {
     var out: FragmentOutput;
     
-    let diffuseAtlasTextureSize: vec2u = textureDimensions(diffuseTextureAtlas);
-    
+    // before any branch, derivatives need uniform control flow
+    let texCoordDX: vec2f = dpdx(in.texCoord.xy);
+    let texCoordDY: vec2f = dpdy(in.texCoord.xy);
+
     var planeNormal: vec3f = vec3f(-1.0f, 0.0f, 0.0f);
     var fPlaneD: f32 = -uniformBuffer.mfCrossSectionPlaneD;
 
@@ -260,21 +435,50 @@ fn fs_main(in: VertexOutput) -> FragmentOutput
         {
             let textureAtlasInfo: TextureAtlasInfo = diffuseTextureAtlasInfoBuffer[iTextureID];
 
-            let atlasPct: vec2f = vec2f(
-                f32(textureAtlasInfo.miImageWidth) / f32(diffuseAtlasTextureSize.x),
-                f32(textureAtlasInfo.miImageHeight) / f32(diffuseAtlasTextureSize.y)
-            );
-            let textureUV: vec2f = textureAtlasInfo.mUV.xy + vec2f(texCoord.x, 1.0f - texCoord.y) * atlasPct.xy;
-
-            let imageCoord: vec2i = vec2i(
-                i32(textureUV.x * 8192.0f),
-                i32(textureUV.y * 8192.0f)
-            );
-            albedo = textureLoad(
-                diffuseTextureAtlas,
-                imageCoord,
-                0
+            // level from the pixel's footprint in texels, up to the last one that doesn't bleed into the neighbours
+            let imageSize: vec2f = vec2f(f32(textureAtlasInfo.miImageWidth), f32(textureAtlasInfo.miImageHeight));
+            let fFootprint: f32 = max(
+                dot(texCoordDX * imageSize, texCoordDX * imageSize),
+                dot(texCoordDY * imageSize, texCoordDY * imageSize)
             );
+            var iNumAtlasMips: u32 = textureNumLevels(diffuseTextureAtlas);
+            if(virtualTextureUniformBuffer.miEnabled != 0u)
+            {
+                iNumAtlasMips = virtualTextureUniformBuffer.miNumMips;
+            }
+            let iMaxMip: u32 = min(max(textureAtlasInfo.miNumMips, 1u), iNumAtlasMips) - 1u;
+            let fLOD: f32 = clamp(0.5f * log2(max(fFootprint, 1.0e-8f)), 0.0f, f32(iMaxMip));
+
+            // trilinear by hand, each level clamped to the entry on its own
+            let iMip: u32 = u32(fLOD);
+            let textureUV: vec2f = vec2f(texCoord.x, 1.0f - texCoord.y);
+            if(virtualTextureUniformBuffer.miEnabled != 0u)
+            {
+                albedo = mix(
+                    sampleVirtualTexture(textureAtlasInfo, textureUV, iMip),
+                    sampleVirtualTexture(textureAtlasInfo, textureUV, min(iMip + 1u, iMaxMip)),
+                    fLOD - f32(iMip)
+                );
+
+                // one pixel of each cell asks for the tile it wanted, a different one every frame
+                let iCellSize: u32 = virtualTextureUniformBuffer.miFeedbackCellSize;
+                let pixel: vec2u = vec2u(in.pos.xy);
+                let iJitter: u32 = u32(defaultUniformBuffer.miFrame) % (iCellSize * iCellSize);
+                if(pixel.x % iCellSize == iJitter % iCellSize && pixel.y % iCellSize == iJitter / iCellSize)
+                {
+                    let cell: vec2u = min(pixel / iCellSize, vec2u(virtualTextureUniformBuffer.miFeedbackWidth, virtualTextureUniformBuffer.miFeedbackHeight) - 1u);
+                    let tile: vec2u = vec2u(getVirtualTexel(textureAtlasInfo, textureUV, iMip) / f32(virtualTextureUniformBuffer.miTileSize));
+                    aiVirtualTextureFeedback[cell.y * virtualTextureUniformBuffer.miFeedbackWidth + cell.x] = packTileRequest(textureAtlasInfo.miPage, iMip, tile);
+                }
+            }
+            else
+            {
+                albedo = mix(
+                    sampleDiffuseAtlas(textureAtlasInfo, textureUV, iMip),
+                    sampleDiffuseAtlas(textureAtlasInfo, textureUV, min(iMip + 1u, iMaxMip)),
+                    fLOD - f32(iMip)
+                );
+            }
         }
 
         let lightDir: vec3f = normalize(vec3f(1.0f, -1.0f, 1.0f));
@@ -13,10 +13,45 @@ struct MeshExtent
     mMaxPosition: vec4<f32>,
 };
 
-struct Range
+struct MeshCluster
 {
-    miStart: u32,
-    miEnd: u32,
+    mBoundingSphere: vec4<f32>,
+    mMinPosition: vec4<f32>,
+    mMaxPosition: vec4<f32>,
+    mNormalCone: vec4<f32>,
+
+    miMesh: u32,
+    miFirstIndex: u32,
+    miNumIndices: u32,
+    miPadding: u32,
+};
+
+struct MeshLODRange
+{
+    miFirstCluster: u32,
+    miFirstLOD: u32,
+    miNumLODs: u32,
+    miBaseVertex: u32,
+};
+
+struct MeshLOD
+{
+    miFirstIndex: u32,
+    miNumIndices: u32,
+    mfError: f32,
+    miPadding: u32,
+};
+
+struct MeshInstance
+{
+    mTransform0: vec4<f32>,
+    mTransform1: vec4<f32>,
+    mTransform2: vec4<f32>,
+
+    miGeometryMesh: u32,
+    miFirstInstance: u32,
+    miNumInstances: u32,
+    miListedMesh: u32,
 };
 
 struct DefaultUniformData
@@ -50,11 +85,17 @@ struct UniformData
 {
     miNumMeshes: u32,
     mfExplodeMultiplier: f32,
+    miNumClusters: u32,
+    miConeCulling: u32,
+    mfLODPixelError: f32,
+    miFirstWideDraw: u32,
+    miPadding1: u32,
+    miPadding2: u32,
 };
 
 @group(0) @binding(0) var<storage, read_write> aDrawCalls: array<DrawIndexParam>;
 @group(0) @binding(1) var<storage, read_write> aNumDrawCalls: array<atomic<u32>>;
-@group(0) @binding(2) var<storage, read_write> aiVisibleMeshID: array<u32>;
+@group(0) @binding(2) var<storage, read_write> aiVisibleClusters: array<u32>;
 //@group(0) @binding(3) depthTexture0: texture_2d<f32>;
 //@group(0) @binding(4) depthTexture1: texture_2d<f32>;
 //@group(0) @binding(5) depthTexture2: texture_2d<f32>;
@@ -65,12 +106,17 @@ struct UniformData
 //@group(0) @binding(10) depthTexture7: texture_2d<f32>;
 
 @group(1) @binding(0) var<uniform> uniformBuffer: UniformData;
-@group(1) @binding(1) var<storage, read> aMeshTriangleIndexRanges: array<Range>;
-@group(1) @binding(2) var<storage, read> aMeshExtents: array<MeshExtent>;
-@group(1) @binding(3) var<storage, read> aiVisibleFlags: array<u32>;
-@group(1) @binding(4) var<uniform> defaultUniformBuffer: DefaultUniformData;
+@group(1) @binding(1) var<storage, read> aMeshExtents: array<MeshExtent>;
+@group(1) @binding(2) var<storage, read> aiVisibleFlags: array<u32>;
+@group(1) @binding(3) var<storage, read> aMeshClusters: array<MeshCluster>;
+@group(1) @binding(4) var<storage, read> aMeshLODRanges: array<MeshLODRange>;
+@group(1) @binding(5) var<storage, read> aMeshLODs: array<MeshLOD>;
+@group(1) @binding(6) var<storage, read> aMeshInstances: array<MeshInstance>;
+@group(1) @binding(7) var<storage, read_write> aiVisibleMeshInstances: array<u32>;
+@group(1) @binding(8) var<uniform> defaultUniformBuffer: DefaultUniformData;
 
 const iNumThreads = 256u;
+const kiWideIndexBaseVertex = 0xffffffffu;
 
 @compute
 @workgroup_size(iNumThreads)
@@ -79,80 +125,264 @@ fn cs_main(
     @builtin(local_invocation_index) iLocalThreadIndex: u32,
     @builtin(workgroup_id) workGroup: vec3<u32>)
 {
-    let iMesh: u32 = iLocalThreadIndex + workGroup.x * iNumThreads;
-    if(iMesh >= uniformBuffer.miNumMeshes)
+    // one thread per meshlet, strided in case there are more meshlets than threads
+    let iNumTotalThreads: u32 = numWorkGroups.x * iNumThreads;
+    for(var iCluster: u32 = iLocalThreadIndex + workGroup.x * iNumThreads; iCluster < uniformBuffer.miNumClusters; iCluster += iNumTotalThreads)
+    {
+        let cluster: MeshCluster = aMeshClusters[iCluster];
+
+        // repeated meshes draw every visible copy with one instanced draw per meshlet
+        let meshInstance: MeshInstance = aMeshInstances[cluster.miMesh];
+        if(meshInstance.miNumInstances > 1u)
+        {
+            drawMeshInstances(
+                iCluster,
+                cluster,
+                meshInstance);
+            continue;
+        }
+
+        // a simplified level draws the whole mesh from the slot of its first meshlet instead of the meshlets
+        var iFirstIndex: u32 = cluster.miFirstIndex;
+        var iNumIndices: u32 = cluster.miNumIndices;
+        var bVisible: bool = (aiVisibleFlags[cluster.miMesh] > 0u);
+        let lodRange: MeshLODRange = aMeshLODRanges[cluster.miMesh];
+        let iLOD: u32 = selectMeshLOD(cluster.miMesh, cluster.miMesh);
+        if(iLOD > 0u)
+        {
+            let meshLOD: MeshLOD = aMeshLODs[lodRange.miFirstLOD + iLOD - 1u];
+            iFirstIndex = meshLOD.miFirstIndex;
+            iNumIndices = meshLOD.miNumIndices;
+            bVisible = bVisible && (iCluster == lodRange.miFirstCluster) && isMeshVisible(cluster.miMesh);
+        }
+        else
+        {
+            bVisible = bVisible && isClusterVisible(cluster);
+        }
+
+        if(iCluster < arrayLength(&aiVisibleClusters))
+        {
+            aiVisibleClusters[iCluster] = select(0u, 1u, bVisible);
+        }
+
+        if(!bVisible)
+        {
+            continue;
+        }
+
+        let iDrawCommandIndex: u32 = allocateDrawCall(lodRange);
+        if(iDrawCommandIndex >= arrayLength(&aDrawCalls))
+        {
+            continue;
+        }
+
+        aDrawCalls[iDrawCommandIndex].miIndexCount = iNumIndices;
+        aDrawCalls[iDrawCommandIndex].miInstanceCount = 1u;
+        aDrawCalls[iDrawCommandIndex].miFirstIndex = iFirstIndex;
+        aDrawCalls[iDrawCommandIndex].miBaseVertex = getBaseVertex(lodRange);
+        aDrawCalls[iDrawCommandIndex].miFirstInstance = 0u;
+    }
+
+    atomicAdd(&aNumDrawCalls[1], 1u);  
+}
+
+/////
+fn drawMeshInstances(
+    iCluster: u32,
+    cluster: MeshCluster,
+    meshInstance: MeshInstance)
+{
+    // every meshlet of the mesh culls the instances the same way, only the first one writes out the visible list for the vertex shader
+    let lodRange: MeshLODRange = aMeshLODRanges[cluster.miMesh];
+    let bFirstCluster: bool = (iCluster == lodRange.miFirstCluster);
+    var iNumVisible: u32 = 0u;
+    var iLOD: u32 = 0xffffffffu;
+    for(var i: u32 = 0u; i < meshInstance.miNumInstances; i++)
+    {
+        let iInstanceMesh: u32 = aMeshInstances[meshInstance.miFirstInstance + i].miListedMesh;
+        if(aiVisibleFlags[iInstanceMesh] == 0u || !isMeshVisible(iInstanceMesh))
+        {
+            continue;
+        }
+
+        if(bFirstCluster)
+        {
+            aiVisibleMeshInstances[meshInstance.miFirstInstance + iNumVisible] = iInstanceMesh;
+        }
+        iNumVisible += 1u;
+
+        // finest level any of the visible copies needs
+        iLOD = min(iLOD, selectMeshLOD(cluster.miMesh, iInstanceMesh));
+    }
+
+    var iFirstIndex: u32 = cluster.miFirstIndex;
+    var iNumIndices: u32 = cluster.miNumIndices;
+    var bVisible: bool = (iNumVisible > 0u);
+    if(bVisible && iLOD > 0u)
+    {
+        let meshLOD: MeshLOD = aMeshLODs[lodRange.miFirstLOD + iLOD - 1u];
+        iFirstIndex = meshLOD.miFirstIndex;
+        iNumIndices = meshLOD.miNumIndices;
+        bVisible = bFirstCluster;
+    }
+
+    if(iCluster < arrayLength(&aiVisibleClusters))
+    {
+        aiVisibleClusters[iCluster] = select(0u, 1u, bVisible);
+    }
+
+    if(!bVisible)
     {
         return;
     }
 
-    if(aiVisibleFlags[iMesh] <= 0)
+    let iDrawCommandIndex: u32 = allocateDrawCall(lodRange);
+    if(iDrawCommandIndex >= arrayLength(&aDrawCalls))
     {
         return;
     }
 
+    aDrawCalls[iDrawCommandIndex].miIndexCount = iNumIndices;
+    aDrawCalls[iDrawCommandIndex].miInstanceCount = iNumVisible;
+    aDrawCalls[iDrawCommandIndex].miFirstIndex = iFirstIndex;
+    aDrawCalls[iDrawCommandIndex].miBaseVertex = getBaseVertex(lodRange);
+    aDrawCalls[iDrawCommandIndex].miFirstInstance = 0u;
+}
+
+/////
+fn allocateDrawCall(lodRange: MeshLODRange) -> u32
+{
+    // 16 bit draws are packed from the front, 32 bit ones from the slot after the last 16 bit meshlet, each counted separately for the two multi draws
+    if(lodRange.miBaseVertex == kiWideIndexBaseVertex)
+    {
+        return uniformBuffer.miFirstWideDraw + atomicAdd(&aNumDrawCalls[2], 1u);
+    }
+
+    return atomicAdd(&aNumDrawCalls[0], 1u);
+}
+
+/////
+fn getBaseVertex(lodRange: MeshLODRange) -> i32
+{
+    // 16 bit indices are relative to the mesh's first vertex
+    return select(i32(lodRange.miBaseVertex), 0, lodRange.miBaseVertex == kiWideIndexBaseVertex);
+}
+
+/////
+fn getExplodeOffset(iMesh: u32) -> f32
+{
     // total mesh extent is at the very end of list
     let totalMeshExtent: MeshExtent = aMeshExtents[defaultUniformBuffer.miNumMeshes];
     let totalCenter: vec3f = (totalMeshExtent.mMaxPosition.xyz + totalMeshExtent.mMinPosition.xyz) * 0.5f;
 
-    let uv: vec2f = vec2f(0.0f, 0.0f);
-    
-    var minPos: vec3f = aMeshExtents[iMesh].mMinPosition.xyz;
-    var maxPos: vec3f = aMeshExtents[iMesh].mMaxPosition.xyz;
-    let meshCenter = (maxPos + minPos) * 0.5f;
+    let meshCenter: vec3f = (aMeshExtents[iMesh].mMaxPosition.xyz + aMeshExtents[iMesh].mMinPosition.xyz) * 0.5f;
+    return (totalCenter.z - meshCenter.z) * max(uniformBuffer.mfExplodeMultiplier, 0.0f);
+}
 
-    let fOffsetZ: f32 = (totalCenter.z - meshCenter.z) * max(uniformBuffer.mfExplodeMultiplier, 0.0f);
+/////
+fn selectMeshLOD(
+    iMesh: u32,
+    iInstanceMesh: u32) -> u32
+{
+    // levels are from the mesh with the triangles, the distance is to the copy being drawn
+    let lodRange: MeshLODRange = aMeshLODRanges[iMesh];
+    if(uniformBuffer.mfLODPixelError <= 0.0f || lodRange.miNumLODs == 0u)
+    {
+        return 0u;
+    }
 
+    // pixels per unit at the closest point of the mesh's bounding sphere
+    let fOffsetZ: f32 = getExplodeOffset(iInstanceMesh);
+    let minPos: vec3f = aMeshExtents[iInstanceMesh].mMinPosition.xyz;
+    let maxPos: vec3f = aMeshExtents[iInstanceMesh].mMaxPosition.xyz;
+    let meshCenter: vec3f = (minPos + maxPos) * 0.5f - vec3f(0.0f, 0.0f, fOffsetZ);
+    let fRadius: f32 = length(maxPos - minPos) * 0.5f;
+    let fDistance: f32 = max(length(meshCenter - defaultUniformBuffer.mCameraPosition.xyz) - fRadius, 0.0001f);
+    let fPixelsPerUnit: f32 = abs(defaultUniformBuffer.mProjectionMatrix[1][1]) * f32(defaultUniformBuffer.miScreenHeight) * 0.5f / fDistance;
+
+    // coarsest level that stays under the error threshold
+    var iLOD: u32 = 0u;
+    for(var i: u32 = 0u; i < lodRange.miNumLODs; i++)
+    {
+        if(aMeshLODs[lodRange.miFirstLOD + i].mfError * fPixelsPerUnit > uniformBuffer.mfLODPixelError)
+        {
+            break;
+        }
+        iLOD = i + 1u;
+    }
+
+    return iLOD;
+}
+
+/////
+fn isMeshVisible(iMesh: u32) -> bool
+{
+    let fOffsetZ: f32 = getExplodeOffset(iMesh);
+
+    var minPos: vec3f = aMeshExtents[iMesh].mMinPosition.xyz;
+    var maxPos: vec3f = aMeshExtents[iMesh].mMaxPosition.xyz;
     minPos.z -= fOffsetZ;
     maxPos.z -= fOffsetZ;
 
-    // check bbox against the depth pyramid
     let bOccluded: bool = cullBBoxDepth(
         minPos,
         maxPos,
         iMesh
     );
 
-    var bInside: bool = cullBBox(
+    let bInside: bool = cullBBox(
         minPos,
         maxPos,
-        iMesh);    
+        iMesh);
 
-    var xformCenter: vec4f = vec4f(meshCenter.xyz, 1.0f) * defaultUniformBuffer.mViewProjectionMatrix;
-    xformCenter.x /= xformCenter.w;
-    xformCenter.y /= xformCenter.w;
-    xformCenter.z /= xformCenter.w;
-
-    //if(xformCenter.x >= -1.0f && xformCenter.x <= 1.0f && xformCenter.y >= -1.0f && xformCenter.x <= 1.0f)
-    //{
-    //    bInside = true;
-    //}
-    //else 
-    //{
-    //    bInside = false;
-    //}
+    return bInside && !bOccluded;
+}
 
-//bInside = true;
+/////
+fn isClusterVisible(cluster: MeshCluster) -> bool
+{
+    // meshlets move with their mesh when exploded
+    let fOffsetZ: f32 = getExplodeOffset(cluster.miMesh);
 
-    aiVisibleMeshID[iMesh] = 0u;
+    var minPos: vec3f = cluster.mMinPosition.xyz;
+    var maxPos: vec3f = cluster.mMaxPosition.xyz;
+    minPos.z -= fOffsetZ;
+    maxPos.z -= fOffsetZ;
 
-    let iNumIndices: u32 = aMeshTriangleIndexRanges[iMesh].miEnd - aMeshTriangleIndexRanges[iMesh].miStart;
-    let iIndexAddressOffset: u32 = aMeshTriangleIndexRanges[iMesh].miStart;
-    //var iDrawCommandIndex: u32 = 0u;
-    if(bInside && !bOccluded)
-    {
-        let iDrawCommandIndex: u32 = atomicAdd(&aNumDrawCalls[0], 1u);
+    // check bbox against the depth pyramid
+    let bOccluded: bool = cullBBoxDepth(
+        minPos,
+        maxPos,
+        cluster.miMesh
+    );
 
-        aDrawCalls[iDrawCommandIndex].miIndexCount = iNumIndices;
-        aDrawCalls[iDrawCommandIndex].miInstanceCount = 1u;
-        aDrawCalls[iDrawCommandIndex].miFirstIndex = iIndexAddressOffset;
-        aDrawCalls[iDrawCommandIndex].miBaseVertex = 0;
-        aDrawCalls[iDrawCommandIndex].miFirstInstance = 0u;
+    let bInside: bool = cullBBox(
+        minPos,
+        maxPos,
+        cluster.miMesh);
 
-        // mark as visible
-        aiVisibleMeshID[iMesh] = 1u;
+    var bBackFacing: bool = false;
+    if(uniformBuffer.miConeCulling > 0u)
+    {
+        let sphereCenter: vec3f = cluster.mBoundingSphere.xyz - vec3f(0.0f, 0.0f, fOffsetZ);
+        bBackFacing = cullNormalCone(
+            sphereCenter,
+            cluster.mBoundingSphere.w,
+            cluster.mNormalCone);
     }
 
-    atomicAdd(&aNumDrawCalls[1], 1u);  
+    return bInside && !bOccluded && !bBackFacing;
+}
+
+/////
+fn cullNormalCone(
+    center: vec3f,
+    fRadius: f32,
+    normalCone: vec4f) -> bool
+{
+    // every triangle faces away from the camera anywhere within the bounding sphere
+    let viewDir: vec3f = center - defaultUniformBuffer.mCameraPosition.xyz;
+    return dot(viewDir, normalCone.xyz) >= normalCone.w * length(viewDir) + fRadius;
 }
 
 /////
@@ -0,0 +1,298 @@
+#include "conversion_cache.h"
+
+#include <stdio.h>
+
+#include <filesystem>
+#include <system_error>
+
+#include <utils/LogPrint.h>
+
+/*
+** FNV-1a over 64 bit words like the vertex welder, the tail bytes are folded in one at a time
+*/
+static uint64_t hashData(
+    uint64_t iHash,
+    char const* pcData,
+    uint64_t iSize)
+{
+    uint64_t iNumWords = iSize / sizeof(uint64_t);
+    for(uint64_t i = 0; i < iNumWords; i++)
+    {
+        uint64_t iWord = 0;
+        memcpy(&iWord, pcData + i * sizeof(uint64_t), sizeof(uint64_t));
+        iHash ^= iWord;
+        iHash *= 0x100000001b3ull;
+    }
+
+    for(uint64_t i = iNumWords * sizeof(uint64_t); i < iSize; i++)
+    {
+        iHash ^= (uint8_t)pcData[i];
+        iHash *= 0x100000001b3ull;
+    }
+
+    iHash ^= iHash >> 33;
+    iHash *= 0xff51afd7ed558ccdull;
+    iHash ^= iHash >> 33;
+
+    return iHash;
+}
+
+/*
+**
+*/
+static bool readFile(
+    std::vector<char>& acData,
+    std::string const& filePath)
+{
+    acData.clear();
+    FILE* fp = fopen(filePath.c_str(), "rb");
+    if(fp == nullptr)
+    {
+        return false;
+    }
+
+    std::error_code errorCode;
+    uint64_t iFileSize = (uint64_t)std::filesystem::file_size(filePath, errorCode);
+    acData.resize(errorCode ? 0 : (size_t)iFileSize);
+    bool bRead = (fread(acData.data(), 1, acData.size(), fp) == acData.size());
+    fclose(fp);
+
+    return bRead;
+}
+
+/*
+** size and modification time, zero for files that don't exist so creating them later counts as a change
+*/
+static ConversionCacheKey::SourceFile stampFile(std::string const& filePath)
+{
+    ConversionCacheKey::SourceFile sourceFile;
+    sourceFile.mPath = filePath;
+
+    std::error_code errorCode;
+    auto modifiedTime = std::filesystem::last_write_time(filePath, errorCode);
+    if(!errorCode)
+    {
+        sourceFile.miModifiedTime = (int64_t)modifiedTime.time_since_epoch().count();
+        sourceFile.miSize = (uint64_t)std::filesystem::file_size(filePath, errorCode);
+    }
+
+    return sourceFile;
+}
+
+/*
+** "mtllib" lines, names are relative to the obj's directory like the obj loader takes them
+*/
+static void findMaterialLibraries(
+    std::vector<std::string>& aFilePaths,
+    std::vector<char> const& acOBJData,
+    std::filesystem::path const& directory)
+{
+    char const* pcLine = acOBJData.data();
+    char const* pcEnd = acOBJData.data() + acOBJData.size();
+    while(pcLine < pcEnd)
+    {
+        char const* pcLineEnd = (char const*)memchr(pcLine, '\n', pcEnd - pcLine);
+        if(pcLineEnd == nullptr)
+        {
+            pcLineEnd = pcEnd;
+        }
+
+        while(pcLine < pcLineEnd && (*pcLine == ' ' || *pcLine == '\t'))
+        {
+            ++pcLine;
+        }
+
+        if(pcLineEnd - pcLine > 7 && strncmp(pcLine, "mtllib", 6) == 0 && (pcLine[6] == ' ' || pcLine[6] == '\t'))
+        {
+            char const* pcName = pcLine + 7;
+            while(pcName < pcLineEnd)
+            {
+                while(pcName < pcLineEnd && (*pcName == ' ' || *pcName == '\t' || *pcName == '\r'))
+                {
+                    ++pcName;
+                }
+
+                char const* pcNameEnd = pcName;
+                while(pcNameEnd < pcLineEnd && *pcNameEnd != ' ' && *pcNameEnd != '\t' && *pcNameEnd != '\r')
+                {
+                    ++pcNameEnd;
+                }
+
+                if(pcNameEnd > pcName)
+                {
+                    aFilePaths.push_back((directory / std::string(pcName, pcNameEnd)).string());
+                }
+                pcName = pcNameEnd;
+            }
+        }
+
+        pcLine = pcLineEnd + 1;
+    }
+}
+
+/*
+**
+*/
+void CConversionCache::setup(
+    std::string const& cacheDirectory,
+    std::vector<char> const& acSettings)
+{
+    mDirectory = cacheDirectory;
+    macSettings = acSettings;
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(mDirectory, errorCode);
+    if(errorCode)
+    {
+        DEBUG_PRINTF("!!! can\'t create cache directory \"%s\": %s !!!\n", mDirectory.c_str(), errorCode.message().c_str());
+    }
+}
+
+/*
+** file name and a hash of the full path, so files with the same name from different directories can share a cache
+*/
+std::string CConversionCache::getEntryPath(std::string const& sourcePath) const
+{
+    std::string absolutePath = std::filesystem::absolute(sourcePath).lexically_normal().string();
+    uint64_t iPathHash = hashData(0xcbf29ce484222325ull, absolutePath.data(), absolutePath.size());
+
+    char szEntryName[32];
+    snprintf(szEntryName, sizeof(szEntryName), "-%016llx.objc", (unsigned long long)iPathHash);
+
+    return (std::filesystem::path(mDirectory) / (std::filesystem::path(sourcePath).stem().string() + szEntryName)).string();
+}
+
+/*
+**
+*/
+void CConversionCache::makeKey(
+    ConversionCacheKey& key,
+    std::string const& sourcePath) const
+{
+    key.mSourcePath = sourcePath;
+    key.maSourceFiles.clear();
+
+    // stamped before reading, a file written to while it's being hashed looks changed on the next run
+    key.maSourceFiles.push_back(stampFile(sourcePath));
+    std::vector<char> acData;
+    readFile(acData, sourcePath);
+    key.miContentHash = hashData(0xcbf29ce484222325ull, acData.data(), acData.size());
+
+    std::vector<std::string> aMaterialLibraryPaths;
+    findMaterialLibraries(
+        aMaterialLibraryPaths,
+        acData,
+        std::filesystem::path(sourcePath).parent_path());
+    for(auto const& materialLibraryPath : aMaterialLibraryPaths)
+    {
+        key.maSourceFiles.push_back(stampFile(materialLibraryPath));
+        readFile(acData, materialLibraryPath);
+        key.miContentHash = hashData(key.miContentHash, materialLibraryPath.data(), materialLibraryPath.size());
+        key.miContentHash = hashData(key.miContentHash, acData.data(), acData.size());
+    }
+}
+
+/*
+**
+*/
+bool CConversionCache::load(
+    std::vector<char>& acPayload,
+    ConversionCacheKey& key,
+    std::string const& sourcePath)
+{
+    ConversionCacheKey cachedKey;
+    std::vector<char> acEntry;
+    bool bValid = readFile(acEntry, getEntryPath(sourcePath));
+    if(bValid)
+    {
+        CacheReader reader = {acEntry};
+        uint32_t iSignature = 0;
+        uint32_t iVersion = 0;
+        std::vector<char> acSettings;
+        uint64_t iNumSourceFiles = 0;
+        bValid = reader.read(iSignature) && iSignature == kiConversionCacheSignature &&
+                 reader.read(iVersion) && iVersion == kiConversionCacheVersion &&
+                 reader.read(acSettings) && acSettings == macSettings &&
+                 reader.read(cachedKey.mSourcePath) && cachedKey.mSourcePath == sourcePath &&
+                 reader.read(cachedKey.miContentHash) &&
+                 reader.read(iNumSourceFiles) && iNumSourceFiles <= acEntry.size();
+        for(uint64_t i = 0; bValid && i < iNumSourceFiles; i++)
+        {
+            ConversionCacheKey::SourceFile sourceFile;
+            bValid = reader.read(sourceFile.mPath) && reader.read(sourceFile.miModifiedTime) && reader.read(sourceFile.miSize);
+            cachedKey.maSourceFiles.push_back(sourceFile);
+        }
+        bValid = bValid && reader.read(acPayload);
+    }
+
+    // same stamps, the contents aren't looked at
+    bool bSameStamps = bValid && cachedKey.maSourceFiles.size() > 0;
+    for(uint32_t i = 0; bSameStamps && i < (uint32_t)cachedKey.maSourceFiles.size(); i++)
+    {
+        ConversionCacheKey::SourceFile const& cachedFile = cachedKey.maSourceFiles[i];
+        ConversionCacheKey::SourceFile sourceFile = stampFile(cachedFile.mPath);
+        bSameStamps = (sourceFile.miModifiedTime == cachedFile.miModifiedTime && sourceFile.miSize == cachedFile.miSize);
+    }
+    if(bSameStamps)
+    {
+        key = cachedKey;
+        return true;
+    }
+
+    // touched or copied without changing, the entry gets the new stamps
+    makeKey(key, sourcePath);
+    if(bValid && key.miContentHash == cachedKey.miContentHash)
+    {
+        store(key, acPayload);
+        return true;
+    }
+
+    acPayload.clear();
+    return false;
+}
+
+/*
+** written next to the entry and renamed over it, an interrupted run doesn't leave a truncated entry behind
+*/
+void CConversionCache::store(
+    ConversionCacheKey const& key,
+    std::vector<char> const& acPayload)
+{
+    std::vector<char> acEntry;
+    CacheWriter writer = {acEntry};
+    writer.write(kiConversionCacheSignature);
+    writer.write(kiConversionCacheVersion);
+    writer.write(macSettings);
+    writer.write(key.mSourcePath);
+    writer.write(key.miContentHash);
+    writer.write((uint64_t)key.maSourceFiles.size());
+    for(auto const& sourceFile : key.maSourceFiles)
+    {
+        writer.write(sourceFile.mPath);
+        writer.write(sourceFile.miModifiedTime);
+        writer.write(sourceFile.miSize);
+    }
+    writer.write(acPayload);
+
+    std::string entryPath = getEntryPath(key.mSourcePath);
+    std::string tempPath = entryPath + ".tmp";
+    FILE* fp = fopen(tempPath.c_str(), "wb");
+    if(fp == nullptr)
+    {
+        DEBUG_PRINTF("!!! can\'t write cache entry \"%s\" !!!\n", tempPath.c_str());
+        return;
+    }
+    bool bWritten = (fwrite(acEntry.data(), 1, acEntry.size(), fp) == acEntry.size());
+    bWritten = (fclose(fp) == 0) && bWritten;
+
+    std::error_code errorCode;
+    if(bWritten)
+    {
+        std::filesystem::rename(tempPath, entryPath, errorCode);
+    }
+    if(!bWritten || errorCode)
+    {
+        DEBUG_PRINTF("!!! can\'t write cache entry \"%s\" !!!\n", entryPath.c_str());
+        std::filesystem::remove(tempPath, errorCode);
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// "OBJC", one entry per obj file in the cache directory
+constexpr uint32_t kiConversionCacheSignature = 0x434a424f;
+constexpr uint32_t kiConversionCacheVersion = 1;
+
+/*
+** what an entry was made from, the obj first and then the material libraries it names
+*/
+struct ConversionCacheKey
+{
+    struct SourceFile
+    {
+        std::string         mPath;
+        int64_t             miModifiedTime = 0;
+        uint64_t            miSize = 0;
+    };
+
+    std::string                 mSourcePath;
+    std::vector<SourceFile>     maSourceFiles;
+    uint64_t                    miContentHash = 0;
+};
+
+/*
+** cache of the per file conversion results, an entry is reused when its source files have the same size and modification
+** time or, failing that, the same content hash, and it was written with the same settings
+*/
+class CConversionCache
+{
+public:
+    CConversionCache() = default;
+    virtual ~CConversionCache() = default;
+
+    // acSettings are whatever changes the converted data, entries written with different ones are converted again
+    void setup(
+        std::string const& cacheDirectory,
+        std::vector<char> const& acSettings);
+
+    // key is filled in either way, a miss leaves it ready for store() once the file is converted
+    bool load(
+        std::vector<char>& acPayload,
+        ConversionCacheKey& key,
+        std::string const& sourcePath);
+
+    void store(
+        ConversionCacheKey const& key,
+        std::vector<char> const& acPayload);
+
+protected:
+    std::string getEntryPath(std::string const& sourcePath) const;
+
+    // stamps the source files and hashes their contents
+    void makeKey(
+        ConversionCacheKey& key,
+        std::string const& sourcePath) const;
+
+protected:
+    std::string                 mDirectory;
+    std::vector<char>           macSettings;
+};
+
+/*
+** payload helpers, the reader fails once anything would go past the end
+*/
+struct CacheWriter
+{
+    std::vector<char>&          macData;
+
+    inline void write(void const* pData, uint64_t iSize)
+    {
+        macData.insert(macData.end(), (char const*)pData, (char const*)pData + iSize);
+    }
+
+    template<typename T>
+    inline void write(T const& value)
+    {
+        write(&value, sizeof(T));
+    }
+
+    inline void write(std::string const& value)
+    {
+        write((uint64_t)value.size());
+        write(value.data(), value.size());
+    }
+
+    template<typename T>
+    inline void write(std::vector<T> const& aValues)
+    {
+        write((uint64_t)aValues.size());
+        write(aValues.data(), aValues.size() * sizeof(T));
+    }
+};
+
+struct CacheReader
+{
+    std::vector<char> const&    macData;
+    uint64_t                    miOffset = 0;
+
+    inline bool read(void* pData, uint64_t iSize)
+    {
+        if(miOffset + iSize > macData.size())
+        {
+            return false;
+        }
+        memcpy(pData, macData.data() + miOffset, iSize);
+        miOffset += iSize;
+        return true;
+    }
+
+    template<typename T>
+    inline bool read(T& value)
+    {
+        return read(&value, sizeof(T));
+    }
+
+    inline bool read(std::string& value)
+    {
+        uint64_t iSize = 0;
+        if(!read(iSize) || iSize > macData.size() - miOffset)
+        {
+            return false;
+        }
+        value.assign(macData.data() + miOffset, iSize);
+        miOffset += iSize;
+        return true;
+    }
+
+    template<typename T>
+    inline bool read(std::vector<T>& aValues)
+    {
+        uint64_t iNumValues = 0;
+        if(!read(iNumValues) || iNumValues > (macData.size() - miOffset) / sizeof(T))
+        {
+            return false;
+        }
+        aValues.resize(iNumValues);
+        return read(aValues.data(), iNumValues * sizeof(T));
+    }
+};
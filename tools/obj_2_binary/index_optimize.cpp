@@ -0,0 +1,364 @@
+#include "index_optimize.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+/*
+**
+*/
+static float3 getPosition(
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iVertex)
+{
+    float const* pfPosition = (float const*)((char const*)pfPositions + (uint64_t)iVertex * iPositionStride);
+    return float3(pfPosition[0], pfPosition[1], pfPosition[2]);
+}
+
+/*
+**
+*/
+void CIndexOptimizer::setCacheSize(uint32_t iCacheSize)
+{
+    miCacheSize = std::max(iCacheSize, 3u);
+}
+
+/*
+** tipsify, Sander et al. 2007, fans around the most recently cached vertex that still has triangles left and jumps back
+** through the dead-end stack when the fan runs out
+*/
+void CIndexOptimizer::optimizeVertexCache(
+    std::vector<uint32_t>& aiTriangleIndices,
+    uint32_t iStart,
+    uint32_t iNumIndices)
+{
+    assert(iNumIndices % 3 == 0);
+    assert(iStart + iNumIndices <= (uint32_t)aiTriangleIndices.size());
+    uint32_t iNumTriangles = iNumIndices / 3;
+    if(iNumTriangles <= 1)
+    {
+        return;
+    }
+
+    uint32_t* piTriangleIndices = aiTriangleIndices.data() + iStart;
+
+    std::vector<uint32_t> aiLocalIndices(iNumIndices);
+    for(uint32_t i = 0; i < iNumIndices; i++)
+    {
+        aiLocalIndices[i] = getLocalVertex(piTriangleIndices[i]);
+    }
+    uint32_t iNumVertices = (uint32_t)maiGlobalVertices.size();
+
+    // triangles using each vertex
+    std::vector<uint32_t> aiVertexTriangleStart(iNumVertices + 1, 0);
+    for(uint32_t iVertex : aiLocalIndices)
+    {
+        aiVertexTriangleStart[iVertex + 1] += 1;
+    }
+    for(uint32_t i = 0; i < iNumVertices; i++)
+    {
+        aiVertexTriangleStart[i + 1] += aiVertexTriangleStart[i];
+    }
+
+    std::vector<uint32_t> aiVertexTriangles(iNumIndices);
+    std::vector<uint32_t> aiNumLiveTriangles(iNumVertices, 0);
+    for(uint32_t i = 0; i < iNumIndices; i++)
+    {
+        uint32_t iVertex = aiLocalIndices[i];
+        aiVertexTriangles[aiVertexTriangleStart[iVertex] + aiNumLiveTriangles[iVertex]] = i / 3;
+        aiNumLiveTriangles[iVertex] += 1;
+    }
+
+    std::vector<uint32_t> aiCacheTime(iNumVertices, 0);
+    std::vector<bool> abEmitted(iNumTriangles, false);
+    std::vector<uint32_t> aiDeadEnd;
+    std::vector<uint32_t> aiCandidates;
+    std::vector<uint32_t> aiOptimizedIndices;
+    aiOptimizedIndices.reserve(iNumIndices);
+
+    uint32_t iTime = miCacheSize + 1;
+    uint32_t iCursor = 0;
+    uint32_t iFanningVertex = 0;
+    while(iFanningVertex != UINT32_MAX)
+    {
+        aiCandidates.clear();
+        for(uint32_t j = aiVertexTriangleStart[iFanningVertex]; j < aiVertexTriangleStart[iFanningVertex + 1]; j++)
+        {
+            uint32_t iTriangle = aiVertexTriangles[j];
+            if(abEmitted[iTriangle])
+            {
+                continue;
+            }
+
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t iVertex = aiLocalIndices[iTriangle * 3 + i];
+                aiDeadEnd.push_back(iVertex);
+                aiCandidates.push_back(iVertex);
+                aiNumLiveTriangles[iVertex] -= 1;
+                if(iTime - aiCacheTime[iVertex] > miCacheSize)
+                {
+                    aiCacheTime[iVertex] = iTime;
+                    iTime += 1;
+                }
+
+                aiOptimizedIndices.push_back(piTriangleIndices[iTriangle * 3 + i]);
+            }
+            abEmitted[iTriangle] = true;
+        }
+
+        // candidate that stays in the cache after fanning through all of its remaining triangles, the oldest one first
+        iFanningVertex = UINT32_MAX;
+        uint32_t iBestPriority = 0;
+        for(uint32_t iVertex : aiCandidates)
+        {
+            if(aiNumLiveTriangles[iVertex] == 0)
+            {
+                continue;
+            }
+
+            uint32_t iPriority = 0;
+            if(iTime - aiCacheTime[iVertex] + 2 * aiNumLiveTriangles[iVertex] <= miCacheSize)
+            {
+                iPriority = iTime - aiCacheTime[iVertex];
+            }
+
+            if(iPriority > iBestPriority)
+            {
+                iBestPriority = iPriority;
+                iFanningVertex = iVertex;
+            }
+        }
+
+        // dead end, most recently referenced vertex with triangles left, then the next one in input order
+        while(iFanningVertex == UINT32_MAX && !aiDeadEnd.empty())
+        {
+            uint32_t iVertex = aiDeadEnd.back();
+            aiDeadEnd.pop_back();
+            if(aiNumLiveTriangles[iVertex] > 0)
+            {
+                iFanningVertex = iVertex;
+            }
+        }
+
+        while(iFanningVertex == UINT32_MAX && iCursor < iNumVertices)
+        {
+            if(aiNumLiveTriangles[iCursor] > 0)
+            {
+                iFanningVertex = iCursor;
+            }
+            else
+            {
+                iCursor += 1;
+            }
+        }
+    }
+
+    assert(aiOptimizedIndices.size() == iNumIndices);
+    std::copy(aiOptimizedIndices.begin(), aiOptimizedIndices.end(), piTriangleIndices);
+
+    clearLocalVertices();
+}
+
+/*
+** fast linear-speed overdraw ordering from the same paper, the meshlets are the clusters so culling keeps its ranges,
+** clusters further out along their average normal are more likely to occlude the rest of the mesh
+*/
+void CIndexOptimizer::optimizeOverdraw(
+    std::vector<uint32_t>& aiTriangleIndices,
+    MeshCluster* pClusters,
+    uint32_t iNumClusters,
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iFirstIndex)
+{
+    if(iNumClusters <= 1)
+    {
+        return;
+    }
+
+    // area weighted centroid and normal of every cluster
+    std::vector<float3> aClusterCentroids(iNumClusters);
+    std::vector<float3> aClusterNormals(iNumClusters);
+    float3 meshCentroid(0.0f, 0.0f, 0.0f);
+    float fMeshArea = 0.0f;
+    for(uint32_t iCluster = 0; iCluster < iNumClusters; iCluster++)
+    {
+        MeshCluster const& cluster = pClusters[iCluster];
+        float3 centroid(0.0f, 0.0f, 0.0f);
+        float3 normal(0.0f, 0.0f, 0.0f);
+        float fClusterArea = 0.0f;
+        uint32_t iStart = cluster.miFirstIndex - iFirstIndex;
+        for(uint32_t i = iStart; i < iStart + cluster.miNumIndices; i += 3)
+        {
+            float3 position0 = getPosition(pfPositions, iPositionStride, aiTriangleIndices[i]);
+            float3 position1 = getPosition(pfPositions, iPositionStride, aiTriangleIndices[i + 1]);
+            float3 position2 = getPosition(pfPositions, iPositionStride, aiTriangleIndices[i + 2]);
+
+            float3 triangleNormal = cross(position1 - position0, position2 - position0);
+            float fArea = length(triangleNormal) * 0.5f;
+
+            centroid = centroid + (position0 + position1 + position2) * (fArea / 3.0f);
+            normal = normal + triangleNormal;
+            fClusterArea += fArea;
+        }
+
+        // degenerate clusters fall back to the center of their bounds
+        aClusterCentroids[iCluster] = (fClusterArea > 0.0f) ? centroid / fClusterArea : float3(cluster.mBoundingSphere);
+        aClusterNormals[iCluster] = normal;
+
+        meshCentroid = meshCentroid + centroid;
+        fMeshArea += fClusterArea;
+    }
+
+    if(fMeshArea <= 0.0f)
+    {
+        return;
+    }
+    meshCentroid = meshCentroid / fMeshArea;
+
+    std::vector<float> afMetrics(iNumClusters, 0.0f);
+    for(uint32_t iCluster = 0; iCluster < iNumClusters; iCluster++)
+    {
+        float fNormalLength = length(aClusterNormals[iCluster]);
+        if(fNormalLength > 0.0f)
+        {
+            afMetrics[iCluster] = dot(aClusterCentroids[iCluster] - meshCentroid, aClusterNormals[iCluster] / fNormalLength);
+        }
+    }
+
+    std::vector<uint32_t> aiOrder(iNumClusters);
+    for(uint32_t i = 0; i < iNumClusters; i++)
+    {
+        aiOrder[i] = i;
+    }
+    std::stable_sort(
+        aiOrder.begin(),
+        aiOrder.end(),
+        [&](uint32_t iLeft, uint32_t iRight)
+        {
+            return afMetrics[iLeft] > afMetrics[iRight];
+        });
+
+    // the mesh's clusters are contiguous, move their triangles into the sorted order
+    uint32_t iRangeStart = pClusters[0].miFirstIndex - iFirstIndex;
+    std::vector<uint32_t> aiSortedIndices;
+    std::vector<MeshCluster> aSortedClusters(iNumClusters);
+    aiSortedIndices.reserve(pClusters[iNumClusters - 1].miFirstIndex + pClusters[iNumClusters - 1].miNumIndices - pClusters[0].miFirstIndex);
+    for(uint32_t i = 0; i < iNumClusters; i++)
+    {
+        MeshCluster cluster = pClusters[aiOrder[i]];
+        uint32_t iStart = cluster.miFirstIndex - iFirstIndex;
+        cluster.miFirstIndex = iFirstIndex + iRangeStart + (uint32_t)aiSortedIndices.size();
+        aiSortedIndices.insert(aiSortedIndices.end(), aiTriangleIndices.begin() + iStart, aiTriangleIndices.begin() + iStart + cluster.miNumIndices);
+        aSortedClusters[i] = cluster;
+    }
+
+    std::copy(aiSortedIndices.begin(), aiSortedIndices.end(), aiTriangleIndices.begin() + iRangeStart);
+    std::copy(aSortedClusters.begin(), aSortedClusters.end(), pClusters);
+}
+
+/*
+**
+*/
+void CIndexOptimizer::optimizeVertexFetch(
+    std::vector<uint32_t>& aiRemap,
+    std::vector<std::vector<uint32_t>>& aaiTriangleIndices,
+    uint32_t iNumVertices)
+{
+    aiRemap.assign(iNumVertices, UINT32_MAX);
+    uint32_t iNextVertex = 0;
+    for(auto& aiTriangleIndices : aaiTriangleIndices)
+    {
+        for(uint32_t& iIndex : aiTriangleIndices)
+        {
+            assert(iIndex < iNumVertices);
+            if(aiRemap[iIndex] == UINT32_MAX)
+            {
+                aiRemap[iIndex] = iNextVertex;
+                iNextVertex += 1;
+            }
+            iIndex = aiRemap[iIndex];
+        }
+    }
+
+    for(uint32_t iVertex = 0; iVertex < iNumVertices; iVertex++)
+    {
+        if(aiRemap[iVertex] == UINT32_MAX)
+        {
+            aiRemap[iVertex] = iNextVertex;
+            iNextVertex += 1;
+        }
+    }
+}
+
+/*
+**
+*/
+VertexCacheStats CIndexOptimizer::analyzeVertexCache(
+    uint32_t const* piTriangleIndices,
+    uint32_t iNumIndices)
+{
+    VertexCacheStats ret;
+    ret.miNumTriangles = iNumIndices / 3;
+
+    // a vertex is still cached if fewer than cache size other vertices were loaded after it
+    std::vector<uint32_t> aiCacheTime;
+    uint32_t iTime = miCacheSize + 1;
+    for(uint32_t i = 0; i < iNumIndices; i++)
+    {
+        uint32_t iVertex = getLocalVertex(piTriangleIndices[i]);
+        if(iVertex >= (uint32_t)aiCacheTime.size())
+        {
+            aiCacheTime.resize(iVertex + 1, 0);
+        }
+
+        if(iTime - aiCacheTime[iVertex] > miCacheSize)
+        {
+            aiCacheTime[iVertex] = iTime;
+            iTime += 1;
+            ret.miNumTransforms += 1;
+        }
+    }
+
+    ret.miNumVertices = (uint32_t)maiGlobalVertices.size();
+    ret.mfACMR = (ret.miNumTriangles > 0) ? (float)ret.miNumTransforms / (float)ret.miNumTriangles : 0.0f;
+    ret.mfATVR = (ret.miNumVertices > 0) ? (float)ret.miNumTransforms / (float)ret.miNumVertices : 0.0f;
+
+    clearLocalVertices();
+
+    return ret;
+}
+
+/*
+**
+*/
+uint32_t CIndexOptimizer::getLocalVertex(uint32_t iVertex)
+{
+    if(iVertex >= (uint32_t)maiLocalVertices.size())
+    {
+        maiLocalVertices.resize((uint64_t)iVertex + 1, UINT32_MAX);
+    }
+
+    if(maiLocalVertices[iVertex] == UINT32_MAX)
+    {
+        maiLocalVertices[iVertex] = (uint32_t)maiGlobalVertices.size();
+        maiGlobalVertices.push_back(iVertex);
+    }
+
+    return maiLocalVertices[iVertex];
+}
+
+/*
+**
+*/
+void CIndexOptimizer::clearLocalVertices()
+{
+    for(uint32_t iVertex : maiGlobalVertices)
+    {
+        maiLocalVertices[iVertex] = UINT32_MAX;
+    }
+    maiGlobalVertices.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh_cluster.h"
+
+/*
+** simulated fifo post-transform cache over an index list
+**    acmr, average cache miss ratio, vertex shader invocations per triangle, 0.5 is the best a regular grid can do
+**    atvr, average transform to vertex ratio, vertex shader invocations per unique vertex, 1.0 is the best possible
+*/
+struct VertexCacheStats
+{
+    uint32_t            miNumTransforms = 0;
+    uint32_t            miNumTriangles = 0;
+    uint32_t            miNumVertices = 0;
+
+    float               mfACMR = 0.0f;
+    float               mfATVR = 0.0f;
+};
+
+/*
+** reorders index lists for the post-transform vertex cache (tipsify), for overdraw (view independent cluster sort)
+** and reorders the vertices for fetch locality
+*/
+class CIndexOptimizer
+{
+public:
+    CIndexOptimizer() = default;
+    virtual ~CIndexOptimizer() = default;
+
+    void setCacheSize(uint32_t iCacheSize);
+
+    // triangles in [iStart, iStart + iNumIndices) are reordered in place, the vertex indices are global
+    void optimizeVertexCache(
+        std::vector<uint32_t>& aiTriangleIndices,
+        uint32_t iStart,
+        uint32_t iNumIndices);
+
+    // clusters of one mesh are sorted so the ones facing out of the mesh draw first, their triangles are moved along with them
+    void optimizeOverdraw(
+        std::vector<uint32_t>& aiTriangleIndices,
+        MeshCluster* pClusters,
+        uint32_t iNumClusters,
+        float const* pfPositions,
+        uint32_t iPositionStride,
+        uint32_t iFirstIndex);
+
+    // vertices are renumbered in the order they're first used, aiRemap maps old vertex index to new, unused vertices go last
+    void optimizeVertexFetch(
+        std::vector<uint32_t>& aiRemap,
+        std::vector<std::vector<uint32_t>>& aaiTriangleIndices,
+        uint32_t iNumVertices);
+
+    VertexCacheStats analyzeVertexCache(
+        uint32_t const* piTriangleIndices,
+        uint32_t iNumIndices);
+
+protected:
+    uint32_t getLocalVertex(uint32_t iVertex);
+    void clearLocalVertices();
+
+protected:
+    uint32_t                        miCacheSize = 16;
+
+    // global to local vertex index for the list being optimized, UINT32_MAX when not used
+    std::vector<uint32_t>           maiLocalVertices;
+    std::vector<uint32_t>           maiGlobalVertices;
+};
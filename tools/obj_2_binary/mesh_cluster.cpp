@@ -0,0 +1,320 @@
+#include "mesh_cluster.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+/*
+**
+*/
+static float3 getPosition(
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iVertex)
+{
+    float const* pfPosition = (float const*)((char const*)pfPositions + (uint64_t)iVertex * iPositionStride);
+    return float3(pfPosition[0], pfPosition[1], pfPosition[2]);
+}
+
+/*
+**
+*/
+void CMeshClusterBuilder::setLimits(uint32_t iMaxVertices, uint32_t iMaxTriangles)
+{
+    // a single triangle has to fit
+    miMaxVertices = std::max(iMaxVertices, 3u);
+    miMaxTriangles = std::max(iMaxTriangles, 1u);
+}
+
+/*
+** vertex indices of one mesh are expected to be in a compact range, they are the way the converter assigns them
+*/
+void CMeshClusterBuilder::build(
+    std::vector<MeshCluster>& aClusters,
+    std::vector<uint32_t>& aiTriangleIndices,
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iMesh,
+    uint32_t iFirstIndex)
+{
+    assert(aiTriangleIndices.size() % 3 == 0);
+    uint32_t iNumTriangles = (uint32_t)aiTriangleIndices.size() / 3;
+    if(iNumTriangles == 0)
+    {
+        return;
+    }
+
+    uint32_t iBaseVertex = *std::min_element(aiTriangleIndices.begin(), aiTriangleIndices.end());
+    uint32_t iNumVertices = *std::max_element(aiTriangleIndices.begin(), aiTriangleIndices.end()) - iBaseVertex + 1;
+
+    // triangles using each vertex
+    std::vector<uint32_t> aiVertexTriangleStart(iNumVertices + 1, 0);
+    for(uint32_t iIndex : aiTriangleIndices)
+    {
+        aiVertexTriangleStart[iIndex - iBaseVertex + 1] += 1;
+    }
+    for(uint32_t i = 0; i < iNumVertices; i++)
+    {
+        aiVertexTriangleStart[i + 1] += aiVertexTriangleStart[i];
+    }
+
+    std::vector<uint32_t> aiVertexTriangles(aiTriangleIndices.size());
+    std::vector<uint32_t> aiNumLiveTriangles(iNumVertices, 0);
+    for(uint32_t iTriangle = 0; iTriangle < iNumTriangles; iTriangle++)
+    {
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            uint32_t iVertex = aiTriangleIndices[iTriangle * 3 + i] - iBaseVertex;
+            aiVertexTriangles[aiVertexTriangleStart[iVertex] + aiNumLiveTriangles[iVertex]] = iTriangle;
+            aiNumLiveTriangles[iVertex] += 1;
+        }
+    }
+
+    std::vector<float3> aTriangleCenters(iNumTriangles);
+    for(uint32_t iTriangle = 0; iTriangle < iNumTriangles; iTriangle++)
+    {
+        float3 center(0.0f, 0.0f, 0.0f);
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            center = center + getPosition(pfPositions, iPositionStride, aiTriangleIndices[iTriangle * 3 + i]);
+        }
+        aTriangleCenters[iTriangle] = center / 3.0f;
+    }
+
+    std::vector<bool> abEmitted(iNumTriangles, false);
+    std::vector<uint32_t> aiVertexCluster(iNumVertices, UINT32_MAX);
+    std::vector<uint32_t> aiClusterTriangles;
+    std::vector<uint32_t> aiClusterVertices;
+    std::vector<uint32_t> aiClusteredIndices;
+    aiClusteredIndices.reserve(aiTriangleIndices.size());
+
+    // number of vertices the triangle would add to the current cluster
+    auto getNumNewVertices = [&](uint32_t iTriangle, uint32_t iCluster)
+    {
+        uint32_t const* piTriangle = &aiTriangleIndices[iTriangle * 3];
+        uint32_t iNumNew = 0;
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            bool bRepeated = (i > 0 && piTriangle[i] == piTriangle[0]) || (i > 1 && piTriangle[i] == piTriangle[1]);
+            if(!bRepeated && aiVertexCluster[piTriangle[i] - iBaseVertex] != iCluster)
+            {
+                iNumNew += 1;
+            }
+        }
+        return iNumNew;
+    };
+
+    // fewest unclustered triangles around any of its vertices
+    auto getNumLiveTriangles = [&](uint32_t iTriangle)
+    {
+        uint32_t const* piTriangle = &aiTriangleIndices[iTriangle * 3];
+        return std::min(
+            std::min(aiNumLiveTriangles[piTriangle[0] - iBaseVertex], aiNumLiveTriangles[piTriangle[1] - iBaseVertex]),
+            aiNumLiveTriangles[piTriangle[2] - iBaseVertex]);
+    };
+
+    uint32_t iNumEmitted = 0;
+    uint32_t iScanTriangle = 0;
+    uint32_t iSeedTriangle = UINT32_MAX;
+    uint32_t iCluster = 0;
+    while(iNumEmitted < iNumTriangles)
+    {
+        if(iSeedTriangle == UINT32_MAX)
+        {
+            while(abEmitted[iScanTriangle])
+            {
+                iScanTriangle += 1;
+            }
+            iSeedTriangle = iScanTriangle;
+        }
+
+        aiClusterTriangles.clear();
+        aiClusterVertices.clear();
+        float3 clusterCenter(0.0f, 0.0f, 0.0f);
+
+        uint32_t iAddTriangle = iSeedTriangle;
+        while(iAddTriangle != UINT32_MAX)
+        {
+            abEmitted[iAddTriangle] = true;
+            iNumEmitted += 1;
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t iVertex = aiTriangleIndices[iAddTriangle * 3 + i] - iBaseVertex;
+                aiNumLiveTriangles[iVertex] -= 1;
+                if(aiVertexCluster[iVertex] != iCluster)
+                {
+                    aiVertexCluster[iVertex] = iCluster;
+                    aiClusterVertices.push_back(iVertex);
+                }
+            }
+            aiClusterTriangles.push_back(iAddTriangle);
+            clusterCenter = clusterCenter + (aTriangleCenters[iAddTriangle] - clusterCenter) / (float)aiClusterTriangles.size();
+
+            if((uint32_t)aiClusterTriangles.size() >= miMaxTriangles)
+            {
+                break;
+            }
+
+            // best fitting neighbor shares the most vertices, then has the fewest triangles left around it so no slivers are
+            // left behind, then is the closest to the cluster's center
+            iAddTriangle = UINT32_MAX;
+            uint32_t iBestNumNew = UINT32_MAX;
+            uint32_t iBestNumLive = UINT32_MAX;
+            float fBestDistance = FLT_MAX;
+            for(uint32_t iVertex : aiClusterVertices)
+            {
+                if(aiNumLiveTriangles[iVertex] == 0)
+                {
+                    continue;
+                }
+
+                for(uint32_t j = aiVertexTriangleStart[iVertex]; j < aiVertexTriangleStart[iVertex + 1]; j++)
+                {
+                    uint32_t iTriangle = aiVertexTriangles[j];
+                    if(abEmitted[iTriangle])
+                    {
+                        continue;
+                    }
+
+                    uint32_t iNumNew = getNumNewVertices(iTriangle, iCluster);
+                    if((uint32_t)aiClusterVertices.size() + iNumNew > miMaxVertices || iNumNew > iBestNumNew)
+                    {
+                        continue;
+                    }
+
+                    uint32_t iNumLive = getNumLiveTriangles(iTriangle);
+                    if(iNumNew == iBestNumNew && iNumLive > iBestNumLive)
+                    {
+                        continue;
+                    }
+
+                    float fDistance = lengthSquared(aTriangleCenters[iTriangle] - clusterCenter);
+                    if(iNumNew < iBestNumNew || iNumLive < iBestNumLive || fDistance < fBestDistance)
+                    {
+                        iAddTriangle = iTriangle;
+                        iBestNumNew = iNumNew;
+                        iBestNumLive = iNumLive;
+                        fBestDistance = fDistance;
+                    }
+                }
+            }
+        }
+
+        finishCluster(
+            aClusters,
+            aiClusteredIndices,
+            aiClusterTriangles,
+            aiTriangleIndices,
+            pfPositions,
+            iPositionStride,
+            iMesh,
+            iFirstIndex);
+
+        // next cluster starts on the border of this one to stay spatially coherent, in its most enclosed corner
+        iSeedTriangle = UINT32_MAX;
+        uint32_t iSeedNumLive = UINT32_MAX;
+        for(uint32_t iVertex : aiClusterVertices)
+        {
+            if(aiNumLiveTriangles[iVertex] == 0)
+            {
+                continue;
+            }
+
+            for(uint32_t j = aiVertexTriangleStart[iVertex]; j < aiVertexTriangleStart[iVertex + 1]; j++)
+            {
+                uint32_t iTriangle = aiVertexTriangles[j];
+                if(!abEmitted[iTriangle] && getNumLiveTriangles(iTriangle) < iSeedNumLive)
+                {
+                    iSeedTriangle = iTriangle;
+                    iSeedNumLive = getNumLiveTriangles(iTriangle);
+                }
+            }
+        }
+
+        iCluster += 1;
+    }
+
+    assert(aiClusteredIndices.size() == aiTriangleIndices.size());
+    aiTriangleIndices.swap(aiClusteredIndices);
+}
+
+/*
+** bounds and normal cone of the cluster, its triangles are appended to aiClusteredIndices
+*/
+void CMeshClusterBuilder::finishCluster(
+    std::vector<MeshCluster>& aClusters,
+    std::vector<uint32_t>& aiClusteredIndices,
+    std::vector<uint32_t> const& aiClusterTriangles,
+    std::vector<uint32_t> const& aiTriangleIndices,
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iMesh,
+    uint32_t iFirstIndex)
+{
+    MeshCluster cluster = {};
+    cluster.miMesh = iMesh;
+    cluster.miFirstIndex = iFirstIndex + (uint32_t)aiClusteredIndices.size();
+    cluster.miNumIndices = (uint32_t)aiClusterTriangles.size() * 3;
+
+    float3 minPosition(FLT_MAX, FLT_MAX, FLT_MAX);
+    float3 maxPosition(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    std::vector<float3> aTriangleNormals;
+    aTriangleNormals.reserve(aiClusterTriangles.size());
+    float3 normalSum(0.0f, 0.0f, 0.0f);
+    for(uint32_t iTriangle : aiClusterTriangles)
+    {
+        float3 aPositions[3];
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            uint32_t iVertex = aiTriangleIndices[iTriangle * 3 + i];
+            aiClusteredIndices.push_back(iVertex);
+
+            aPositions[i] = getPosition(pfPositions, iPositionStride, iVertex);
+            minPosition = fminf(minPosition, aPositions[i]);
+            maxPosition = fmaxf(maxPosition, aPositions[i]);
+        }
+
+        // degenerate triangles don't constrain the cone
+        float3 normal = cross(aPositions[1] - aPositions[0], aPositions[2] - aPositions[0]);
+        float fLength = length(normal);
+        if(fLength > 0.0f)
+        {
+            aTriangleNormals.push_back(normal / fLength);
+            normalSum = normalSum + aTriangleNormals.back();
+        }
+    }
+
+    float3 center = (minPosition + maxPosition) * 0.5f;
+    float fRadiusSquared = 0.0f;
+    for(uint32_t i = cluster.miFirstIndex - iFirstIndex; i < (uint32_t)aiClusteredIndices.size(); i++)
+    {
+        fRadiusSquared = std::max(fRadiusSquared, lengthSquared(getPosition(pfPositions, iPositionStride, aiClusteredIndices[i]) - center));
+    }
+
+    cluster.mBoundingSphere = float4(center, sqrtf(fRadiusSquared));
+    cluster.mMinPosition = float4(minPosition, 1.0f);
+    cluster.mMaxPosition = float4(maxPosition, 1.0f);
+
+    // cutoff is the sine of the widest angle to the axis, cones close to or wider than a hemisphere are left unculled
+    cluster.mNormalCone = float4(0.0f, 0.0f, 1.0f, 1.0f);
+    float fAxisLength = length(normalSum);
+    if(fAxisLength > 0.0f)
+    {
+        float3 axis = normalSum / fAxisLength;
+        float fMinDP = 1.0f;
+        for(auto const& normal : aTriangleNormals)
+        {
+            fMinDP = std::min(fMinDP, dot(axis, normal));
+        }
+
+        if(fMinDP > 0.1f)
+        {
+            cluster.mNormalCone = float4(axis, sqrtf(std::max(1.0f - fMinDP * fMinDP, 0.0f)));
+        }
+    }
+
+    aClusters.push_back(cluster);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <math/vec.h>
+
+/*
+** one meshlet, layout matches MeshCluster in mesh-culling-compute.shader
+*/
+struct MeshCluster
+{
+    float4              mBoundingSphere;                // center in xyz, radius in w
+    float4              mMinPosition;
+    float4              mMaxPosition;
+    float4              mNormalCone;                    // axis in xyz, cutoff in w, a cutoff of 1 never culls
+
+    uint32_t            miMesh;
+    uint32_t            miFirstIndex;                   // into the whole index buffer
+    uint32_t            miNumIndices;
+    uint32_t            miPadding;
+};
+
+/*
+** greedy meshlet builder, grows each cluster through triangles sharing its vertices so the clusters stay compact
+*/
+class CMeshClusterBuilder
+{
+public:
+    CMeshClusterBuilder() = default;
+    virtual ~CMeshClusterBuilder() = default;
+
+    void setLimits(uint32_t iMaxVertices, uint32_t iMaxTriangles);
+
+    // reorders aiTriangleIndices so every cluster's triangles are contiguous, clusters are appended to aClusters
+    void build(
+        std::vector<MeshCluster>& aClusters,
+        std::vector<uint32_t>& aiTriangleIndices,
+        float const* pfPositions,
+        uint32_t iPositionStride,
+        uint32_t iMesh,
+        uint32_t iFirstIndex);
+
+protected:
+    void finishCluster(
+        std::vector<MeshCluster>& aClusters,
+        std::vector<uint32_t>& aiClusteredIndices,
+        std::vector<uint32_t> const& aiClusterTriangles,
+        std::vector<uint32_t> const& aiTriangleIndices,
+        float const* pfPositions,
+        uint32_t iPositionStride,
+        uint32_t iMesh,
+        uint32_t iFirstIndex);
+
+protected:
+    uint32_t                        miMaxVertices = 64;
+    uint32_t                        miMaxTriangles = 124;
+};
@@ -0,0 +1,421 @@
+#include "mesh_instance.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+/*
+**
+*/
+static float const* getAttribute(
+    float const* pfAttributes,
+    uint32_t iVertexStride,
+    uint32_t iVertex)
+{
+    return (float const*)((char const*)pfAttributes + (uint64_t)iVertex * iVertexStride);
+}
+
+/*
+**
+*/
+static uint64_t mixHash(uint64_t iHash, uint64_t iValue)
+{
+    iHash ^= iValue + 0x9e3779b97f4a7c15ull + (iHash << 6) + (iHash >> 2);
+    iHash = (iHash ^ (iHash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    iHash = (iHash ^ (iHash >> 27)) * 0x94d049bb133111ebull;
+    return iHash ^ (iHash >> 31);
+}
+
+/*
+** cyclic jacobi rotations, the eigenvectors end up in the columns of aafEigenVectors
+*/
+static void solveSymmetricEigen(
+    double aafMatrix[4][4],
+    double aafEigenVectors[4][4])
+{
+    for(uint32_t iRow = 0; iRow < 4; iRow++)
+    {
+        for(uint32_t iColumn = 0; iColumn < 4; iColumn++)
+        {
+            aafEigenVectors[iRow][iColumn] = (iRow == iColumn) ? 1.0 : 0.0;
+        }
+    }
+
+    for(uint32_t iSweep = 0; iSweep < 32; iSweep++)
+    {
+        double fOffDiagonal = 0.0;
+        for(uint32_t iRow = 0; iRow < 4; iRow++)
+        {
+            for(uint32_t iColumn = iRow + 1; iColumn < 4; iColumn++)
+            {
+                fOffDiagonal += aafMatrix[iRow][iColumn] * aafMatrix[iRow][iColumn];
+            }
+        }
+        if(fOffDiagonal < 1.0e-30)
+        {
+            break;
+        }
+
+        for(uint32_t iP = 0; iP < 4; iP++)
+        {
+            for(uint32_t iQ = iP + 1; iQ < 4; iQ++)
+            {
+                if(fabs(aafMatrix[iP][iQ]) < 1.0e-300)
+                {
+                    continue;
+                }
+
+                // rotation that zeroes the (p, q) element
+                double fTheta = (aafMatrix[iQ][iQ] - aafMatrix[iP][iP]) / (2.0 * aafMatrix[iP][iQ]);
+                double fT = ((fTheta >= 0.0) ? 1.0 : -1.0) / (fabs(fTheta) + sqrt(fTheta * fTheta + 1.0));
+                double fCos = 1.0 / sqrt(fT * fT + 1.0);
+                double fSin = fT * fCos;
+
+                for(uint32_t iK = 0; iK < 4; iK++)
+                {
+                    double fKP = aafMatrix[iK][iP];
+                    double fKQ = aafMatrix[iK][iQ];
+                    aafMatrix[iK][iP] = fCos * fKP - fSin * fKQ;
+                    aafMatrix[iK][iQ] = fSin * fKP + fCos * fKQ;
+                }
+                for(uint32_t iK = 0; iK < 4; iK++)
+                {
+                    double fPK = aafMatrix[iP][iK];
+                    double fQK = aafMatrix[iQ][iK];
+                    aafMatrix[iP][iK] = fCos * fPK - fSin * fQK;
+                    aafMatrix[iQ][iK] = fSin * fPK + fCos * fQK;
+                }
+                for(uint32_t iK = 0; iK < 4; iK++)
+                {
+                    double fKP = aafEigenVectors[iK][iP];
+                    double fKQ = aafEigenVectors[iK][iQ];
+                    aafEigenVectors[iK][iP] = fCos * fKP - fSin * fKQ;
+                    aafEigenVectors[iK][iQ] = fSin * fKP + fCos * fKQ;
+                }
+            }
+        }
+    }
+}
+
+/*
+**
+*/
+void CMeshInstanceFinder::setTolerance(float fPositionTolerance, float fNormalTolerance, float fUVTolerance)
+{
+    mfPositionTolerance = fPositionTolerance;
+    mfNormalTolerance = fNormalTolerance;
+    mfUVTolerance = fUVTolerance;
+}
+
+/*
+**
+*/
+void CMeshInstanceFinder::find(
+    std::vector<MeshInstance>& aInstances,
+    std::vector<std::vector<uint32_t>> const& aaiTriangleIndices,
+    float const* pfPositions,
+    float const* pfNormals,
+    float const* pfUVs,
+    uint32_t iVertexStride)
+{
+    uint32_t iNumMeshes = (uint32_t)aaiTriangleIndices.size();
+    aInstances.resize(iNumMeshes);
+
+    std::vector<Signature> aSignatures(iNumMeshes);
+    for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+    {
+        buildSignature(
+            aSignatures[iMesh],
+            aaiTriangleIndices[iMesh],
+            pfPositions,
+            pfUVs,
+            iVertexStride);
+    }
+
+    // first mesh of each geometry, by hash
+    std::unordered_map<uint64_t, std::vector<uint32_t>> aGeometryMeshes;
+    for(uint32_t iMesh = 0; iMesh < iNumMeshes; iMesh++)
+    {
+        MeshInstance& instance = aInstances[iMesh];
+        instance.maTransform[0] = float4(1.0f, 0.0f, 0.0f, 0.0f);
+        instance.maTransform[1] = float4(0.0f, 1.0f, 0.0f, 0.0f);
+        instance.maTransform[2] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+        instance.miMesh = iMesh;
+        instance.miGeometryMesh = iMesh;
+        instance.miPadding0 = 0;
+        instance.miPadding1 = 0;
+
+        Signature const& signature = aSignatures[iMesh];
+        if(signature.maiLocalIndices.size() == 0)
+        {
+            continue;
+        }
+
+        std::vector<uint32_t>& aiCandidates = aGeometryMeshes[signature.miHash];
+        bool bFound = false;
+        for(uint32_t iGeometryMesh : aiCandidates)
+        {
+            Signature const& geometry = aSignatures[iGeometryMesh];
+
+            // hashes can collide, the triangles have to be the same before solving
+            if(geometry.maiVertices.size() != signature.maiVertices.size() ||
+               geometry.maiLocalIndices != signature.maiLocalIndices)
+            {
+                continue;
+            }
+
+            if(solveTransform(
+                instance.maTransform,
+                geometry,
+                signature,
+                pfPositions,
+                pfNormals,
+                pfUVs,
+                iVertexStride))
+            {
+                instance.miGeometryMesh = iGeometryMesh;
+                bFound = true;
+                break;
+            }
+        }
+
+        if(!bFound)
+        {
+            instance.maTransform[0] = float4(1.0f, 0.0f, 0.0f, 0.0f);
+            instance.maTransform[1] = float4(0.0f, 1.0f, 0.0f, 0.0f);
+            instance.maTransform[2] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+            aiCandidates.push_back(iMesh);
+        }
+    }
+}
+
+/*
+** vertices are numbered in the order the triangles use them, so copies written out the same way get the same local triangle list
+*/
+void CMeshInstanceFinder::buildSignature(
+    Signature& signature,
+    std::vector<uint32_t> const& aiTriangleIndices,
+    float const* pfPositions,
+    float const* pfUVs,
+    uint32_t iVertexStride)
+{
+    std::unordered_map<uint32_t, uint32_t> aLocalVertices;
+    aLocalVertices.reserve(aiTriangleIndices.size());
+    signature.maiLocalIndices.resize(aiTriangleIndices.size());
+    for(uint32_t i = 0; i < (uint32_t)aiTriangleIndices.size(); i++)
+    {
+        auto iter = aLocalVertices.find(aiTriangleIndices[i]);
+        if(iter == aLocalVertices.end())
+        {
+            iter = aLocalVertices.emplace(aiTriangleIndices[i], (uint32_t)signature.maiVertices.size()).first;
+            signature.maiVertices.push_back(aiTriangleIndices[i]);
+        }
+        signature.maiLocalIndices[i] = iter->second;
+    }
+
+    uint32_t iNumVertices = (uint32_t)signature.maiVertices.size();
+    if(iNumVertices == 0)
+    {
+        return;
+    }
+
+    double afCentroid[3] = {0.0, 0.0, 0.0};
+    for(uint32_t iVertex : signature.maiVertices)
+    {
+        float const* pfPosition = getAttribute(pfPositions, iVertexStride, iVertex);
+        afCentroid[0] += pfPosition[0];
+        afCentroid[1] += pfPosition[1];
+        afCentroid[2] += pfPosition[2];
+    }
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        signature.mafCentroid[i] = afCentroid[i] / (double)iNumVertices;
+    }
+
+    double fSumDistanceSquared = 0.0;
+    for(uint32_t iVertex : signature.maiVertices)
+    {
+        float const* pfPosition = getAttribute(pfPositions, iVertexStride, iVertex);
+        double fX = pfPosition[0] - signature.mafCentroid[0];
+        double fY = pfPosition[1] - signature.mafCentroid[1];
+        double fZ = pfPosition[2] - signature.mafCentroid[2];
+        fSumDistanceSquared += fX * fX + fY * fY + fZ * fZ;
+    }
+    signature.mfRadius = sqrt(fSumDistanceSquared / (double)iNumVertices);
+
+    uint64_t iHash = mixHash(0, aiTriangleIndices.size());
+    iHash = mixHash(iHash, iNumVertices);
+    for(uint32_t iLocalIndex : signature.maiLocalIndices)
+    {
+        iHash = mixHash(iHash, iLocalIndex);
+    }
+
+    // copies keep their uvs, rounding only has to absorb the weld's quantization
+    double fInvUVStep = 1.0 / (double)(mfUVTolerance * 16.0f);
+    for(uint32_t iVertex : signature.maiVertices)
+    {
+        float const* pfUV = getAttribute(pfUVs, iVertexStride, iVertex);
+        iHash = mixHash(iHash, (uint64_t)(int64_t)floor(pfUV[0] * fInvUVStep));
+        iHash = mixHash(iHash, (uint64_t)(int64_t)floor(pfUV[1] * fInvUVStep));
+    }
+
+    // 1/32 of an octave, far coarser than a rotation's rounding error
+    int64_t iRadiusBucket = (signature.mfRadius > 0.0) ? (int64_t)floor(log2(signature.mfRadius) * 32.0) : INT64_MIN;
+    signature.miHash = mixHash(iHash, (uint64_t)iRadiusBucket);
+}
+
+/*
+** closed form rotation from the largest eigenvector of the 4x4 matrix built from the cross covariance (horn's method)
+** fails if any vertex ends up further than the tolerance from its copy
+*/
+bool CMeshInstanceFinder::solveTransform(
+    float4* pTransform,
+    Signature const& geometry,
+    Signature const& instance,
+    float const* pfPositions,
+    float const* pfNormals,
+    float const* pfUVs,
+    uint32_t iVertexStride)
+{
+    uint32_t iNumVertices = (uint32_t)geometry.maiVertices.size();
+    assert(iNumVertices == (uint32_t)instance.maiVertices.size());
+
+    if(fabs(geometry.mfRadius - instance.mfRadius) > geometry.mfRadius * (double)mfPositionTolerance * 4.0 + 1.0e-12)
+    {
+        return false;
+    }
+
+    double aafCovariance[3][3] = {};
+    for(uint32_t i = 0; i < iNumVertices; i++)
+    {
+        float const* pfGeometryPosition = getAttribute(pfPositions, iVertexStride, geometry.maiVertices[i]);
+        float const* pfInstancePosition = getAttribute(pfPositions, iVertexStride, instance.maiVertices[i]);
+
+        double afP[3], afQ[3];
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            afP[j] = pfGeometryPosition[j] - geometry.mafCentroid[j];
+            afQ[j] = pfInstancePosition[j] - instance.mafCentroid[j];
+        }
+        for(uint32_t iRow = 0; iRow < 3; iRow++)
+        {
+            for(uint32_t iColumn = 0; iColumn < 3; iColumn++)
+            {
+                aafCovariance[iRow][iColumn] += afP[iRow] * afQ[iColumn];
+            }
+        }
+    }
+
+    double fXX = aafCovariance[0][0], fXY = aafCovariance[0][1], fXZ = aafCovariance[0][2];
+    double fYX = aafCovariance[1][0], fYY = aafCovariance[1][1], fYZ = aafCovariance[1][2];
+    double fZX = aafCovariance[2][0], fZY = aafCovariance[2][1], fZZ = aafCovariance[2][2];
+    double aafMatrix[4][4] =
+    {
+        {fXX + fYY + fZZ,   fYZ - fZY,          fZX - fXZ,          fXY - fYX},
+        {fYZ - fZY,         fXX - fYY - fZZ,    fXY + fYX,          fZX + fXZ},
+        {fZX - fXZ,         fXY + fYX,          -fXX + fYY - fZZ,   fYZ + fZY},
+        {fXY - fYX,         fZX + fXZ,          fYZ + fZY,          -fXX - fYY + fZZ},
+    };
+
+    double aafEigenVectors[4][4];
+    solveSymmetricEigen(aafMatrix, aafEigenVectors);
+
+    uint32_t iLargest = 0;
+    for(uint32_t i = 1; i < 4; i++)
+    {
+        if(aafMatrix[i][i] > aafMatrix[iLargest][iLargest])
+        {
+            iLargest = i;
+        }
+    }
+
+    double fW = aafEigenVectors[0][iLargest];
+    double fX = aafEigenVectors[1][iLargest];
+    double fY = aafEigenVectors[2][iLargest];
+    double fZ = aafEigenVectors[3][iLargest];
+    double fLength = sqrt(fW * fW + fX * fX + fY * fY + fZ * fZ);
+    if(fLength <= 0.0)
+    {
+        return false;
+    }
+    fW /= fLength; fX /= fLength; fY /= fLength; fZ /= fLength;
+
+    double aafRotation[3][3] =
+    {
+        {1.0 - 2.0 * (fY * fY + fZ * fZ),   2.0 * (fX * fY - fW * fZ),          2.0 * (fX * fZ + fW * fY)},
+        {2.0 * (fX * fY + fW * fZ),         1.0 - 2.0 * (fX * fX + fZ * fZ),    2.0 * (fY * fZ - fW * fX)},
+        {2.0 * (fX * fZ - fW * fY),         2.0 * (fY * fZ + fW * fX),          1.0 - 2.0 * (fX * fX + fY * fY)},
+    };
+
+    double afTranslation[3];
+    for(uint32_t iRow = 0; iRow < 3; iRow++)
+    {
+        afTranslation[iRow] = instance.mafCentroid[iRow] -
+            (aafRotation[iRow][0] * geometry.mafCentroid[0] +
+             aafRotation[iRow][1] * geometry.mafCentroid[1] +
+             aafRotation[iRow][2] * geometry.mafCentroid[2]);
+    }
+
+    // relative to the mesh's size, plus what float positions far from the origin can hold
+    double fMagnitude = std::max(
+        fabs(instance.mafCentroid[0]) + fabs(instance.mafCentroid[1]) + fabs(instance.mafCentroid[2]),
+        fabs(geometry.mafCentroid[0]) + fabs(geometry.mafCentroid[1]) + fabs(geometry.mafCentroid[2]));
+    double fPositionTolerance = (double)mfPositionTolerance * geometry.mfRadius * 2.0 + fMagnitude * 8.0 * (double)FLT_EPSILON;
+    double fPositionToleranceSquared = fPositionTolerance * fPositionTolerance;
+    double fNormalToleranceSquared = (double)mfNormalTolerance * (double)mfNormalTolerance;
+
+    for(uint32_t i = 0; i < iNumVertices; i++)
+    {
+        uint32_t iGeometryVertex = geometry.maiVertices[i];
+        uint32_t iInstanceVertex = instance.maiVertices[i];
+
+        float const* pfGeometryUV = getAttribute(pfUVs, iVertexStride, iGeometryVertex);
+        float const* pfInstanceUV = getAttribute(pfUVs, iVertexStride, iInstanceVertex);
+        if(fabsf(pfGeometryUV[0] - pfInstanceUV[0]) > mfUVTolerance || fabsf(pfGeometryUV[1] - pfInstanceUV[1]) > mfUVTolerance)
+        {
+            return false;
+        }
+
+        float const* pfGeometryPosition = getAttribute(pfPositions, iVertexStride, iGeometryVertex);
+        float const* pfInstancePosition = getAttribute(pfPositions, iVertexStride, iInstanceVertex);
+        float const* pfGeometryNormal = getAttribute(pfNormals, iVertexStride, iGeometryVertex);
+        float const* pfInstanceNormal = getAttribute(pfNormals, iVertexStride, iInstanceVertex);
+
+        double fPositionDistanceSquared = 0.0;
+        double fNormalDistanceSquared = 0.0;
+        for(uint32_t iRow = 0; iRow < 3; iRow++)
+        {
+            double fPosition =
+                aafRotation[iRow][0] * pfGeometryPosition[0] +
+                aafRotation[iRow][1] * pfGeometryPosition[1] +
+                aafRotation[iRow][2] * pfGeometryPosition[2] +
+                afTranslation[iRow];
+            double fNormal =
+                aafRotation[iRow][0] * pfGeometryNormal[0] +
+                aafRotation[iRow][1] * pfGeometryNormal[1] +
+                aafRotation[iRow][2] * pfGeometryNormal[2];
+
+            fPositionDistanceSquared += (fPosition - pfInstancePosition[iRow]) * (fPosition - pfInstancePosition[iRow]);
+            fNormalDistanceSquared += (fNormal - pfInstanceNormal[iRow]) * (fNormal - pfInstanceNormal[iRow]);
+        }
+
+        if(fPositionDistanceSquared > fPositionToleranceSquared || fNormalDistanceSquared > fNormalToleranceSquared)
+        {
+            return false;
+        }
+    }
+
+    for(uint32_t iRow = 0; iRow < 3; iRow++)
+    {
+        pTransform[iRow] = float4(
+            (float)aafRotation[iRow][0],
+            (float)aafRotation[iRow][1],
+            (float)aafRotation[iRow][2],
+            (float)afTranslation[iRow]);
+    }
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <math/vec.h>
+
+/*
+** one entry per mesh in "-mesh-instances.bin", a mesh is drawn with the triangles of miGeometryMesh moved by the transform
+** unique meshes and the first mesh of each repeated geometry point at themselves with the identity
+*/
+struct MeshInstance
+{
+    float4              maTransform[3];                 // rows of the rotation, translation in w
+    uint32_t            miMesh;
+    uint32_t            miGeometryMesh;
+    uint32_t            miPadding0;
+    uint32_t            miPadding1;
+};
+
+/*
+** finds meshes that are rigidly moved copies of an earlier mesh
+**    candidates are grouped by a hash of what a rotation and translation don't change: the triangle list in first use order, the uvs and the spread of the positions
+**    the transform between a candidate and the first mesh of its group is solved from the matching vertices and every vertex is checked against it
+*/
+class CMeshInstanceFinder
+{
+public:
+    CMeshInstanceFinder() = default;
+    virtual ~CMeshInstanceFinder() = default;
+
+    // position tolerance is a fraction of the mesh's diagonal
+    void setTolerance(float fPositionTolerance, float fNormalTolerance, float fUVTolerance);
+
+    // aInstances gets one entry per mesh, vertices of different meshes are expected not to be shared
+    void find(
+        std::vector<MeshInstance>& aInstances,
+        std::vector<std::vector<uint32_t>> const& aaiTriangleIndices,
+        float const* pfPositions,
+        float const* pfNormals,
+        float const* pfUVs,
+        uint32_t iVertexStride);
+
+protected:
+    struct Signature
+    {
+        uint64_t                    miHash = 0;
+        std::vector<uint32_t>       maiVertices;        // global vertex index in first use order
+        std::vector<uint32_t>       maiLocalIndices;    // triangle list into maiVertices
+        double                      mfRadius = 0.0;     // root mean square distance from the centroid
+        double                      mafCentroid[3] = {0.0, 0.0, 0.0};
+    };
+
+    void buildSignature(
+        Signature& signature,
+        std::vector<uint32_t> const& aiTriangleIndices,
+        float const* pfPositions,
+        float const* pfUVs,
+        uint32_t iVertexStride);
+
+    bool solveTransform(
+        float4* pTransform,
+        Signature const& geometry,
+        Signature const& instance,
+        float const* pfPositions,
+        float const* pfNormals,
+        float const* pfUVs,
+        uint32_t iVertexStride);
+
+protected:
+    float                           mfPositionTolerance = 1.0e-4f;
+    float                           mfNormalTolerance = 1.0e-2f;
+    float                           mfUVTolerance = 1.0e-4f;
+};
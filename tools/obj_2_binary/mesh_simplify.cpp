@@ -0,0 +1,507 @@
+#include "mesh_simplify.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include <math/vec.h>
+
+// border planes are weighted by the edge length squared times this, keeps open borders from drifting
+constexpr double kfBorderWeight = 10.0;
+
+/*
+**
+*/
+static float3 getPosition(
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iVertex)
+{
+    float const* pfPosition = (float const*)((char const*)pfPositions + (uint64_t)iVertex * iPositionStride);
+    return float3(pfPosition[0], pfPosition[1], pfPosition[2]);
+}
+
+/*
+**
+*/
+void CMeshSimplifier::Quadric::addPlane(double fA, double fB, double fC, double fD, double fWeight)
+{
+    mfA2 += fWeight * fA * fA; mfAB += fWeight * fA * fB; mfAC += fWeight * fA * fC; mfAD += fWeight * fA * fD;
+    mfB2 += fWeight * fB * fB; mfBC += fWeight * fB * fC; mfBD += fWeight * fB * fD;
+    mfC2 += fWeight * fC * fC; mfCD += fWeight * fC * fD;
+    mfD2 += fWeight * fD * fD;
+    mfWeight += fWeight;
+}
+
+/*
+**
+*/
+void CMeshSimplifier::Quadric::add(Quadric const& quadric)
+{
+    mfA2 += quadric.mfA2; mfAB += quadric.mfAB; mfAC += quadric.mfAC; mfAD += quadric.mfAD;
+    mfB2 += quadric.mfB2; mfBC += quadric.mfBC; mfBD += quadric.mfBD;
+    mfC2 += quadric.mfC2; mfCD += quadric.mfCD;
+    mfD2 += quadric.mfD2;
+    mfWeight += quadric.mfWeight;
+}
+
+/*
+** weighted sum of squared distances to the planes
+*/
+double CMeshSimplifier::Quadric::evaluate(double fX, double fY, double fZ) const
+{
+    double fValue =
+        mfA2 * fX * fX + mfB2 * fY * fY + mfC2 * fZ * fZ +
+        2.0 * (mfAB * fX * fY + mfAC * fX * fZ + mfBC * fY * fZ) +
+        2.0 * (mfAD * fX + mfBD * fY + mfCD * fZ) +
+        mfD2;
+
+    return std::max(fValue, 0.0);
+}
+
+/*
+** collapses are picked in passes, cheapest first, each one locks its neighborhood until the next pass so the flip checks
+** stay valid without updating the adjacency
+*/
+float CMeshSimplifier::simplify(
+    std::vector<uint32_t>& aiSimplifiedIndices,
+    std::vector<uint32_t> const& aiTriangleIndices,
+    float const* pfPositions,
+    uint32_t iPositionStride,
+    uint32_t iTargetNumIndices,
+    float fMaxError)
+{
+    assert(aiTriangleIndices.size() % 3 == 0);
+    aiSimplifiedIndices = aiTriangleIndices;
+    if((uint32_t)aiTriangleIndices.size() <= iTargetNumIndices)
+    {
+        return 0.0f;
+    }
+
+    // local vertex indices
+    std::vector<uint32_t> aiVertices(aiTriangleIndices);
+    std::sort(aiVertices.begin(), aiVertices.end());
+    aiVertices.erase(std::unique(aiVertices.begin(), aiVertices.end()), aiVertices.end());
+    uint32_t iNumVertices = (uint32_t)aiVertices.size();
+
+    std::vector<uint32_t> aiIndices(aiTriangleIndices.size());
+    for(uint32_t i = 0; i < (uint32_t)aiTriangleIndices.size(); i++)
+    {
+        aiIndices[i] = (uint32_t)(std::lower_bound(aiVertices.begin(), aiVertices.end(), aiTriangleIndices[i]) - aiVertices.begin());
+    }
+
+    std::vector<float3> aPositions(iNumVertices);
+    for(uint32_t iVertex = 0; iVertex < iNumVertices; iVertex++)
+    {
+        aPositions[iVertex] = getPosition(pfPositions, iPositionStride, aiVertices[iVertex]);
+    }
+
+    // vertices at the same position are wedges of one position, they only differ in normal or uv
+    std::vector<uint32_t> aiSortedVertices(iNumVertices);
+    for(uint32_t i = 0; i < iNumVertices; i++)
+    {
+        aiSortedVertices[i] = i;
+    }
+    auto positionLess = [&](uint32_t iLeft, uint32_t iRight)
+    {
+        float3 const& left = aPositions[iLeft];
+        float3 const& right = aPositions[iRight];
+        if(left.x != right.x) return left.x < right.x;
+        if(left.y != right.y) return left.y < right.y;
+        return left.z < right.z;
+    };
+    std::sort(aiSortedVertices.begin(), aiSortedVertices.end(), positionLess);
+
+    std::vector<uint32_t> aiPositionIDs(iNumVertices);
+    std::vector<uint32_t> aiWedgeStart(1, 0);
+    std::vector<uint32_t> aiWedges(iNumVertices);
+    uint32_t iNumPositions = 0;
+    for(uint32_t i = 0; i < iNumVertices; i++)
+    {
+        if(i > 0 && positionLess(aiSortedVertices[i - 1], aiSortedVertices[i]))
+        {
+            aiWedgeStart.push_back(i);
+            iNumPositions += 1;
+        }
+        aiPositionIDs[aiSortedVertices[i]] = iNumPositions;
+        aiWedges[i] = aiSortedVertices[i];
+    }
+    iNumPositions += 1;
+    aiWedgeStart.push_back(iNumVertices);
+
+    auto getPositionID = [&](uint32_t iIndex)
+    {
+        return aiPositionIDs[aiIndices[iIndex]];
+    };
+
+    // triangles already degenerate in position can't be collapsed any further
+    uint32_t iNumValidIndices = 0;
+    for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i += 3)
+    {
+        if(getPositionID(i) == getPositionID(i + 1) || getPositionID(i) == getPositionID(i + 2) || getPositionID(i + 1) == getPositionID(i + 2))
+        {
+            continue;
+        }
+
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            aiIndices[iNumValidIndices + j] = aiIndices[i + j];
+        }
+        iNumValidIndices += 3;
+    }
+    aiIndices.resize(iNumValidIndices);
+
+    // undirected position edges, sorted so the triangles sharing an edge are next to each other
+    std::vector<uint64_t> aiEdges;
+    auto buildEdges = [&]()
+    {
+        aiEdges.clear();
+        for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i += 3)
+        {
+            for(uint32_t j = 0; j < 3; j++)
+            {
+                uint64_t iPosition0 = getPositionID(i + j);
+                uint64_t iPosition1 = getPositionID(i + (j + 1) % 3);
+                if(iPosition0 != iPosition1)
+                {
+                    aiEdges.push_back((std::min(iPosition0, iPosition1) << 32) | std::max(iPosition0, iPosition1));
+                }
+            }
+        }
+        std::sort(aiEdges.begin(), aiEdges.end());
+    };
+
+    auto isBorderEdge = [&](uint32_t iPosition0, uint32_t iPosition1)
+    {
+        uint64_t iKey = ((uint64_t)std::min(iPosition0, iPosition1) << 32) | std::max(iPosition0, iPosition1);
+        auto range = std::equal_range(aiEdges.begin(), aiEdges.end(), iKey);
+        return (range.second - range.first) == 1;
+    };
+
+    // plane of every triangle, weighted by its area, and planes perpendicular to the open borders
+    std::vector<Quadric> aQuadrics(iNumPositions);
+    buildEdges();
+    for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i += 3)
+    {
+        float3 position0 = aPositions[aiIndices[i]];
+        float3 position1 = aPositions[aiIndices[i + 1]];
+        float3 position2 = aPositions[aiIndices[i + 2]];
+        float3 normal = cross(position1 - position0, position2 - position0);
+        float fLength = length(normal);
+        if(fLength <= 0.0f)
+        {
+            continue;
+        }
+        normal = normal / fLength;
+
+        Quadric quadric;
+        quadric.addPlane(normal.x, normal.y, normal.z, -dot(normal, position0), fLength * 0.5f);
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            aQuadrics[getPositionID(i + j)].add(quadric);
+        }
+
+        float3 const aTrianglePositions[3] = {position0, position1, position2};
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            uint32_t iPosition0 = getPositionID(i + j);
+            uint32_t iPosition1 = getPositionID(i + (j + 1) % 3);
+            if(iPosition0 == iPosition1 || !isBorderEdge(iPosition0, iPosition1))
+            {
+                continue;
+            }
+
+            float3 edge = aTrianglePositions[(j + 1) % 3] - aTrianglePositions[j];
+            float3 borderNormal = cross(edge, normal);
+            float fBorderLength = length(borderNormal);
+            if(fBorderLength > 0.0f)
+            {
+                borderNormal = borderNormal / fBorderLength;
+
+                Quadric borderQuadric;
+                borderQuadric.addPlane(
+                    borderNormal.x,
+                    borderNormal.y,
+                    borderNormal.z,
+                    -dot(borderNormal, aTrianglePositions[j]),
+                    dot(edge, edge) * kfBorderWeight);
+                aQuadrics[iPosition0].add(borderQuadric);
+                aQuadrics[iPosition1].add(borderQuadric);
+            }
+        }
+    }
+
+    struct Collapse
+    {
+        float           mfError;
+        uint32_t        miFrom;
+        uint32_t        miTo;
+    };
+
+    uint8_t const kiBorder = 1;
+    uint8_t const kiLocked = 2;
+
+    std::vector<uint8_t> aiPositionFlags(iNumPositions);
+    std::vector<uint32_t> aiNumBorderEdges(iNumPositions);
+    std::vector<uint32_t> aiPositionTriangleStart(iNumPositions + 1);
+    std::vector<uint32_t> aiPositionTriangles;
+    std::vector<uint32_t> aiNumPositionTriangles(iNumPositions);
+    std::vector<uint8_t> abPassLocked(iNumPositions);
+    std::vector<uint32_t> aiRemap(iNumVertices);
+    std::vector<uint32_t> aiWedgeTargets(iNumVertices, UINT32_MAX);
+    std::vector<Collapse> aCollapses;
+
+    double fMaxErrorSquared = (double)fMaxError * (double)fMaxError;
+    double fLargestError = 0.0;
+    for(;;)
+    {
+        if((uint32_t)aiIndices.size() <= iTargetNumIndices)
+        {
+            break;
+        }
+
+        // triangles around each position
+        std::fill(aiPositionTriangleStart.begin(), aiPositionTriangleStart.end(), 0);
+        for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i++)
+        {
+            aiPositionTriangleStart[getPositionID(i) + 1] += 1;
+        }
+        for(uint32_t i = 0; i < iNumPositions; i++)
+        {
+            aiPositionTriangleStart[i + 1] += aiPositionTriangleStart[i];
+        }
+        aiPositionTriangles.resize(aiIndices.size());
+        std::fill(aiNumPositionTriangles.begin(), aiNumPositionTriangles.end(), 0);
+        for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i++)
+        {
+            uint32_t iPosition = getPositionID(i);
+            aiPositionTriangles[aiPositionTriangleStart[iPosition] + aiNumPositionTriangles[iPosition]] = i / 3;
+            aiNumPositionTriangles[iPosition] += 1;
+        }
+
+        // borders have one triangle on the edge, non-manifold edges lock their positions
+        buildEdges();
+        std::fill(aiPositionFlags.begin(), aiPositionFlags.end(), 0);
+        std::fill(aiNumBorderEdges.begin(), aiNumBorderEdges.end(), 0);
+        for(uint32_t iEdge = 0; iEdge < (uint32_t)aiEdges.size();)
+        {
+            uint32_t iEdgeEnd = iEdge + 1;
+            while(iEdgeEnd < (uint32_t)aiEdges.size() && aiEdges[iEdgeEnd] == aiEdges[iEdge])
+            {
+                iEdgeEnd += 1;
+            }
+
+            uint32_t iPosition0 = (uint32_t)(aiEdges[iEdge] >> 32);
+            uint32_t iPosition1 = (uint32_t)(aiEdges[iEdge] & 0xffffffff);
+            if(iEdgeEnd - iEdge == 1)
+            {
+                aiPositionFlags[iPosition0] |= kiBorder;
+                aiPositionFlags[iPosition1] |= kiBorder;
+                aiNumBorderEdges[iPosition0] += 1;
+                aiNumBorderEdges[iPosition1] += 1;
+            }
+            else if(iEdgeEnd - iEdge > 2)
+            {
+                aiPositionFlags[iPosition0] |= kiLocked;
+                aiPositionFlags[iPosition1] |= kiLocked;
+            }
+
+            iEdge = iEdgeEnd;
+        }
+
+        // corners where several borders meet stay
+        for(uint32_t iPosition = 0; iPosition < iNumPositions; iPosition++)
+        {
+            if((aiPositionFlags[iPosition] & kiBorder) && aiNumBorderEdges[iPosition] != 2)
+            {
+                aiPositionFlags[iPosition] |= kiLocked;
+            }
+        }
+
+        aCollapses.clear();
+        for(uint32_t iEdge = 0; iEdge < (uint32_t)aiEdges.size();)
+        {
+            uint32_t iEdgeEnd = iEdge + 1;
+            while(iEdgeEnd < (uint32_t)aiEdges.size() && aiEdges[iEdgeEnd] == aiEdges[iEdge])
+            {
+                iEdgeEnd += 1;
+            }
+
+            bool bBorderEdge = (iEdgeEnd - iEdge == 1);
+            uint32_t aiEdgePositions[2] = {(uint32_t)(aiEdges[iEdge] >> 32), (uint32_t)(aiEdges[iEdge] & 0xffffffff)};
+            for(uint32_t iDirection = 0; iDirection < 2; iDirection++)
+            {
+                uint32_t iFrom = aiEdgePositions[iDirection];
+                uint32_t iTo = aiEdgePositions[1 - iDirection];
+
+                // border positions only slide along the border
+                if((aiPositionFlags[iFrom] & kiLocked) || ((aiPositionFlags[iFrom] & kiBorder) && !bBorderEdge))
+                {
+                    continue;
+                }
+
+                Quadric quadric = aQuadrics[iFrom];
+                quadric.add(aQuadrics[iTo]);
+                float3 const& position = aPositions[aiWedges[aiWedgeStart[iTo]]];
+                double fError = quadric.evaluate(position.x, position.y, position.z) / std::max(quadric.mfWeight, 1.0e-30);
+                if(fError <= fMaxErrorSquared)
+                {
+                    aCollapses.push_back({(float)fError, iFrom, iTo});
+                }
+            }
+
+            iEdge = iEdgeEnd;
+        }
+
+        std::sort(
+            aCollapses.begin(),
+            aCollapses.end(),
+            [](Collapse const& left, Collapse const& right)
+            {
+                return left.mfError < right.mfError;
+            });
+
+        for(uint32_t i = 0; i < iNumVertices; i++)
+        {
+            aiRemap[i] = i;
+        }
+        std::fill(abPassLocked.begin(), abPassLocked.end(), 0);
+
+        uint32_t iNumRemovedIndices = 0;
+        uint32_t iNumCollapsed = 0;
+        for(Collapse const& collapse : aCollapses)
+        {
+            if((uint32_t)aiIndices.size() - iNumRemovedIndices <= iTargetNumIndices)
+            {
+                break;
+            }
+
+            uint32_t iFrom = collapse.miFrom;
+            uint32_t iTo = collapse.miTo;
+            if(abPassLocked[iFrom] || abPassLocked[iTo])
+            {
+                continue;
+            }
+
+            // every wedge has to land on the wedge of the target it shares an edge with, the remaining triangles can't flip
+            float3 const& toPosition = aPositions[aiWedges[aiWedgeStart[iTo]]];
+            bool bValid = true;
+            uint32_t iNumCollapsedTriangles = 0;
+            for(uint32_t j = aiPositionTriangleStart[iFrom]; j < aiPositionTriangleStart[iFrom + 1] && bValid; j++)
+            {
+                uint32_t iTriangle = aiPositionTriangles[j];
+                uint32_t iFromCorner = UINT32_MAX, iToCorner = UINT32_MAX;
+                for(uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t iPosition = getPositionID(iTriangle * 3 + k);
+                    iFromCorner = (iPosition == iFrom) ? k : iFromCorner;
+                    iToCorner = (iPosition == iTo) ? k : iToCorner;
+                }
+
+                if(iToCorner != UINT32_MAX)
+                {
+                    uint32_t iFromWedge = aiIndices[iTriangle * 3 + iFromCorner];
+                    if(aiWedgeTargets[iFromWedge] == UINT32_MAX)
+                    {
+                        aiWedgeTargets[iFromWedge] = aiIndices[iTriangle * 3 + iToCorner];
+                    }
+                    iNumCollapsedTriangles += 1;
+                    continue;
+                }
+
+                float3 aTrianglePositions[3];
+                for(uint32_t k = 0; k < 3; k++)
+                {
+                    aTrianglePositions[k] = aPositions[aiIndices[iTriangle * 3 + k]];
+                }
+                float3 normal = cross(aTrianglePositions[1] - aTrianglePositions[0], aTrianglePositions[2] - aTrianglePositions[0]);
+                aTrianglePositions[iFromCorner] = toPosition;
+                float3 collapsedNormal = cross(aTrianglePositions[1] - aTrianglePositions[0], aTrianglePositions[2] - aTrianglePositions[0]);
+                bValid = (dot(normal, collapsedNormal) > 0.25f * length(normal) * length(collapsedNormal));
+            }
+
+            for(uint32_t j = aiPositionTriangleStart[iFrom]; j < aiPositionTriangleStart[iFrom + 1] && bValid; j++)
+            {
+                uint32_t iTriangle = aiPositionTriangles[j];
+                for(uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t iVertex = aiIndices[iTriangle * 3 + k];
+                    if(aiPositionIDs[iVertex] == iFrom && aiWedgeTargets[iVertex] == UINT32_MAX)
+                    {
+                        bValid = false;
+                    }
+                }
+            }
+
+            if(bValid)
+            {
+                for(uint32_t j = aiWedgeStart[iFrom]; j < aiWedgeStart[iFrom + 1]; j++)
+                {
+                    uint32_t iWedge = aiWedges[j];
+                    if(aiWedgeTargets[iWedge] != UINT32_MAX)
+                    {
+                        aiRemap[iWedge] = aiWedgeTargets[iWedge];
+                    }
+                }
+
+                aQuadrics[iTo].add(aQuadrics[iFrom]);
+                fLargestError = std::max(fLargestError, (double)collapse.mfError);
+                iNumRemovedIndices += iNumCollapsedTriangles * 3;
+                iNumCollapsed += 1;
+
+                // neighborhoods of both ends keep their triangles until the next pass
+                for(uint32_t iPosition : {iFrom, iTo})
+                {
+                    for(uint32_t j = aiPositionTriangleStart[iPosition]; j < aiPositionTriangleStart[iPosition + 1]; j++)
+                    {
+                        uint32_t iTriangle = aiPositionTriangles[j];
+                        for(uint32_t k = 0; k < 3; k++)
+                        {
+                            abPassLocked[getPositionID(iTriangle * 3 + k)] = 1;
+                        }
+                    }
+                }
+            }
+
+            for(uint32_t j = aiWedgeStart[iFrom]; j < aiWedgeStart[iFrom + 1]; j++)
+            {
+                aiWedgeTargets[aiWedges[j]] = UINT32_MAX;
+            }
+        }
+
+        if(iNumCollapsed == 0)
+        {
+            break;
+        }
+
+        // collapsed triangles are the ones left with a repeated position
+        uint32_t iNumIndices = 0;
+        for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i += 3)
+        {
+            uint32_t iVertex0 = aiRemap[aiIndices[i]];
+            uint32_t iVertex1 = aiRemap[aiIndices[i + 1]];
+            uint32_t iVertex2 = aiRemap[aiIndices[i + 2]];
+            if(aiPositionIDs[iVertex0] == aiPositionIDs[iVertex1] ||
+               aiPositionIDs[iVertex0] == aiPositionIDs[iVertex2] ||
+               aiPositionIDs[iVertex1] == aiPositionIDs[iVertex2])
+            {
+                continue;
+            }
+
+            aiIndices[iNumIndices] = iVertex0;
+            aiIndices[iNumIndices + 1] = iVertex1;
+            aiIndices[iNumIndices + 2] = iVertex2;
+            iNumIndices += 3;
+        }
+        aiIndices.resize(iNumIndices);
+    }
+
+    aiSimplifiedIndices.resize(aiIndices.size());
+    for(uint32_t i = 0; i < (uint32_t)aiIndices.size(); i++)
+    {
+        aiSimplifiedIndices[i] = aiVertices[aiIndices[i]];
+    }
+
+    return (float)sqrt(fLargestError);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+** one simplified level of a mesh, its indices follow the base indices of all the meshes
+** levels of a mesh are consecutive and get coarser, layout matches MeshLOD in the renderer
+*/
+struct MeshLOD
+{
+    uint32_t            miMesh;
+    uint32_t            miFirstIndex;                   // into the whole index buffer
+    uint32_t            miNumIndices;
+    float               mfError;                        // distance from the full resolution surface, in mesh units
+};
+
+/*
+** quadric error metric edge collapse, vertices collapse onto one of their neighbors so the levels reuse the vertex buffer
+** vertices sharing a position (normal and uv seams) collapse together, open borders only collapse along themselves
+*/
+class CMeshSimplifier
+{
+public:
+    CMeshSimplifier() = default;
+    virtual ~CMeshSimplifier() = default;
+
+    // returns the largest error introduced, stops at the target index count or before exceeding fMaxError
+    float simplify(
+        std::vector<uint32_t>& aiSimplifiedIndices,
+        std::vector<uint32_t> const& aiTriangleIndices,
+        float const* pfPositions,
+        uint32_t iPositionStride,
+        uint32_t iTargetNumIndices,
+        float fMaxError);
+
+protected:
+    struct Quadric
+    {
+        double          mfA2 = 0.0, mfAB = 0.0, mfAC = 0.0, mfAD = 0.0;
+        double          mfB2 = 0.0, mfBC = 0.0, mfBD = 0.0;
+        double          mfC2 = 0.0, mfCD = 0.0;
+        double          mfD2 = 0.0;
+        double          mfWeight = 0.0;
+
+        void addPlane(double fA, double fB, double fC, double fD, double fWeight);
+        void add(Quadric const& quadric);
+        double evaluate(double fX, double fY, double fZ) const;
+    };
+};
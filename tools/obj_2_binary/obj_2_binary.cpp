@@ -8,10 +8,27 @@
 #include <mutex>
 #include <map>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <thread>
 
 #include <math/vec.h>
+#include <math/compact_vertex.h>
+#include <math/bvh.h>
 #include <utils/LogPrint.h>
+#include <loader/bundle.h>
+#include <loader/mesh_file.h>
+
+#include "vertex_weld.h"
+#include "mesh_cluster.h"
+#include "index_optimize.h"
+#include "mesh_simplify.h"
+#include "mesh_instance.h"
+#include "conversion_cache.h"
+#include "texture_atlas.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image/stb_image.h>
@@ -62,6 +79,8 @@ struct OBJMaterialInfo
     int32_t            miRoughnessTextureID = -1;
     int32_t            miMetallicTextureID = -1;
     int32_t            miNormalTextureID = -1;
+
+    bool                mbRandomDiffuse = false;
 };
 
 struct OutputMaterialInfo
@@ -95,13 +114,46 @@ struct MeshExtent
     vec4            mMaxPosition;
 };
 
+/*
+** everything one obj file adds, mesh ids and vertex indices are local to the file until it's merged
+*/
+struct ConvertedOBJ
+{
+    std::string                                         mBaseName;
+    uint32_t                                            miNumShapes = 0;
+
+    std::vector<Vertex>                                 maVertices;
+    std::vector<std::vector<uint32_t>>                  maaiTriangleVertexIndices;
+    std::vector<MeshExtent>                             maMeshExtents;
+    std::vector<float3>                                 maMeshCenters;
+    std::vector<float3>                                 maMeshBBoxes;
+    std::vector<std::string>                            maMeshNames;
+    std::vector<OBJMaterialInfo>                        maMeshMaterials;            // texture ids are assigned during the merge
+
+    float3                                              mMinPosition = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+    float3                                              mMaxPosition = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    double                                              mfParseMilliseconds = 0.0;
+    double                                              mfWeldMilliseconds = 0.0;
+    bool                                                mbFromCache = false;
+};
+
 
 void outputVerticesAndTriangles(
     std::vector<Vertex> const& aTotalVertices,
     std::vector<std::vector<uint32_t>> const& aaiTriangleVertexIndices,
     std::vector<MeshExtent> const& aMeshExtents,
+    std::vector<MeshCluster> const& aMeshClusters,
+    std::vector<MeshLOD> const& aMeshLODs,
+    std::vector<uint32_t> const& aiLODIndices,
+    std::vector<BVHNode> const& aMeshBVHNodes,
+    std::vector<uint32_t> const& aiMeshBVHPrimitives,
+    std::vector<BVHNode> const& aTriangleBVHNodes,
+    std::vector<uint32_t> const& aiTriangleBVHPrimitives,
     std::string const& directory,
-    std::string const& baseName);
+    std::string const& baseName,
+    bool bCompactVertices,
+    bool bSmallIndices);
 
 void outputTrianglePositionsAndTriangles(
     std::vector<float4> const& aTrianglePositions,
@@ -136,10 +188,177 @@ void outputMeshMaterialIDs(
 
 void convertNormalImages(std::string const& directory);
 
+void outputBundle(
+    std::vector<std::string> const& aDiffuseTextureNames,
+    std::vector<std::string> const& aAtlasFileNames,
+    std::string const& directory,
+    std::string const& baseName,
+    bool bCompress);
+
+void convertOBJ(
+    ConvertedOBJ& convertedOBJ,
+    std::string const& objFilePath,
+    std::string const& directory,
+    WeldTolerance const& weldTolerance);
+
+void writeConvertedOBJ(
+    std::vector<char>& acData,
+    ConvertedOBJ const& convertedOBJ);
+
+bool readConvertedOBJ(
+    ConvertedOBJ& convertedOBJ,
+    std::vector<char> const& acData);
+
 
 int main(int argc, char* argv[])
 {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
     std::string fullPath = argv[1];
+
+    // "-bundle" also packs the outputs and diffuse textures into "<name>.bundle", "-compress" deflates the sections that shrink
+    // "-weld-position <epsilon>", "-weld-normal <epsilon>" and "-weld-uv <epsilon>" set how close attributes have to be for vertices to be merged
+    // "-threads <count>" sets the number of obj files converted at the same time, defaults to the number of cores
+    // "-legacy-vertices" writes the 48 byte v1 vertices instead of the quantized 20 byte v2 ones
+    // "-cluster-vertices <count>" and "-cluster-triangles <count>" limit the size of the meshlets used for culling
+    // "-no-index-optimization" keeps the meshlets' triangles and the vertices in the order they were read
+    // "-vertex-cache-size <count>" sets the post-transform cache size the triangles are ordered and measured for
+    // "-lod-levels <count>" sets the number of simplified levels per mesh, each with about half the triangles of the one before
+    // "-lod-error <fraction>" limits how far a level can move from the full mesh, as a fraction of the mesh's diagonal
+    // "-triangle-bvh" also writes a bvh over the base triangles next to the one over the meshes
+    // "-32-bit-indices" keeps every mesh in the 32 bit index list instead of giving the ones spanning less than 65536 vertices 16 bit indices
+    // "-cache-directory <path>" sets where the per file conversion results are kept, "<directory>/obj-cache" by default, "-no-cache" converts every file
+    // "-no-instance-sharing" keeps the triangles and vertices of meshes found to be moved copies of another instead of drawing them from "-mesh-instances.bin"
+    // "-atlas-size <pixels>" sets the width and largest height of the "-diffuse-atlas.bin" pages, "-atlas-gutter <pixels>" the border repeated around each texture
+    // "-atlas-pages <count>" limits how many pages the textures can spill into, the ones that don't fit are left out
+    // "-no-atlas" leaves the diffuse pngs to be packed by the renderer at load time
+    // "-no-atlas-compression" only writes the uncompressed atlas, without the BC7 and ETC2 copies for devices that can sample them
+    // "-virtual-texture" cuts the atlas pages into tiles in "-diffuse-pages.bin" for the renderer to stream, "-atlas-pages" can then go past what fits in memory
+    bool bOutputBundle = false;
+    bool bCompactVertices = true;
+    uint32_t iMaxClusterVertices = 64;
+    uint32_t iMaxClusterTriangles = 124;
+    bool bOptimizeIndices = true;
+    uint32_t iVertexCacheSize = 16;
+    uint32_t iNumLODLevels = 3;
+    float fMaxLODError = 0.05f;
+    bool bShareInstanceGeometry = true;
+    bool bTriangleBVH = false;
+    bool bSmallIndices = true;
+    bool bUseCache = true;
+    std::string cacheDirectory = "";
+    bool bCompressBundle = false;
+    bool bBakeAtlas = true;
+    TextureAtlasSettings atlasSettings;
+    WeldTolerance weldTolerance;
+    uint32_t iNumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for(int32_t i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if(option == "-bundle")
+        {
+            bOutputBundle = true;
+        }
+        else if(option == "-compress")
+        {
+            bCompressBundle = true;
+        }
+        else if(option == "-weld-position" && i + 1 < argc)
+        {
+            weldTolerance.mfPosition = (float)atof(argv[++i]);
+        }
+        else if(option == "-weld-normal" && i + 1 < argc)
+        {
+            weldTolerance.mfNormal = (float)atof(argv[++i]);
+        }
+        else if(option == "-weld-uv" && i + 1 < argc)
+        {
+            weldTolerance.mfUV = (float)atof(argv[++i]);
+        }
+        else if(option == "-threads" && i + 1 < argc)
+        {
+            iNumThreads = std::max(atoi(argv[++i]), 1);
+        }
+        else if(option == "-legacy-vertices")
+        {
+            bCompactVertices = false;
+        }
+        else if(option == "-cluster-vertices" && i + 1 < argc)
+        {
+            iMaxClusterVertices = (uint32_t)std::max(atoi(argv[++i]), 3);
+        }
+        else if(option == "-cluster-triangles" && i + 1 < argc)
+        {
+            iMaxClusterTriangles = (uint32_t)std::max(atoi(argv[++i]), 1);
+        }
+        else if(option == "-no-index-optimization")
+        {
+            bOptimizeIndices = false;
+        }
+        else if(option == "-vertex-cache-size" && i + 1 < argc)
+        {
+            iVertexCacheSize = (uint32_t)std::max(atoi(argv[++i]), 3);
+        }
+        else if(option == "-lod-levels" && i + 1 < argc)
+        {
+            iNumLODLevels = (uint32_t)std::max(atoi(argv[++i]), 0);
+        }
+        else if(option == "-lod-error" && i + 1 < argc)
+        {
+            fMaxLODError = (float)atof(argv[++i]);
+        }
+        else if(option == "-no-instance-sharing")
+        {
+            bShareInstanceGeometry = false;
+        }
+        else if(option == "-triangle-bvh")
+        {
+            bTriangleBVH = true;
+        }
+        else if(option == "-32-bit-indices")
+        {
+            bSmallIndices = false;
+        }
+        else if(option == "-cache-directory" && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else if(option == "-no-cache")
+        {
+            bUseCache = false;
+        }
+        else if(option == "-atlas-size" && i + 1 < argc)
+        {
+            atlasSettings.miPageWidth = atlasSettings.miMaxPageHeight = (uint32_t)std::max(atoi(argv[++i]), 1);
+        }
+        else if(option == "-atlas-gutter" && i + 1 < argc)
+        {
+            atlasSettings.miGutter = (uint32_t)std::max(atoi(argv[++i]), 1);
+        }
+        else if(option == "-atlas-pages" && i + 1 < argc)
+        {
+            atlasSettings.miMaxPages = (uint32_t)std::max(atoi(argv[++i]), 1);
+        }
+        else if(option == "-no-atlas")
+        {
+            bBakeAtlas = false;
+        }
+        else if(option == "-no-atlas-compression")
+        {
+            atlasSettings.maCompressedFormats.clear();
+        }
+        else if(option == "-virtual-texture")
+        {
+            atlasSettings.mbVirtualTexture = true;
+        }
+    }
+
+    if(weldTolerance.mfPosition <= 0.0f || weldTolerance.mfNormal <= 0.0f || weldTolerance.mfUV <= 0.0f)
+    {
+        DEBUG_PRINTF("!!! weld tolerances have to be greater than zero !!!\n");
+        return 1;
+    }
+
     auto iter = fullPath.rfind("\\");
     if(iter == std::string::npos)
     {
@@ -165,25 +384,7 @@ int main(int argc, char* argv[])
         baseName = fileName.substr(0, extensionIter);
     }
     
-    auto encodeToMapString = [&](Vertex const& v, uint32_t iMeshIndex)
-        {
-            Vertex copy = v;
-            copy.mPosition.x *= 100.0f;
-            copy.mPosition.y *= 100.0f;
-            copy.mPosition.z *= 100.0f;
-
-            std::ostringstream oss;
-            oss << copy.mPosition.x << "_" << copy.mPosition.y << "_" << copy.mPosition.z << "_" <<
-                copy.mNormal.x << "_" << copy.mNormal.y << "_" << copy.mNormal.z << "_" <<
-                copy.mUV.x << "_" << copy.mUV.y << "_" << iMeshIndex;
-
-            return oss.str();
-        };
-
-    std::map<std::string, std::vector<uint32_t>> aMeshInstanceIndices;
-
     std::vector<Vertex> aTotalVertices;
-    std::map<std::string, uint32_t> aTotalVertexMap;
     std::vector<std::vector<uint32_t>> aaiTriangleVertexIndices;
     std::vector<MeshExtent> aMeshExtents;
     std::vector<float3> aMeshCenters;
@@ -209,402 +410,209 @@ int main(int argc, char* argv[])
     float3 totalMinPos = float3(FLT_MAX, FLT_MAX, FLT_MAX);
     float3 totalMaxPos = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-    float fZMult = 1.0f;
-
+    // sorted so mesh order and ids don't depend on the directory listing or on which file finishes first
+    std::vector<std::string> aOBJFilePaths;
     for(auto const& entry : std::filesystem::directory_iterator(directory))
     {
-        std::string path = entry.path().string().c_str();
-
-        std::string fileName = path.substr(iter + 1);
-        auto extensionIter = fileName.rfind(".obj");
-        if(extensionIter == std::string::npos)
+        if(entry.path().extension() == ".obj")
         {
-            continue;
+            aOBJFilePaths.push_back(entry.path().string());
         }
+    }
+    std::sort(aOBJFilePaths.begin(), aOBJFilePaths.end());
 
-        auto parseBaseName = [](std::string const& filePath)
-        {
-            auto baseNameStart = filePath.rfind("\\");
-            if(baseNameStart == std::string::npos)
-            {
-                baseNameStart = filePath.rfind("/");
-            }
-            if(baseNameStart == std::string::npos)
-            {
-                baseNameStart = 0;
-            }
-            else
-            {
-                baseNameStart += 1;
-            }
-            std::string baseName = filePath.substr(baseNameStart);
-
-            return baseName;
-        };
-
-        std::string baseName = fileName.substr(0, extensionIter);
-
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+    // unchanged files are read back from their cache entry instead, entries depend on the weld tolerances
+    CConversionCache conversionCache;
+    if(bUseCache)
+    {
+        std::vector<char> acCacheSettings;
+        CacheWriter settingsWriter = {acCacheSettings};
+        settingsWriter.write(weldTolerance);
+        settingsWriter.write((double)POSITION_MULT);
+        conversionCache.setup(
+            (cacheDirectory.length() > 0) ? cacheDirectory : directory + "/obj-cache",
+            acCacheSettings);
+    }
 
-        bool ret = tinyobj::LoadObj(
-            &attrib, 
-            &shapes, 
-            &materials, 
-            &warn, 
-            &err, 
-            path.c_str(),
-            directory.c_str());
+    // files are parsed and welded on the workers, each into its own ConvertedOBJ
+    std::vector<ConvertedOBJ> aConvertedOBJs(aOBJFilePaths.size());
+    std::vector<bool> abConverted(aOBJFilePaths.size(), false);
+    std::atomic<uint32_t> iNextFile = 0;
+    std::mutex convertMutex;
+    std::condition_variable convertCondition;
 
-        // Access loaded data
-        uint32_t iCurrMaterial = 0;
-        for(size_t s = 0; s < shapes.size(); s++)
+    std::vector<std::thread> aWorkers;
+    iNumThreads = std::min(iNumThreads, std::max((uint32_t)aOBJFilePaths.size(), 1u));
+    for(uint32_t iThread = 0; iThread < iNumThreads; iThread++)
+    {
+        aWorkers.emplace_back([&]()
         {
-            std::ostringstream partNameStringStream;
-            partNameStringStream << baseName << "-" << "shape" << s;
-            aMeshNames.push_back(partNameStringStream.str());
-
-            OBJMaterialInfo material = {};
-            if(materials.size() > 0)
-            {
-                int32_t iMaterialID = shapes[s].mesh.material_ids[0];
-                material.mDiffuse = float4(
-                    (float)materials[iMaterialID].diffuse[0], 
-                    (float)materials[iMaterialID].diffuse[1], 
-                    (float)materials[iMaterialID].diffuse[2], 1.0f);
-
-                material.mSpecular = float4(
-                    (float)materials[iMaterialID].specular[0],
-                    (float)materials[iMaterialID].specular[1],
-                    (float)materials[iMaterialID].specular[2], 1.0f);
-
-                material.mEmissive = float4(
-                    (float)materials[iMaterialID].emission[0],
-                    (float)materials[iMaterialID].emission[1],
-                    (float)materials[iMaterialID].emission[2], 1.0f);
-
-                material.mAlbedoTexturePath = materials[iMaterialID].diffuse_texname;
-                material.mEmissiveTexturePath = materials[iMaterialID].emissive_texname;
-                material.mSpecularTexturePath = materials[iMaterialID].specular_texname;
-                material.mNormalTexturePath = materials[iMaterialID].normal_texname;
-
-                // save material texture name and set material id
-                {
-                    if(materials[iMaterialID].diffuse_texname.length() > 0)
-                    {
-                        std::string baseName = parseBaseName(materials[iMaterialID].diffuse_texname);
-                        if(aDiffuseTextureNameMap.find(baseName) == aDiffuseTextureNameMap.end())
-                        {
-                            aDiffuseTextureNameMap[baseName] = (uint32_t)aDiffuseTextureNames.size();
-                            material.miDiffuseTextureID = (uint32_t)aDiffuseTextureNames.size();
-                            aDiffuseTextureNames.push_back(baseName);
-                        }
-                        else
-                        {
-                            material.miDiffuseTextureID = aDiffuseTextureNameMap[baseName];
-                        }
-                    }
-
-                    if(materials[iMaterialID].emissive_texname.length() > 0)
-                    {
-                        std::string baseName = parseBaseName(materials[iMaterialID].emissive_texname);
-                        if(aEmissiveTextureNameMap.find(baseName) == aEmissiveTextureNameMap.end())
-                        {
-                            aEmissiveTextureNameMap[baseName] = (uint32_t)aEmissiveTextureNames.size();
-                            material.miEmissiveTextureID = (uint32_t)aEmissiveTextureNames.size();
-                            aEmissiveTextureNames.push_back(baseName);
-                        }
-                        else
-                        {
-                            material.miEmissiveTextureID = aEmissiveTextureNameMap[baseName];
-                        }
-                    }
-
-                    if(materials[iMaterialID].specular_texname.length() > 0)
-                    {
-                        std::string baseName = parseBaseName(materials[iMaterialID].emissive_texname);
-                        if(aSpecularTextureNameMap.find(baseName) == aSpecularTextureNameMap.end())
-                        {
-                            aSpecularTextureNameMap[baseName] = (uint32_t)aSpecularTextureNames.size();
-                            material.miSpecularTextureID = (uint32_t)aSpecularTextureNames.size();
-                            aSpecularTextureNames.push_back(baseName);
-                        }
-                        else
-                        {
-                            material.miSpecularTextureID = aSpecularTextureNameMap[baseName];
-                        }
-                    }
-
-                    if(materials[iMaterialID].normal_texname.length() > 0)
-                    {
-                        std::string baseName = parseBaseName(materials[iMaterialID].emissive_texname);
-                        if(aNormalTextureNameMap.find(baseName) == aNormalTextureNameMap.end())
-                        {
-                            aNormalTextureNameMap[baseName] = (uint32_t)aNormalTextureNames.size();
-                            material.miNormalTextureID = (uint32_t)aNormalTextureNames.size();
-                            aNormalTextureNames.push_back(baseName);
-                        }
-                        else
-                        {
-                            material.miNormalTextureID = aNormalTextureNameMap[baseName];
-                        }
-                    }
-
-                }   // material texture names
-
-            }
-            else 
-            {
-                float fRed = float(rand() % 255) / 255.0f;
-                float fGreen = float(rand() % 255) / 255.0f;
-                float fBlue = float(rand() % 255) / 255.0f;
-                material.mDiffuse = float4(fRed, fGreen, fBlue, 1.0f);
-            }
-
-            aMeshMaterials.push_back(material);
-            aiMeshMaterialIDs.push_back((uint32_t)aMeshMaterials.size() - 1);
-
-            std::vector<Vertex> aVertices;
-            std::vector<uint32_t> aiVertexIndices;
-
-            float3 maxPosition = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-            float3 minPosition = float3(FLT_MAX, FLT_MAX, FLT_MAX);
-
-            // Loop over faces(polygon)
-            size_t index_offset = 0;
-            uint32_t iCurrMaterial = UINT32_MAX;
-            for(size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+            for(uint32_t iFile = iNextFile++; iFile < (uint32_t)aOBJFilePaths.size(); iFile = iNextFile++)
             {
-                int fv = shapes[s].mesh.num_face_vertices[f];
-                int32_t iMaterial = shapes[s].mesh.material_ids[f];
-                if(iCurrMaterial == UINT32_MAX)
+                ConversionCacheKey cacheKey;
+                std::vector<char> acCacheData;
+                if(bUseCache && conversionCache.load(acCacheData, cacheKey, aOBJFilePaths[iFile]) && readConvertedOBJ(aConvertedOBJs[iFile], acCacheData))
                 {
-                    iCurrMaterial = iMaterial;
+                    aConvertedOBJs[iFile].mbFromCache = true;
                 }
-                if(iMaterial != iCurrMaterial)
+                else
                 {
-                    assert(aiVertexIndices.size() % 3 == 0);
-                    aaiTriangleVertexIndices.push_back(aiVertexIndices);
-                    aiVertexIndices.clear();
-
-                    MeshExtent meshExtent;
-                    meshExtent.mMinPosition = float4(minPosition.x, minPosition.y, minPosition.z, 1.0f);
-                    meshExtent.mMaxPosition = float4(maxPosition.x, maxPosition.y, maxPosition.z, 1.0f);
-
-                    aMeshExtents.push_back(meshExtent);
-
-                    float3 center = (maxPosition + minPosition) * 0.5f;
-                    aMeshCenters.push_back(center);
-
-                    float3 bbox = maxPosition - minPosition;
-                    aMeshBBoxes.push_back(bbox);
-
-                    maxPosition = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-                    minPosition = float3(FLT_MAX, FLT_MAX, FLT_MAX);
-
-                    aVertices.clear();
-
-                    int32_t iMaterialID = shapes[s].mesh.material_ids[f];
-                    material.mDiffuse = float4(
-                        (float)materials[iMaterialID].diffuse[0],
-                        (float)materials[iMaterialID].diffuse[1],
-                        (float)materials[iMaterialID].diffuse[2], 1.0f);
-
-                    material.mSpecular = float4(
-                        (float)materials[iMaterialID].specular[0],
-                        (float)materials[iMaterialID].specular[1],
-                        (float)materials[iMaterialID].specular[2], 1.0f);
-
-                    material.mEmissive = float4(
-                        (float)materials[iMaterialID].emission[0],
-                        (float)materials[iMaterialID].emission[1],
-                        (float)materials[iMaterialID].emission[2], 1.0f);
-
-                    material.mAlbedoTexturePath = materials[iMaterialID].diffuse_texname;
-                    material.mEmissiveTexturePath = materials[iMaterialID].emissive_texname;
-                    material.mSpecularTexturePath = materials[iMaterialID].specular_texname;
-                    material.mNormalTexturePath = materials[iMaterialID].normal_texname;
-
-                    // save material texture name and set material id
+                    aConvertedOBJs[iFile] = ConvertedOBJ();
+                    convertOBJ(
+                        aConvertedOBJs[iFile],
+                        aOBJFilePaths[iFile],
+                        directory,
+                        weldTolerance);
+
+                    if(bUseCache)
                     {
-                        if(materials[iMaterialID].diffuse_texname.length() > 0)
-                        {
-                            std::string baseName = parseBaseName(materials[iMaterialID].diffuse_texname);
-                            if(aDiffuseTextureNameMap.find(baseName) == aDiffuseTextureNameMap.end())
-                            {
-                                aDiffuseTextureNameMap[baseName] = (uint32_t)aDiffuseTextureNames.size();
-                                material.miDiffuseTextureID = (uint32_t)aDiffuseTextureNames.size();
-                                aDiffuseTextureNames.push_back(baseName);
-                            }
-                            else
-                            {
-                                material.miDiffuseTextureID = aDiffuseTextureNameMap[baseName];
-                            }
-                        }
-
-                        if(materials[iMaterialID].emissive_texname.length() > 0)
-                        {
-                            std::string baseName = parseBaseName(materials[iMaterialID].emissive_texname);
-                            if(aEmissiveTextureNameMap.find(baseName) == aEmissiveTextureNameMap.end())
-                            {
-                                aEmissiveTextureNameMap[baseName] = (uint32_t)aEmissiveTextureNames.size();
-                                material.miEmissiveTextureID = (uint32_t)aEmissiveTextureNames.size();
-                                aEmissiveTextureNames.push_back(baseName);
-                            }
-                            else
-                            {
-                                material.miEmissiveTextureID = aEmissiveTextureNameMap[baseName];
-                            }
-                        }
-
-                        if(materials[iMaterialID].specular_texname.length() > 0)
-                        {
-                            std::string baseName = parseBaseName(materials[iMaterialID].emissive_texname);
-                            if(aSpecularTextureNameMap.find(baseName) == aSpecularTextureNameMap.end())
-                            {
-                                aSpecularTextureNameMap[baseName] = (uint32_t)aSpecularTextureNames.size();
-                                material.miSpecularTextureID = (uint32_t)aSpecularTextureNames.size();
-                                aSpecularTextureNames.push_back(baseName);
-                            }
-                            else
-                            {
-                                material.miSpecularTextureID = aSpecularTextureNameMap[baseName];
-                            }
-                        }
-
-                        if(materials[iMaterialID].normal_texname.length() > 0)
-                        {
-                            std::string baseName = parseBaseName(materials[iMaterialID].emissive_texname);
-                            if(aNormalTextureNameMap.find(baseName) == aNormalTextureNameMap.end())
-                            {
-                                aNormalTextureNameMap[baseName] = (uint32_t)aNormalTextureNames.size();
-                                material.miNormalTextureID = (uint32_t)aNormalTextureNames.size();
-                                aNormalTextureNames.push_back(baseName);
-                            }
-                            else
-                            {
-                                material.miNormalTextureID = aNormalTextureNameMap[baseName];
-                            }
-                        }
-
-                    }   // material texture names
-
-                    aMeshMaterials.push_back(material);
-                    aiMeshMaterialIDs.push_back((uint32_t)aMeshMaterials.size() - 1);
-
-                    iCurrMaterial = iMaterial;
+                        acCacheData.clear();
+                        writeConvertedOBJ(acCacheData, aConvertedOBJs[iFile]);
+                        conversionCache.store(cacheKey, acCacheData);
+                    }
                 }
 
-                // Loop over vertices in the face.
-                for(size_t v = 0; v < fv; v++)
                 {
-                    // access to vertex
-                    tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+                    std::lock_guard<std::mutex> lock(convertMutex);
+                    abConverted[iFile] = true;
+                }
+                convertCondition.notify_all();
+            }
+        });
+    }
 
-                    float vx = float(attrib.vertices[3 * idx.vertex_index + 0] * POSITION_MULT);
-                    float vy = float(attrib.vertices[3 * idx.vertex_index + 1] * POSITION_MULT);
-                    float vz = float(attrib.vertices[3 * idx.vertex_index + 2] * POSITION_MULT);
+    DEBUG_PRINTF("converting %d obj files on %d threads\n", (uint32_t)aOBJFilePaths.size(), iNumThreads);
 
-                    float nx = 0.0f;
-                    float ny = 0.0f;
-                    float nz = 0.0f;
+    auto parseBaseName = [](std::string const& filePath)
+    {
+        auto baseNameStart = filePath.rfind("\\");
+        if(baseNameStart == std::string::npos)
+        {
+            baseNameStart = filePath.rfind("/");
+        }
+        if(baseNameStart == std::string::npos)
+        {
+            baseNameStart = 0;
+        }
+        else
+        {
+            baseNameStart += 1;
+        }
+        std::string baseName = filePath.substr(baseNameStart);
 
-                    float tx = 0.0f;
-                    float ty = 0.0f;
+        return baseName;
+    };
 
-                    // Check if normals and texcoords are loaded
-                    if(idx.normal_index >= 0)
-                    {
-                        nx = attrib.normals[3 * idx.normal_index + 0];
-                        ny = attrib.normals[3 * idx.normal_index + 1];
-                        nz = attrib.normals[3 * idx.normal_index + 2];
-                        // Use normal data
-                    }
-                    if(idx.texcoord_index >= 0)
-                    {
-                        tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-                        ty = attrib.texcoords[2 * idx.texcoord_index + 1];
-                        // Use texture coordinate data
-                    }
+    // texture ids are handed out in order of first use
+    auto getTextureID = [&](
+        std::map<std::string, uint32_t>& aTextureNameMap,
+        std::vector<std::string>& aTextureNames,
+        std::string const& texturePath)
+    {
+        if(texturePath.length() == 0)
+        {
+            return -1;
+        }
 
-                    // Process vertex data (e.g., store in your data structures
-                    Vertex vertex;
-                    vertex.mPosition = float4(vx, vy, vz * fZMult, (float)aMeshExtents.size());
-                    vertex.mNormal = float4(nx, ny, nz * fZMult, 1.0f);
-                    vertex.mUV = float4(tx, ty, (float)aMeshExtents.size(), 1.0f);
+        std::string textureBaseName = parseBaseName(texturePath);
+        auto iter = aTextureNameMap.find(textureBaseName);
+        if(iter != aTextureNameMap.end())
+        {
+            return (int32_t)iter->second;
+        }
 
-                    totalMinPos = fminf(totalMinPos, float3(vertex.mPosition));
-                    totalMaxPos = fmaxf(totalMaxPos, float3(vertex.mPosition));
+        uint32_t iTextureID = (uint32_t)aTextureNames.size();
+        aTextureNameMap[textureBaseName] = iTextureID;
+        aTextureNames.push_back(textureBaseName);
 
-                    std::string mapString = encodeToMapString(vertex, (uint32_t)s);
-                    auto iter = aTotalVertexMap.find(mapString);
-                    if(iter == aTotalVertexMap.end())
-                    {
-                        aVertices.push_back(vertex);
-                        uint32_t iVertexIndex = (uint32_t)aTotalVertices.size();
-                        aTotalVertexMap[mapString] = iVertexIndex;
-                        aiVertexIndices.push_back(iVertexIndex);
+        return (int32_t)iTextureID;
+    };
 
-                        aTotalVertices.push_back(vertex);
-                    }
-                    else
-                    {
-                        uint32_t iVertexIndex = aTotalVertexMap[mapString];
+    // merged in file order as the files become ready
+    for(uint32_t iFile = 0; iFile < (uint32_t)aConvertedOBJs.size(); iFile++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(convertMutex);
+            convertCondition.wait(lock, [&]() { return abConverted[iFile] == true; });
+        }
 
-#if defined(_DEBUG)
-                        Vertex const& checkV = aTotalVertices[iVertexIndex];
-                        float3 diffPos = checkV.mPosition - vertex.mPosition;
-                        float3 diffNorm = checkV.mNormal - vertex.mNormal;
-                        float fDP0 = dot(diffPos, diffPos);
-                        float fDP1 = dot(diffNorm, diffNorm);
-                        assert(fDP0 <= 0.0001f && fDP1 <= 0.0001f);
-#endif // #if 0
+        ConvertedOBJ& convertedOBJ = aConvertedOBJs[iFile];
+        uint32_t iVertexOffset = (uint32_t)aTotalVertices.size();
+        uint32_t iMeshOffset = (uint32_t)aMeshExtents.size();
 
-                        aiVertexIndices.push_back(iVertexIndex);
-                    }
-                    
-                    minPosition = fminf(float3(vertex.mPosition), minPosition);
-                    maxPosition = fmaxf(float3(vertex.mPosition), maxPosition);
+        // mesh id is kept in position.w and uv.z
+        for(auto vertex : convertedOBJ.maVertices)
+        {
+            vertex.mPosition.w += (float)iMeshOffset;
+            vertex.mUV.z += (float)iMeshOffset;
+            aTotalVertices.push_back(vertex);
+        }
 
-                }   // for vertex
+        for(auto& aiVertexIndices : convertedOBJ.maaiTriangleVertexIndices)
+        {
+            for(auto& iVertexIndex : aiVertexIndices)
+            {
+                iVertexIndex += iVertexOffset;
+            }
+            aaiTriangleVertexIndices.push_back(std::move(aiVertexIndices));
+        }
 
-                index_offset += fv;
+        aMeshExtents.insert(aMeshExtents.end(), convertedOBJ.maMeshExtents.begin(), convertedOBJ.maMeshExtents.end());
+        aMeshCenters.insert(aMeshCenters.end(), convertedOBJ.maMeshCenters.begin(), convertedOBJ.maMeshCenters.end());
+        aMeshBBoxes.insert(aMeshBBoxes.end(), convertedOBJ.maMeshBBoxes.begin(), convertedOBJ.maMeshBBoxes.end());
+        aMeshNames.insert(aMeshNames.end(), convertedOBJ.maMeshNames.begin(), convertedOBJ.maMeshNames.end());
 
-            }   // for face
+        for(auto material : convertedOBJ.maMeshMaterials)
+        {
+            if(material.mbRandomDiffuse)
+            {
+                float fRed = float(rand() % 255) / 255.0f;
+                float fGreen = float(rand() % 255) / 255.0f;
+                float fBlue = float(rand() % 255) / 255.0f;
+                material.mDiffuse = float4(fRed, fGreen, fBlue, 1.0f);
+            }
 
-            assert(aiVertexIndices.size() % 3 == 0);
-            aaiTriangleVertexIndices.push_back(aiVertexIndices);
+            material.miDiffuseTextureID = getTextureID(aDiffuseTextureNameMap, aDiffuseTextureNames, material.mAlbedoTexturePath);
+            material.miEmissiveTextureID = getTextureID(aEmissiveTextureNameMap, aEmissiveTextureNames, material.mEmissiveTexturePath);
+            material.miSpecularTextureID = getTextureID(aSpecularTextureNameMap, aSpecularTextureNames, material.mSpecularTexturePath);
+            material.miNormalTextureID = getTextureID(aNormalTextureNameMap, aNormalTextureNames, material.mNormalTexturePath);
 
-            MeshExtent meshExtent;
-            meshExtent.mMinPosition = float4(minPosition.x, minPosition.y, minPosition.z, 1.0f);
-            meshExtent.mMaxPosition = float4(maxPosition.x, maxPosition.y, maxPosition.z, 1.0f);
+            aMeshMaterials.push_back(material);
+            aiMeshMaterialIDs.push_back((uint32_t)aMeshMaterials.size() - 1);
+        }
 
-            aMeshExtents.push_back(meshExtent);
+        totalMinPos = fminf(totalMinPos, convertedOBJ.mMinPosition);
+        totalMaxPos = fmaxf(totalMaxPos, convertedOBJ.mMaxPosition);
 
-            float3 center = (maxPosition + minPosition) * 0.5f;
-            aMeshCenters.push_back(center);
+        DEBUG_PRINTF("added \"%s\" num meshes %d total num meshes: %d total num vertices: %d (%s %.2f ms, weld %.2f ms)\n", 
+            convertedOBJ.mBaseName.c_str(), 
+            convertedOBJ.miNumShapes,
+            (uint32_t)aMeshBBoxes.size(),
+            (uint32_t)aTotalVertices.size(),
+            convertedOBJ.mbFromCache ? "cached" : "parse",
+            convertedOBJ.mfParseMilliseconds,
+            convertedOBJ.mfWeldMilliseconds);
 
-            float3 bbox = maxPosition - minPosition;
-            aMeshBBoxes.push_back(bbox);
+        convertedOBJ = ConvertedOBJ();
 
-            {
-                std::stringstream meshInstanceStringStream;
-                meshInstanceStringStream << bbox.x << "_" << bbox.y << "_" << bbox.z << "_" << aiVertexIndices.size();
-                std::string mapEntryName = meshInstanceStringStream.str();
-                aMeshInstanceIndices[mapEntryName].push_back((uint32_t)aMeshBBoxes.size() - 1);
-                
-            }
+    }   // for obj file
 
-        }   // for shape = 0 to num shapes
-    
-        DEBUG_PRINTF("added \"%s\" num meshes %d total num meshes: %d\n", 
-            baseName.c_str(), 
-            shapes.size(),
-            aMeshBBoxes.size());
+    for(auto& worker : aWorkers)
+    {
+        worker.join();
+    }
 
-    }   // tiny obj
+    // no faces or every input failed, there's nothing to cluster or write
+    uint64_t iNumTotalTriangleIndices = 0;
+    for(auto const& aiTriangleVertexIndices : aaiTriangleVertexIndices)
+    {
+        iNumTotalTriangleIndices += aiTriangleVertexIndices.size();
+    }
+    if(aTotalVertices.size() == 0 || iNumTotalTriangleIndices == 0)
+    {
+        DEBUG_PRINTF("!!! no triangles in \"%s\" !!!\n", fullPath.c_str());
+        return 1;
+    }
 
     // total mesh extent
     MeshExtent meshExtent;
@@ -614,24 +622,91 @@ int main(int argc, char* argv[])
 
     DEBUG_PRINTF("num total meshes: %d\n", aMeshBBoxes.size());
 
-    std::map<uint32_t, std::vector<uint32_t>> aMeshInstances;
-    for(auto const& keyValue : aMeshInstanceIndices)
+    auto outputStartTime = std::chrono::high_resolution_clock::now();
+
+    // meshes that are moved copies of an earlier one, before anything reorders their triangles
+    std::vector<MeshInstance> aMeshInstances;
     {
-        uint32_t iMeshIndex = keyValue.second[0];
-        for(uint32_t i = 1; i < (uint32_t)keyValue.second.size(); i++)
+        auto instanceStartTime = std::chrono::high_resolution_clock::now();
+
+        CMeshInstanceFinder instanceFinder;
+        if(aTotalVertices.size() > 0)
         {
-            aMeshInstances[iMeshIndex].push_back(keyValue.second[i]);
+            instanceFinder.find(
+                aMeshInstances,
+                aaiTriangleVertexIndices,
+                &aTotalVertices[0].mPosition.x,
+                &aTotalVertices[0].mNormal.x,
+                &aTotalVertices[0].mUV.x,
+                (uint32_t)sizeof(Vertex));
+        }
+        else
+        {
+            aMeshInstances.resize(aaiTriangleVertexIndices.size());
+            for(uint32_t iMesh = 0; iMesh < (uint32_t)aMeshInstances.size(); iMesh++)
+            {
+                aMeshInstances[iMesh] = {};
+                aMeshInstances[iMesh].miMesh = aMeshInstances[iMesh].miGeometryMesh = iMesh;
+            }
         }
-    }
 
-    for(auto const& keyValue : aMeshInstances)
-    {
-        DEBUG_PRINTF("mesh %d\t ", keyValue.second[0]);
-        for(uint32_t i = 1; i < keyValue.second.size(); i++)
+        uint32_t iNumInstances = 0;
+        uint32_t iNumInstanceIndices = 0;
+        std::vector<bool> abVertexUsed(aTotalVertices.size(), false);
+        for(uint32_t iMesh = 0; iMesh < (uint32_t)aMeshInstances.size(); iMesh++)
+        {
+            if(aMeshInstances[iMesh].miGeometryMesh == iMesh)
+            {
+                for(uint32_t iVertexIndex : aaiTriangleVertexIndices[iMesh])
+                {
+                    abVertexUsed[iVertexIndex] = true;
+                }
+                continue;
+            }
+
+            iNumInstances += 1;
+            iNumInstanceIndices += (uint32_t)aaiTriangleVertexIndices[iMesh].size();
+            if(bShareInstanceGeometry)
+            {
+                aaiTriangleVertexIndices[iMesh].clear();
+            }
+        }
+
+        // vertices are never shared across meshes, the instances' own ones aren't used by anything else
+        uint32_t iNumRemovedVertices = 0;
+        if(bShareInstanceGeometry && iNumInstances > 0)
         {
-            DEBUG_PRINTF("%d ", keyValue.second[i]);
+            std::vector<uint32_t> aiVertexRemap(aTotalVertices.size(), UINT32_MAX);
+            uint32_t iNumVertices = 0;
+            for(uint32_t iVertex = 0; iVertex < (uint32_t)aTotalVertices.size(); iVertex++)
+            {
+                if(abVertexUsed[iVertex])
+                {
+                    aiVertexRemap[iVertex] = iNumVertices;
+                    aTotalVertices[iNumVertices] = aTotalVertices[iVertex];
+                    iNumVertices += 1;
+                }
+            }
+            iNumRemovedVertices = (uint32_t)aTotalVertices.size() - iNumVertices;
+            aTotalVertices.resize(iNumVertices);
+
+            for(auto& aiTriangleVertexIndices : aaiTriangleVertexIndices)
+            {
+                for(auto& iVertexIndex : aiTriangleVertexIndices)
+                {
+                    iVertexIndex = aiVertexRemap[iVertexIndex];
+                }
+            }
         }
-        DEBUG_PRINTF("\n");
+
+        auto instanceEndTime = std::chrono::high_resolution_clock::now();
+        DEBUG_PRINTF("%d of %d meshes are instances, %d triangles %s, %d vertices removed (%.3f ms)\n",
+            iNumInstances,
+            (uint32_t)aMeshInstances.size(),
+            iNumInstanceIndices / 3,
+            bShareInstanceGeometry ? "shared" : "kept",
+            iNumRemovedVertices,
+            std::chrono::duration<double, std::milli>(instanceEndTime - instanceStartTime).count());
     }
 
     // output materials
@@ -714,17 +789,12 @@ int main(int argc, char* argv[])
 
     }   // materials
 
-    std::string outputPath = directory + "/" + baseName + "-mesh-instance-ids.bin";
+    // one entry per mesh, the transform takes the geometry mesh's vertices to this mesh
+    std::string outputPath = directory + "/" + baseName + "-mesh-instances.bin";
     FILE* fp = fopen(outputPath.c_str(), "wb");
-    uint32_t iNumValidMeshes = (uint32_t)aMeshInstances.size();
-    fwrite(&iNumValidMeshes, sizeof(uint32_t), 1, fp);
-    for(auto const& keyValue: aMeshInstances)
-    {
-        uint32_t iNumMeshInstances = (uint32_t)keyValue.second.size();
-        fwrite(&keyValue.first, sizeof(uint32_t), 1, fp);
-        fwrite(&iNumMeshInstances, sizeof(uint32_t), 1, fp);
-        fwrite(keyValue.second.data(), sizeof(uint32_t), keyValue.second.size(), fp);
-    }
+    uint32_t iNumMeshInstances = (uint32_t)aMeshInstances.size();
+    fwrite(&iNumMeshInstances, sizeof(uint32_t), 1, fp);
+    fwrite(aMeshInstances.data(), sizeof(MeshInstance), aMeshInstances.size(), fp);
     fclose(fp);
 
     uint32_t iNumMeshes = (uint32_t)aMeshExtents.size();
@@ -740,46 +810,672 @@ int main(int argc, char* argv[])
     fwrite(aMeshBBoxes.data(), sizeof(float3), aMeshBBoxes.size(), fp);
     fclose(fp);
 
-    outputVerticesAndTriangles(
-        aTotalVertices,
-        aaiTriangleVertexIndices,
-        aMeshExtents,
-        directory,
-        baseName);
+    CIndexOptimizer indexOptimizer;
+    indexOptimizer.setCacheSize(iVertexCacheSize);
 
-    std::vector<float4> aTotalTrianglePositions(aTotalVertices.size());
-    for(uint32_t i = 0; i < (uint32_t)aTotalVertices.size(); i++)
+    std::vector<VertexCacheStats> aInputCacheStats(aaiTriangleVertexIndices.size());
+    for(uint32_t iMesh = 0; iMesh < (uint32_t)aaiTriangleVertexIndices.size(); iMesh++)
     {
-        aTotalTrianglePositions[i] = float4(aTotalVertices[i].mPosition, 1.0f);
+        aInputCacheStats[iMesh] = indexOptimizer.analyzeVertexCache(
+            aaiTriangleVertexIndices[iMesh].data(),
+            (uint32_t)aaiTriangleVertexIndices[iMesh].size());
     }
-    outputTrianglePositionsAndTriangles(
-        aTotalTrianglePositions,
-        aaiTriangleVertexIndices,
-        aMeshExtents,
-        directory,
-        baseName
-    );
-
-    outputMeshMaterialIDs(
-        aiMeshMaterialIDs,
-        directory,
-        baseName);
 
-    std::string loadFullPath = directory + "/" + baseName + "-triangles.bin";
-    std::vector<Vertex> aTestTotalVertices;
-    std::vector<std::vector<uint32_t>> aaiTriangleIndices;
-    std::vector<MeshRange> aMeshRanges;
-    std::vector<MeshExtent> aTestMeshExtents;
-    test(
-        aTestTotalVertices,
-        aaiTriangleIndices,
-        aMeshRanges,
-        aTestMeshExtents,
-        loadFullPath);
-}
+    // meshlets, each mesh's triangles are reordered so every cluster is one contiguous index range
+    std::vector<MeshCluster> aMeshClusters;
+    {
+        auto clusterStartTime = std::chrono::high_resolution_clock::now();
 
-/*
-**
+        CMeshClusterBuilder clusterBuilder;
+        clusterBuilder.setLimits(iMaxClusterVertices, iMaxClusterTriangles);
+        uint32_t iFirstIndex = 0;
+        for(uint32_t iMesh = 0; iMesh < (uint32_t)aaiTriangleVertexIndices.size(); iMesh++)
+        {
+            uint32_t iFirstCluster = (uint32_t)aMeshClusters.size();
+            clusterBuilder.build(
+                aMeshClusters,
+                aaiTriangleVertexIndices[iMesh],
+                &aTotalVertices[0].mPosition.x,
+                (uint32_t)sizeof(Vertex),
+                iMesh,
+                iFirstIndex);
+
+            // clusters draw in overdraw order, the triangles inside each one in vertex cache order
+            if(bOptimizeIndices)
+            {
+                indexOptimizer.optimizeOverdraw(
+                    aaiTriangleVertexIndices[iMesh],
+                    aMeshClusters.data() + iFirstCluster,
+                    (uint32_t)aMeshClusters.size() - iFirstCluster,
+                    &aTotalVertices[0].mPosition.x,
+                    (uint32_t)sizeof(Vertex),
+                    iFirstIndex);
+
+                for(uint32_t iCluster = iFirstCluster; iCluster < (uint32_t)aMeshClusters.size(); iCluster++)
+                {
+                    indexOptimizer.optimizeVertexCache(
+                        aaiTriangleVertexIndices[iMesh],
+                        aMeshClusters[iCluster].miFirstIndex - iFirstIndex,
+                        aMeshClusters[iCluster].miNumIndices);
+                }
+            }
+
+            iFirstIndex += (uint32_t)aaiTriangleVertexIndices[iMesh].size();
+        }
+
+        auto clusterEndTime = std::chrono::high_resolution_clock::now();
+        DEBUG_PRINTF("%d clusters for %d meshes (%.3f ms)\n",
+            (uint32_t)aMeshClusters.size(),
+            (uint32_t)aaiTriangleVertexIndices.size(),
+            std::chrono::duration<double, std::milli>(clusterEndTime - clusterStartTime).count());
+    }
+
+    // vertices in the order the optimized triangles first use them
+    if(bOptimizeIndices)
+    {
+        std::vector<uint32_t> aiVertexRemap;
+        indexOptimizer.optimizeVertexFetch(
+            aiVertexRemap,
+            aaiTriangleVertexIndices,
+            (uint32_t)aTotalVertices.size());
+
+        std::vector<Vertex> aRemappedVertices(aTotalVertices.size());
+        for(uint32_t iVertex = 0; iVertex < (uint32_t)aTotalVertices.size(); iVertex++)
+        {
+            aRemappedVertices[aiVertexRemap[iVertex]] = aTotalVertices[iVertex];
+        }
+        aTotalVertices.swap(aRemappedVertices);
+    }
+
+    // vertex shader invocations before and after, the deferred passes pay for them twice a frame
+    {
+        VertexCacheStats totalInputStats, totalOutputStats;
+        for(uint32_t iMesh = 0; iMesh < (uint32_t)aaiTriangleVertexIndices.size(); iMesh++)
+        {
+            VertexCacheStats const& inputStats = aInputCacheStats[iMesh];
+            VertexCacheStats outputStats = indexOptimizer.analyzeVertexCache(
+                aaiTriangleVertexIndices[iMesh].data(),
+                (uint32_t)aaiTriangleVertexIndices[iMesh].size());
+            DEBUG_PRINTF("mesh %d: %d triangles %d vertices, acmr %.3f -> %.3f, atvr %.3f -> %.3f\n",
+                iMesh,
+                outputStats.miNumTriangles,
+                outputStats.miNumVertices,
+                inputStats.mfACMR,
+                outputStats.mfACMR,
+                inputStats.mfATVR,
+                outputStats.mfATVR);
+
+            totalInputStats.miNumTransforms += inputStats.miNumTransforms;
+            totalOutputStats.miNumTransforms += outputStats.miNumTransforms;
+            totalOutputStats.miNumTriangles += outputStats.miNumTriangles;
+            totalOutputStats.miNumVertices += outputStats.miNumVertices;
+        }
+
+        if(totalOutputStats.miNumTriangles > 0 && totalOutputStats.miNumVertices > 0)
+        {
+            DEBUG_PRINTF("total (cache size %d): acmr %.3f -> %.3f, atvr %.3f -> %.3f\n",
+                iVertexCacheSize,
+                (float)totalInputStats.miNumTransforms / (float)totalOutputStats.miNumTriangles,
+                (float)totalOutputStats.miNumTransforms / (float)totalOutputStats.miNumTriangles,
+                (float)totalInputStats.miNumTransforms / (float)totalOutputStats.miNumVertices,
+                (float)totalOutputStats.miNumTransforms / (float)totalOutputStats.miNumVertices);
+        }
+    }
+
+    // simplified levels, each from the one before, their indices go after the base indices of every mesh
+    std::vector<MeshLOD> aMeshLODs;
+    std::vector<uint32_t> aiLODIndices;
+    if(iNumLODLevels > 0 && aTotalVertices.size() > 0)
+    {
+        auto lodStartTime = std::chrono::high_resolution_clock::now();
+
+        uint32_t iNumBaseIndices = 0;
+        for(auto const& aiTriangleVertexIndices : aaiTriangleVertexIndices)
+        {
+            iNumBaseIndices += (uint32_t)aiTriangleVertexIndices.size();
+        }
+
+        CMeshSimplifier simplifier;
+        std::vector<uint32_t> aiLevelIndices;
+        std::vector<uint32_t> aiSimplifiedIndices;
+        for(uint32_t iMesh = 0; iMesh < (uint32_t)aaiTriangleVertexIndices.size(); iMesh++)
+        {
+            float3 meshSize = float3(aMeshExtents[iMesh].mMaxPosition) - float3(aMeshExtents[iMesh].mMinPosition);
+            float fMaxError = fMaxLODError * length(meshSize);
+
+            aiLevelIndices = aaiTriangleVertexIndices[iMesh];
+            float fError = 0.0f;
+            for(uint32_t iLevel = 0; iLevel < iNumLODLevels; iLevel++)
+            {
+                uint32_t iTargetNumIndices = (uint32_t)(aiLevelIndices.size() / 6) * 3;
+                if(iTargetNumIndices < 16 * 3)
+                {
+                    break;
+                }
+
+                fError += simplifier.simplify(
+                    aiSimplifiedIndices,
+                    aiLevelIndices,
+                    &aTotalVertices[0].mPosition.x,
+                    (uint32_t)sizeof(Vertex),
+                    iTargetNumIndices,
+                    fMaxError);
+
+                // not worth a level if the error limit stopped it early
+                if(aiSimplifiedIndices.size() == 0 || aiSimplifiedIndices.size() > aiLevelIndices.size() * 7 / 8)
+                {
+                    break;
+                }
+
+                if(bOptimizeIndices)
+                {
+                    indexOptimizer.optimizeVertexCache(aiSimplifiedIndices, 0, (uint32_t)aiSimplifiedIndices.size());
+                }
+
+                MeshLOD meshLOD;
+                meshLOD.miMesh = iMesh;
+                meshLOD.miFirstIndex = iNumBaseIndices + (uint32_t)aiLODIndices.size();
+                meshLOD.miNumIndices = (uint32_t)aiSimplifiedIndices.size();
+                meshLOD.mfError = fError;
+                aMeshLODs.push_back(meshLOD);
+                aiLODIndices.insert(aiLODIndices.end(), aiSimplifiedIndices.begin(), aiSimplifiedIndices.end());
+
+                aiLevelIndices.swap(aiSimplifiedIndices);
+            }
+        }
+
+        auto lodEndTime = std::chrono::high_resolution_clock::now();
+        DEBUG_PRINTF("%d lod levels, %d extra triangles (%.3f ms)\n",
+            (uint32_t)aMeshLODs.size(),
+            (uint32_t)aiLODIndices.size() / 3,
+            std::chrono::duration<double, std::milli>(lodEndTime - lodStartTime).count());
+    }
+
+    // hierarchy over the mesh extents for queries on the cpu, instances keep their own extents so they're in it too
+    std::vector<BVHNode> aMeshBVHNodes;
+    std::vector<uint32_t> aiMeshBVHPrimitives;
+    std::vector<BVHNode> aTriangleBVHNodes;
+    std::vector<uint32_t> aiTriangleBVHPrimitives;
+    {
+        auto bvhStartTime = std::chrono::high_resolution_clock::now();
+
+        uint32_t iNumBVHMeshes = (uint32_t)aaiTriangleVertexIndices.size();
+        std::vector<float3> aMinPositions(iNumBVHMeshes);
+        std::vector<float3> aMaxPositions(iNumBVHMeshes);
+        for(uint32_t iMesh = 0; iMesh < iNumBVHMeshes; iMesh++)
+        {
+            aMinPositions[iMesh] = float3(aMeshExtents[iMesh].mMinPosition);
+            aMaxPositions[iMesh] = float3(aMeshExtents[iMesh].mMaxPosition);
+        }
+        buildBVH(
+            aMeshBVHNodes,
+            aiMeshBVHPrimitives,
+            aMinPositions.data(),
+            aMaxPositions.data(),
+            iNumBVHMeshes,
+            4);
+
+        // base triangles are numbered across the meshes in order, the index lists are split by index size in the file
+        if(bTriangleBVH)
+        {
+            aMinPositions.clear();
+            aMaxPositions.clear();
+            for(auto const& aiTriangleVertexIndices : aaiTriangleVertexIndices)
+            {
+                for(uint32_t i = 0; i + 2 < (uint32_t)aiTriangleVertexIndices.size(); i += 3)
+                {
+                    float3 pos0 = float3(aTotalVertices[aiTriangleVertexIndices[i]].mPosition);
+                    float3 pos1 = float3(aTotalVertices[aiTriangleVertexIndices[i + 1]].mPosition);
+                    float3 pos2 = float3(aTotalVertices[aiTriangleVertexIndices[i + 2]].mPosition);
+                    aMinPositions.push_back(fminf(fminf(pos0, pos1), pos2));
+                    aMaxPositions.push_back(fmaxf(fmaxf(pos0, pos1), pos2));
+                }
+            }
+            buildBVH(
+                aTriangleBVHNodes,
+                aiTriangleBVHPrimitives,
+                aMinPositions.data(),
+                aMaxPositions.data(),
+                (uint32_t)aMinPositions.size(),
+                4);
+        }
+
+        auto bvhEndTime = std::chrono::high_resolution_clock::now();
+        DEBUG_PRINTF("bvh: %d mesh nodes, %d triangle nodes (%.3f ms)\n",
+            (uint32_t)aMeshBVHNodes.size(),
+            (uint32_t)aTriangleBVHNodes.size(),
+            std::chrono::duration<double, std::milli>(bvhEndTime - bvhStartTime).count());
+    }
+
+    outputVerticesAndTriangles(
+        aTotalVertices,
+        aaiTriangleVertexIndices,
+        aMeshExtents,
+        aMeshClusters,
+        aMeshLODs,
+        aiLODIndices,
+        aMeshBVHNodes,
+        aiMeshBVHPrimitives,
+        aTriangleBVHNodes,
+        aiTriangleBVHPrimitives,
+        directory,
+        baseName,
+        bCompactVertices,
+        bSmallIndices);
+
+    std::vector<float4> aTotalTrianglePositions(aTotalVertices.size());
+    for(uint32_t i = 0; i < (uint32_t)aTotalVertices.size(); i++)
+    {
+        aTotalTrianglePositions[i] = float4(aTotalVertices[i].mPosition, 1.0f);
+    }
+    outputTrianglePositionsAndTriangles(
+        aTotalTrianglePositions,
+        aaiTriangleVertexIndices,
+        aMeshExtents,
+        directory,
+        baseName
+    );
+
+    outputMeshMaterialIDs(
+        aiMeshMaterialIDs,
+        directory,
+        baseName);
+
+    // same name mangling as the renderer, the pngs are only needed when it does the packing
+    std::vector<std::string> aAtlasPaths;
+    if(bBakeAtlas)
+    {
+        std::vector<std::string> aTexturePaths;
+        for(auto const& diffuseTextureName : aDiffuseTextureNames)
+        {
+            std::string textureBaseName = diffuseTextureName.substr(diffuseTextureName.find_last_of("/\\") + 1);
+            aTexturePaths.push_back(directory + "/textures/" + textureBaseName.substr(0, textureBaseName.rfind(".")) + ".png");
+        }
+        atlasSettings.miNumThreads = iNumThreads;
+        bakeTextureAtlas(
+            aAtlasPaths,
+            directory + "/" + baseName,
+            aTexturePaths,
+            atlasSettings);
+    }
+    else
+    {
+        removeTextureAtlases(directory + "/" + baseName);
+    }
+
+    if(bOutputBundle)
+    {
+        std::vector<std::string> aAtlasFileNames;
+        for(auto const& atlasPath : aAtlasPaths)
+        {
+            aAtlasFileNames.push_back(atlasPath.substr(directory.length() + 1));
+        }
+
+        outputBundle(
+            (aAtlasFileNames.size() > 0) ? std::vector<std::string>() : aDiffuseTextureNames,
+            aAtlasFileNames,
+            directory,
+            baseName,
+            bCompressBundle);
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    DEBUG_PRINTF("converted in %.3f seconds (output %.3f seconds)\n",
+        std::chrono::duration<double>(endTime - startTime).count(),
+        std::chrono::duration<double>(endTime - outputStartTime).count());
+
+    std::string loadFullPath = directory + "/" + baseName + "-triangles.bin";
+    std::vector<Vertex> aTestTotalVertices;
+    std::vector<std::vector<uint32_t>> aaiTriangleIndices;
+    std::vector<MeshRange> aMeshRanges;
+    std::vector<MeshExtent> aTestMeshExtents;
+    test(
+        aTestTotalVertices,
+        aaiTriangleIndices,
+        aMeshRanges,
+        aTestMeshExtents,
+        loadFullPath);
+}
+
+/*
+** runs on a worker thread, only touches convertedOBJ
+*/
+void convertOBJ(
+    ConvertedOBJ& convertedOBJ,
+    std::string const& objFilePath,
+    std::string const& directory,
+    WeldTolerance const& weldTolerance)
+{
+    convertedOBJ.mBaseName = std::filesystem::path(objFilePath).stem().string();
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    auto parseStartTime = std::chrono::high_resolution_clock::now();
+    bool ret = tinyobj::LoadObj(
+        &attrib, 
+        &shapes, 
+        &materials, 
+        &warn, 
+        &err, 
+        objFilePath.c_str(),
+        directory.c_str());
+    if(!ret)
+    {
+        DEBUG_PRINTF("!!! can\'t load \"%s\": %s !!!\n", objFilePath.c_str(), err.c_str());
+    }
+
+    auto weldStartTime = std::chrono::high_resolution_clock::now();
+
+    // at least one vertex per position, the table doesn't need to rehash for most files
+    CVertexWelder vertexWelder;
+    vertexWelder.setTolerance(weldTolerance);
+    vertexWelder.reserve((uint32_t)(attrib.vertices.size() / 3));
+
+    // texture paths are kept, the ids are assigned when merging
+    auto setMaterial = [&](OBJMaterialInfo& material, int32_t iMaterialID)
+    {
+        material = {};
+        if(iMaterialID < 0 || iMaterialID >= (int32_t)materials.size())
+        {
+            return;
+        }
+
+        material.mDiffuse = float4(
+            (float)materials[iMaterialID].diffuse[0], 
+            (float)materials[iMaterialID].diffuse[1], 
+            (float)materials[iMaterialID].diffuse[2], 1.0f);
+
+        material.mSpecular = float4(
+            (float)materials[iMaterialID].specular[0],
+            (float)materials[iMaterialID].specular[1],
+            (float)materials[iMaterialID].specular[2], 1.0f);
+
+        material.mEmissive = float4(
+            (float)materials[iMaterialID].emission[0],
+            (float)materials[iMaterialID].emission[1],
+            (float)materials[iMaterialID].emission[2], 1.0f);
+
+        material.mAlbedoTexturePath = materials[iMaterialID].diffuse_texname;
+        material.mEmissiveTexturePath = materials[iMaterialID].emissive_texname;
+        material.mSpecularTexturePath = materials[iMaterialID].specular_texname;
+        material.mNormalTexturePath = materials[iMaterialID].normal_texname;
+    };
+
+    float fZMult = 1.0f;
+
+    // Access loaded data
+    for(size_t s = 0; s < shapes.size(); s++)
+    {
+        std::ostringstream partNameStringStream;
+        partNameStringStream << convertedOBJ.mBaseName << "-" << "shape" << s;
+        convertedOBJ.maMeshNames.push_back(partNameStringStream.str());
+
+        OBJMaterialInfo material = {};
+        if(materials.size() > 0)
+        {
+            setMaterial(material, shapes[s].mesh.material_ids[0]);
+        }
+        else 
+        {
+            material.mbRandomDiffuse = true;
+        }
+        convertedOBJ.maMeshMaterials.push_back(material);
+
+        std::vector<uint32_t> aiVertexIndices;
+
+        float3 maxPosition = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        float3 minPosition = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+
+        // Loop over faces(polygon)
+        size_t index_offset = 0;
+        uint32_t iCurrMaterial = UINT32_MAX;
+        for(size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+        {
+            int fv = shapes[s].mesh.num_face_vertices[f];
+            int32_t iMaterial = shapes[s].mesh.material_ids[f];
+            if(iCurrMaterial == UINT32_MAX)
+            {
+                iCurrMaterial = iMaterial;
+            }
+            if(iMaterial != iCurrMaterial)
+            {
+                assert(aiVertexIndices.size() % 3 == 0);
+                convertedOBJ.maaiTriangleVertexIndices.push_back(aiVertexIndices);
+                aiVertexIndices.clear();
+
+                MeshExtent meshExtent;
+                meshExtent.mMinPosition = float4(minPosition.x, minPosition.y, minPosition.z, 1.0f);
+                meshExtent.mMaxPosition = float4(maxPosition.x, maxPosition.y, maxPosition.z, 1.0f);
+
+                convertedOBJ.maMeshExtents.push_back(meshExtent);
+
+                float3 center = (maxPosition + minPosition) * 0.5f;
+                convertedOBJ.maMeshCenters.push_back(center);
+
+                float3 bbox = maxPosition - minPosition;
+                convertedOBJ.maMeshBBoxes.push_back(bbox);
+
+                maxPosition = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+                minPosition = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+
+                setMaterial(material, iMaterial);
+                convertedOBJ.maMeshMaterials.push_back(material);
+
+                iCurrMaterial = iMaterial;
+            }
+
+            // Loop over vertices in the face.
+            for(size_t v = 0; v < fv; v++)
+            {
+                // access to vertex
+                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+
+                float vx = float(attrib.vertices[3 * idx.vertex_index + 0] * POSITION_MULT);
+                float vy = float(attrib.vertices[3 * idx.vertex_index + 1] * POSITION_MULT);
+                float vz = float(attrib.vertices[3 * idx.vertex_index + 2] * POSITION_MULT);
+
+                float nx = 0.0f;
+                float ny = 0.0f;
+                float nz = 0.0f;
+
+                float tx = 0.0f;
+                float ty = 0.0f;
+
+                // Check if normals and texcoords are loaded
+                if(idx.normal_index >= 0)
+                {
+                    nx = attrib.normals[3 * idx.normal_index + 0];
+                    ny = attrib.normals[3 * idx.normal_index + 1];
+                    nz = attrib.normals[3 * idx.normal_index + 2];
+                    // Use normal data
+                }
+                if(idx.texcoord_index >= 0)
+                {
+                    tx = attrib.texcoords[2 * idx.texcoord_index + 0];
+                    ty = attrib.texcoords[2 * idx.texcoord_index + 1];
+                    // Use texture coordinate data
+                }
+
+                // mesh id is local to the file, offset when merging
+                uint32_t iMeshID = (uint32_t)convertedOBJ.maMeshExtents.size();
+
+                // Process vertex data (e.g., store in your data structures
+                Vertex vertex;
+                vertex.mPosition = float4(vx, vy, vz * fZMult, (float)iMeshID);
+                vertex.mNormal = float4(nx, ny, nz * fZMult, 1.0f);
+                vertex.mUV = float4(tx, ty, (float)iMeshID, 1.0f);
+
+                convertedOBJ.mMinPosition = fminf(convertedOBJ.mMinPosition, float3(vertex.mPosition));
+                convertedOBJ.mMaxPosition = fmaxf(convertedOBJ.mMaxPosition, float3(vertex.mPosition));
+
+                // keyed on the mesh id stored in position.w, vertices are never shared across meshes
+                bool bAdded = false;
+                uint32_t iVertexIndex = vertexWelder.findOrAdd(
+                    &vertex.mPosition.x,
+                    &vertex.mNormal.x,
+                    &vertex.mUV.x,
+                    iMeshID,
+                    (uint32_t)convertedOBJ.maVertices.size(),
+                    bAdded);
+                if(bAdded)
+                {
+                    convertedOBJ.maVertices.push_back(vertex);
+                }
+                else
+                {
+#if defined(_DEBUG)
+                    Vertex const& checkV = convertedOBJ.maVertices[iVertexIndex];
+                    float3 diffPos = checkV.mPosition - vertex.mPosition;
+                    float3 diffNorm = checkV.mNormal - vertex.mNormal;
+                    float fDP0 = dot(diffPos, diffPos);
+                    float fDP1 = dot(diffNorm, diffNorm);
+                    assert(fDP0 <= 0.0001f && fDP1 <= 0.0001f);
+#endif // #if 0
+                }
+                aiVertexIndices.push_back(iVertexIndex);
+                
+                minPosition = fminf(float3(vertex.mPosition), minPosition);
+                maxPosition = fmaxf(float3(vertex.mPosition), maxPosition);
+
+            }   // for vertex
+
+            index_offset += fv;
+
+        }   // for face
+
+        assert(aiVertexIndices.size() % 3 == 0);
+        convertedOBJ.maaiTriangleVertexIndices.push_back(aiVertexIndices);
+
+        MeshExtent meshExtent;
+        meshExtent.mMinPosition = float4(minPosition.x, minPosition.y, minPosition.z, 1.0f);
+        meshExtent.mMaxPosition = float4(maxPosition.x, maxPosition.y, maxPosition.z, 1.0f);
+
+        convertedOBJ.maMeshExtents.push_back(meshExtent);
+
+        float3 center = (maxPosition + minPosition) * 0.5f;
+        convertedOBJ.maMeshCenters.push_back(center);
+
+        float3 bbox = maxPosition - minPosition;
+        convertedOBJ.maMeshBBoxes.push_back(bbox);
+
+    }   // for shape = 0 to num shapes
+
+    convertedOBJ.miNumShapes = (uint32_t)shapes.size();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    convertedOBJ.mfParseMilliseconds = std::chrono::duration<double, std::milli>(weldStartTime - parseStartTime).count();
+    convertedOBJ.mfWeldMilliseconds = std::chrono::duration<double, std::milli>(endTime - weldStartTime).count();
+}
+
+/*
+** cache payload, everything convertOBJ fills in except the timings
+*/
+void writeConvertedOBJ(
+    std::vector<char>& acData,
+    ConvertedOBJ const& convertedOBJ)
+{
+    CacheWriter writer = {acData};
+    writer.write(convertedOBJ.mBaseName);
+    writer.write(convertedOBJ.miNumShapes);
+    writer.write(convertedOBJ.maVertices);
+    writer.write((uint64_t)convertedOBJ.maaiTriangleVertexIndices.size());
+    for(auto const& aiTriangleVertexIndices : convertedOBJ.maaiTriangleVertexIndices)
+    {
+        writer.write(aiTriangleVertexIndices);
+    }
+    writer.write(convertedOBJ.maMeshExtents);
+    writer.write(convertedOBJ.maMeshCenters);
+    writer.write(convertedOBJ.maMeshBBoxes);
+    writer.write((uint64_t)convertedOBJ.maMeshNames.size());
+    for(auto const& meshName : convertedOBJ.maMeshNames)
+    {
+        writer.write(meshName);
+    }
+    writer.write((uint64_t)convertedOBJ.maMeshMaterials.size());
+    for(auto const& material : convertedOBJ.maMeshMaterials)
+    {
+        writer.write(material.mDiffuse);
+        writer.write(material.mSpecular);
+        writer.write(material.mEmissive);
+        writer.write(material.mAlbedoTexturePath);
+        writer.write(material.mNormalTexturePath);
+        writer.write(material.mSpecularTexturePath);
+        writer.write(material.mEmissiveTexturePath);
+        writer.write((uint32_t)material.mbRandomDiffuse);
+    }
+    writer.write(convertedOBJ.mMinPosition);
+    writer.write(convertedOBJ.mMaxPosition);
+}
+
+/*
+**
+*/
+bool readConvertedOBJ(
+    ConvertedOBJ& convertedOBJ,
+    std::vector<char> const& acData)
+{
+    CacheReader reader = {acData};
+    uint64_t iNumMeshes = 0;
+    bool bValid = reader.read(convertedOBJ.mBaseName) &&
+                  reader.read(convertedOBJ.miNumShapes) &&
+                  reader.read(convertedOBJ.maVertices) &&
+                  reader.read(iNumMeshes) && iNumMeshes <= acData.size();
+    convertedOBJ.maaiTriangleVertexIndices.resize(bValid ? iNumMeshes : 0);
+    for(auto& aiTriangleVertexIndices : convertedOBJ.maaiTriangleVertexIndices)
+    {
+        bValid = bValid && reader.read(aiTriangleVertexIndices);
+    }
+    bValid = bValid &&
+             reader.read(convertedOBJ.maMeshExtents) &&
+             reader.read(convertedOBJ.maMeshCenters) &&
+             reader.read(convertedOBJ.maMeshBBoxes) &&
+             reader.read(iNumMeshes) && iNumMeshes <= acData.size();
+    convertedOBJ.maMeshNames.resize(bValid ? iNumMeshes : 0);
+    for(auto& meshName : convertedOBJ.maMeshNames)
+    {
+        bValid = bValid && reader.read(meshName);
+    }
+    bValid = bValid && reader.read(iNumMeshes) && iNumMeshes <= acData.size();
+    convertedOBJ.maMeshMaterials.resize(bValid ? iNumMeshes : 0);
+    for(auto& material : convertedOBJ.maMeshMaterials)
+    {
+        uint32_t iRandomDiffuse = 0;
+        bValid = bValid &&
+                 reader.read(material.mDiffuse) &&
+                 reader.read(material.mSpecular) &&
+                 reader.read(material.mEmissive) &&
+                 reader.read(material.mAlbedoTexturePath) &&
+                 reader.read(material.mNormalTexturePath) &&
+                 reader.read(material.mSpecularTexturePath) &&
+                 reader.read(material.mEmissiveTexturePath) &&
+                 reader.read(iRandomDiffuse);
+        material.mbRandomDiffuse = (iRandomDiffuse != 0);
+    }
+    bValid = bValid &&
+             reader.read(convertedOBJ.mMinPosition) &&
+             reader.read(convertedOBJ.mMaxPosition);
+
+    // every mesh has its indices, extent and material
+    uint64_t iNumEntries = convertedOBJ.maaiTriangleVertexIndices.size();
+    bValid = bValid &&
+             reader.miOffset == acData.size() &&
+             convertedOBJ.maMeshExtents.size() == iNumEntries &&
+             convertedOBJ.maMeshCenters.size() == iNumEntries &&
+             convertedOBJ.maMeshBBoxes.size() == iNumEntries &&
+             convertedOBJ.maMeshMaterials.size() == iNumEntries;
+    if(!bValid)
+    {
+        DEBUG_PRINTF("!!! invalid cache entry for \"%s\", converting again !!!\n", convertedOBJ.mBaseName.c_str());
+    }
+
+    return bValid;
+}
+
+/*
+**
 */
 void outputMeshMaterialIDs(
     std::vector<uint32_t> const& aiMeshMaterialIDs,
@@ -792,6 +1488,76 @@ void outputMeshMaterialIDs(
     fclose(fp);
 }
 
+/*
+** section names are the paths the renderer loads, so a mounted bundle stands in for the loose files
+*/
+void outputBundle(
+    std::vector<std::string> const& aDiffuseTextureNames,
+    std::vector<std::string> const& aAtlasFileNames,
+    std::string const& directory,
+    std::string const& baseName,
+    bool bCompress)
+{
+    Loader::CBundleWriter bundleWriter;
+
+    auto addFile = [&](std::string const& sectionName, std::string const& fullPath, Loader::SectionType type, bool bCompressSection)
+    {
+        FILE* fp = fopen(fullPath.c_str(), "rb");
+        if(fp == nullptr)
+        {
+            DEBUG_PRINTF("!!! can't open \"%s\" for bundle, skipping !!!\n", fullPath.c_str());
+            return;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        uint64_t iFileSize = (uint64_t)ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        std::vector<char> acFileContent((size_t)iFileSize);
+        fread(acFileContent.data(), sizeof(char), acFileContent.size(), fp);
+        fclose(fp);
+
+        bundleWriter.addSection(sectionName, type, acFileContent, bCompressSection);
+    };
+
+    std::pair<char const*, Loader::SectionType> aSuffixes[] =
+    {
+        {"-triangles.bin", Loader::SectionType::Mesh},
+        {"-triangle-positions.bin", Loader::SectionType::TrianglePositions},
+        {".mat", Loader::SectionType::Materials},
+        {".mid", Loader::SectionType::MaterialIDs},
+        {"-texture-names.tex", Loader::SectionType::TextureNames},
+        {"-mesh-instances.bin", Loader::SectionType::MeshInstances},
+        {"-mesh-instance-positions.bin", Loader::SectionType::MeshInstances},
+        {"-mesh-instance-bboxes.bin", Loader::SectionType::MeshInstances},
+    };
+    for(auto const& suffix : aSuffixes)
+    {
+        std::string fileName = baseName + suffix.first;
+        addFile(fileName, directory + "/" + fileName, suffix.second, bCompress);
+    }
+
+    for(auto const& atlasFileName : aAtlasFileNames)
+    {
+        addFile(atlasFileName, directory + "/" + atlasFileName, Loader::SectionType::TextureAtlas, bCompress);
+    }
+
+    // same name mangling as the renderer, pngs are already compressed
+    for(auto const& diffuseTextureName : aDiffuseTextureNames)
+    {
+        std::string textureName = "textures/" + diffuseTextureName.substr(0, diffuseTextureName.rfind(".")) + ".png";
+        addFile(textureName, directory + "/" + textureName, Loader::SectionType::Image, false);
+    }
+
+    std::string fullPath = directory + "/" + baseName + ".bundle";
+    if(!bundleWriter.write(fullPath))
+    {
+        DEBUG_PRINTF("!!! error writing bundle \"%s\" !!!\n", fullPath.c_str());
+        return;
+    }
+
+    DEBUG_PRINTF("wrote bundle %s\n", fullPath.c_str());
+}
+
 /*
 **
 */
@@ -836,65 +1602,161 @@ void getPositionRange(
 }
 
 /*
-**
+** v2 quantizes each vertex against the extent of the mesh it belongs to, see CompactVertex
+** the index sections include the lod triangles, the mesh ranges only cover the base indices, see Loader::MeshFileHeader
 */
 void outputVerticesAndTriangles(
     std::vector<Vertex> const& aTotalVertices,
     std::vector<std::vector<uint32_t>> const& aaiTriangleVertexIndices,
     std::vector<MeshExtent> const& aMeshExtents,
+    std::vector<MeshCluster> const& aMeshClusters,
+    std::vector<MeshLOD> const& aMeshLODs,
+    std::vector<uint32_t> const& aiLODIndices,
+    std::vector<BVHNode> const& aMeshBVHNodes,
+    std::vector<uint32_t> const& aiMeshBVHPrimitives,
+    std::vector<BVHNode> const& aTriangleBVHNodes,
+    std::vector<uint32_t> const& aiTriangleBVHPrimitives,
     std::string const& directory,
-    std::string const& baseName)
+    std::string const& baseName,
+    bool bCompactVertices,
+    bool bSmallIndices)
 {
     std::string fullPath = directory + "/" + baseName + "-triangles.bin";
 
+    // a mesh's vertices are contiguous, the ones spanning less than 65536 vertices get 16 bit indices from their first vertex
     uint32_t iNumMeshes = (uint32_t)aaiTriangleVertexIndices.size();
+    std::vector<uint32_t> aiMeshBaseVertices(iNumMeshes, kiWideIndexBaseVertex);
+    for(uint32_t iMesh = 0; bSmallIndices && iMesh < iNumMeshes; iMesh++)
+    {
+        auto const& aiTriangleVertexIndices = aaiTriangleVertexIndices[iMesh];
+        if(aiTriangleVertexIndices.size() <= 0)
+        {
+            continue;
+        }
+
+        auto minMaxIndex = std::minmax_element(aiTriangleVertexIndices.begin(), aiTriangleVertexIndices.end());
+        if(*minMaxIndex.second - *minMaxIndex.first < 65536)
+        {
+            aiMeshBaseVertices[iMesh] = *minMaxIndex.first;
+        }
+    }
+
+    // base indices of all the meshes before their lods, in each list
+    std::vector<uint32_t> aiWideIndices;
+    std::vector<uint16_t> aiSmallIndices;
     std::vector<MeshRange> aMeshTriangleRanges(iNumMeshes);
-    uint32_t iCurrStart = 0;
+    std::vector<uint32_t> aiSourceMeshStarts(iNumMeshes);
+    uint32_t iSourceStart = 0;
+    auto appendIndices = [&](uint32_t iMesh, uint32_t const* aiIndices, uint32_t iNumIndices) -> uint32_t
+    {
+        uint32_t iBaseVertex = aiMeshBaseVertices[iMesh];
+        if(iBaseVertex == kiWideIndexBaseVertex)
+        {
+            aiWideIndices.insert(aiWideIndices.end(), aiIndices, aiIndices + iNumIndices);
+            return (uint32_t)aiWideIndices.size() - iNumIndices;
+        }
+
+        for(uint32_t i = 0; i < iNumIndices; i++)
+        {
+            assert(aiIndices[i] >= iBaseVertex && aiIndices[i] - iBaseVertex < 65536);
+            aiSmallIndices.push_back((uint16_t)(aiIndices[i] - iBaseVertex));
+        }
+        return (uint32_t)aiSmallIndices.size() - iNumIndices;
+    };
     for(uint32_t i = 0; i < iNumMeshes; i++)
     {
-        MeshRange range;
-        range.miStart = iCurrStart;
-        iCurrStart += (uint32_t)aaiTriangleVertexIndices[i].size();
-        range.miEnd = iCurrStart;
-        aMeshTriangleRanges[i] = range;
+        assert(aaiTriangleVertexIndices[i].size() % 3 == 0);
+        uint32_t iNumIndices = (uint32_t)aaiTriangleVertexIndices[i].size();
+        aMeshTriangleRanges[i].miStart = appendIndices(i, aaiTriangleVertexIndices[i].data(), iNumIndices);
+        aMeshTriangleRanges[i].miEnd = aMeshTriangleRanges[i].miStart + iNumIndices;
+        aiSourceMeshStarts[i] = iSourceStart;
+        iSourceStart += iNumIndices;
     }
-    uint32_t iTriangleRangeSize = (uint32_t)aMeshTriangleRanges.size() * sizeof(MeshRange);
 
-    uint32_t iNumTotalVertices = (uint32_t)aTotalVertices.size();
-    uint32_t iVertexSize = (uint32_t)sizeof(Vertex);
+    // meshlets and lods move with their mesh's indices, lod indices came after all the base ones
+    std::vector<MeshCluster> aOutputMeshClusters(aMeshClusters);
+    for(auto& cluster : aOutputMeshClusters)
+    {
+        cluster.miFirstIndex = cluster.miFirstIndex - aiSourceMeshStarts[cluster.miMesh] + aMeshTriangleRanges[cluster.miMesh].miStart;
+    }
 
-    uint32_t iNumTotalTriangles = 0;
-    for(auto const& aiTriangleVertexIndices : aaiTriangleVertexIndices)
+    assert(aiLODIndices.size() % 3 == 0);
+    std::vector<MeshLOD> aOutputMeshLODs(aMeshLODs);
+    for(auto& meshLOD : aOutputMeshLODs)
     {
-        assert(aiTriangleVertexIndices.size() % 3 == 0);
-        uint32_t iNumTriangles = (uint32_t)aiTriangleVertexIndices.size() / 3;
-        iNumTotalTriangles += iNumTriangles;
+        assert(meshLOD.miFirstIndex >= iSourceStart);
+        meshLOD.miFirstIndex = appendIndices(meshLOD.miMesh, aiLODIndices.data() + (meshLOD.miFirstIndex - iSourceStart), meshLOD.miNumIndices);
     }
 
-    uint32_t iTriangleStartOffset = iNumTotalVertices * iVertexSize + iTriangleRangeSize + sizeof(uint32_t) * 5 + iNumMeshes * sizeof(MeshExtent);
+    uint32_t iNumTotalVertices = (uint32_t)aTotalVertices.size();
+    uint32_t iVertexSize = bCompactVertices ? kiCompactVertexSize : kiLegacyVertexSize;
 
-    FILE* fp = fopen(fullPath.c_str(), "wb");
-    fwrite(&iNumMeshes, sizeof(uint32_t), 1, fp);
-    fwrite(&iNumTotalVertices, sizeof(uint32_t), 1, fp);
-    fwrite(&iNumTotalTriangles, sizeof(uint32_t), 1, fp);
-    fwrite(&iVertexSize, sizeof(uint32_t), 1, fp);
-    fwrite(&iTriangleStartOffset, sizeof(uint32_t), 1, fp);
-    fwrite(aMeshTriangleRanges.data(), sizeof(MeshRange), aMeshTriangleRanges.size(), fp);
+    uint32_t iNumSmallIndexMeshes = (uint32_t)std::count_if(aiMeshBaseVertices.begin(), aiMeshBaseVertices.end(), [](uint32_t iBaseVertex) { return iBaseVertex != kiWideIndexBaseVertex; });
+    DEBUG_PRINTF("%d of %d meshes with 16 bit indices, %d 16 bit and %d 32 bit indices\n",
+        iNumSmallIndexMeshes,
+        iNumMeshes,
+        (uint32_t)aiSmallIndices.size(),
+        (uint32_t)aiWideIndices.size());
 
-    // mesh extents
+    // ranges and extents first, the renderer encodes v1 vertices against the extents as they stream in
     assert(aMeshExtents.size() == iNumMeshes + 1);
-    fwrite(aMeshExtents.data(), sizeof(MeshExtent), iNumMeshes + 1, fp);
-
-    // vertices and triangle indices
     assert(aaiTriangleVertexIndices.size() == iNumMeshes);
-    fwrite(aTotalVertices.data(), sizeof(Vertex), aTotalVertices.size(), fp);
+    Loader::CMeshFileWriter meshFileWriter;
+    meshFileWriter.addSection(Loader::MeshSectionType::MeshRanges, aMeshTriangleRanges.data(), sizeof(MeshRange), iNumMeshes);
+    meshFileWriter.addSection(Loader::MeshSectionType::MeshExtents, aMeshExtents.data(), sizeof(MeshExtent), iNumMeshes + 1);
 
-    for(uint32_t i = 0; i < aaiTriangleVertexIndices.size(); i++)
+    std::vector<CompactVertex> aCompactVertices;
+    if(bCompactVertices)
     {
-        fwrite(aaiTriangleVertexIndices[i].data(), sizeof(uint32_t), aaiTriangleVertexIndices[i].size(), fp);
+        aCompactVertices.resize(aTotalVertices.size());
+        for(uint32_t i = 0; i < (uint32_t)aTotalVertices.size(); i++)
+        {
+            Vertex const& vertex = aTotalVertices[i];
+            uint32_t iMesh = (uint32_t)(vertex.mPosition.w + 0.5f);
+            assert(iMesh < iNumMeshes);
+            aCompactVertices[i] = encodeCompactVertex(
+                vertex.mPosition,
+                vertex.mUV,
+                vertex.mNormal,
+                aMeshExtents[iMesh].mMinPosition,
+                aMeshExtents[iMesh].mMaxPosition);
+        }
+        meshFileWriter.addSection(Loader::MeshSectionType::Vertices, aCompactVertices.data(), iVertexSize, iNumTotalVertices);
     }
+    else
+    {
+        meshFileWriter.addSection(Loader::MeshSectionType::Vertices, aTotalVertices.data(), iVertexSize, iNumTotalVertices);
+    }
+    meshFileWriter.addSection(Loader::MeshSectionType::Indices, aiWideIndices.data(), sizeof(uint32_t), (uint32_t)aiWideIndices.size());
 
-    fclose(fp);
+    // 16 bit indices, padded to whole words
+    if(aiSmallIndices.size() > 0)
+    {
+        if(aiSmallIndices.size() % 2 != 0)
+        {
+            aiSmallIndices.push_back(0);
+        }
+        meshFileWriter.addSection(Loader::MeshSectionType::SmallIndices, aiSmallIndices.data(), sizeof(uint16_t), (uint32_t)aiSmallIndices.size());
+        meshFileWriter.addSection(Loader::MeshSectionType::MeshBaseVertices, aiMeshBaseVertices.data(), sizeof(uint32_t), iNumMeshes);
+    }
+
+    // meshlets and the lod table
+    meshFileWriter.addSection(Loader::MeshSectionType::MeshClusters, aOutputMeshClusters.data(), sizeof(MeshCluster), (uint32_t)aOutputMeshClusters.size());
+    meshFileWriter.addSection(Loader::MeshSectionType::MeshLODs, aOutputMeshLODs.data(), sizeof(MeshLOD), (uint32_t)aOutputMeshLODs.size());
+
+    // bvh sections, the triangle one only when asked for
+    meshFileWriter.addSection(Loader::MeshSectionType::MeshBVHNodes, aMeshBVHNodes.data(), sizeof(BVHNode), (uint32_t)aMeshBVHNodes.size());
+    meshFileWriter.addSection(Loader::MeshSectionType::MeshBVHIndices, aiMeshBVHPrimitives.data(), sizeof(uint32_t), (uint32_t)aiMeshBVHPrimitives.size());
+    if(aTriangleBVHNodes.size() > 0)
+    {
+        meshFileWriter.addSection(Loader::MeshSectionType::TriangleBVHNodes, aTriangleBVHNodes.data(), sizeof(BVHNode), (uint32_t)aTriangleBVHNodes.size());
+        meshFileWriter.addSection(Loader::MeshSectionType::TriangleBVHIndices, aiTriangleBVHPrimitives.data(), sizeof(uint32_t), (uint32_t)aiTriangleBVHPrimitives.size());
+    }
+
+    if(!meshFileWriter.write(fullPath))
+    {
+        DEBUG_PRINTF("!!! error writing \"%s\" !!!\n", fullPath.c_str());
+    }
 
     DEBUG_PRINTF("wrote to %s num meshes: %d\n", fullPath.c_str(), (int32_t)aaiTriangleVertexIndices.size());
 }
@@ -973,13 +1835,6 @@ void test(
     std::vector<MeshExtent>& aMeshExtents,
     std::string const& fullPath)
 {
-    uint32_t iNumMeshes = 0;
-    uint32_t iNumTotalVertices = 0;
-    uint32_t iNumTotalTriangles = 0;
-    uint32_t iVertexSize = 0;
-    uint32_t iTriangleStartOffset = 0;
-
-    FILE* fp = fopen(fullPath.c_str(), "rb");
     auto directoryEnd = fullPath.find_last_of("/");
     if(directoryEnd == std::string::npos)
     {
@@ -990,38 +1845,117 @@ void test(
     auto baseNameEnd = fileName.find_last_of(".");
     std::string baseName = fileName.substr(0, baseNameEnd);
 
-    uint64_t iFileSize = (uint64_t)fseek(fp, 0, SEEK_END);
-    fseek(fp, (long)iFileSize - 8, SEEK_SET);
-    float fTest = 0.0f;
-    fread(&fTest, sizeof(float), 1, fp);
-    fseek(fp, 0, SEEK_SET);
+    std::vector<char> acFileData;
+    FILE* fp = fopen(fullPath.c_str(), "rb");
+    if(fp != nullptr)
+    {
+        fseek(fp, 0, SEEK_END);
+        acFileData.resize((size_t)ftell(fp));
+        fseek(fp, 0, SEEK_SET);
+        fread(acFileData.data(), sizeof(char), acFileData.size(), fp);
+        fclose(fp);
+    }
+
+    std::vector<Loader::MeshFileSection> aSections;
+    uint32_t iVersion = 0;
+    if(!Loader::readMeshFileSections(aSections, iVersion, acFileData.data(), acFileData.size(), acFileData.size()))
+    {
+        DEBUG_PRINTF("!!! can\'t read \"%s\" !!!\n", fullPath.c_str());
+        return;
+    }
 
-    fread(&iNumMeshes, sizeof(uint32_t), 1, fp);
-    fread(&iNumTotalVertices, sizeof(uint32_t), 1, fp);
-    fread(&iNumTotalTriangles, sizeof(uint32_t), 1, fp);
-    fread(&iVertexSize, sizeof(uint32_t), 1, fp);
-    fread(&iTriangleStartOffset, sizeof(uint32_t), 1, fp);
+    // the legacy tail is split into the sections it chains, offsets made relative to the file
+    std::vector<Loader::MeshFileSection> aLegacySections;
+    Loader::MeshFileSection const* pLegacySections = Loader::findMeshFileSection(aSections, Loader::MeshSectionType::LegacySections);
+    if(pLegacySections != nullptr)
+    {
+        Loader::readLegacyMeshSections(aLegacySections, acFileData.data() + pLegacySections->miOffset, pLegacySections->miSize);
+        for(auto& section : aLegacySections)
+        {
+            section.miOffset += pLegacySections->miOffset;
+        }
+    }
 
-    aMeshRanges.resize(iNumMeshes);
-    fread(aMeshRanges.data(), sizeof(MeshRange), iNumMeshes, fp);
+    auto getSection = [&](Loader::MeshSectionType type) -> Loader::MeshFileSection const*
+    {
+        Loader::MeshFileSection const* pSection = Loader::findMeshFileSection(aSections, type);
+        if(pSection == nullptr)
+        {
+            pSection = Loader::findMeshFileSection(aLegacySections, type);
+        }
+        if(pSection != nullptr && iVersion >= Loader::kiMeshFileVersion && !Loader::checkMeshFileSection(*pSection, acFileData.data()))
+        {
+            return nullptr;
+        }
+
+        return pSection;
+    };
+
+    auto readSection = [&](auto& aValues, Loader::MeshSectionType type)
+    {
+        Loader::MeshFileSection const* pSection = getSection(type);
+        if(pSection != nullptr)
+        {
+            aValues.resize((size_t)(pSection->miSize / sizeof(aValues[0])));
+            memcpy(aValues.data(), acFileData.data() + pSection->miOffset, (size_t)pSection->miSize);
+        }
+    };
+
+    readSection(aMeshRanges, Loader::MeshSectionType::MeshRanges);
+    uint32_t iNumMeshes = (uint32_t)aMeshRanges.size();
 
     aMeshExtents.resize(iNumMeshes + 1);            // last mesh extent is the overall mesh
-    fread(aMeshExtents.data(), sizeof(MeshExtent), iNumMeshes + 1, fp);
+    readSection(aMeshExtents, Loader::MeshSectionType::MeshExtents);
 
+    Loader::MeshFileSection const* pVertices = getSection(Loader::MeshSectionType::Vertices);
+    uint32_t iNumTotalVertices = (pVertices != nullptr) ? pVertices->miCount : 0;
     aTotalVertices.resize(iNumTotalVertices);
-    fread(aTotalVertices.data(), sizeof(Vertex), iNumTotalVertices, fp);
+    if(pVertices != nullptr && pVertices->miStride == kiCompactVertexSize)
+    {
+        CompactVertex const* pCompactVertices = (CompactVertex const*)(acFileData.data() + pVertices->miOffset);
+        for(uint32_t i = 0; i < iNumTotalVertices; i++)
+        {
+            MeshExtent const& meshExtent = aMeshExtents[std::min(pCompactVertices[i].miMeshID, iNumMeshes)];
+            decodeCompactVertex(
+                aTotalVertices[i].mPosition,
+                aTotalVertices[i].mUV,
+                aTotalVertices[i].mNormal,
+                pCompactVertices[i],
+                meshExtent.mMinPosition,
+                meshExtent.mMaxPosition);
+        }
+    }
+    else if(pVertices != nullptr)
+    {
+        memcpy(aTotalVertices.data(), acFileData.data() + pVertices->miOffset, (size_t)pVertices->miSize);
+    }
+
+    std::vector<uint32_t> aiWideIndices;
+    readSection(aiWideIndices, Loader::MeshSectionType::Indices);
+
+    std::vector<uint32_t> aiMeshBaseVertices(iNumMeshes, kiWideIndexBaseVertex);
+    std::vector<uint16_t> aiSmallIndices;
+    readSection(aiMeshBaseVertices, Loader::MeshSectionType::MeshBaseVertices);
+    readSection(aiSmallIndices, Loader::MeshSectionType::SmallIndices);
 
     for(uint32_t i = 0; i < iNumMeshes; i++)
     {
         MeshRange const& range = aMeshRanges[i];
-        uint32_t iNumTriangleIndices = range.miEnd - range.miStart;
-        std::vector<uint32_t> aiTriangles(iNumTriangleIndices);
-        fread(aiTriangles.data(), sizeof(uint32_t), iNumTriangleIndices, fp);
+        std::vector<uint32_t> aiTriangles;
+        for(uint32_t iIndex = range.miStart; iIndex < range.miEnd; iIndex++)
+        {
+            if(aiMeshBaseVertices[i] == kiWideIndexBaseVertex)
+            {
+                aiTriangles.push_back(iIndex < aiWideIndices.size() ? aiWideIndices[iIndex] : 0);
+            }
+            else
+            {
+                aiTriangles.push_back(iIndex < aiSmallIndices.size() ? aiMeshBaseVertices[i] + aiSmallIndices[iIndex] : 0);
+            }
+        }
         aaiTriangleVertexIndices.push_back(aiTriangles);
     }
 
-    fclose(fp);
-
     DEBUG_PRINTF("output verifcation obj meshes: \"%s\"\n, num meshes: %d\n", fullPath.c_str(), iNumMeshes);
 
     std::vector<uint32_t> aiMeshes;
@@ -0,0 +1,702 @@
+#include "texture_atlas.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+#include "texture_compress.h"
+
+#include <loader/atlas_file.h>
+#include <loader/mesh_file.h>
+#include <loader/page_file.h>
+#include <math/skyline_packer.h>
+#include <stb_image/stb_image.h>
+#include <utils/LogPrint.h>
+
+/*
+**
+*/
+static uint32_t roundUpToPowerOfTwo(uint32_t iValue)
+{
+    uint32_t iPowerOfTwo = 1;
+    while(iPowerOfTwo < iValue && iPowerOfTwo < (1u << 31))
+    {
+        iPowerOfTwo <<= 1;
+    }
+
+    return iPowerOfTwo;
+}
+
+/*
+**
+*/
+static uint32_t getLog2(uint32_t iValue)
+{
+    uint32_t iLog2 = 0;
+    while(iValue > 1)
+    {
+        iValue >>= 1;
+        ++iLog2;
+    }
+
+    return iLog2;
+}
+
+/*
+** 2x2 box filter, colors averaged in linear space, odd sizes repeat their last row or column
+*/
+static void downsampleLevel(
+    std::vector<uint8_t>& acDest,
+    uint32_t iDestWidth,
+    uint32_t iDestHeight,
+    std::vector<uint8_t> const& acSource,
+    uint32_t iSourceWidth,
+    uint32_t iSourceHeight)
+{
+    static float s_afSRGBToLinear[256];
+    static uint8_t s_acLinearToSRGB[4096];
+    static bool s_bTablesReady = false;
+    if(!s_bTablesReady)
+    {
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            float fValue = (float)i / 255.0f;
+            s_afSRGBToLinear[i] = (fValue <= 0.04045f) ? fValue / 12.92f : powf((fValue + 0.055f) / 1.055f, 2.4f);
+        }
+        for(uint32_t i = 0; i < 4096; i++)
+        {
+            float fValue = (float)i / 4095.0f;
+            fValue = (fValue <= 0.0031308f) ? fValue * 12.92f : 1.055f * powf(fValue, 1.0f / 2.4f) - 0.055f;
+            s_acLinearToSRGB[i] = (uint8_t)std::min(fValue * 255.0f + 0.5f, 255.0f);
+        }
+        s_bTablesReady = true;
+    }
+
+    acDest.resize((size_t)iDestWidth * iDestHeight * 4);
+    for(uint32_t iY = 0; iY < iDestHeight; iY++)
+    {
+        uint8_t const* apcRows[2] =
+        {
+            acSource.data() + (size_t)std::min(iY * 2, iSourceHeight - 1) * iSourceWidth * 4,
+            acSource.data() + (size_t)std::min(iY * 2 + 1, iSourceHeight - 1) * iSourceWidth * 4,
+        };
+        for(uint32_t iX = 0; iX < iDestWidth; iX++)
+        {
+            uint32_t aiColumns[2] = {std::min(iX * 2, iSourceWidth - 1) * 4, std::min(iX * 2 + 1, iSourceWidth - 1) * 4};
+
+            uint8_t* pcDest = acDest.data() + ((size_t)iY * iDestWidth + iX) * 4;
+            for(uint32_t iChannel = 0; iChannel < 3; iChannel++)
+            {
+                float fTotal =
+                    s_afSRGBToLinear[apcRows[0][aiColumns[0] + iChannel]] + s_afSRGBToLinear[apcRows[0][aiColumns[1] + iChannel]] +
+                    s_afSRGBToLinear[apcRows[1][aiColumns[0] + iChannel]] + s_afSRGBToLinear[apcRows[1][aiColumns[1] + iChannel]];
+                pcDest[iChannel] = s_acLinearToSRGB[(uint32_t)(fTotal * 0.25f * 4095.0f + 0.5f)];
+            }
+
+            uint32_t iAlpha = apcRows[0][aiColumns[0] + 3] + apcRows[0][aiColumns[1] + 3] + apcRows[1][aiColumns[0] + 3] + apcRows[1][aiColumns[1] + 3];
+            pcDest[3] = (uint8_t)((iAlpha + 2) / 4);
+        }
+    }
+}
+
+/*
+** header, texture table and level table, then each level at the next multiple of the alignment
+**    the level sizes only depend on the page size and the format, so the offsets are known before anything is encoded
+**    pages are written one after the other and the level table is written again once their checksums are known
+*/
+struct AtlasOutput
+{
+    Loader::AtlasFormat                 mFormat;
+    std::string                         mOutputPath;
+    FILE*                               mpFile = nullptr;
+    uint64_t                            miFilePosition = 0;
+    uint64_t                            miLevelTableOffset = 0;
+    std::vector<Loader::AtlasMipLevel>  maMipLevels;
+    double                              mfEncodeSeconds = 0.0;
+};
+
+/*
+** tiles of the virtual pages, offsets are handed out as the tiles are written since empty ones are skipped
+*/
+struct PageFileOutput
+{
+    std::string                         mOutputPath;
+    FILE*                               mpFile = nullptr;
+    uint64_t                            miFilePosition = 0;
+    Loader::PageFileHeader              mHeader = {};
+    std::vector<Loader::PageFileTile>   maTiles;
+    uint32_t                            miNumStoredTiles = 0;
+};
+
+static_assert(Loader::kiPageFileAlignment == Loader::kiAtlasFileAlignment, "page file payloads are aligned like the atlas levels");
+
+/*
+**
+*/
+template<typename Output>
+static void writeAligned(
+    Output& output,
+    void const* pData,
+    uint64_t iSize,
+    uint64_t iAlignedOffset)
+{
+    static char const s_acPadding[Loader::kiAtlasFileAlignment] = {};
+
+    assert(iAlignedOffset >= output.miFilePosition && iAlignedOffset - output.miFilePosition <= Loader::kiAtlasFileAlignment);
+    fwrite(s_acPadding, sizeof(char), (size_t)(iAlignedOffset - output.miFilePosition), output.mpFile);
+    fwrite(pData, sizeof(char), (size_t)iSize, output.mpFile);
+    output.miFilePosition = iAlignedOffset + iSize;
+}
+
+/*
+**
+*/
+static bool beginAtlasFile(
+    AtlasOutput& output,
+    Loader::AtlasFileHeader header,
+    std::vector<Loader::AtlasTextureInfo> const& aTextureInfo)
+{
+    auto alignOffset = [](uint64_t iOffset)
+    {
+        return (iOffset + Loader::kiAtlasFileAlignment - 1) & ~((uint64_t)Loader::kiAtlasFileAlignment - 1);
+    };
+
+    header.miFormat = (uint32_t)output.mFormat;
+    Loader::AtlasFormatInfo formatInfo = Loader::getAtlasFormatInfo(header.miFormat);
+
+    output.maMipLevels.resize(header.miNumPages * header.miNumMips);
+    output.miLevelTableOffset = sizeof(Loader::AtlasFileHeader) + sizeof(Loader::AtlasTextureInfo) * aTextureInfo.size();
+    uint64_t iOffset = alignOffset(output.miLevelTableOffset + sizeof(Loader::AtlasMipLevel) * output.maMipLevels.size());
+    for(uint32_t i = 0; i < (uint32_t)output.maMipLevels.size(); i++)
+    {
+        Loader::AtlasMipLevel& mipLevel = output.maMipLevels[i];
+        mipLevel = {};
+        mipLevel.miPage = i / header.miNumMips;
+        mipLevel.miLevel = i % header.miNumMips;
+        mipLevel.miWidth = std::max(header.miPageWidth >> mipLevel.miLevel, 1u);
+        mipLevel.miHeight = std::max(header.miPageHeight >> mipLevel.miLevel, 1u);
+        mipLevel.miBytesPerRow = ((mipLevel.miWidth + formatInfo.miBlockWidth - 1) / formatInfo.miBlockWidth) * formatInfo.miBlockSize;
+        mipLevel.miNumRows = (mipLevel.miHeight + formatInfo.miBlockHeight - 1) / formatInfo.miBlockHeight;
+        mipLevel.miSize = (uint64_t)mipLevel.miBytesPerRow * mipLevel.miNumRows;
+        mipLevel.miOffset = iOffset;
+        iOffset = alignOffset(iOffset + mipLevel.miSize);
+    }
+    header.miFileSize = output.maMipLevels.back().miOffset + output.maMipLevels.back().miSize;
+
+    output.mpFile = fopen(output.mOutputPath.c_str(), "wb");
+    if(output.mpFile == nullptr)
+    {
+        return false;
+    }
+
+    output.miFilePosition = 0;
+    writeAligned(output, &header, sizeof(header), 0);
+    writeAligned(output, aTextureInfo.data(), sizeof(Loader::AtlasTextureInfo) * aTextureInfo.size(), output.miFilePosition);
+    writeAligned(output, output.maMipLevels.data(), sizeof(Loader::AtlasMipLevel) * output.maMipLevels.size(), output.miFilePosition);
+
+    return (ferror(output.mpFile) == 0);
+}
+
+/*
+** the levels of one page, compressed first if the file's format is
+*/
+static void writeAtlasPage(
+    AtlasOutput& output,
+    uint32_t iPage,
+    std::vector<std::vector<uint8_t>> const& aacLevels,
+    uint32_t iNumThreads)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<uint8_t> acCompressed;
+    uint32_t iNumMips = (uint32_t)aacLevels.size();
+    for(uint32_t iLevel = 0; iLevel < iNumMips; iLevel++)
+    {
+        Loader::AtlasMipLevel& mipLevel = output.maMipLevels[iPage * iNumMips + iLevel];
+        std::vector<uint8_t> const* pacLevelData = &aacLevels[iLevel];
+        if(output.mFormat != Loader::AtlasFormat::RGBA8)
+        {
+            compressImage(
+                acCompressed,
+                aacLevels[iLevel],
+                mipLevel.miWidth,
+                mipLevel.miHeight,
+                output.mFormat,
+                iNumThreads);
+            pacLevelData = &acCompressed;
+        }
+
+        assert(pacLevelData->size() == mipLevel.miSize);
+        mipLevel.miChecksum = Loader::getMeshFileChecksum(pacLevelData->data(), mipLevel.miSize);
+        writeAligned(output, pacLevelData->data(), mipLevel.miSize, mipLevel.miOffset);
+    }
+
+    output.mfEncodeSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+/*
+** texture and level tables again, now that the pages are placed and their checksums known
+*/
+static bool endAtlasFile(
+    AtlasOutput& output,
+    std::vector<Loader::AtlasTextureInfo> const& aTextureInfo)
+{
+    bool bWriteError = (ferror(output.mpFile) != 0);
+    if(!bWriteError)
+    {
+        bWriteError = (fseek(output.mpFile, (long)sizeof(Loader::AtlasFileHeader), SEEK_SET) != 0);
+        bWriteError = bWriteError || (fwrite(aTextureInfo.data(), sizeof(Loader::AtlasTextureInfo), aTextureInfo.size(), output.mpFile) != aTextureInfo.size());
+        bWriteError = bWriteError || (fwrite(output.maMipLevels.data(), sizeof(Loader::AtlasMipLevel), output.maMipLevels.size(), output.mpFile) != output.maMipLevels.size());
+    }
+    bWriteError = (fclose(output.mpFile) != 0) || bWriteError;
+    output.mpFile = nullptr;
+
+    return !bWriteError;
+}
+
+/*
+** header and tables are written again by endPageFile
+*/
+static bool beginPageFile(
+    PageFileOutput& output,
+    Loader::AtlasFileHeader const& atlasHeader,
+    uint32_t iNumMips,
+    uint32_t iTileSize,
+    uint32_t iTileBorder,
+    std::vector<Loader::AtlasTextureInfo> const& aTextureInfo)
+{
+    Loader::PageFileHeader& header = output.mHeader;
+    header = {};
+    header.miSignature = Loader::kiPageFileSignature;
+    header.miVersion = Loader::kiPageFileVersion;
+    header.miFormat = (uint32_t)Loader::AtlasFormat::RGBA8;
+    header.miNumTextures = (uint32_t)aTextureInfo.size();
+    header.miPageWidth = atlasHeader.miPageWidth;
+    header.miPageHeight = atlasHeader.miPageHeight;
+    header.miNumPages = atlasHeader.miNumPages;
+    header.miNumMips = iNumMips;
+    header.miTileSize = iTileSize;
+    header.miTileBorder = iTileBorder;
+    header.miGutter = atlasHeader.miGutter;
+    header.miNumTiles = Loader::getPageFileFirstTile(header, header.miNumPages, 0);
+    output.maTiles.assign(header.miNumTiles, Loader::PageFileTile{});
+
+    output.mpFile = fopen(output.mOutputPath.c_str(), "wb");
+    if(output.mpFile == nullptr)
+    {
+        return false;
+    }
+
+    output.miFilePosition = 0;
+    writeAligned(output, &header, sizeof(header), 0);
+    writeAligned(output, aTextureInfo.data(), sizeof(Loader::AtlasTextureInfo) * aTextureInfo.size(), output.miFilePosition);
+    writeAligned(output, output.maTiles.data(), sizeof(Loader::PageFileTile) * output.maTiles.size(), output.miFilePosition);
+
+    return (ferror(output.mpFile) == 0);
+}
+
+/*
+** every tile of the page's levels, border texels past the edge of a level repeat its last row or column
+** tiles without a single set texel are left out, except on the last level which stays resident
+*/
+static void writePageFileTiles(
+    PageFileOutput& output,
+    uint32_t iPage,
+    std::vector<std::vector<uint8_t>> const& aacLevels)
+{
+    Loader::PageFileHeader const& header = output.mHeader;
+    uint32_t iTileWidth = header.miTileSize + header.miTileBorder * 2;
+    std::vector<uint8_t> acTile((size_t)Loader::getPageFileTileSize(header));
+    for(uint32_t iLevel = 0; iLevel < header.miNumMips; iLevel++)
+    {
+        int32_t iLevelWidth = (int32_t)std::max(header.miPageWidth >> iLevel, 1u);
+        int32_t iLevelHeight = (int32_t)std::max(header.miPageHeight >> iLevel, 1u);
+        uint8_t const* pcLevel = aacLevels[iLevel].data();
+
+        uint32_t iNumTilesX = 0, iNumTilesY = 0;
+        Loader::getPageFileLevelTiles(iNumTilesX, iNumTilesY, header, iLevel);
+        uint32_t iFirstTile = Loader::getPageFileFirstTile(header, iPage, iLevel);
+        for(uint32_t iTileY = 0; iTileY < iNumTilesY; iTileY++)
+        {
+            for(uint32_t iTileX = 0; iTileX < iNumTilesX; iTileX++)
+            {
+                bool bEmpty = true;
+                for(uint32_t iY = 0; iY < iTileWidth; iY++)
+                {
+                    int32_t iSourceY = std::clamp((int32_t)(iTileY * header.miTileSize + iY) - (int32_t)header.miTileBorder, 0, iLevelHeight - 1);
+                    uint8_t* pcDest = acTile.data() + (size_t)iY * iTileWidth * 4;
+                    for(uint32_t iX = 0; iX < iTileWidth; iX++)
+                    {
+                        int32_t iSourceX = std::clamp((int32_t)(iTileX * header.miTileSize + iX) - (int32_t)header.miTileBorder, 0, iLevelWidth - 1);
+                        uint8_t const* pcSource = pcLevel + ((size_t)iSourceY * iLevelWidth + iSourceX) * 4;
+                        memcpy(pcDest + iX * 4, pcSource, 4);
+                        bEmpty = bEmpty && (pcSource[0] | pcSource[1] | pcSource[2] | pcSource[3]) == 0;
+                    }
+                }
+
+                if(bEmpty && iLevel + 1 < header.miNumMips)
+                {
+                    continue;
+                }
+
+                uint64_t iOffset = (output.miFilePosition + Loader::kiPageFileAlignment - 1) & ~((uint64_t)Loader::kiPageFileAlignment - 1);
+                Loader::PageFileTile& tile = output.maTiles[iFirstTile + iTileY * iNumTilesX + iTileX];
+                tile.miOffset = iOffset;
+                tile.miChecksum = Loader::getMeshFileChecksum(acTile.data(), acTile.size());
+                writeAligned(output, acTile.data(), acTile.size(), iOffset);
+                ++output.miNumStoredTiles;
+            }
+        }
+    }
+}
+
+/*
+** header and tables again, now that the file size and tile offsets are known
+*/
+static bool endPageFile(
+    PageFileOutput& output,
+    std::vector<Loader::AtlasTextureInfo> const& aTextureInfo)
+{
+    output.mHeader.miFileSize = output.miFilePosition;
+
+    bool bWriteError = (ferror(output.mpFile) != 0);
+    if(!bWriteError)
+    {
+        bWriteError = (fseek(output.mpFile, 0, SEEK_SET) != 0);
+        bWriteError = bWriteError || (fwrite(&output.mHeader, sizeof(Loader::PageFileHeader), 1, output.mpFile) != 1);
+        bWriteError = bWriteError || (fwrite(aTextureInfo.data(), sizeof(Loader::AtlasTextureInfo), aTextureInfo.size(), output.mpFile) != aTextureInfo.size());
+        bWriteError = bWriteError || (fwrite(output.maTiles.data(), sizeof(Loader::PageFileTile), output.maTiles.size(), output.mpFile) != output.maTiles.size());
+    }
+    bWriteError = (fclose(output.mpFile) != 0) || bWriteError;
+    output.mpFile = nullptr;
+
+    return !bWriteError;
+}
+
+/*
+**
+*/
+bool bakeTextureAtlas(
+    std::vector<std::string>& aOutputPaths,
+    std::string const& outputPathPrefix,
+    std::vector<std::string> const& aTexturePaths,
+    TextureAtlasSettings const& settings)
+{
+    removeTextureAtlases(outputPathPrefix);
+
+    // power of two pages halve evenly down to 1x1
+    uint32_t iGutter = roundUpToPowerOfTwo(std::max(settings.miGutter, 1u));
+    uint32_t iBlockSize = iGutter * 2;
+    uint32_t iPageWidth = roundUpToPowerOfTwo(std::max(std::max(settings.miPageWidth, iBlockSize), 4u));
+    uint32_t iMaxPageHeight = std::max(roundUpToPowerOfTwo(settings.miMaxPageHeight + 1) >> 1, iBlockSize);
+
+    struct PlacedTexture
+    {
+        bool                mbPlaced = false;
+        int32_t             miWidth = 0;
+        int32_t             miHeight = 0;
+        uint32_t            miBlockWidth = 0;
+        uint32_t            miBlockHeight = 0;
+        PackedRect          mBlock = {};
+    };
+    std::vector<PlacedTexture> aPlacedTextures(aTexturePaths.size());
+
+    // sizes from the image headers, the blocks are packed tallest first so the skyline stays flat
+    std::vector<uint32_t> aiPackingOrder;
+    for(uint32_t iTexture = 0; iTexture < (uint32_t)aTexturePaths.size(); iTexture++)
+    {
+        PlacedTexture& placedTexture = aPlacedTextures[iTexture];
+        int32_t iComp = 0;
+        if(!stbi_info(aTexturePaths[iTexture].c_str(), &placedTexture.miWidth, &placedTexture.miHeight, &iComp) ||
+           placedTexture.miWidth <= 0 || placedTexture.miHeight <= 0)
+        {
+            DEBUG_PRINTF("!!! can\'t load atlas texture \"%s\" !!!\n", aTexturePaths[iTexture].c_str());
+            continue;
+        }
+
+        placedTexture.miBlockWidth = ((uint32_t)placedTexture.miWidth + iGutter * 2 + iBlockSize - 1) & ~(iBlockSize - 1);
+        placedTexture.miBlockHeight = ((uint32_t)placedTexture.miHeight + iGutter * 2 + iBlockSize - 1) & ~(iBlockSize - 1);
+        aiPackingOrder.push_back(iTexture);
+    }
+    std::stable_sort(aiPackingOrder.begin(), aiPackingOrder.end(), [&](uint32_t iLeft, uint32_t iRight)
+    {
+        PlacedTexture const& left = aPlacedTextures[iLeft];
+        PlacedTexture const& right = aPlacedTextures[iRight];
+        return (left.miBlockHeight != right.miBlockHeight) ? (left.miBlockHeight > right.miBlockHeight) : (left.miBlockWidth > right.miBlockWidth);
+    });
+
+    // the packer works in blocks, which keeps every texture aligned to them
+    CSkylinePacker packer(iPageWidth / iBlockSize, iMaxPageHeight / iBlockSize, std::max(settings.miMaxPages, 1u));
+    for(uint32_t iTexture : aiPackingOrder)
+    {
+        PlacedTexture& placedTexture = aPlacedTextures[iTexture];
+        placedTexture.mbPlaced = packer.insert(
+            placedTexture.mBlock,
+            placedTexture.miBlockWidth / iBlockSize,
+            placedTexture.miBlockHeight / iBlockSize);
+        if(!placedTexture.mbPlaced)
+        {
+            DEBUG_PRINTF("!!! atlas texture \"%s\" (%d x %d) doesn\'t fit in %d pages of %d x %d !!!\n",
+                aTexturePaths[iTexture].c_str(),
+                placedTexture.miWidth,
+                placedTexture.miHeight,
+                std::max(settings.miMaxPages, 1u),
+                iPageWidth,
+                iMaxPageHeight);
+        }
+    }
+
+    // pages are layers of one texture, a single page is trimmed to what's used, at least one 4x4 block for the compressed formats
+    uint32_t iNumPages = std::max(packer.getNumPages(), 1u);
+    uint32_t iPageHeight = iMaxPageHeight;
+    if(iNumPages == 1)
+    {
+        iPageHeight = roundUpToPowerOfTwo(std::max(std::max(packer.getUsedHeight(0) * iBlockSize, iBlockSize), 4u));
+    }
+    uint32_t iNumMips = getLog2(std::max(iPageWidth, iPageHeight)) + 1;
+
+    std::vector<Loader::AtlasTextureInfo> aTextureInfo(aTexturePaths.size());
+    for(uint32_t iTexture = 0; iTexture < (uint32_t)aPlacedTextures.size(); iTexture++)
+    {
+        aTextureInfo[iTexture].miTextureID = iTexture;
+    }
+
+    Loader::AtlasFileHeader header = {};
+    header.miSignature = Loader::kiAtlasFileSignature;
+    header.miVersion = Loader::kiAtlasFileVersion;
+    header.miNumTextures = (uint32_t)aTextureInfo.size();
+    header.miPageWidth = iPageWidth;
+    header.miPageHeight = iPageHeight;
+    header.miNumPages = iNumPages;
+    header.miNumMips = iNumMips;
+    header.miGutter = iGutter;
+
+    // uncompressed first, it's the fallback for devices without any of the compressed formats
+    std::vector<AtlasOutput> aOutputs(1);
+    aOutputs[0].mFormat = Loader::AtlasFormat::RGBA8;
+    for(auto format : settings.maCompressedFormats)
+    {
+        if(settings.mbVirtualTexture)
+        {
+            break;
+        }
+
+        bool bListed = false;
+        for(auto const& output : aOutputs)
+        {
+            bListed = bListed || (output.mFormat == format);
+        }
+        if(!bListed)
+        {
+            aOutputs.emplace_back();
+            aOutputs.back().mFormat = format;
+        }
+    }
+    for(auto& output : aOutputs)
+    {
+        output.mOutputPath = outputPathPrefix + Loader::getAtlasFileSuffix(output.mFormat);
+    }
+
+    // virtual texturing streams the tiles of the levels the textures have, so the page file replaces the atlases
+    PageFileOutput pageOutput;
+    if(settings.mbVirtualTexture)
+    {
+        aOutputs.clear();
+
+        uint32_t iTileSize = roundUpToPowerOfTwo(std::max(settings.miTileSize, 8u));
+        uint32_t iTileBorder = std::min(settings.miTileBorder, iTileSize / 2);
+        uint32_t iNumVirtualMips = std::min(iNumMips, getLog2(iBlockSize) + 1);
+        pageOutput.mOutputPath = outputPathPrefix + Loader::kszPageFileSuffix;
+        if(!beginPageFile(pageOutput, header, iNumVirtualMips, iTileSize, iTileBorder, aTextureInfo))
+        {
+            DEBUG_PRINTF("!!! error writing page file \"%s\" !!!\n", pageOutput.mOutputPath.c_str());
+            if(pageOutput.mpFile)
+            {
+                fclose(pageOutput.mpFile);
+                pageOutput.mpFile = nullptr;
+            }
+        }
+    }
+
+    // the texture table is filled in as the pages are built
+    for(auto& output : aOutputs)
+    {
+        if(!beginAtlasFile(output, header, aTextureInfo))
+        {
+            DEBUG_PRINTF("!!! error writing atlas \"%s\" !!!\n", output.mOutputPath.c_str());
+            if(output.mpFile)
+            {
+                fclose(output.mpFile);
+                output.mpFile = nullptr;
+            }
+        }
+    }
+
+    // one page with its mip chain in memory at a time
+    std::vector<std::vector<uint8_t>> aacLevels(iNumMips);
+    for(uint32_t iPage = 0; iPage < iNumPages; iPage++)
+    {
+        // largest level, the gutter around each texture repeats it like the shader wraps its coordinates
+        aacLevels[0].assign((size_t)iPageWidth * iPageHeight * 4, 0);
+        for(uint32_t iTexture = 0; iTexture < (uint32_t)aPlacedTextures.size(); iTexture++)
+        {
+            PlacedTexture& placedTexture = aPlacedTextures[iTexture];
+            Loader::AtlasTextureInfo& textureInfo = aTextureInfo[iTexture];
+            if(!placedTexture.mbPlaced || placedTexture.mBlock.miPage != iPage)
+            {
+                continue;
+            }
+
+            // decoded one at a time, only the page is kept
+            int32_t iWidth = 0, iHeight = 0, iComp = 0;
+            stbi_uc* pImageData = stbi_load(aTexturePaths[iTexture].c_str(), &iWidth, &iHeight, &iComp, 4);
+            if(pImageData == nullptr || iWidth != placedTexture.miWidth || iHeight != placedTexture.miHeight)
+            {
+                DEBUG_PRINTF("!!! can\'t load atlas texture \"%s\" !!!\n", aTexturePaths[iTexture].c_str());
+                stbi_image_free(pImageData);
+                continue;
+            }
+
+            uint32_t iBlockX = placedTexture.mBlock.miX * iBlockSize;
+            uint32_t iBlockY = placedTexture.mBlock.miY * iBlockSize;
+            for(uint32_t iY = 0; iY < placedTexture.miBlockHeight; iY++)
+            {
+                uint32_t iSourceY = (iY + (uint32_t)iHeight - (iGutter % (uint32_t)iHeight)) % (uint32_t)iHeight;
+                uint8_t* pcDest = aacLevels[0].data() + ((size_t)(iBlockY + iY) * iPageWidth + iBlockX) * 4;
+                for(uint32_t iX = 0; iX < placedTexture.miBlockWidth; iX++)
+                {
+                    uint32_t iSourceX = (iX + (uint32_t)iWidth - (iGutter % (uint32_t)iWidth)) % (uint32_t)iWidth;
+                    memcpy(pcDest + iX * 4, pImageData + ((size_t)iSourceY * iWidth + iSourceX) * 4, 4);
+                }
+            }
+            stbi_image_free(pImageData);
+
+            // a texel of the levels up to the block alignment still covers a single block
+            textureInfo.maiTextureCoord[0] = iBlockX + iGutter;
+            textureInfo.maiTextureCoord[1] = iBlockY + iGutter;
+            textureInfo.mafUV[0] = (float)textureInfo.maiTextureCoord[0] / (float)iPageWidth;
+            textureInfo.mafUV[1] = (float)textureInfo.maiTextureCoord[1] / (float)iPageHeight;
+            textureInfo.miImageWidth = iWidth;
+            textureInfo.miImageHeight = iHeight;
+            textureInfo.miNumMips = std::min(getLog2(iBlockSize), getLog2((uint32_t)std::min(iWidth, iHeight))) + 1;
+            textureInfo.miPage = iPage;
+        }
+
+        for(uint32_t iLevel = 1; iLevel < iNumMips; iLevel++)
+        {
+            downsampleLevel(
+                aacLevels[iLevel],
+                std::max(iPageWidth >> iLevel, 1u),
+                std::max(iPageHeight >> iLevel, 1u),
+                aacLevels[iLevel - 1],
+                std::max(iPageWidth >> (iLevel - 1), 1u),
+                std::max(iPageHeight >> (iLevel - 1), 1u));
+        }
+
+        for(auto& output : aOutputs)
+        {
+            if(output.mpFile)
+            {
+                writeAtlasPage(output, iPage, aacLevels, settings.miNumThreads);
+            }
+        }
+        if(pageOutput.mpFile)
+        {
+            writePageFileTiles(pageOutput, iPage, aacLevels);
+        }
+
+        DEBUG_PRINTF("atlas page %d: %d x %d texels used, %.1f%% occupancy\n",
+            iPage,
+            iPageWidth,
+            packer.getUsedHeight(iPage) * iBlockSize,
+            100.0 * (double)packer.getUsedArea(iPage) * iBlockSize * iBlockSize / ((double)iPageWidth * iPageHeight));
+    }
+
+    uint64_t iUsedArea = 0;
+    for(uint32_t iPage = 0; iPage < packer.getNumPages(); iPage++)
+    {
+        iUsedArea += packer.getUsedArea(iPage) * iBlockSize * iBlockSize;
+    }
+    DEBUG_PRINTF("atlas occupancy %.1f%% over %d pages\n",
+        100.0 * (double)iUsedArea / ((double)iPageWidth * iPageHeight * iNumPages),
+        iNumPages);
+
+    bool bWritten = true;
+    if(settings.mbVirtualTexture)
+    {
+        bWritten = (pageOutput.mpFile != nullptr) && endPageFile(pageOutput, aTextureInfo);
+        if(bWritten)
+        {
+            aOutputPaths.push_back(pageOutput.mOutputPath);
+
+            DEBUG_PRINTF("wrote %d textures into %d virtual pages of %d x %d with %d mips, %d of %d tiles of %d texels stored, %s\n",
+                (uint32_t)aTextureInfo.size(),
+                iNumPages,
+                iPageWidth,
+                iPageHeight,
+                pageOutput.mHeader.miNumMips,
+                pageOutput.miNumStoredTiles,
+                pageOutput.mHeader.miNumTiles,
+                pageOutput.mHeader.miTileSize,
+                pageOutput.mOutputPath.c_str());
+        }
+        else
+        {
+            DEBUG_PRINTF("!!! error writing page file \"%s\" !!!\n", pageOutput.mOutputPath.c_str());
+            std::error_code errorCode;
+            std::filesystem::remove(pageOutput.mOutputPath, errorCode);
+        }
+    }
+
+    for(auto& output : aOutputs)
+    {
+        if(output.mpFile == nullptr)
+        {
+            bWritten = false;
+            continue;
+        }
+
+        if(!endAtlasFile(output, aTextureInfo))
+        {
+            DEBUG_PRINTF("!!! error writing atlas \"%s\" !!!\n", output.mOutputPath.c_str());
+            std::error_code errorCode;
+            std::filesystem::remove(output.mOutputPath, errorCode);
+            bWritten = false;
+            continue;
+        }
+        aOutputPaths.push_back(output.mOutputPath);
+
+        DEBUG_PRINTF("wrote %d textures into %d atlas pages of %d x %d with %d mips, %.3f seconds encoding, %s\n",
+            (uint32_t)aTextureInfo.size(),
+            iNumPages,
+            iPageWidth,
+            iPageHeight,
+            iNumMips,
+            output.mfEncodeSeconds,
+            output.mOutputPath.c_str());
+    }
+
+    return bWritten;
+}
+
+/*
+**
+*/
+void removeTextureAtlases(std::string const& outputPathPrefix)
+{
+    Loader::AtlasFormat aFormats[] = {Loader::AtlasFormat::RGBA8, Loader::AtlasFormat::BC7, Loader::AtlasFormat::ETC2RGBA8};
+    for(auto format : aFormats)
+    {
+        std::error_code errorCode;
+        std::filesystem::remove(outputPathPrefix + Loader::getAtlasFileSuffix(format), errorCode);
+    }
+
+    std::error_code errorCode;
+    std::filesystem::remove(outputPathPrefix + Loader::kszPageFileSuffix, errorCode);
+}
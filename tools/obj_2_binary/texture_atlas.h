@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <loader/atlas_file.h>
+
+/*
+** packs the diffuse textures into atlas pages with their full mip chain, written as "-diffuse-atlas.bin", see loader/atlas_file.h
+**    textures are skyline packed tallest first into blocks aligned to twice the gutter, the gutter wraps the texture around
+**    textures that don't fit spill into another page, up to miMaxPages
+**    levels are averaged in linear space and stored back as srgb like the pngs they come from
+**    the compressed formats are encoded from the same levels into files of their own
+**    for virtual texturing the pages are cut into tiles and written as "-diffuse-pages.bin" instead, see loader/page_file.h
+*/
+struct TextureAtlasSettings
+{
+    uint32_t                            miPageWidth = 8192;
+    uint32_t                            miMaxPageHeight = 8192;
+    uint32_t                            miGutter = 16;                  // rounded up to a power of two
+    uint32_t                            miMaxPages = 16;
+    std::vector<Loader::AtlasFormat>    maCompressedFormats = {Loader::AtlasFormat::BC7, Loader::AtlasFormat::ETC2RGBA8};
+    uint32_t                            miNumThreads = 1;
+    bool                                mbVirtualTexture = false;
+    uint32_t                            miTileSize = 128;               // rounded up to a power of two
+    uint32_t                            miTileBorder = 4;
+};
+
+// aTexturePaths in texture id order, textures that can't be loaded or don't fit get an empty slot
+// one file per format at outputPathPrefix + getAtlasFileSuffix(), the paths written go into aOutputPaths
+bool bakeTextureAtlas(
+    std::vector<std::string>& aOutputPaths,
+    std::string const& outputPathPrefix,
+    std::vector<std::string> const& aTexturePaths,
+    TextureAtlasSettings const& settings);
+
+// atlases and page file of an earlier run, so the renderer doesn't pick a stale one over what was written this time
+void removeTextureAtlases(std::string const& outputPathPrefix);
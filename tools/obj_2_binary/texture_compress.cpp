@@ -0,0 +1,610 @@
+#include "texture_compress.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// interpolation weights of the 4 bit indices, out of 64
+static int32_t const s_aiBC7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// ETC1 intensity modifiers, a texel adds +a, +b, -a or -b of its half's table
+static int32_t const s_aaiETCModifiers[8][2] =
+{
+    {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183},
+};
+
+static int32_t const s_aaiEACModifiers[16][8] =
+{
+    {-3, -6, -9, -15, 2, 5, 8, 14},
+    {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12},
+    {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11},
+    {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10},
+    {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},
+    {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},
+    {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},
+    {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},
+    {-3, -5, -7, -9, 2, 4, 6, 8},
+};
+
+/*
+**
+*/
+static inline int32_t clampByte(int32_t iValue)
+{
+    return std::min(std::max(iValue, 0), 255);
+}
+
+/*
+** mode 6 endpoints are 7 bits per channel plus a shared lowest bit per endpoint
+*/
+static void quantizeBC7Endpoints(
+    int32_t (&aaiQuantized)[2][4],
+    int32_t (&aaiExpanded)[2][4],
+    float const (&aafEndpoints)[2][4],
+    uint32_t const (&aiPBits)[2])
+{
+    for(uint32_t iEndpoint = 0; iEndpoint < 2; iEndpoint++)
+    {
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            int32_t iQuantized = (int32_t)floorf((aafEndpoints[iEndpoint][iChannel] - (float)aiPBits[iEndpoint]) * 0.5f + 0.5f);
+            iQuantized = std::min(std::max(iQuantized, 0), 127);
+            aaiQuantized[iEndpoint][iChannel] = iQuantized;
+            aaiExpanded[iEndpoint][iChannel] = (iQuantized << 1) | (int32_t)aiPBits[iEndpoint];
+        }
+    }
+}
+
+/*
+** closest palette entry per texel, returns the squared error over the block
+*/
+static uint32_t fitBC7Indices(
+    uint8_t (&aiIndices)[16],
+    int32_t const (&aaiExpanded)[2][4],
+    uint8_t const* pcTexels)
+{
+    int32_t aaiPalette[16][4];
+    for(uint32_t iIndex = 0; iIndex < 16; iIndex++)
+    {
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            aaiPalette[iIndex][iChannel] =
+                ((64 - s_aiBC7Weights[iIndex]) * aaiExpanded[0][iChannel] + s_aiBC7Weights[iIndex] * aaiExpanded[1][iChannel] + 32) >> 6;
+        }
+    }
+
+    uint32_t iTotalError = 0;
+    for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+    {
+        uint8_t const* pcTexel = pcTexels + iTexel * 4;
+        uint32_t iBestError = UINT32_MAX;
+        for(uint32_t iIndex = 0; iIndex < 16; iIndex++)
+        {
+            uint32_t iError = 0;
+            for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+            {
+                int32_t iDiff = aaiPalette[iIndex][iChannel] - (int32_t)pcTexel[iChannel];
+                iError += (uint32_t)(iDiff * iDiff);
+            }
+            if(iError < iBestError)
+            {
+                iBestError = iError;
+                aiIndices[iTexel] = (uint8_t)iIndex;
+            }
+        }
+        iTotalError += iBestError;
+    }
+
+    return iTotalError;
+}
+
+/*
+**
+*/
+void encodeBC7Block(
+    uint8_t* pcBlock,
+    uint8_t const* pcTexels)
+{
+    float afMean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float afMin[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+    float afMax[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+    {
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            float fValue = (float)pcTexels[iTexel * 4 + iChannel];
+            afMean[iChannel] += fValue * (1.0f / 16.0f);
+            afMin[iChannel] = std::min(afMin[iChannel], fValue);
+            afMax[iChannel] = std::max(afMax[iChannel], fValue);
+        }
+    }
+
+    // principal axis by power iteration, starting from the bounding box diagonal
+    float aafCovariance[4][4] = {};
+    for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+    {
+        float afDiff[4];
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            afDiff[iChannel] = (float)pcTexels[iTexel * 4 + iChannel] - afMean[iChannel];
+        }
+        for(uint32_t iRow = 0; iRow < 4; iRow++)
+        {
+            for(uint32_t iColumn = 0; iColumn < 4; iColumn++)
+            {
+                aafCovariance[iRow][iColumn] += afDiff[iRow] * afDiff[iColumn];
+            }
+        }
+    }
+
+    float afAxis[4];
+    for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+    {
+        afAxis[iChannel] = afMax[iChannel] - afMin[iChannel];
+    }
+    for(uint32_t iIteration = 0; iIteration < 8; iIteration++)
+    {
+        float afNext[4] = {};
+        float fLargest = 0.0f;
+        for(uint32_t iRow = 0; iRow < 4; iRow++)
+        {
+            for(uint32_t iColumn = 0; iColumn < 4; iColumn++)
+            {
+                afNext[iRow] += aafCovariance[iRow][iColumn] * afAxis[iColumn];
+            }
+            fLargest = std::max(fLargest, fabsf(afNext[iRow]));
+        }
+        if(fLargest < 1.0e-6f)
+        {
+            break;
+        }
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            afAxis[iChannel] = afNext[iChannel] / fLargest;
+        }
+    }
+
+    float fAxisLength = sqrtf(afAxis[0] * afAxis[0] + afAxis[1] * afAxis[1] + afAxis[2] * afAxis[2] + afAxis[3] * afAxis[3]);
+    float fMinProjection = 0.0f, fMaxProjection = 0.0f;
+    if(fAxisLength > 1.0e-6f)
+    {
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            afAxis[iChannel] /= fAxisLength;
+        }
+        fMinProjection = FLT_MAX;
+        fMaxProjection = -FLT_MAX;
+        for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+        {
+            float fProjection = 0.0f;
+            for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+            {
+                fProjection += ((float)pcTexels[iTexel * 4 + iChannel] - afMean[iChannel]) * afAxis[iChannel];
+            }
+            fMinProjection = std::min(fMinProjection, fProjection);
+            fMaxProjection = std::max(fMaxProjection, fProjection);
+        }
+    }
+
+    float aafEndpoints[2][4];
+    for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+    {
+        aafEndpoints[0][iChannel] = std::min(std::max(afMean[iChannel] + afAxis[iChannel] * fMinProjection, 0.0f), 255.0f);
+        aafEndpoints[1][iChannel] = std::min(std::max(afMean[iChannel] + afAxis[iChannel] * fMaxProjection, 0.0f), 255.0f);
+    }
+
+    // every p bit pair, then once more with the endpoints refit to the chosen indices by least squares
+    uint32_t iBestError = UINT32_MAX;
+    int32_t aaiBestQuantized[2][4] = {};
+    uint32_t aiBestPBits[2] = {};
+    uint8_t aiBestIndices[16] = {};
+    for(uint32_t iPass = 0; iPass < 2; iPass++)
+    {
+        for(uint32_t iPBits = 0; iPBits < 4; iPBits++)
+        {
+            uint32_t aiPBits[2] = {iPBits & 1, iPBits >> 1};
+            int32_t aaiQuantized[2][4], aaiExpanded[2][4];
+            quantizeBC7Endpoints(aaiQuantized, aaiExpanded, aafEndpoints, aiPBits);
+
+            uint8_t aiIndices[16];
+            uint32_t iError = fitBC7Indices(aiIndices, aaiExpanded, pcTexels);
+            if(iError < iBestError)
+            {
+                iBestError = iError;
+                memcpy(aaiBestQuantized, aaiQuantized, sizeof(aaiQuantized));
+                memcpy(aiBestPBits, aiPBits, sizeof(aiPBits));
+                memcpy(aiBestIndices, aiIndices, sizeof(aiIndices));
+            }
+        }
+
+        if(iPass > 0 || iBestError == 0)
+        {
+            break;
+        }
+
+        float fAA = 0.0f, fAB = 0.0f, fBB = 0.0f;
+        float afAX[4] = {}, afBX[4] = {};
+        for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+        {
+            float fB = (float)s_aiBC7Weights[aiBestIndices[iTexel]] / 64.0f;
+            float fA = 1.0f - fB;
+            fAA += fA * fA;
+            fAB += fA * fB;
+            fBB += fB * fB;
+            for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+            {
+                afAX[iChannel] += fA * (float)pcTexels[iTexel * 4 + iChannel];
+                afBX[iChannel] += fB * (float)pcTexels[iTexel * 4 + iChannel];
+            }
+        }
+        float fDeterminant = fAA * fBB - fAB * fAB;
+        if(fabsf(fDeterminant) < 1.0e-6f)
+        {
+            break;
+        }
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            aafEndpoints[0][iChannel] = std::min(std::max((fBB * afAX[iChannel] - fAB * afBX[iChannel]) / fDeterminant, 0.0f), 255.0f);
+            aafEndpoints[1][iChannel] = std::min(std::max((fAA * afBX[iChannel] - fAB * afAX[iChannel]) / fDeterminant, 0.0f), 255.0f);
+        }
+    }
+
+    // the first texel's index has no top bit, endpoints are swapped when it would need one
+    if(aiBestIndices[0] & 8)
+    {
+        for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+        {
+            std::swap(aaiBestQuantized[0][iChannel], aaiBestQuantized[1][iChannel]);
+        }
+        std::swap(aiBestPBits[0], aiBestPBits[1]);
+        for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+        {
+            aiBestIndices[iTexel] = 15 - aiBestIndices[iTexel];
+        }
+    }
+
+    memset(pcBlock, 0, 16);
+    uint32_t iBit = 0;
+    auto writeBits = [&](uint32_t iValue, uint32_t iNumBits)
+    {
+        for(uint32_t i = 0; i < iNumBits; i++, iBit++)
+        {
+            pcBlock[iBit >> 3] |= (uint8_t)(((iValue >> i) & 1) << (iBit & 7));
+        }
+    };
+
+    writeBits(1 << 6, 7);
+    for(uint32_t iChannel = 0; iChannel < 4; iChannel++)
+    {
+        writeBits((uint32_t)aaiBestQuantized[0][iChannel], 7);
+        writeBits((uint32_t)aaiBestQuantized[1][iChannel], 7);
+    }
+    writeBits(aiBestPBits[0], 1);
+    writeBits(aiBestPBits[1], 1);
+    writeBits(aiBestIndices[0], 3);
+    for(uint32_t iTexel = 1; iTexel < 16; iTexel++)
+    {
+        writeBits(aiBestIndices[iTexel], 4);
+    }
+    assert(iBit == 128);
+}
+
+/*
+** best modifier table for the 8 texels of one half around its base color, codes are in ETC's order of +a, +b, -a, -b
+*/
+static uint32_t fitETCHalf(
+    uint32_t& iBestTable,
+    uint32_t (&aiCodes)[16],
+    int32_t const (&aiBase)[3],
+    uint8_t const* pcTexels,
+    uint32_t const (&aiTexels)[8])
+{
+    uint32_t iBestError = UINT32_MAX;
+    for(uint32_t iTable = 0; iTable < 8; iTable++)
+    {
+        int32_t aiModifiers[4] =
+        {
+            s_aaiETCModifiers[iTable][0], s_aaiETCModifiers[iTable][1], -s_aaiETCModifiers[iTable][0], -s_aaiETCModifiers[iTable][1],
+        };
+
+        uint32_t iTableError = 0;
+        uint32_t aiTableCodes[8];
+        for(uint32_t i = 0; i < 8 && iTableError < iBestError; i++)
+        {
+            uint8_t const* pcTexel = pcTexels + aiTexels[i] * 4;
+            uint32_t iBestTexelError = UINT32_MAX;
+            for(uint32_t iCode = 0; iCode < 4; iCode++)
+            {
+                uint32_t iError = 0;
+                for(uint32_t iChannel = 0; iChannel < 3; iChannel++)
+                {
+                    int32_t iDiff = clampByte(aiBase[iChannel] + aiModifiers[iCode]) - (int32_t)pcTexel[iChannel];
+                    iError += (uint32_t)(iDiff * iDiff);
+                }
+                if(iError < iBestTexelError)
+                {
+                    iBestTexelError = iError;
+                    aiTableCodes[i] = iCode;
+                }
+            }
+            iTableError += iBestTexelError;
+        }
+
+        if(iTableError < iBestError)
+        {
+            iBestError = iTableError;
+            iBestTable = iTable;
+            for(uint32_t i = 0; i < 8; i++)
+            {
+                aiCodes[aiTexels[i]] = aiTableCodes[i];
+            }
+        }
+    }
+
+    return iBestError;
+}
+
+/*
+** 8 byte EAC block, base, multiplier and table with a 3 bit index per texel
+*/
+static void encodeEACAlphaBlock(
+    uint8_t* pcBlock,
+    uint8_t const* pcTexels)
+{
+    int32_t iMin = 255, iMax = 0;
+    for(uint32_t iTexel = 0; iTexel < 16; iTexel++)
+    {
+        iMin = std::min(iMin, (int32_t)pcTexels[iTexel * 4 + 3]);
+        iMax = std::max(iMax, (int32_t)pcTexels[iTexel * 4 + 3]);
+    }
+
+    // flat blocks are exact with table 13's zero modifier
+    uint32_t iBestBase = (uint32_t)iMin, iBestMultiplier = 1, iBestTable = 13;
+    uint32_t aiBestIndices[16];
+    std::fill(aiBestIndices, aiBestIndices + 16, 4u);
+    if(iMin != iMax)
+    {
+        uint32_t iBestError = UINT32_MAX;
+        for(uint32_t iTable = 0; iTable < 16 && iBestError > 0; iTable++)
+        {
+            int32_t iTableMin = s_aaiEACModifiers[iTable][3];
+            int32_t iTableMax = s_aaiEACModifiers[iTable][7];
+            int32_t iMultiplier = (int32_t)floorf((float)(iMax - iMin) / (float)(iTableMax - iTableMin) + 0.5f);
+            for(int32_t iTry = std::max(iMultiplier - 1, 1); iTry <= std::min(iMultiplier + 1, 15); iTry++)
+            {
+                int32_t iBase = clampByte((int32_t)floorf((float)(iMax + iMin) * 0.5f - (float)((iTableMax + iTableMin) * iTry) * 0.5f + 0.5f));
+
+                uint32_t iError = 0;
+                uint32_t aiIndices[16];
+                for(uint32_t iTexel = 0; iTexel < 16 && iError < iBestError; iTexel++)
+                {
+                    int32_t iAlpha = (int32_t)pcTexels[iTexel * 4 + 3];
+                    uint32_t iBestTexelError = UINT32_MAX;
+                    for(uint32_t iIndex = 0; iIndex < 8; iIndex++)
+                    {
+                        int32_t iDiff = clampByte(iBase + s_aaiEACModifiers[iTable][iIndex] * iTry) - iAlpha;
+                        if((uint32_t)(iDiff * iDiff) < iBestTexelError)
+                        {
+                            iBestTexelError = (uint32_t)(iDiff * iDiff);
+                            aiIndices[iTexel] = iIndex;
+                        }
+                    }
+                    iError += iBestTexelError;
+                }
+
+                if(iError < iBestError)
+                {
+                    iBestError = iError;
+                    iBestBase = (uint32_t)iBase;
+                    iBestMultiplier = (uint32_t)iTry;
+                    iBestTable = iTable;
+                    memcpy(aiBestIndices, aiIndices, sizeof(aiIndices));
+                }
+            }
+        }
+    }
+
+    // indices go column by column, most significant bits first
+    uint64_t iIndexBits = 0;
+    for(uint32_t iX = 0; iX < 4; iX++)
+    {
+        for(uint32_t iY = 0; iY < 4; iY++)
+        {
+            iIndexBits |= (uint64_t)aiBestIndices[iY * 4 + iX] << (45 - 3 * (iX * 4 + iY));
+        }
+    }
+
+    pcBlock[0] = (uint8_t)iBestBase;
+    pcBlock[1] = (uint8_t)((iBestMultiplier << 4) | iBestTable);
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        pcBlock[2 + i] = (uint8_t)(iIndexBits >> (40 - 8 * i));
+    }
+}
+
+/*
+** color half only uses the ETC1 modes, differential mode is picked only when the second color stays in range so
+** ETC2 decoders never read it as one of their own modes
+*/
+void encodeETC2Block(
+    uint8_t* pcBlock,
+    uint8_t const* pcTexels)
+{
+    encodeEACAlphaBlock(pcBlock, pcTexels);
+
+    uint32_t iBestError = UINT32_MAX;
+    uint64_t iBestWord = 0;
+    for(uint32_t iFlip = 0; iFlip < 2; iFlip++)
+    {
+        // side by side 2x4 halves without flip, 4x2 halves on top of each other with it
+        uint32_t aaiHalves[2][8];
+        uint32_t aiNumTexels[2] = {0, 0};
+        float aafAverage[2][3] = {};
+        for(uint32_t iY = 0; iY < 4; iY++)
+        {
+            for(uint32_t iX = 0; iX < 4; iX++)
+            {
+                uint32_t iHalf = (iFlip == 0) ? (iX >> 1) : (iY >> 1);
+                aaiHalves[iHalf][aiNumTexels[iHalf]++] = iY * 4 + iX;
+                for(uint32_t iChannel = 0; iChannel < 3; iChannel++)
+                {
+                    aafAverage[iHalf][iChannel] += (float)pcTexels[(iY * 4 + iX) * 4 + iChannel] * 0.125f;
+                }
+            }
+        }
+
+        for(uint32_t iDifferential = 0; iDifferential < 2; iDifferential++)
+        {
+            int32_t aaiQuantized[2][3];
+            int32_t aaiBase[2][3];
+            bool bValid = true;
+            for(uint32_t iHalf = 0; iHalf < 2; iHalf++)
+            {
+                for(uint32_t iChannel = 0; iChannel < 3; iChannel++)
+                {
+                    if(iDifferential)
+                    {
+                        aaiQuantized[iHalf][iChannel] = (int32_t)floorf(aafAverage[iHalf][iChannel] * 31.0f / 255.0f + 0.5f);
+                        aaiBase[iHalf][iChannel] = (aaiQuantized[iHalf][iChannel] << 3) | (aaiQuantized[iHalf][iChannel] >> 2);
+                    }
+                    else
+                    {
+                        aaiQuantized[iHalf][iChannel] = (int32_t)floorf(aafAverage[iHalf][iChannel] * 15.0f / 255.0f + 0.5f);
+                        aaiBase[iHalf][iChannel] = aaiQuantized[iHalf][iChannel] * 17;
+                    }
+                }
+            }
+            for(uint32_t iChannel = 0; iChannel < 3 && iDifferential; iChannel++)
+            {
+                int32_t iDelta = aaiQuantized[1][iChannel] - aaiQuantized[0][iChannel];
+                bValid = bValid && (iDelta >= -4 && iDelta <= 3);
+            }
+            if(!bValid)
+            {
+                continue;
+            }
+
+            uint32_t aiTables[2] = {};
+            uint32_t aiCodes[16] = {};
+            uint32_t iError = fitETCHalf(aiTables[0], aiCodes, aaiBase[0], pcTexels, aaiHalves[0]);
+            iError += fitETCHalf(aiTables[1], aiCodes, aaiBase[1], pcTexels, aaiHalves[1]);
+            if(iError >= iBestError)
+            {
+                continue;
+            }
+            iBestError = iError;
+
+            uint64_t iWord = 0;
+            for(uint32_t iChannel = 0; iChannel < 3; iChannel++)
+            {
+                uint32_t iShift = 56 - iChannel * 8;
+                if(iDifferential)
+                {
+                    int32_t iDelta = aaiQuantized[1][iChannel] - aaiQuantized[0][iChannel];
+                    iWord |= (uint64_t)aaiQuantized[0][iChannel] << (iShift + 3);
+                    iWord |= (uint64_t)(iDelta & 7) << iShift;
+                }
+                else
+                {
+                    iWord |= (uint64_t)aaiQuantized[0][iChannel] << (iShift + 4);
+                    iWord |= (uint64_t)aaiQuantized[1][iChannel] << iShift;
+                }
+            }
+            iWord |= (uint64_t)aiTables[0] << 37;
+            iWord |= (uint64_t)aiTables[1] << 34;
+            iWord |= (uint64_t)iDifferential << 33;
+            iWord |= (uint64_t)iFlip << 32;
+
+            // texels go column by column, the low bit of each code in the low half of the word
+            for(uint32_t iX = 0; iX < 4; iX++)
+            {
+                for(uint32_t iY = 0; iY < 4; iY++)
+                {
+                    uint32_t iCode = aiCodes[iY * 4 + iX];
+                    uint32_t iPosition = iX * 4 + iY;
+                    iWord |= (uint64_t)(iCode >> 1) << (16 + iPosition);
+                    iWord |= (uint64_t)(iCode & 1) << iPosition;
+                }
+            }
+            iBestWord = iWord;
+        }
+    }
+
+    for(uint32_t i = 0; i < 8; i++)
+    {
+        pcBlock[8 + i] = (uint8_t)(iBestWord >> (56 - 8 * i));
+    }
+}
+
+/*
+**
+*/
+void compressImage(
+    std::vector<uint8_t>& acBlocks,
+    std::vector<uint8_t> const& acTexels,
+    uint32_t iWidth,
+    uint32_t iHeight,
+    Loader::AtlasFormat format,
+    uint32_t iNumThreads)
+{
+    assert(format == Loader::AtlasFormat::BC7 || format == Loader::AtlasFormat::ETC2RGBA8);
+
+    uint32_t iNumBlocksX = (iWidth + 3) / 4;
+    uint32_t iNumBlocksY = (iHeight + 3) / 4;
+    acBlocks.resize((size_t)iNumBlocksX * iNumBlocksY * 16);
+
+    std::atomic<uint32_t> iNextBlockRow = 0;
+    auto compressBlockRows = [&]()
+    {
+        uint8_t acBlockTexels[16 * 4];
+        for(uint32_t iBlockY = iNextBlockRow++; iBlockY < iNumBlocksY; iBlockY = iNextBlockRow++)
+        {
+            for(uint32_t iBlockX = 0; iBlockX < iNumBlocksX; iBlockX++)
+            {
+                for(uint32_t iY = 0; iY < 4; iY++)
+                {
+                    uint32_t iTexelY = std::min(iBlockY * 4 + iY, iHeight - 1);
+                    for(uint32_t iX = 0; iX < 4; iX++)
+                    {
+                        uint32_t iTexelX = std::min(iBlockX * 4 + iX, iWidth - 1);
+                        memcpy(acBlockTexels + (iY * 4 + iX) * 4, acTexels.data() + ((size_t)iTexelY * iWidth + iTexelX) * 4, 4);
+                    }
+                }
+
+                uint8_t* pcBlock = acBlocks.data() + ((size_t)iBlockY * iNumBlocksX + iBlockX) * 16;
+                if(format == Loader::AtlasFormat::BC7)
+                {
+                    encodeBC7Block(pcBlock, acBlockTexels);
+                }
+                else
+                {
+                    encodeETC2Block(pcBlock, acBlockTexels);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> aThreads;
+    uint32_t iNumWorkers = std::min(std::max(iNumThreads, 1u), iNumBlocksY);
+    for(uint32_t iThread = 1; iThread < iNumWorkers; iThread++)
+    {
+        aThreads.emplace_back(compressBlockRows);
+    }
+    compressBlockRows();
+    for(auto& thread : aThreads)
+    {
+        thread.join();
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <loader/atlas_file.h>
+
+/*
+** cpu block compression for the atlas levels, 4x4 texel blocks of 16 bytes
+**    BC7 uses mode 6 only, one rgba line per block with 4 bit indices, endpoints along the block's principal axis refit once
+**    ETC2 RGBA8 is EAC alpha followed by an ETC1 compatible color block, individual or differential, the best table per half
+*/
+
+// pcTexels are 16 rgba8 texels, row by row
+void encodeBC7Block(
+    uint8_t* pcBlock,
+    uint8_t const* pcTexels);
+
+void encodeETC2Block(
+    uint8_t* pcBlock,
+    uint8_t const* pcTexels);
+
+// block rows are spread over the threads, texels past the right and bottom edges repeat the last column and row
+void compressImage(
+    std::vector<uint8_t>& acBlocks,
+    std::vector<uint8_t> const& acTexels,
+    uint32_t iWidth,
+    uint32_t iHeight,
+    Loader::AtlasFormat format,
+    uint32_t iNumThreads);
@@ -0,0 +1,145 @@
+#include "vertex_weld.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+/*
+**
+*/
+bool CVertexWelder::Key::operator == (Key const& key) const
+{
+    return memcmp(this, &key, sizeof(Key)) == 0;
+}
+
+/*
+**
+*/
+void CVertexWelder::setTolerance(WeldTolerance const& tolerance)
+{
+    assert(miNumEntries == 0);
+
+    mTolerance = tolerance;
+    mfInvPosition = 1.0f / mTolerance.mfPosition;
+    mfInvNormal = 1.0f / mTolerance.mfNormal;
+    mfInvUV = 1.0f / mTolerance.mfUV;
+}
+
+/*
+**
+*/
+void CVertexWelder::reserve(uint32_t iNumVertices)
+{
+    // keep the load factor under one half
+    uint32_t iCapacity = 16;
+    while(iCapacity < iNumVertices * 2)
+    {
+        iCapacity <<= 1;
+    }
+
+    if(iCapacity > (uint32_t)maEntries.size())
+    {
+        grow(iCapacity);
+    }
+}
+
+/*
+** FNV-1a over 64 bit words instead of bytes, followed by a final mix since only the low bits pick the slot
+*/
+uint64_t CVertexWelder::hash(Key const& key)
+{
+    static_assert(sizeof(Key) % sizeof(uint64_t) == 0, "key is hashed as whole words");
+
+    uint64_t aiWords[sizeof(Key) / sizeof(uint64_t)];
+    memcpy(aiWords, &key, sizeof(Key));
+
+    uint64_t iHash = 0xcbf29ce484222325ull;
+    for(uint64_t iWord : aiWords)
+    {
+        iHash ^= iWord;
+        iHash *= 0x100000001b3ull;
+    }
+
+    iHash ^= iHash >> 33;
+    iHash *= 0xff51afd7ed558ccdull;
+    iHash ^= iHash >> 33;
+
+    return iHash;
+}
+
+/*
+**
+*/
+void CVertexWelder::grow(uint32_t iNewCapacity)
+{
+    std::vector<Entry> aOldEntries;
+    aOldEntries.swap(maEntries);
+    maEntries.resize(iNewCapacity);
+
+    uint64_t iMask = (uint64_t)iNewCapacity - 1;
+    for(auto const& entry : aOldEntries)
+    {
+        if(entry.miVertexIndex == UINT32_MAX)
+        {
+            continue;
+        }
+
+        uint64_t iSlot = hash(entry.mKey) & iMask;
+        while(maEntries[iSlot].miVertexIndex != UINT32_MAX)
+        {
+            iSlot = (iSlot + 1) & iMask;
+        }
+        maEntries[iSlot] = entry;
+    }
+}
+
+/*
+**
+*/
+uint32_t CVertexWelder::findOrAdd(
+    float const* afPosition,
+    float const* afNormal,
+    float const* afUV,
+    uint32_t iMeshID,
+    uint32_t iNewIndex,
+    bool& bAdded)
+{
+    assert(iNewIndex != UINT32_MAX);
+
+    if((miNumEntries + 1) * 2 > (uint32_t)maEntries.size())
+    {
+        grow((maEntries.size() > 0) ? (uint32_t)maEntries.size() * 2 : 1024);
+    }
+
+    // zeroed so padding doesn't take part in the hash and compare
+    Key key;
+    memset(&key, 0, sizeof(Key));
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        key.maiPosition[i] = (int64_t)floor((double)afPosition[i] * (double)mfInvPosition + 0.5);
+        key.maiNormal[i] = (int32_t)floorf(afNormal[i] * mfInvNormal + 0.5f);
+    }
+    key.maiUV[0] = (int64_t)floor((double)afUV[0] * (double)mfInvUV + 0.5);
+    key.maiUV[1] = (int64_t)floor((double)afUV[1] * (double)mfInvUV + 0.5);
+    key.miMeshID = iMeshID;
+
+    uint64_t iMask = (uint64_t)maEntries.size() - 1;
+    uint64_t iSlot = hash(key) & iMask;
+    while(maEntries[iSlot].miVertexIndex != UINT32_MAX)
+    {
+        if(maEntries[iSlot].mKey == key)
+        {
+            bAdded = false;
+            return maEntries[iSlot].miVertexIndex;
+        }
+
+        iSlot = (iSlot + 1) & iMask;
+    }
+
+    maEntries[iSlot].mKey = key;
+    maEntries[iSlot].miVertexIndex = iNewIndex;
+    ++miNumEntries;
+
+    bAdded = true;
+    return iNewIndex;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+** tolerances the attributes are quantized with before comparing, values closer than this usually map to the same key
+*/
+struct WeldTolerance
+{
+    float               mfPosition = 1.0e-5f;
+    float               mfNormal = 1.0e-4f;
+    float               mfUV = 1.0e-5f;
+};
+
+/*
+** open-addressing hash table from quantized vertex attributes to vertex index, linear probing with power of two capacity
+*/
+class CVertexWelder
+{
+public:
+    CVertexWelder() = default;
+    virtual ~CVertexWelder() = default;
+
+    void setTolerance(WeldTolerance const& tolerance);
+
+    // expected number of unique vertices, avoids rehashing while adding
+    void reserve(uint32_t iNumVertices);
+
+    // index of a previously added vertex with the same key, or iNewIndex after adding it
+    uint32_t findOrAdd(
+        float const* afPosition,
+        float const* afNormal,
+        float const* afUV,
+        uint32_t iMeshID,
+        uint32_t iNewIndex,
+        bool& bAdded);
+
+    inline uint32_t getNumVertices() const { return miNumEntries; }
+
+protected:
+    struct Key
+    {
+        int64_t         maiPosition[3];
+        int32_t         maiNormal[3];
+        int64_t         maiUV[2];       // tiled uvs run well past what fits in 32 bits at the weld tolerance
+        uint32_t        miMeshID;
+
+        bool operator == (Key const& key) const;
+    };
+
+    struct Entry
+    {
+        Key             mKey;
+        uint32_t        miVertexIndex = UINT32_MAX;
+    };
+
+    static uint64_t hash(Key const& key);
+    void grow(uint32_t iNewCapacity);
+
+protected:
+    WeldTolerance               mTolerance;
+    float                       mfInvPosition = 1.0f / 1.0e-5f;
+    float                       mfInvNormal = 1.0f / 1.0e-4f;
+    float                       mfInvUV = 1.0f / 1.0e-5f;
+
+    std::vector<Entry>          maEntries;
+    uint32_t                    miNumEntries = 0;
+};